@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------
+// File: AlignedAlloc.h
+//
+// Aligned heap blocks for SIMD data.  new only promises 8 byte alignment on
+// 32-bit Windows, which is not enough for aligned SSE loads.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+
+// Alignment must be a power of two.  Free with AlignedFree.
+inline void* AlignedAlloc(size_t bytes, size_t alignment)
+{
+#if defined(_MSC_VER)
+	return _aligned_malloc(bytes, alignment);
+#else
+	void* p = nullptr;
+	if (alignment < sizeof(void*))
+		alignment = sizeof(void*);
+	if (posix_memalign(&p, alignment, bytes) != 0)
+		return nullptr;
+	return p;
+#endif
+}
+
+inline void AlignedFree(void* p)
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
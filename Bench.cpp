@@ -0,0 +1,329 @@
+//--------------------------------------------------------------------------------------
+// File: Bench.cpp
+//
+// Sampling, outlier rejection, pinning, and output for the benchmark harness.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Timing.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+
+BenchOptions DefaultBenchOptions()
+{
+	BenchOptions options;
+	options.WarmupMs = 200;
+	options.Samples = 31;
+	options.TargetSampleNs = 2000000;
+	options.Cpu = 0;
+	options.OutlierThreshold = 3.5;
+	options.MaxObjects = 1000000;
+	return options;
+}
+
+
+#if defined(_MSC_VER)
+static volatile const void* s_Sink;
+
+void BenchSink(const void* p)
+{
+	s_Sink = p;
+}
+#endif
+
+
+bool BenchPinThread(int cpu)
+{
+#if defined(_WIN32)
+	if (cpu < 0)
+	{
+		DWORD_PTR process, system;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system))
+			return false;
+		return SetThreadAffinityMask(GetCurrentThread(), process) != 0;
+	}
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8))
+		return false;
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (cpu < 0)
+	{
+		for (int i = 0; i < CPU_SETSIZE; i++)
+			CPU_SET(i, &set);
+	}
+	else
+	{
+		CPU_SET(cpu, &set);
+	}
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+uint64_t BenchResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#else
+	FILE* f = fopen("/proc/self/statm", "rb");
+	if (!f)
+		return 0;
+	unsigned long long pages = 0;
+	unsigned long long resident = 0;
+	int fields = fscanf(f, "%llu %llu", &pages, &resident);
+	fclose(f);
+	if (fields != 2)
+		return 0;
+	return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// BenchRunner
+//--------------------------------------------------------------------------------------
+BenchRunner::BenchRunner(const BenchOptions& options)
+	: m_Options(options)
+{
+	if (m_Options.Samples < 3)
+		m_Options.Samples = 3;
+	if (m_Options.Cpu < 0 || !BenchPinThread(m_Options.Cpu))
+		m_Options.Cpu = -1;
+}
+
+bool BenchRunner::Enabled(const char* suite, const char* name) const
+{
+	if (m_Options.Filter.empty())
+		return true;
+	std::string full = std::string(suite) + "/" + name;
+	return full.find(m_Options.Filter) != std::string::npos;
+}
+
+static uint64_t TimeIterations(BenchFunction function, void* pContext, uint64_t iterations)
+{
+	uint64_t start = GetTimeNs();
+	function(pContext, iterations);
+	return GetTimeNs() - start;
+}
+
+static double Median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	return (n % 2) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+//--------------------------------------------------------------------------------------
+// Warmup doubles the iteration count until one sample is long enough to time
+// reliably, then keeps running at that count until the warmup time is used.
+//--------------------------------------------------------------------------------------
+BenchResult* BenchRunner::Run(const char* suite, const char* name, const char* variant,
+	BenchFunction function, void* pContext, double itemsPerOp)
+{
+	if (!Enabled(suite, name))
+		return nullptr;
+
+	uint64_t iterations = 1;
+	uint64_t warmupEnd = GetTimeNs() + (uint64_t)m_Options.WarmupMs * 1000000ull;
+	for (;;)
+	{
+		uint64_t ns = TimeIterations(function, pContext, iterations);
+		if (ns < m_Options.TargetSampleNs && iterations < (1ull << 40))
+		{
+			// Jump most of the way there once the timing means something.
+			if (ns > 10000)
+				iterations = std::max(iterations * 2, (uint64_t)((double)iterations * (double)m_Options.TargetSampleNs / (double)ns));
+			else
+				iterations *= 2;
+			continue;
+		}
+		if (GetTimeNs() >= warmupEnd)
+			break;
+	}
+
+	std::vector<double> perOp;
+	perOp.reserve(m_Options.Samples);
+	for (uint32_t i = 0; i < m_Options.Samples; i++)
+		perOp.push_back((double)TimeIterations(function, pContext, iterations) / (double)iterations);
+
+	// Median absolute deviation, scaled to match a standard deviation for normal data.
+	double median = Median(perOp);
+	std::vector<double> deviations;
+	for (size_t i = 0; i < perOp.size(); i++)
+		deviations.push_back(fabs(perOp[i] - median));
+	double mad = 1.4826 * Median(deviations);
+
+	std::vector<double> kept;
+	for (size_t i = 0; i < perOp.size(); i++)
+		if (mad == 0.0 || fabs(perOp[i] - median) <= m_Options.OutlierThreshold * mad)
+			kept.push_back(perOp[i]);
+
+	BenchResult result;
+	result.Suite = suite;
+	result.Name = name;
+	result.Variant = variant;
+	result.Iterations = iterations;
+	result.Samples = (uint32_t)kept.size();
+	result.Rejected = (uint32_t)(perOp.size() - kept.size());
+	result.ItemsPerOp = itemsPerOp;
+	result.MedianNs = Median(kept);
+	result.MinNs = *std::min_element(kept.begin(), kept.end());
+	result.MaxNs = *std::max_element(kept.begin(), kept.end());
+
+	double sum = 0.0;
+	for (size_t i = 0; i < kept.size(); i++)
+		sum += kept[i];
+	result.MeanNs = sum / (double)kept.size();
+	double squares = 0.0;
+	for (size_t i = 0; i < kept.size(); i++)
+		squares += (kept[i] - result.MeanNs) * (kept[i] - result.MeanNs);
+	result.StdDevNs = (kept.size() > 1) ? sqrt(squares / (double)(kept.size() - 1)) : 0.0;
+
+	m_Results.push_back(result);
+	return &m_Results.back();
+}
+
+void BenchRunner::AddCounter(const char* name, double value)
+{
+	if (!m_Results.empty())
+		m_Results.back().Counters.push_back(std::make_pair(std::string(name), value));
+}
+
+
+//--------------------------------------------------------------------------------------
+// Output
+//--------------------------------------------------------------------------------------
+void BenchRunner::PrintTable() const
+{
+	printf("%-36s %-10s %12s %10s %14s %5s\n", "benchmark", "variant", "median ns", "+/- %", "items/s", "rej");
+	for (size_t i = 0; i < m_Results.size(); i++)
+	{
+		const BenchResult& r = m_Results[i];
+		std::string full = r.Suite + "/" + r.Name;
+		double spread = (r.MedianNs > 0.0) ? 100.0 * r.StdDevNs / r.MedianNs : 0.0;
+		double rate = (r.MedianNs > 0.0) ? r.ItemsPerOp * 1e9 / r.MedianNs : 0.0;
+		printf("%-36s %-10s %12.2f %10.2f %14.4g %5u", full.c_str(), r.Variant.c_str(), r.MedianNs, spread, rate, r.Rejected);
+		for (size_t c = 0; c < r.Counters.size(); c++)
+			printf("  %s=%g", r.Counters[c].first.c_str(), r.Counters[c].second);
+		printf("\n");
+	}
+}
+
+static void WriteJsonString(FILE* f, const std::string& s)
+{
+	fputc('"', f);
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		char c = s[i];
+		if (c == '"' || c == '\\')
+			fputc('\\', f);
+		if ((unsigned char)c >= 0x20)
+			fputc(c, f);
+	}
+	fputc('"', f);
+}
+
+static const char* CompilerName()
+{
+#if defined(_MSC_VER)
+	static char name[32];
+	sprintf(name, "msvc %d", _MSC_VER);
+	return name;
+#elif defined(__clang__)
+	return "clang " __clang_version__;
+#elif defined(__GNUC__)
+	return "gcc " __VERSION__;
+#else
+	return "unknown";
+#endif
+}
+
+static const char* SimdLevel()
+{
+#if defined(__AVX2__)
+	return "avx2";
+#elif defined(__AVX__)
+	return "avx";
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return "sse2";
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	return "neon";
+#else
+	return "none";
+#endif
+}
+
+bool BenchRunner::WriteJson(const char* path) const
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+
+	fprintf(f, "{\"format\":1,\"label\":");
+	WriteJsonString(f, m_Options.Label);
+	fprintf(f, ",\"time\":%lld,\"compiler\":", (long long)time(nullptr));
+	WriteJsonString(f, CompilerName());
+	fprintf(f, ",\"simd\":\"%s\",\"xm_no_intrinsics\":%s,\"debug\":%s,\"pointer_bits\":%u,"
+		"\"hardware_threads\":%u,\"cpu\":%d,\"warmup_ms\":%u,\"samples\":%u,\"target_sample_ns\":%llu,\"outlier_mads\":%g,"
+		"\"max_objects\":%u,\n\"results\":[\n",
+		SimdLevel(),
+#if defined(_XM_NO_INTRINSICS_)
+		"true",
+#else
+		"false",
+#endif
+#if defined(_DEBUG) || !defined(NDEBUG)
+		"true",
+#else
+		"false",
+#endif
+		(unsigned)(sizeof(void*) * 8), std::thread::hardware_concurrency(), m_Options.Cpu,
+		m_Options.WarmupMs, m_Options.Samples, (unsigned long long)m_Options.TargetSampleNs, m_Options.OutlierThreshold,
+		m_Options.MaxObjects);
+
+	for (size_t i = 0; i < m_Results.size(); i++)
+	{
+		const BenchResult& r = m_Results[i];
+		fprintf(f, "%s{\"suite\":", (i > 0) ? ",\n" : "");
+		WriteJsonString(f, r.Suite);
+		fprintf(f, ",\"name\":");
+		WriteJsonString(f, r.Name);
+		fprintf(f, ",\"variant\":");
+		WriteJsonString(f, r.Variant);
+		fprintf(f, ",\"iterations\":%llu,\"samples\":%u,\"rejected\":%u,\"items_per_op\":%g,"
+			"\"median_ns\":%.3f,\"mean_ns\":%.3f,\"stddev_ns\":%.3f,\"min_ns\":%.3f,\"max_ns\":%.3f,\"items_per_sec\":%.6g",
+			(unsigned long long)r.Iterations, r.Samples, r.Rejected, r.ItemsPerOp,
+			r.MedianNs, r.MeanNs, r.StdDevNs, r.MinNs, r.MaxNs,
+			(r.MedianNs > 0.0) ? r.ItemsPerOp * 1e9 / r.MedianNs : 0.0);
+		for (size_t c = 0; c < r.Counters.size(); c++)
+		{
+			fprintf(f, ",");
+			WriteJsonString(f, r.Counters[c].first);
+			fprintf(f, ":%.6g", r.Counters[c].second);
+		}
+		fprintf(f, "}");
+	}
+
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	return true;
+}
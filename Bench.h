@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// File: Bench.h
+//
+// Microbenchmark harness shared by the benchmark suites in BenchMain.cpp.
+//
+// Each benchmark is a function that runs its body a given number of times.
+// The runner pins the thread to one CPU, warms the body up while finding an
+// iteration count that makes one sample last about TargetSampleNs, then takes
+// Samples samples.  Samples further than OutlierThreshold median absolute
+// deviations from the median are dropped, since they are interrupts and
+// context switches rather than the code.  Results print as a table and go to
+// JSON along with the build and machine details, so runs from different
+// commits can be diffed.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+struct BenchOptions
+{
+	uint32_t WarmupMs;
+	uint32_t Samples;
+	uint64_t TargetSampleNs;
+	int Cpu;						// -1 to leave the thread unpinned
+	double OutlierThreshold;		// In median absolute deviations
+	std::string Filter;				// Substring of "suite/name", empty for all
+	std::string Label;				// Free text for the JSON, a commit hash say
+	uint32_t MaxObjects;			// Largest scene the scaling suites build
+};
+
+BenchOptions DefaultBenchOptions();
+
+
+struct BenchResult
+{
+	std::string Suite;
+	std::string Name;
+	std::string Variant;			// "scalar", "sse2", "instanced", ...
+	uint64_t Iterations;			// Per sample
+	uint32_t Samples;				// Kept
+	uint32_t Rejected;
+	double ItemsPerOp;				// For the rate, objects or matrices per call
+	double MedianNs;				// Per op, and the rest
+	double MeanNs;
+	double StdDevNs;
+	double MinNs;
+	double MaxNs;
+	std::vector<std::pair<std::string, double> > Counters;	// Extra results, memory and the like
+};
+
+
+typedef void (*BenchFunction)(void* pContext, uint64_t iterations);
+
+
+class BenchRunner
+{
+public:
+	explicit BenchRunner(const BenchOptions& options);
+
+	const BenchOptions& Options() const { return m_Options; }
+
+	// Whether "suite/name" passes the filter.  Setup that is expensive should check first.
+	bool Enabled(const char* suite, const char* name) const;
+
+	// Null if filtered out.  The result stays valid until the next Run.
+	BenchResult* Run(const char* suite, const char* name, const char* variant,
+		BenchFunction function, void* pContext, double itemsPerOp = 1.0);
+
+	void AddCounter(const char* name, double value);
+
+	const std::vector<BenchResult>& Results() const { return m_Results; }
+
+	void PrintTable() const;
+	bool WriteJson(const char* path) const;
+
+private:
+	BenchOptions m_Options;
+	std::vector<BenchResult> m_Results;
+};
+
+
+// True if the thread is now on that CPU.  -1 lets it run anywhere again, which
+// threads should be started from, since they inherit the pinning.
+bool BenchPinThread(int cpu);
+
+// Bytes in use by the process, the working set on Windows and RSS elsewhere.
+uint64_t BenchResidentBytes();
+
+
+//--------------------------------------------------------------------------------------
+// Keep the compiler from deleting work whose result is unused.
+//--------------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+void BenchSink(const void* p);
+
+template <typename T>
+inline void BenchDoNotOptimize(const T& value)
+{
+	BenchSink(&value);
+	_ReadWriteBarrier();
+}
+
+inline void BenchClobberMemory()
+{
+	_ReadWriteBarrier();
+}
+#else
+template <typename T>
+inline void BenchDoNotOptimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void BenchClobberMemory()
+{
+	asm volatile("" : : : "memory");
+}
+#endif
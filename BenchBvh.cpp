@@ -0,0 +1,226 @@
+//--------------------------------------------------------------------------------------
+// File: BenchBvh.cpp
+//
+// The Bvh over scene bounds at 10k, 100k and 1M objects: how long a build and
+// a refit take, the stereo frustum cull through it against the flat SIMD cull
+// of every sphere, and picking rays from the camera.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Bvh.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "StereoCull.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kBvhCounts[] = { 10000, 100000, 1000000 };
+static const uint32_t kPickRays = 1024;
+
+struct BvhContext
+{
+	const Scene* pScene;
+	Bvh* pBvh;
+	StereoFrustum Frustum;
+	std::vector<uint32_t> Visible;
+	std::vector<float> Rays;		// Direction x, y, z per ray, all from Origin
+	float Origin[3];
+	uint32_t Result;
+	BvhQueryStats Stats;
+};
+
+void BuildBvh(void* pContext, uint64_t iterations)
+{
+	BvhContext* c = static_cast<BvhContext*>(pContext);
+	const SceneBounds& b = c->pScene->Bounds;
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->pBvh->Build(&b.CenterX[0], &b.CenterY[0], &b.CenterZ[0], &b.Radius[0], (uint32_t)c->pScene->Objects.size());
+		BenchClobberMemory();
+	}
+}
+
+void RefitBvh(void* pContext, uint64_t iterations)
+{
+	BvhContext* c = static_cast<BvhContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->pBvh->Refit();
+		BenchClobberMemory();
+	}
+}
+
+void CullFlat(void* pContext, uint64_t iterations)
+{
+	BvhContext* c = static_cast<BvhContext*>(pContext);
+	const SceneBounds& b = c->pScene->Bounds;
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Result = StereoCullSpheresSIMD(c->Frustum, &b.CenterX[0], &b.CenterY[0], &b.CenterZ[0], &b.Radius[0],
+			(uint32_t)c->pScene->Objects.size(), &c->Visible[0]);
+		BenchClobberMemory();
+	}
+}
+
+void CullBvh(void* pContext, uint64_t iterations)
+{
+	BvhContext* c = static_cast<BvhContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Result = c->pBvh->QueryFrustum(c->Frustum, &c->Visible[0], &c->Stats);
+		BenchClobberMemory();
+	}
+}
+
+void PickRays(void* pContext, uint64_t iterations)
+{
+	BvhContext* c = static_cast<BvhContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		uint32_t hits = 0;
+		for (uint32_t r = 0; r < kPickRays; r++)
+		{
+			BvhHit hit;
+			if (c->pBvh->Pick(c->Origin, &c->Rays[3 * r], 1000.0f, &hit))
+				hits++;
+		}
+		c->Result = hits;
+		BenchClobberMemory();
+	}
+}
+
+uint32_t NextRandom(uint32_t* pState)
+{
+	uint32_t x = *pState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*pState = x;
+	return x;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are objects, except for picking where they are rays.  The cull runs
+// report how many objects were visible, and the bvh one how many nodes and
+// spheres it tested, its speedup over the flat cull, and matches, 1 if both
+// found the same objects.  The flat cull is four spheres an instruction and
+// reads memory in order, so at 10k the bvh is the slower of the two, at 100k
+// about even, and only at 1M is it well ahead.  Refit reports the SAH cost after every object has moved
+// up to a unit, against a fresh build's, which is how much a refit tree has
+// worn and when to build again.
+//--------------------------------------------------------------------------------------
+void BenchBvhSuite(BenchRunner& runner)
+{
+	const SceneLayout layouts[] = { SCENE_GRID, SCENE_CLOUD };
+
+	for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++)
+	{
+		for (size_t n = 0; n < sizeof(kBvhCounts) / sizeof(kBvhCounts[0]); n++)
+		{
+			uint32_t count = kBvhCounts[n];
+			if (count > runner.Options().MaxObjects)
+				continue;
+
+			char name[64];
+			sprintf(name, "%s/%u", SceneLayoutName(layouts[l]), count);
+			if (!runner.Enabled("bvh", name))
+				continue;
+
+			Scene scene;
+			GenerateScene(layouts[l], count, 0x5EED, &scene);
+
+			Bvh bvh;
+			BvhContext c;
+			c.pScene = &scene;
+			c.pBvh = &bvh;
+			c.Visible.resize(scene.Bounds.Radius.size());
+			c.Result = 0;
+			c.Stats.NodesVisited = 0;
+			c.Stats.SpheresTested = 0;
+
+			if (runner.Run("bvh", name, "build", BuildBvh, &c, (double)count))
+			{
+				runner.AddCounter("nodes", (double)bvh.NodeCount());
+				runner.AddCounter("depth", (double)bvh.Depth());
+				runner.AddCounter("sah_cost", bvh.SahCost());
+				runner.AddCounter("bvh_bytes", (double)bvh.MemoryBytes());
+			}
+			const SceneBounds& b = scene.Bounds;
+			bvh.Build(&b.CenterX[0], &b.CenterY[0], &b.CenterZ[0], &b.Radius[0], count);
+			double builtCost = bvh.SahCost();
+
+			StereoView view = DefaultStereoView(1280.0f / 720.0f);
+			BuildStereoUnionFrustum(view.View, view.Projection, view.Separation, view.Convergence, &c.Frustum);
+
+			// The bvh visits objects in tree order, so both sets are sorted
+			// before they are compared.
+			std::vector<uint32_t> flatVisible;
+			BenchResult* pFlat = runner.Run("bvh", name, "cull-flat", CullFlat, &c, (double)count);
+			if (pFlat)
+			{
+				runner.AddCounter("visible", (double)c.Result);
+				flatVisible.assign(c.Visible.begin(), c.Visible.begin() + c.Result);
+				std::sort(flatVisible.begin(), flatVisible.end());
+			}
+			double flatNs = pFlat ? pFlat->MedianNs : 0.0;
+			BenchResult* pBvh = runner.Run("bvh", name, "cull-bvh", CullBvh, &c, (double)count);
+			if (pBvh)
+			{
+				runner.AddCounter("visible", (double)c.Result);
+				runner.AddCounter("nodes_visited", (double)c.Stats.NodesVisited);
+				runner.AddCounter("spheres_tested", (double)c.Stats.SpheresTested);
+				if (pFlat)
+				{
+					std::vector<uint32_t> bvhVisible(c.Visible.begin(), c.Visible.begin() + c.Result);
+					std::sort(bvhVisible.begin(), bvhVisible.end());
+					bool matches = bvhVisible == flatVisible;
+					if (!matches)
+						fprintf(stderr, "bvh/%s: the bvh found %u visible, the flat cull %u, not the same objects\n", name,
+							(uint32_t)bvhVisible.size(), (uint32_t)flatVisible.size());
+					runner.AddCounter("speedup", flatNs / pBvh->MedianNs);
+					runner.AddCounter("matches", matches ? 1.0 : 0.0);
+				}
+			}
+
+			// Rays from the camera to random objects, so most of them hit something.
+			uint32_t random = 0x5EED;
+			c.Origin[0] = 0.0f;
+			c.Origin[1] = 3.0f;
+			c.Origin[2] = -6.0f;
+			c.Rays.resize(3 * kPickRays);
+			for (uint32_t r = 0; r < kPickRays; r++)
+			{
+				uint32_t target = NextRandom(&random) % count;
+				c.Rays[3 * r + 0] = b.CenterX[target] - c.Origin[0];
+				c.Rays[3 * r + 1] = b.CenterY[target] - c.Origin[1];
+				c.Rays[3 * r + 2] = b.CenterZ[target] - c.Origin[2];
+			}
+			if (runner.Run("bvh", name, "pick", PickRays, &c, (double)kPickRays))
+				runner.AddCounter("hits", (double)c.Result);
+
+			// Move everything, then time refitting the tree to it.
+			for (uint32_t i = 0; i < count; i++)
+			{
+				SceneObject& object = scene.Objects[i];
+				for (int k = 0; k < 3; k++)
+					object.Position[k] += (float)(NextRandom(&random) % 2001) * 0.001f - 1.0f;
+			}
+			scene.UpdateBounds();
+			if (runner.Run("bvh", name, "refit", RefitBvh, &c, (double)count))
+			{
+				runner.AddCounter("sah_cost", bvh.SahCost());
+				runner.AddCounter("sah_cost_built", builtCost);
+			}
+		}
+	}
+}
@@ -0,0 +1,196 @@
+//--------------------------------------------------------------------------------------
+// File: BenchDrawSort.cpp
+//
+// Draws of many shaders, materials and meshes submitted in object order
+// against sorted by DrawQueue keys.
+//
+// The scene is a cloud of cubes, each given one of 64 materials over 8
+// shaders and one of 16 meshes at random, no culling, so every object is a
+// draw in each eye.  "unsorted" and "sorted" are whole stereo frames, and
+// report the state changes per frame, both eyes.  "radix", "radix-1t" and
+// "std-sort" time only the sort of the same frame's keys, in object order: the
+// parallel radix sort, the same on one thread, and std::sort of key and value
+// pairs.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "DrawQueue.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kDrawSortSeed = 0x5EED;
+static const uint32_t kDrawSortCounts[] = { 10000, 100000 };
+static const uint32_t kDrawSortShaders = 8;
+static const uint32_t kDrawSortMaterials = 64;
+static const uint32_t kDrawSortMeshes = 16;
+
+struct DrawSortContext
+{
+	Scene* pScene;
+	StereoView View;
+	SceneRenderer* pRenderer;
+	NullRenderBackend* pBackend;
+	SceneSubmitMode Mode;
+
+	// For the sort-only variants.
+	std::vector<uint64_t> Keys;
+	DrawQueue Queue;
+	WorkerPool* pPool;
+	std::vector<std::pair<uint64_t, uint32_t> > Pairs;
+};
+
+void SubmitFrame(void* pContext, uint64_t iterations)
+{
+	DrawSortContext* c = static_cast<DrawSortContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+		c->pRenderer->Submit(*c->pScene, c->View, 0.0f, c->pBackend, c->Mode);
+	BenchClobberMemory();
+}
+
+void RadixSort(void* pContext, uint64_t iterations)
+{
+	DrawSortContext* c = static_cast<DrawSortContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Queue.Clear();
+		for (uint32_t i = 0; i < (uint32_t)c->Keys.size(); i++)
+			c->Queue.Add(c->Keys[i], i);
+		c->Queue.Sort(c->pPool);
+		BenchClobberMemory();
+	}
+}
+
+void StdSort(void* pContext, uint64_t iterations)
+{
+	DrawSortContext* c = static_cast<DrawSortContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Pairs.clear();
+		for (uint32_t i = 0; i < (uint32_t)c->Keys.size(); i++)
+			c->Pairs.push_back(std::make_pair(c->Keys[i], i));
+		std::sort(c->Pairs.begin(), c->Pairs.end());
+		BenchClobberMemory();
+	}
+}
+
+// The cube's range repeated, each copy a mesh of its own to the backend.
+void BuildDrawSortScene(uint32_t count, Scene* pScene)
+{
+	GenerateScene(SCENE_CLOUD, count, kDrawSortSeed, pScene);
+
+	SceneMesh cube = CubeSceneMesh();
+	pScene->Meshes.clear();
+	for (uint32_t m = 0; m < kDrawSortMeshes; m++)
+	{
+		SceneMesh mesh = cube;
+		mesh.StartIndex = m * cube.IndexCount;
+		pScene->Meshes.push_back(mesh);
+	}
+
+	pScene->Materials.clear();
+	for (uint32_t m = 0; m < kDrawSortMaterials; m++)
+	{
+		SceneMaterial material = { m % kDrawSortShaders };
+		pScene->Materials.push_back(material);
+	}
+
+	uint32_t random = kDrawSortSeed;
+	for (size_t i = 0; i < pScene->Objects.size(); i++)
+	{
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		pScene->Objects[i].Material = (random >> 8) % kDrawSortMaterials;
+		pScene->Objects[i].Mesh = (random >> 20) % kDrawSortMeshes;
+	}
+	pScene->UpdateBounds();
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are draws.  sort_us is the last frame's.
+//--------------------------------------------------------------------------------------
+void BenchDrawSortSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kDrawSortCounts) / sizeof(kDrawSortCounts[0]); n++)
+	{
+		uint32_t count = kDrawSortCounts[n];
+		if (count > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "cloud/%u", count);
+		if (!runner.Enabled("drawsort", name))
+			continue;
+
+		Scene scene;
+		BuildDrawSortScene(count, &scene);
+		WorkerPool pool(WorkerPool::DefaultWorkers());
+
+		const SceneSubmitMode modes[] = { SCENE_SUBMIT_PER_OBJECT, SCENE_SUBMIT_SORTED };
+		const char* const modeNames[] = { "unsorted", "sorted" };
+		for (int m = 0; m < 2; m++)
+		{
+			SceneRenderer renderer;
+			renderer.SetSortPool(&pool);
+			NullRenderBackend backend;
+
+			DrawSortContext c;
+			c.pScene = &scene;
+			c.View = DefaultStereoView(1280.0f / 720.0f);
+			c.pRenderer = &renderer;
+			c.pBackend = &backend;
+			c.Mode = modes[m];
+			c.pPool = &pool;
+
+			// Once up front, so the counts are for exactly one frame.
+			renderer.Submit(scene, c.View, 0.0f, &backend, c.Mode);
+			RenderBackendCounters frame = backend.Counters();
+
+			if (!runner.Run("drawsort", name, modeNames[m], SubmitFrame, &c, 2.0 * count))
+				continue;
+
+			runner.AddCounter("draws", (double)frame.Draws);
+			runner.AddCounter("shader_changes", (double)frame.ShaderChanges);
+			runner.AddCounter("material_changes", (double)frame.MaterialChanges);
+			runner.AddCounter("mesh_changes", (double)frame.MeshChanges);
+			if (c.Mode == SCENE_SUBMIT_SORTED)
+			{
+				runner.AddCounter("sort_us", (double)renderer.SortedDraws().SortNs() / 1000.0);
+				runner.AddCounter("sort_passes", (double)renderer.SortedDraws().SortPasses());
+			}
+		}
+
+		// The keys in object order, as SceneRenderer makes them.
+		DrawSortContext c;
+		c.pPool = &pool;
+		StereoView view = DefaultStereoView(1280.0f / 720.0f);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const SceneObject& object = scene.Objects[i];
+			const float* p = object.Position;
+			float depth = p[0] * view.View.m[0][2] + p[1] * view.View.m[1][2] + p[2] * view.View.m[2][2] + view.View.m[3][2];
+			c.Keys.push_back(MakeDrawKey(scene.Materials[object.Material].Shader, object.Material, object.Mesh, depth));
+		}
+
+		if (runner.Run("drawsort", name, "radix", RadixSort, &c, (double)count))
+			runner.AddCounter("threads", (double)pool.ThreadCount());
+		c.pPool = nullptr;
+		runner.Run("drawsort", name, "radix-1t", RadixSort, &c, (double)count);
+		runner.Run("drawsort", name, "std-sort", StdSort, &c, (double)count);
+	}
+}
@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------
+// File: BenchFrame.cpp
+//
+// The CPU side of RenderFrame(), step by step and as a whole frame: the world
+// rotation, the three transposes per eye, the _31/_41 projection edits, packing
+// SharedCB, and the copy UpdateSubresource makes of it.  Each math step runs
+// with both StereoMath implementations.
+//--------------------------------------------------------------------------------------
+
+#include "AlignedAlloc.h"
+#include "Bench.h"
+#include "SceneRenderer.h"
+#include "StereoMath.h"
+
+#include <string.h>
+
+
+namespace
+{
+
+// Like UpdateSubresource, which copies into driver memory that rotates between
+// frames in flight.
+static const uint32_t kUploadSlots = 8;
+
+struct FrameContext
+{
+	SMMatrix World;
+	SMMatrix View;
+	SMMatrix Projection;
+	float Angle;
+	float Separation;
+	float Convergence;
+	SMSharedCB CB[2];
+	SMSharedCB Upload[kUploadSlots][2];
+	uint32_t UploadSlot;
+};
+
+void InitContext(FrameContext* c)
+{
+	memset(c, 0, sizeof(*c));
+	c->World = StereoMathScalar::Identity();
+
+	StereoView view = DefaultStereoView(1280.0f / 720.0f);
+	c->View = view.View;
+	c->Projection = view.Projection;
+	c->Separation = view.Separation;
+	c->Convergence = view.Convergence;
+}
+
+
+// Kept in one turn, sinf gets slower on large arguments.
+inline float NextAngle(float angle)
+{
+	angle += 0.001f;
+	return (angle > 6.2831853f) ? angle - 6.2831853f : angle;
+}
+
+template <typename Math>
+void RotationY(void* pContext, uint64_t iterations)
+{
+	FrameContext* c = static_cast<FrameContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		c->Angle = NextAngle(c->Angle);
+		c->World = Math::RotationY(c->Angle);
+		BenchClobberMemory();
+	}
+}
+
+template <typename Math>
+void Transpose3(void* pContext, uint64_t iterations)
+{
+	FrameContext* c = static_cast<FrameContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		c->CB[0].World = Math::Transpose(c->World);
+		c->CB[0].View = Math::Transpose(c->View);
+		c->CB[0].Projection = Math::Transpose(c->Projection);
+		BenchClobberMemory();
+	}
+}
+
+void ProjectionEdit(void* pContext, uint64_t iterations)
+{
+	FrameContext* c = static_cast<FrameContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		SMMatrix left = c->Projection;
+		SMMatrix right = c->Projection;
+		StereoProjectionEdit(&left, -1.0f, c->Separation, c->Convergence);
+		StereoProjectionEdit(&right, 1.0f, c->Separation, c->Convergence);
+		c->CB[0].Projection = left;
+		c->CB[1].Projection = right;
+		BenchClobberMemory();
+	}
+}
+
+template <typename Math>
+void PackBothEyes(void* pContext, uint64_t iterations)
+{
+	FrameContext* c = static_cast<FrameContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		StereoPackSharedCB<Math>(&c->CB[0], c->World, c->View, c->Projection, -1.0f, c->Separation, c->Convergence);
+		StereoPackSharedCB<Math>(&c->CB[1], c->World, c->View, c->Projection, 1.0f, c->Separation, c->Convergence);
+		BenchClobberMemory();
+	}
+}
+
+void UploadCopy(void* pContext, uint64_t iterations)
+{
+	FrameContext* c = static_cast<FrameContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		c->UploadSlot = (c->UploadSlot + 1) % kUploadSlots;
+		memcpy(&c->Upload[c->UploadSlot][0], &c->CB[0], sizeof(SMSharedCB));
+		memcpy(&c->Upload[c->UploadSlot][1], &c->CB[1], sizeof(SMSharedCB));
+		BenchClobberMemory();
+	}
+}
+
+template <typename Math>
+void WholeFrame(void* pContext, uint64_t iterations)
+{
+	FrameContext* c = static_cast<FrameContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		c->Angle = NextAngle(c->Angle);
+		c->World = Math::RotationY(c->Angle);
+
+		c->UploadSlot = (c->UploadSlot + 1) % kUploadSlots;
+		for (int eye = 0; eye < 2; eye++)
+		{
+			StereoPackSharedCB<Math>(&c->CB[eye], c->World, c->View, c->Projection,
+				eye ? 1.0f : -1.0f, c->Separation, c->Convergence);
+			memcpy(&c->Upload[c->UploadSlot][eye], &c->CB[eye], sizeof(SMSharedCB));
+		}
+		BenchClobberMemory();
+	}
+}
+
+template <typename Math>
+void RunMath(BenchRunner& runner, FrameContext* c)
+{
+	runner.Run("frame", "RotationY", Math::Name(), RotationY<Math>, c);
+	runner.Run("frame", "Transpose3", Math::Name(), Transpose3<Math>, c);
+	runner.Run("frame", "PackSharedCB2", Math::Name(), PackBothEyes<Math>, c);
+	runner.Run("frame", "WholeFrame", Math::Name(), WholeFrame<Math>, c);
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// PackSharedCB2 and UploadCopy cover both eyes, as does WholeFrame.
+//--------------------------------------------------------------------------------------
+void BenchFrameSuite(BenchRunner& runner)
+{
+	// Too big for the stack with the upload ring, and needs the alignment.
+	FrameContext* pContext = static_cast<FrameContext*>(AlignedAlloc(sizeof(FrameContext), 16));
+	InitContext(pContext);
+
+	RunMath<StereoMathScalar>(runner, pContext);
+#if STEREO_MATH_SSE
+	RunMath<StereoMathSSE>(runner, pContext);
+#endif
+	runner.Run("frame", "ProjectionEdit2", "scalar", ProjectionEdit, pContext);
+	runner.Run("frame", "UploadCopy2", "memcpy", UploadCopy, pContext);
+
+	AlignedFree(pContext);
+}
@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------
+// File: BenchFrameStats.cpp
+//
+// FrameStats against frame times whose answers are known.
+//
+// Each distribution is kSamples frames, made up front.  "p2/<dist>" times what
+// the stats thread does per frame, adding one to each of the four P-square
+// estimators.  After it, all the frames go through Record, in bursts the ring
+// can hold, to a running FrameStats, and the summary is checked against the
+// same frames sorted:
+//
+//     frames				every one got through the ring, none dropped
+//     p50 to p99.9		the share of frames at or under the estimate is
+//							within kRankError[q] of the quantile
+//     missed				over_budget and missed_vblanks counted directly
+//     imbalance			mean and max of |left - right|
+//
+// matches is 1 if all of them hold.  "constant" is every frame the same,
+// "uniform" spread evenly over 4 to 12ms, and "bimodal" mostly on time, a
+// tenth one refresh late and 1% long hitches out to 60ms.
+//--------------------------------------------------------------------------------------
+#include "Bench.h"
+#include "FrameStats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kSamples = 100000;
+static const uint32_t kSamplesPerOp = 4096;
+static const uint32_t kBurst = FrameStats::kRingSize / 2;
+static const double kQuantiles[] = { 0.5, 0.95, 0.99, 0.999 };
+static const double kRankError[] = { 0.01, 0.005, 0.002, 0.0005 };
+
+enum Distribution
+{
+	DIST_CONSTANT = 0,
+	DIST_UNIFORM,
+	DIST_BIMODAL
+};
+
+static const char* kDistributionNames[] = { "constant", "uniform", "bimodal" };
+
+struct StatsContext
+{
+	std::vector<FrameSample> Samples;
+	std::vector<double> FrameMs;
+	P2Quantile* pEstimators[4];
+	uint32_t Next;
+};
+
+void RunP2(void* pContext, uint64_t iterations)
+{
+	StatsContext* c = static_cast<StatsContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (uint32_t s = 0; s < kSamplesPerOp; s++)
+		{
+			double ms = c->FrameMs[c->Next];
+			c->Next = (c->Next + 1 == kSamples) ? 0 : c->Next + 1;
+			for (uint32_t q = 0; q < 4; q++)
+				c->pEstimators[q]->Add(ms);
+		}
+		BenchClobberMemory();
+	}
+}
+
+uint32_t s_Random = 1;
+
+double NextUniform()
+{
+	s_Random = s_Random * 1664525u + 1013904223u;
+	return (double)(s_Random >> 8) / 16777216.0;
+}
+
+void MakeSamples(Distribution distribution, std::vector<FrameSample>* pSamples)
+{
+	s_Random = 1;
+	pSamples->resize(kSamples);
+	for (uint32_t i = 0; i < kSamples; i++)
+	{
+		double ms = 8.0;
+		if (distribution == DIST_UNIFORM)
+			ms = 4.0 + 8.0 * NextUniform();
+		else if (distribution == DIST_BIMODAL)
+		{
+			double pick = NextUniform();
+			if (pick < 0.89)
+				ms = 6.5 + NextUniform();
+			else if (pick < 0.99)
+				ms = 13.0 + 2.0 * NextUniform();
+			else
+				ms = 20.0 / (1.0 - 0.66 * NextUniform());		// Pareto-ish, 20 to ~60ms
+		}
+
+		FrameSample& s = (*pSamples)[i];
+		s.FrameNs = (uint64_t)(ms * 1e6);
+		s.EyeNs[0] = s.FrameNs * 2 / 5;
+		s.EyeNs[1] = s.EyeNs[0] + (i % 5) * 100000ull;		// 0 to 0.4ms apart, left never slower
+	}
+}
+
+// Share of the sorted frames at or under value.
+double Rank(const std::vector<double>& sorted, double value)
+{
+	return (double)(std::upper_bound(sorted.begin(), sorted.end(), value) - sorted.begin()) / (double)sorted.size();
+}
+
+// Records every sample, never faster than the stats thread drains, and waits
+// for it to have seen them all.
+bool FeedFrameStats(const std::vector<FrameSample>& samples, FrameStatsSummary* pSummary)
+{
+	FrameStatsConfig config = DefaultFrameStatsConfig();
+	config.CsvPath.clear();
+	config.JsonPath.clear();
+
+	FrameStats stats;
+	stats.Start(config);
+	bool drained = true;
+	for (size_t i = 0; i < samples.size() && drained; i += kBurst)
+	{
+		size_t end = std::min(samples.size(), i + kBurst);
+		for (size_t s = i; s < end; s++)
+			stats.Record(samples[s]);
+
+		drained = false;
+		for (int wait = 0; wait < 500 && !drained; wait++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			drained = (stats.GetSummary().Frames == end);
+		}
+	}
+	stats.Stop();
+	*pSummary = stats.GetSummary();
+	return drained;
+}
+
+}
+
+
+void BenchFrameStatsSuite(BenchRunner& runner)
+{
+	char name[64];
+
+	for (int d = DIST_CONSTANT; d <= DIST_BIMODAL; d++)
+	{
+		sprintf(name, "p2/%s", kDistributionNames[d]);
+		if (!runner.Enabled("framestats", name))
+			continue;
+
+		StatsContext c;
+		MakeSamples((Distribution)d, &c.Samples);
+		for (size_t i = 0; i < c.Samples.size(); i++)
+			c.FrameMs.push_back((double)c.Samples[i].FrameNs / 1e6);
+		P2Quantile p50(0.5), p95(0.95), p99(0.99), p999(0.999);
+		c.pEstimators[0] = &p50;
+		c.pEstimators[1] = &p95;
+		c.pEstimators[2] = &p99;
+		c.pEstimators[3] = &p999;
+		c.Next = 0;
+
+		if (!runner.Run("framestats", name, "4 quantiles", RunP2, &c, (double)kSamplesPerOp))
+			continue;
+
+		// What the summary should say.
+		std::vector<double> sorted = c.FrameMs;
+		std::sort(sorted.begin(), sorted.end());
+		uint64_t budgetNs = DefaultFrameStatsConfig().BudgetNs;
+		uint64_t overBudget = 0, missed = 0, maxImbalanceNs = 0;
+		double totalImbalanceMs = 0.0;
+		for (size_t i = 0; i < c.Samples.size(); i++)
+		{
+			const FrameSample& s = c.Samples[i];
+			uint64_t refreshes = (s.FrameNs + budgetNs - 1) / budgetNs;
+			if (refreshes > 1)
+			{
+				overBudget++;
+				missed += refreshes - 1;
+			}
+			uint64_t imbalanceNs = s.EyeNs[1] - s.EyeNs[0];
+			totalImbalanceMs += (double)imbalanceNs / 1e6;
+			maxImbalanceNs = std::max(maxImbalanceNs, imbalanceNs);
+		}
+		double meanImbalanceMs = totalImbalanceMs / (double)c.Samples.size();
+
+		FrameStatsSummary summary;
+		bool drained = FeedFrameStats(c.Samples, &summary);
+		bool matches = drained && summary.Frames == kSamples && summary.DroppedSamples == 0;
+		if (!matches)
+			fprintf(stderr, "framestats/%s: %llu of %u frames through the ring, %llu dropped\n", name,
+				(unsigned long long)summary.Frames, kSamples, (unsigned long long)summary.DroppedSamples);
+
+		const double estimates[] = { summary.P50Ms, summary.P95Ms, summary.P99Ms, summary.P999Ms };
+		const char* quantileNames[] = { "p50", "p95", "p99", "p999" };
+		for (uint32_t q = 0; q < 4; q++)
+		{
+			double exact = sorted[(size_t)(kQuantiles[q] * (double)(sorted.size() - 1))];
+			double rank = Rank(sorted, estimates[q]);
+			// Ties put all of a constant's frames at its one value.
+			bool close = (exact == estimates[q]) || fabs(rank - kQuantiles[q]) <= kRankError[q];
+			if (!close)
+				fprintf(stderr, "framestats/%s: %s is %.4fms, at rank %.4f, the exact one %.4fms\n",
+					name, quantileNames[q], estimates[q], rank, exact);
+			matches = matches && close;
+
+			char counter[32];
+			runner.AddCounter(quantileNames[q], estimates[q]);
+			sprintf(counter, "%s_exact", quantileNames[q]);
+			runner.AddCounter(counter, exact);
+		}
+
+		bool counted = summary.FramesOverBudget == overBudget && summary.MissedVblanks == missed &&
+			fabs(summary.MeanEyeImbalanceMs - meanImbalanceMs) < 1e-6 &&
+			fabs(summary.MaxEyeImbalanceMs - (double)maxImbalanceNs / 1e6) < 1e-9;
+		if (!counted)
+			fprintf(stderr, "framestats/%s: %llu over budget and %llu missed vblanks, expected %llu and %llu\n", name,
+				(unsigned long long)summary.FramesOverBudget, (unsigned long long)summary.MissedVblanks,
+				(unsigned long long)overBudget, (unsigned long long)missed);
+		matches = matches && counted;
+
+		runner.AddCounter("missed", (double)summary.MissedVblanks);
+		runner.AddCounter("missed_expected", (double)missed);
+		runner.AddCounter("imbalance_ms", summary.MeanEyeImbalanceMs);
+		runner.AddCounter("matches", matches ? 1.0 : 0.0);
+	}
+}
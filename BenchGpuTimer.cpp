@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------------------
+// File: BenchGpuTimer.cpp
+//
+// The GpuTimer frame ring and its rolling windows, on the CPU clock backend.
+//
+// Each op is one frame as Render() times it, both eyes' clear and draw.  The
+// timer is CpuGpuTimer with its results held back until they are delay frames
+// old, the way a GPU behind the CPU holds back its queries.  The ring has
+// GpuTimer::kRingSize slots, so a frame still not ready when its slot comes
+// round again is dropped:
+//
+//     delay < kRingSize		every frame is collected, the last delay still pending
+//     delay >= kRingSize		every frame is dropped, the last kRingSize still pending
+//
+// Run long enough to go round the ring and the window many times, matches is
+// 1 if the collected and dropped counts are exactly that, and each window of
+// collected frames holds the last kSamples: stage windows full, and an eye's
+// last, mean, min and max no less than its stages'.  "window" adds a known
+// sequence to one GpuTimeWindow and checks it holds only the last kSamples.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "GpuTimer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+
+namespace
+{
+
+static const uint32_t kDelays[] = { 0, 1, GpuTimer::kRingSize - 1, GpuTimer::kRingSize, GpuTimer::kRingSize + 2 };
+static const uint32_t kWindowAdds = 1000;
+
+class DelayedCpuGpuTimer : public CpuGpuTimer
+{
+public:
+	explicit DelayedCpuGpuTimer(uint32_t delay) : m_Delay(delay), m_Begun(0), m_Ended(0) {}
+
+	uint64_t FramesEnded() const { return m_Ended; }
+
+protected:
+	void IssueFrameBegin(uint32_t slot)
+	{
+		m_SlotFrame[slot] = m_Begun++;
+		CpuGpuTimer::IssueFrameBegin(slot);
+	}
+
+	void IssueFrameEnd(uint32_t slot)
+	{
+		m_Ended++;
+		CpuGpuTimer::IssueFrameEnd(slot);
+	}
+
+	ReadResult TryReadFrame(uint32_t slot, uint32_t spanMask, uint64_t* pTimestamps, uint64_t* pFrequency)
+	{
+		if (m_Ended - m_SlotFrame[slot] <= m_Delay)
+			return READ_NOT_READY;
+		return CpuGpuTimer::TryReadFrame(slot, spanMask, pTimestamps, pFrequency);
+	}
+
+private:
+	uint32_t m_Delay;
+	uint64_t m_Begun;
+	uint64_t m_Ended;
+	uint64_t m_SlotFrame[kRingSize];
+};
+
+void RunFrames(void* pContext, uint64_t iterations)
+{
+	GpuTimer* pTimer = static_cast<GpuTimer*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		pTimer->BeginFrame();
+		for (uint32_t eye = 0; eye < kGpuTimerEyes; eye++)
+		{
+			pTimer->Begin(eye, GPU_STAGE_CLEAR);
+			pTimer->End(eye, GPU_STAGE_CLEAR);
+			pTimer->Begin(eye, GPU_STAGE_DRAW);
+			BenchClobberMemory();
+			pTimer->End(eye, GPU_STAGE_DRAW);
+		}
+		pTimer->EndFrame();
+	}
+}
+
+void RunWindow(void* pContext, uint64_t iterations)
+{
+	GpuTimeWindow* pWindow = static_cast<GpuTimeWindow*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		*pWindow = GpuTimeWindow();
+		for (uint32_t i = 1; i <= kWindowAdds; i++)
+			pWindow->Add(i);
+		BenchClobberMemory();
+	}
+}
+
+// A window of collected frames is full once there have been kSamples of them,
+// and an eye's sample is the sum of its stages' from the same frame.
+bool CheckWindows(const GpuTimer& timer)
+{
+	uint32_t expected = (timer.FramesCollected() < GpuTimeWindow::kSamples) ?
+		(uint32_t)timer.FramesCollected() : GpuTimeWindow::kSamples;
+	for (uint32_t eye = 0; eye < kGpuTimerEyes; eye++)
+	{
+		const GpuTimeWindow& eyeWindow = timer.GetEyeWindow(eye);
+		const GpuTimeWindow& clear = timer.GetWindow(eye, GPU_STAGE_CLEAR);
+		const GpuTimeWindow& draw = timer.GetWindow(eye, GPU_STAGE_DRAW);
+		if (eyeWindow.Count() != expected || clear.Count() != expected || draw.Count() != expected)
+			return false;
+		if (expected == 0)
+			continue;
+
+		double stagesMean = clear.Mean() + draw.Mean();
+		if (eyeWindow.Last() != clear.Last() + draw.Last() ||
+			fabs(eyeWindow.Mean() - stagesMean) > 1e-9 * stagesMean + 1e-6 ||
+			eyeWindow.Max() < clear.Max() || eyeWindow.Max() < draw.Max() ||
+			eyeWindow.Min() < clear.Min() || eyeWindow.Min() < draw.Min() ||
+			eyeWindow.Mean() < (double)eyeWindow.Min() || eyeWindow.Mean() > (double)eyeWindow.Max())
+			return false;
+	}
+	return true;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are frames, and added samples for the window.
+//--------------------------------------------------------------------------------------
+void BenchGpuTimerSuite(BenchRunner& runner)
+{
+	char name[64];
+
+	for (size_t d = 0; d < sizeof(kDelays) / sizeof(kDelays[0]); d++)
+	{
+		uint32_t delay = kDelays[d];
+		sprintf(name, "cpu/delay%u", delay);
+		if (!runner.Enabled("gputimer", name))
+			continue;
+
+		DelayedCpuGpuTimer timer(delay);
+		if (!runner.Run("gputimer", name, "frame", RunFrames, static_cast<GpuTimer*>(&timer)))
+			continue;
+
+		uint64_t frames = timer.FramesEnded();
+		uint64_t collected = (delay < GpuTimer::kRingSize) ? frames - delay : 0;
+		uint64_t dropped = (delay < GpuTimer::kRingSize) ? 0 : frames - GpuTimer::kRingSize;
+		bool counted = timer.FramesCollected() == collected && timer.FramesDropped() == dropped;
+		if (!counted)
+			fprintf(stderr, "gputimer/%s: %llu frames, %llu collected and %llu dropped, expected %llu and %llu\n", name,
+				(unsigned long long)frames, (unsigned long long)timer.FramesCollected(),
+				(unsigned long long)timer.FramesDropped(), (unsigned long long)collected, (unsigned long long)dropped);
+		bool windows = frames > GpuTimeWindow::kSamples + GpuTimer::kRingSize && CheckWindows(timer);
+		if (!windows)
+			fprintf(stderr, "gputimer/%s: the windows don't hold the last %u collected frames\n", name,
+				GpuTimeWindow::kSamples);
+
+		runner.AddCounter("frames", (double)frames);
+		runner.AddCounter("collected", (double)timer.FramesCollected());
+		runner.AddCounter("dropped", (double)timer.FramesDropped());
+		runner.AddCounter("eye0_mean_ns", timer.GetEyeWindow(0).Mean());
+		runner.AddCounter("matches", (counted && windows) ? 1.0 : 0.0);
+	}
+
+	if (runner.Enabled("gputimer", "window"))
+	{
+		GpuTimeWindow window;
+		if (runner.Run("gputimer", "window", "add", RunWindow, &window, (double)kWindowAdds))
+		{
+			// 1 to kWindowAdds went in, so the window has the last kSamples of them.
+			uint64_t first = kWindowAdds - GpuTimeWindow::kSamples + 1;
+			bool matches = window.Count() == GpuTimeWindow::kSamples && window.Last() == kWindowAdds &&
+				window.Min() == first && window.Max() == kWindowAdds &&
+				window.Mean() == (double)(first + kWindowAdds) / 2.0;
+			if (!matches)
+				fprintf(stderr, "gputimer/window: %u samples, %llu to %llu, mean %.2f, expected %u, %llu to %u, mean %.2f\n",
+					window.Count(), (unsigned long long)window.Min(), (unsigned long long)window.Max(), window.Mean(),
+					GpuTimeWindow::kSamples, (unsigned long long)first, kWindowAdds, (double)(first + kWindowAdds) / 2.0);
+			runner.AddCounter("mean", window.Mean());
+			runner.AddCounter("matches", matches ? 1.0 : 0.0);
+		}
+	}
+}
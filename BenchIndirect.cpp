@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// File: BenchIndirect.cpp
+//
+// CPU culled submission against GPU driven indirect submission of the same
+// cloud of cubes, with NullRenderBackend running the cull pass on the CPU.
+//
+// The cubes use four copies of the cube mesh in turn, so the indirect frame
+// has four argument records.  "per-object" and "instanced" cull on the CPU
+// against both eyes' frusta, as -cull does, and "indirect" is -indirect.  Each
+// is a whole stereo frame.  Indirect's includes the emulated cull pass, which
+// on a device is the GPU's, and "indirect-cpu" is the same frame with the
+// emulation off, what the CPU is left with.
+//
+// Before timing, the indirect frame's argument records and instances are
+// checked against StereoCullSpheresScalar and SceneRenderer's world matrices;
+// matches is 1 if every mesh got exactly the visible objects, in object order,
+// with the same matrices.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "IndirectDraw.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+#include "StereoCull.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kIndirectSeed = 0x5EED;
+static const uint32_t kIndirectCounts[] = { 10000, 100000, 1000000 };
+static const uint32_t kIndirectMeshes = 4;
+
+struct IndirectContext
+{
+	Scene* pScene;
+	StereoView View;
+	SceneRenderer* pRenderer;
+	NullRenderBackend* pBackend;
+	SceneSubmitMode Mode;
+};
+
+void SubmitFrame(void* pContext, uint64_t iterations)
+{
+	IndirectContext* c = static_cast<IndirectContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+		c->pRenderer->Submit(*c->pScene, c->View, 0.0f, c->pBackend, c->Mode);
+	BenchClobberMemory();
+}
+
+// The last frame's records and instances against the CPU cull's, for time 0.
+bool CheckIndirect(const Scene& scene, const StereoView& view, const NullRenderBackend& backend)
+{
+	uint32_t count = (uint32_t)scene.Objects.size();
+	StereoFrustum frustum;
+	BuildStereoUnionFrustum(view.View, view.Projection, view.Separation, view.Convergence, &frustum);
+	std::vector<uint32_t> visible(scene.Bounds.Radius.size());
+	uint32_t visibleCount = StereoCullSpheresScalar(frustum, &scene.Bounds.CenterX[0], &scene.Bounds.CenterY[0],
+		&scene.Bounds.CenterZ[0], &scene.Bounds.Radius[0], count, &visible[0]);
+	if (visibleCount != backend.IndirectVisible())
+		return false;
+
+	const std::vector<IndirectDrawArgs>& args = backend.IndirectArgs();
+	std::vector<uint32_t> taken(args.size(), 0);
+	for (uint32_t v = 0; v < visibleCount; v++)
+	{
+		const SceneObject& object = scene.Objects[visible[v]];
+		const IndirectDrawArgs& record = args[object.Mesh];
+		if (taken[object.Mesh] >= record.InstanceCount)
+			return false;
+
+		SMMatrix world;
+		memset(&world, 0, sizeof(world));
+		float s = sinf(object.Phase) * object.Scale;
+		float c = cosf(object.Phase) * object.Scale;
+		world.m[0][0] = c;
+		world.m[0][2] = -s;
+		world.m[1][1] = object.Scale;
+		world.m[2][0] = s;
+		world.m[2][2] = c;
+		memcpy(world.m[3], object.Position, sizeof(object.Position));
+		world.m[3][3] = 1.0f;
+		if (memcmp(&world, &backend.IndirectInstances()[record.StartInstanceLocation + taken[object.Mesh]++], sizeof(world)) != 0)
+			return false;
+	}
+	for (size_t d = 0; d < args.size(); d++)
+		if (taken[d] != args[d].InstanceCount)
+			return false;
+	return true;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are objects.  draw_calls is what the CPU issues a frame, both eyes,
+// and draws what the GPU executes.
+//--------------------------------------------------------------------------------------
+void BenchIndirectSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kIndirectCounts) / sizeof(kIndirectCounts[0]); n++)
+	{
+		uint32_t count = kIndirectCounts[n];
+		if (count > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "cloud/%u", count);
+		if (!runner.Enabled("indirect", name))
+			continue;
+
+		Scene scene;
+		GenerateScene(SCENE_CLOUD, count, kIndirectSeed, &scene);
+		scene.Meshes.resize(kIndirectMeshes, scene.Meshes[0]);
+		for (uint32_t i = 0; i < count; i++)
+			scene.Objects[i].Mesh = i % kIndirectMeshes;
+		scene.UpdateBounds();
+
+		const SceneSubmitMode modes[] = { SCENE_SUBMIT_PER_OBJECT, SCENE_SUBMIT_INSTANCED, SCENE_SUBMIT_INDIRECT, SCENE_SUBMIT_INDIRECT };
+		const char* const modeNames[] = { "per-object", "instanced", "indirect", "indirect-cpu" };
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		{
+			SceneRenderer renderer;
+			renderer.SetCulling(true);
+			NullRenderBackend backend;
+			bool emulate = (m != 3);
+
+			IndirectContext c;
+			c.pScene = &scene;
+			c.View = DefaultStereoView(1280.0f / 720.0f);
+			c.pRenderer = &renderer;
+			c.pBackend = &backend;
+			c.Mode = modes[m];
+
+			// Once up front, so the counts are for exactly one frame.
+			renderer.Submit(scene, c.View, 0.0f, &backend, c.Mode);
+			RenderBackendCounters frame = backend.Counters();
+			bool matches = (c.Mode != SCENE_SUBMIT_INDIRECT) || CheckIndirect(scene, c.View, backend);
+			if (!matches)
+				fprintf(stderr, "indirect/%s: the emulated cull pass differs from the CPU cull\n", name);
+			backend.SetEmulateIndirect(emulate);
+
+			BenchResult* pResult = runner.Run("indirect", name, modeNames[m], SubmitFrame, &c, (double)count);
+			if (!pResult)
+				continue;
+
+			runner.AddCounter("submit_ms", pResult->MedianNs / 1e6);
+			runner.AddCounter("draw_calls", (double)((c.Mode == SCENE_SUBMIT_INDIRECT) ? frame.IndirectCalls : frame.Draws));
+			runner.AddCounter("draws", (double)frame.Draws);
+			runner.AddCounter("instances", (double)frame.Instances);
+			runner.AddCounter("upload_bytes", (double)(frame.ConstantBytes + frame.InstanceBytes));
+			if (c.Mode == SCENE_SUBMIT_INDIRECT)
+				runner.AddCounter("matches", matches ? 1.0 : 0.0);
+		}
+	}
+}
@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------
+// File: BenchInstancing.cpp
+//
+// Per-object against instanced submission of the same grid of cubes, at 10k
+// and 100k objects: CPU time per stereo frame, and how many draws and bytes
+// each one hands the driver.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include <stdio.h>
+
+
+namespace
+{
+
+static const uint32_t kInstancingSeed = 0x5EED;
+static const uint32_t kInstanceCounts[] = { 10000, 100000 };
+
+struct InstancingContext
+{
+	Scene* pScene;
+	StereoView View;
+	SceneRenderer* pRenderer;
+	NullRenderBackend* pBackend;
+	SceneSubmitMode Mode;
+	float Time;
+};
+
+void SubmitFrame(void* pContext, uint64_t iterations)
+{
+	InstancingContext* c = static_cast<InstancingContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		c->Time += 0.016f;
+		if (c->Time > 6.2831853f)
+			c->Time -= 6.2831853f;
+		c->pRenderer->Submit(*c->pScene, c->View, c->Time, c->pBackend, c->Mode);
+	}
+	BenchClobberMemory();
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// draw_reduction is per-object draws over this variant's draws, so 1 for
+// per-object itself.  upload_bytes is constants and instances together.
+//--------------------------------------------------------------------------------------
+void BenchInstancingSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kInstanceCounts) / sizeof(kInstanceCounts[0]); n++)
+	{
+		uint32_t count = kInstanceCounts[n];
+		if (count > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "grid/%u", count);
+		if (!runner.Enabled("instancing", name))
+			continue;
+
+		Scene scene;
+		GenerateScene(SCENE_GRID, count, kInstancingSeed, &scene);
+		double perObjectDraws = 2.0 * (double)count;
+
+		const SceneSubmitMode modes[] = { SCENE_SUBMIT_PER_OBJECT, SCENE_SUBMIT_INSTANCED };
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		{
+			SceneRenderer renderer;
+			NullRenderBackend backend;
+
+			InstancingContext c;
+			c.pScene = &scene;
+			c.View = DefaultStereoView(1280.0f / 720.0f);
+			c.pRenderer = &renderer;
+			c.pBackend = &backend;
+			c.Mode = modes[m];
+			c.Time = 0.0f;
+
+			// One frame for the counts.
+			renderer.Submit(scene, c.View, c.Time, &backend, c.Mode);
+			RenderBackendCounters frame = backend.Counters();
+
+			BenchResult* pResult = runner.Run("instancing", name, SceneSubmitModeName(c.Mode), SubmitFrame, &c, (double)count);
+			if (!pResult)
+				continue;
+
+			runner.AddCounter("submit_ms", pResult->MedianNs / 1e6);
+			runner.AddCounter("draws", (double)frame.Draws);
+			runner.AddCounter("draw_reduction", frame.Draws ? perObjectDraws / (double)frame.Draws : 0.0);
+			runner.AddCounter("constant_updates", (double)frame.ConstantUpdates);
+			runner.AddCounter("upload_bytes", (double)(frame.ConstantBytes + frame.InstanceBytes));
+			runner.AddCounter("renderer_bytes", (double)renderer.MemoryBytes());
+		}
+	}
+}
@@ -0,0 +1,183 @@
+//--------------------------------------------------------------------------------------
+// File: BenchLiveMetrics.cpp
+//
+// The live metrics seqlock, with a writer and a reader on different threads.
+//
+// "publish" is one Publish with nobody reading, the cost RenderFrame() pays.
+// "read" runs a writer thread publishing as fast as it can while this thread
+// reads.  Every word of the writer's n-th snapshot is made from n, so a read
+// that mixes two snapshots shows up as words that don't agree.  torn counts
+// those and has to be 0, failed counts reads that found the writer mid-update
+// on every try.  The segment is opened by name as LiveMetricsMonitor would,
+// and matches is 1 if its header has this build's magic, version and size and
+// no read was torn.
+//--------------------------------------------------------------------------------------
+#include "Bench.h"
+#include "LiveMetrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+
+namespace
+{
+
+#if defined(_WIN32)
+static const char* kSegmentName = "Local\\BenchLiveMetrics";
+#else
+static const char* kSegmentName = "/BenchLiveMetrics";
+#endif
+static const uint32_t kReadTries = 64;
+
+// Word i of snapshot n.  The multiply spreads n over every bit, so halves of
+// two snapshots can't happen to agree.
+uint64_t SnapshotWord(uint64_t n, uint32_t i)
+{
+	return (n * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)i << 56) ^ i;
+}
+
+void MakeSnapshot(uint64_t n, LiveMetricsSnapshot* pSnapshot)
+{
+	uint64_t words[kLiveMetricsWords];
+	for (uint32_t i = 0; i < kLiveMetricsWords; i++)
+		words[i] = SnapshotWord(n, i);
+	memcpy(pSnapshot, words, sizeof(words));
+}
+
+// n from the first word, then every other word has to match it.
+bool Consistent(const LiveMetricsSnapshot& snapshot)
+{
+	uint64_t words[kLiveMetricsWords];
+	memcpy(words, &snapshot, sizeof(words));
+	uint64_t n = words[0] * 0xF1DE83E19937733Dull;		// Inverse of the multiplier mod 2^64
+	for (uint32_t i = 0; i < kLiveMetricsWords; i++)
+		if (words[i] != SnapshotWord(n, i))
+			return false;
+	return true;
+}
+
+struct PublishContext
+{
+	LiveMetricsWriter* pWriter;
+	LiveMetricsSnapshot Snapshot;
+	uint64_t Next;
+};
+
+void RunPublish(void* pContext, uint64_t iterations)
+{
+	PublishContext* c = static_cast<PublishContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Snapshot.FrameIndex = c->Next++;
+		c->pWriter->Publish(c->Snapshot);
+		BenchClobberMemory();
+	}
+}
+
+struct ReadContext
+{
+	LiveMetricsReader* pReader;
+	uint64_t Reads;
+	uint64_t Torn;
+	uint64_t Failed;
+};
+
+void RunRead(void* pContext, uint64_t iterations)
+{
+	ReadContext* c = static_cast<ReadContext*>(pContext);
+	LiveMetricsSnapshot snapshot;
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		if (!c->pReader->Read(&snapshot, kReadTries))
+			c->Failed++;
+		else if (!Consistent(snapshot))
+			c->Torn++;
+		c->Reads++;
+		BenchClobberMemory();
+	}
+}
+
+}
+
+
+void BenchLiveMetricsSuite(BenchRunner& runner)
+{
+	if (!runner.Enabled("livemetrics", "publish") && !runner.Enabled("livemetrics", "read"))
+		return;
+
+	LiveMetricsWriter writer;
+	const char* nvapiNames[] = { "NvAPI_Stereo_SetActiveEye" };
+	if (!writer.Open(kSegmentName, nvapiNames, 1))
+	{
+		fprintf(stderr, "livemetrics: can't create the segment %s\n", kSegmentName);
+		return;
+	}
+
+	PublishContext p;
+	p.pWriter = &writer;
+	MakeSnapshot(1, &p.Snapshot);
+	p.Next = 0;
+	if (runner.Run("livemetrics", "publish", "seqlock", RunPublish, &p))
+		runner.AddCounter("words", (double)kLiveMetricsWords);
+
+	if (!runner.Enabled("livemetrics", "read"))
+		return;
+
+	LiveMetricsReader reader;
+	LiveMetricsReader::OpenResult opened = reader.Open(kSegmentName);
+	bool layout = (opened == LiveMetricsReader::OPEN_OK) &&
+		reader.Header().Magic.load(std::memory_order_acquire) == kLiveMetricsMagic &&
+		reader.Header().Version == kLiveMetricsVersion && reader.Header().Size == sizeof(LiveMetricsShared) &&
+		reader.Header().NvapiCount == 1 && strcmp(reader.Header().NvapiNames[0], nvapiNames[0]) == 0;
+	if (!layout)
+	{
+		fprintf(stderr, "livemetrics/read: the segment's header isn't this build's layout\n");
+		return;
+	}
+
+	// Snapshot 0 first, the segment starts zeroed and "publish" leaves one
+	// whose FrameIndex doesn't agree with its other words.  The writer runs
+	// unpinned, or it would share the reader's CPU and only ever be caught
+	// mid-update by preemption.
+	MakeSnapshot(0, &p.Snapshot);
+	writer.Publish(p.Snapshot);
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> published(0);
+	BenchPinThread(-1);
+	std::thread publisher([&writer, &stop, &published]()
+	{
+		LiveMetricsSnapshot snapshot;
+		uint64_t n = 1;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			MakeSnapshot(n++, &snapshot);
+			writer.Publish(snapshot);
+		}
+		published.store(n - 1);
+	});
+	BenchPinThread(runner.Options().Cpu);
+
+	ReadContext r;
+	r.pReader = &reader;
+	r.Reads = 0;
+	r.Torn = 0;
+	r.Failed = 0;
+	BenchResult* pResult = runner.Run("livemetrics", "read", "concurrent", RunRead, &r);
+	stop.store(true);
+	publisher.join();
+
+	if (pResult)
+	{
+		if (r.Torn > 0)
+			fprintf(stderr, "livemetrics/read: %llu of %llu reads were torn\n",
+				(unsigned long long)r.Torn, (unsigned long long)r.Reads);
+		runner.AddCounter("reads", (double)r.Reads);
+		runner.AddCounter("published", (double)published.load());
+		runner.AddCounter("failed", (double)r.Failed);
+		runner.AddCounter("torn", (double)r.Torn);
+		runner.AddCounter("version", (double)reader.Header().Version);
+		runner.AddCounter("matches", (layout && r.Torn == 0) ? 1.0 : 0.0);
+	}
+}
@@ -0,0 +1,166 @@
+//--------------------------------------------------------------------------------------
+// File: BenchLod.cpp
+//
+// Stereo LOD selection on the scaling scenes, with the cube swapped for a
+// sphere with four LODs, culled and instanced.
+//
+// Each op is a stereo frame with the camera dollying a tenth of a unit back
+// and forth, enough to move objects near a boundary across it.  "full" draws
+// every object's finest LOD, "lod" picks once per object per frame with the
+// default hysteresis, and "lod-no-hysteresis" without any.  triangles are per
+// eye, changes_per_frame is how many objects switched LOD each frame on
+// average over the op, which the hysteresis should keep near zero.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Mesh.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+
+namespace
+{
+
+static const uint32_t kLodSeed = 0x5EED;
+static const uint32_t kLodObjectCounts[] = { 100, 10000, 1000000 };
+static const uint32_t kLodSegments[] = { 64, 32, 16, 8 };
+
+struct LodContext
+{
+	Scene* pScene;
+	StereoView View;
+	SceneRenderer* pRenderer;
+	NullRenderBackend* pBackend;
+	uint64_t Frame;
+	uint64_t Frames;
+	uint64_t Changes;
+};
+
+void SubmitFrame(void* pContext, uint64_t iterations)
+{
+	LodContext* c = static_cast<LodContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		StereoView view = c->View;
+		view.View.m[3][2] += (c->Frame++ & 1) ? 0.1f : 0.0f;
+		c->pRenderer->Submit(*c->pScene, view, 0.0f, c->pBackend, SCENE_SUBMIT_INSTANCED);
+		c->Frames++;
+		c->Changes += c->pRenderer->LodStats().Changes;
+	}
+	BenchClobberMemory();
+}
+
+// Radius 1 spheres, finest first.  A UV sphere's faces sag at most about
+// 1 - cos^2(pi / segments) inside the true sphere, so a LOD's error against
+// the finest is the difference.
+void BuildSphereLods(Scene* pScene)
+{
+	const uint32_t lodCount = sizeof(kLodSegments) / sizeof(kLodSegments[0]);
+	uint32_t startIndex = 0;
+	int32_t baseVertex = 0;
+	float finestSag = 0.0f;
+
+	pScene->Meshes.clear();
+	for (uint32_t lod = 0; lod < lodCount; lod++)
+	{
+		MeshData sphere;
+		BuildSphereMesh(kLodSegments[lod] / 2, kLodSegments[lod], &sphere);
+		float c = cosf(3.14159265f / (float)kLodSegments[lod]);
+		float sag = 1.0f - c * c;
+		if (lod == 0)
+			finestSag = sag;
+
+		SceneMesh mesh;
+		mesh.IndexCount = (uint32_t)sphere.Indices.size();
+		mesh.StartIndex = startIndex;
+		mesh.BaseVertex = baseVertex;
+		mesh.VertexCount = (uint32_t)sphere.Vertices.size();
+		mesh.Radius = 1.0f;
+		mesh.LodCount = lodCount - lod;
+		mesh.LodError = sag - finestSag;
+		pScene->Meshes.push_back(mesh);
+
+		startIndex += mesh.IndexCount;
+		baseVertex += (int32_t)mesh.VertexCount;
+	}
+	pScene->UpdateBounds();
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are objects.  select_us is the last frame's selection alone.
+//--------------------------------------------------------------------------------------
+void BenchLodSuite(BenchRunner& runner)
+{
+	static const char* const variants[] = { "full", "lod", "lod-no-hysteresis" };
+
+	for (int layout = 0; layout < SCENE_LAYOUT_COUNT; layout++)
+	{
+		for (size_t n = 0; n < sizeof(kLodObjectCounts) / sizeof(kLodObjectCounts[0]); n++)
+		{
+			uint32_t count = kLodObjectCounts[n];
+			if (count > runner.Options().MaxObjects)
+				continue;
+
+			char name[64];
+			sprintf(name, "%s/%u", SceneLayoutName((SceneLayout)layout), count);
+			if (!runner.Enabled("lod", name))
+				continue;
+
+			Scene scene;
+			GenerateScene((SceneLayout)layout, count, kLodSeed, &scene);
+			BuildSphereLods(&scene);
+
+			for (int v = 0; v < 3; v++)
+			{
+				SceneRenderer renderer;
+				renderer.SetCulling(true);
+				renderer.SetLod(v != 0);
+				StereoLodConfig config = DefaultStereoLodConfig();
+				if (v == 2)
+					config.Hysteresis = 0.0f;
+				renderer.SetLodConfig(config);
+				NullRenderBackend backend;
+
+				LodContext c;
+				c.pScene = &scene;
+				c.View = DefaultStereoView(1280.0f / 720.0f);
+				c.pRenderer = &renderer;
+				c.pBackend = &backend;
+				c.Frame = 0;
+
+				// Settle first, so changes are the flips and not the first picks.
+				renderer.Submit(scene, c.View, 0.0f, &backend, SCENE_SUBMIT_INSTANCED);
+				c.Frames = 0;
+				c.Changes = 0;
+
+				if (!runner.Run("lod", name, variants[v], SubmitFrame, &c, (double)count))
+					continue;
+
+				const SceneCullStats& cull = renderer.CullStats();
+				uint64_t fullTriangles = (uint64_t)(scene.Meshes[0].IndexCount / 3) * cull.Visible;
+				runner.AddCounter("visible", (double)cull.Visible);
+				runner.AddCounter("full_triangles", (double)fullTriangles);
+				if (v == 0)
+				{
+					runner.AddCounter("triangles", (double)fullTriangles);
+					continue;
+				}
+
+				const StereoLodStats& lod = renderer.LodStats();
+				runner.AddCounter("triangles", (double)lod.Triangles);
+				runner.AddCounter("triangles_percent", fullTriangles ? 100.0 * (double)lod.Triangles / (double)fullTriangles : 0.0);
+				runner.AddCounter("select_us", (double)lod.SelectNs / 1000.0);
+				runner.AddCounter("changes_per_frame", c.Frames ? (double)c.Changes / (double)c.Frames : 0.0);
+				runner.AddCounter("instance_ranges", (double)renderer.InstanceRanges().size());
+			}
+		}
+	}
+}
@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------
+// File: BenchMain.cpp
+//
+// Benchmark runner for the CPU side of the stereo renderer, no device needed.
+//
+//     Benchmarks [-filter suite/name] [-json path] [-label text] [-cpu n]
+//                [-samples n] [-warmup ms] [-target-us n] [-max-objects n] [-list]
+//
+// Results print as a table and go to Benchmarks.json unless -json says otherwise.
+// Build it from Benchmarks.vcxproj, or on Linux with
+//     g++ -std=c++11 -O2 -msse2 -pthread -DPROFILER_ENABLED=1 Bench*.cpp Bvh.cpp DrawQueue.cpp FrameStats.cpp GpuTimer.cpp IndirectDraw.cpp LiveMetrics.cpp MappedFile.cpp Mesh.cpp MeshFile.cpp Meshlet.cpp MeshOptimize.cpp
+//         MeshStream.cpp NvapiShim.cpp NvapiStandIn.cpp ObjImport.cpp Presenter.cpp Profiler.cpp RenderBackend.cpp Scene.cpp SceneRenderer.cpp ShaderCache.cpp StartupTimeline.cpp StereoAudit.cpp StereoCull.cpp
+//         StereoLod.cpp TextureCodec.cpp TextureFile.cpp TextureStream.cpp TransformStore.cpp WorkerPool.cpp -o Benchmarks -lrt
+//
+// NVAPI is the stand-in from NvapiStandIn.cpp on every platform, so the suites
+// that call it run without a driver and can script its answers.  The profiler
+// is always on, nothing but its own suite has zones.
+//--------------------------------------------------------------------------------------
+
+#include "Bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void BenchFrameSuite(BenchRunner& runner);
+void BenchSceneSuite(BenchRunner& runner);
+void BenchInstancingSuite(BenchRunner& runner);
+void BenchTransformsSuite(BenchRunner& runner);
+void BenchBvhSuite(BenchRunner& runner);
+void BenchMeshSuite(BenchRunner& runner);
+void BenchMeshOptSuite(BenchRunner& runner);
+void BenchQuantizeSuite(BenchRunner& runner);
+void BenchMeshletSuite(BenchRunner& runner);
+void BenchStreamSuite(BenchRunner& runner);
+void BenchLodSuite(BenchRunner& runner);
+void BenchDrawSortSuite(BenchRunner& runner);
+void BenchTextureSuite(BenchRunner& runner);
+void BenchIndirectSuite(BenchRunner& runner);
+void BenchShaderCacheSuite(BenchRunner& runner);
+void BenchStereoAuditSuite(BenchRunner& runner);
+void BenchNvapiShimSuite(BenchRunner& runner);
+void BenchPresentSuite(BenchRunner& runner);
+void BenchProfilerSuite(BenchRunner& runner);
+void BenchFrameStatsSuite(BenchRunner& runner);
+void BenchLiveMetricsSuite(BenchRunner& runner);
+void BenchGpuTimerSuite(BenchRunner& runner);
+void BenchStartupSuite(BenchRunner& runner);
+
+
+struct BenchSuite
+{
+	const char* Name;
+	const char* Description;
+	void (*Run)(BenchRunner& runner);
+};
+
+static const BenchSuite s_Suites[] =
+{
+	{ "frame", "Per-frame stereo setup in RenderFrame()", BenchFrameSuite },
+	{ "scene", "Stereo submission from 1 to 1M objects", BenchSceneSuite },
+	{ "instancing", "Per-object against instanced submission", BenchInstancingSuite },
+	{ "transforms", "World matrices from SoA transforms against AoS", BenchTransformsSuite },
+	{ "bvh", "BVH build, refit, stereo cull and picking", BenchBvhSuite },
+	{ "mesh", "Mesh file load to first draw, mapped, read and OBJ", BenchMeshSuite },
+	{ "meshopt", "Vertex cache, overdraw and fetch reordering", BenchMeshOptSuite },
+	{ "quantize", "Vertex formats: write cost, stereo fetch bytes and error", BenchQuantizeSuite },
+	{ "meshlet", "Meshlet build and stereo cluster culling", BenchMeshletSuite },
+	{ "stream", "Meshes loaded before the first frame against streamed", BenchStreamSuite },
+	{ "lod", "Stereo LOD selection with hysteresis on the scaling scenes", BenchLodSuite },
+	{ "drawsort", "Draws in object order against radix sorted by state", BenchDrawSortSuite },
+	{ "texture", "BC texture decoding, scalar against SSE2, and mip streaming", BenchTextureSuite },
+	{ "indirect", "CPU culled draws against GPU culled multi-draw indirect", BenchIndirectSuite },
+	{ "shadercache", "Shader archive keys and warm start lookups", BenchShaderCacheSuite },
+	{ "audit", "Sampled stereo draw audit against scripted NVAPI answers", BenchStereoAuditSuite },
+	{ "nvapishim", "NVAPI call counters and timing under injected failures and latency", BenchNvapiShimSuite },
+	{ "present", "Queue depth and display latency of the simulated swap chain configs", BenchPresentSuite },
+	{ "profiler", "Cost of one profiling zone, recorded, dropped and compiled out", BenchProfilerSuite },
+	{ "framestats", "Frame time quantiles and missed vblanks against known distributions", BenchFrameStatsSuite },
+	{ "livemetrics", "The live metrics seqlock read while another thread publishes", BenchLiveMetricsSuite },
+	{ "gputimer", "GPU timer query ring wraparound and rolling windows on the CPU clock", BenchGpuTimerSuite },
+	{ "startup", "Startup budget checks and report on a timeline with known times", BenchStartupSuite },
+};
+
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options = DefaultBenchOptions();
+	const char* jsonPath = "Benchmarks.json";
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc);
+
+		if (strcmp(argv[i], "-filter") == 0 && hasValue)
+			options.Filter = argv[++i];
+		else if (strcmp(argv[i], "-json") == 0 && hasValue)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "-label") == 0 && hasValue)
+			options.Label = argv[++i];
+		else if (strcmp(argv[i], "-cpu") == 0 && hasValue)
+			options.Cpu = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-samples") == 0 && hasValue)
+			options.Samples = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-warmup") == 0 && hasValue)
+			options.WarmupMs = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-target-us") == 0 && hasValue)
+			options.TargetSampleNs = (uint64_t)atoi(argv[++i]) * 1000;
+		else if (strcmp(argv[i], "-max-objects") == 0 && hasValue)
+			options.MaxObjects = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-list") == 0)
+		{
+			for (size_t s = 0; s < sizeof(s_Suites) / sizeof(s_Suites[0]); s++)
+				printf("%-12s %s\n", s_Suites[s].Name, s_Suites[s].Description);
+			return 0;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-filter suite/name] [-json path] [-label text] [-cpu n] "
+				"[-samples n] [-warmup ms] [-target-us n] [-max-objects n] [-list]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	BenchRunner runner(options);
+	for (size_t s = 0; s < sizeof(s_Suites) / sizeof(s_Suites[0]); s++)
+		s_Suites[s].Run(runner);
+
+	runner.PrintTable();
+	if (!runner.WriteJson(jsonPath))
+	{
+		fprintf(stderr, "Can't write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,223 @@
+//--------------------------------------------------------------------------------------
+// File: BenchMesh.cpp
+//
+// Loading a mesh up to its first draw, from a mapped mesh file, from the same
+// file read into memory first, and from OBJ.  Each op opens the file, gets the
+// vertices and indices, copies them into a buffer the way CreateBuffer copies
+// pSysMem, and makes the first DrawIndexed into a NullRenderBackend, so the
+// median is the time to first draw.
+//
+// The mapped path's only copy is the upload.  Reading first adds one, and OBJ
+// adds the parse.  The files are read again and again, so this is with them in
+// the file cache, which is the case after the first run of the app.  They are
+// written to the working directory and removed after.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "ObjImport.h"
+#include "RenderBackend.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kMeshVertexCounts[] = { 10000, 100000, 1000000 };
+static const char* kMeshPath = "BenchMesh.tmp.smsh";
+static const char* kObjPath = "BenchMesh.tmp.obj";
+
+struct LoadContext
+{
+	std::vector<uint8_t> Device;		// Stands in for the GPU buffers
+	std::vector<uint8_t> Read;			// The read path's copy of the file
+	NullRenderBackend* pBackend;
+	MeshData Obj;
+	bool Failed;
+};
+
+// What CreateBuffer does with the data, and the first draw.
+void Upload(LoadContext* c, const void* pVertices, size_t vertexBytes, const void* pIndices, size_t indexBytes, uint32_t indexCount)
+{
+	if (c->Device.size() < vertexBytes + indexBytes)
+		c->Device.resize(vertexBytes + indexBytes);
+	memcpy(&c->Device[0], pVertices, vertexBytes);
+	memcpy(&c->Device[vertexBytes], pIndices, indexBytes);
+	c->pBackend->DrawIndexed(indexCount, 0, 0);
+}
+
+void LoadMapped(void* pContext, uint64_t iterations)
+{
+	LoadContext* c = static_cast<LoadContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		MappedFile file;
+		MeshFileView view;
+		if (!file.Open(kMeshPath) || !view.Parse(file.Data(), file.Size()))
+		{
+			c->Failed = true;
+			return;
+		}
+		Upload(c, view.Vertices(), view.VertexDataBytes(), view.Indices(), view.IndexDataBytes(), view.IndexCount());
+		BenchClobberMemory();
+	}
+}
+
+void LoadRead(void* pContext, uint64_t iterations)
+{
+	LoadContext* c = static_cast<LoadContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		FILE* f = fopen(kMeshPath, "rb");
+		if (!f)
+		{
+			c->Failed = true;
+			return;
+		}
+		fseek(f, 0, SEEK_END);
+		long bytes = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		c->Read.resize((size_t)bytes);
+		size_t read = fread(&c->Read[0], 1, (size_t)bytes, f);
+		fclose(f);
+
+		MeshFileView view;
+		if (read != (size_t)bytes || !view.Parse(&c->Read[0], read))
+		{
+			c->Failed = true;
+			return;
+		}
+		Upload(c, view.Vertices(), view.VertexDataBytes(), view.Indices(), view.IndexDataBytes(), view.IndexCount());
+		BenchClobberMemory();
+	}
+}
+
+void LoadObj(void* pContext, uint64_t iterations)
+{
+	LoadContext* c = static_cast<LoadContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		if (!ImportObj(kObjPath, &c->Obj))
+		{
+			c->Failed = true;
+			return;
+		}
+		Upload(c, &c->Obj.Vertices[0], c->Obj.Vertices.size() * sizeof(MeshVertex),
+			&c->Obj.Indices[0], c->Obj.Indices.size() * sizeof(uint32_t), (uint32_t)c->Obj.Indices.size());
+		BenchClobberMemory();
+	}
+}
+
+// Undoes what ImportObj does to the handedness, so the mesh reads back the same.
+bool WriteObj(const char* path, const MeshData& mesh)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	for (size_t i = 0; i < mesh.Vertices.size(); i++)
+	{
+		const MeshVertex& v = mesh.Vertices[i];
+		fprintf(f, "v %.6f %.6f %.6f\n", v.Position[0], v.Position[1], -v.Position[2]);
+	}
+	for (size_t i = 0; i < mesh.Vertices.size(); i++)
+	{
+		const MeshVertex& v = mesh.Vertices[i];
+		fprintf(f, "vt %.6f %.6f\n", v.Texcoord[0], 1.0f - v.Texcoord[1]);
+	}
+	for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+	{
+		uint32_t a = mesh.Indices[i] + 1;
+		uint32_t b = mesh.Indices[i + 2] + 1;
+		uint32_t c = mesh.Indices[i + 1] + 1;
+		fprintf(f, "f %u/%u %u/%u %u/%u\n", a, a, b, b, c, c);
+	}
+	return fclose(f) == 0;
+}
+
+long FileBytes(const char* path)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	long bytes = ftell(f);
+	fclose(f);
+	return bytes;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are bytes of the file loaded, so items/s is bytes/s, also given as
+// mb_per_sec.  first_draw_ms is the median op.
+//--------------------------------------------------------------------------------------
+void BenchMeshSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kMeshVertexCounts) / sizeof(kMeshVertexCounts[0]); n++)
+	{
+		uint32_t vertices = kMeshVertexCounts[n];
+		if (vertices > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "sphere/%u", vertices);
+		if (!runner.Enabled("mesh", name))
+			continue;
+
+		uint32_t side = (uint32_t)sqrtf((float)vertices);
+		MeshData sphere;
+		BuildSphereMesh(side - 1, side - 1, &sphere);
+		if (!WriteMeshFile(kMeshPath, sphere) || !WriteObj(kObjPath, sphere))
+		{
+			fprintf(stderr, "mesh: can't write the test files\n");
+			break;
+		}
+
+		NullRenderBackend backend;
+		LoadContext c;
+		c.pBackend = &backend;
+		c.Failed = false;
+
+		struct Variant
+		{
+			const char* Name;
+			BenchFunction Function;
+			const char* Path;
+		};
+		const Variant variants[] =
+		{
+			{ "mapped", LoadMapped, kMeshPath },
+			{ "read", LoadRead, kMeshPath },
+			{ "obj", LoadObj, kObjPath },
+		};
+
+		for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+		{
+			double bytes = (double)FileBytes(variants[v].Path);
+			BenchResult* pResult = runner.Run("mesh", name, variants[v].Name, variants[v].Function, &c, bytes);
+			if (!pResult)
+				continue;
+			if (c.Failed)
+			{
+				fprintf(stderr, "mesh: %s load failed\n", variants[v].Name);
+				break;
+			}
+			runner.AddCounter("vertices", (double)sphere.Vertices.size());
+			runner.AddCounter("triangles", (double)(sphere.Indices.size() / 3));
+			runner.AddCounter("file_mb", bytes / (1024.0 * 1024.0));
+			runner.AddCounter("mb_per_sec", bytes / (1024.0 * 1024.0) * 1e9 / pResult->MedianNs);
+			runner.AddCounter("first_draw_ms", pResult->MedianNs / 1e6);
+		}
+
+		remove(kMeshPath);
+		remove(kObjPath);
+	}
+}
@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------------------
+// File: BenchMeshOpt.cpp
+//
+// The MeshOptimize.h passes, timed, with what they buy.  The test mesh is
+// several overlapping spheres merged into one and its triangles shuffled, as
+// an exporter that doesn't care might leave it, so the cache order starts
+// about as bad as it gets and there is overdraw for the cluster sort to fix.
+//
+// Each result carries the ACMR, ATVR, overfetch and overdraw before and after
+// all three passes, and the vertex shader invocations per eye NullRenderBackend
+// counts drawing the mesh once in stereo.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Mesh.h"
+#include "MeshOptimize.h"
+#include "RenderBackend.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kMeshOptVertexCounts[] = { 10000, 100000, 1000000 };
+static const uint32_t kMeshOptSpheres = 6;
+
+struct OptimizeContext
+{
+	const MeshData* pSource;
+	std::vector<uint32_t> CacheOrder;
+	std::vector<uint32_t> Result;
+	MeshData Copy;
+};
+
+void RunVertexCache(void* pContext, uint64_t iterations)
+{
+	OptimizeContext* c = static_cast<OptimizeContext*>(pContext);
+	const MeshData& mesh = *c->pSource;
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		OptimizeVertexCache(&c->Result[0], &mesh.Indices[0], mesh.Indices.size(), (uint32_t)mesh.Vertices.size());
+		BenchClobberMemory();
+	}
+}
+
+void RunOverdraw(void* pContext, uint64_t iterations)
+{
+	OptimizeContext* c = static_cast<OptimizeContext*>(pContext);
+	const MeshData& mesh = *c->pSource;
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		OptimizeOverdraw(&c->Result[0], &c->CacheOrder[0], c->CacheOrder.size(), &mesh.Vertices[0], (uint32_t)mesh.Vertices.size());
+		BenchClobberMemory();
+	}
+}
+
+// Includes copying the mesh back, since the pass works in place.
+void RunVertexFetch(void* pContext, uint64_t iterations)
+{
+	OptimizeContext* c = static_cast<OptimizeContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Copy.Vertices = c->pSource->Vertices;
+		c->Copy.Indices = c->CacheOrder;
+		BenchDoNotOptimize(OptimizeVertexFetch(&c->Copy));
+		BenchClobberMemory();
+	}
+}
+
+void RunAll(void* pContext, uint64_t iterations)
+{
+	OptimizeContext* c = static_cast<OptimizeContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Copy = *c->pSource;
+		OptimizeMesh(&c->Copy);
+		BenchClobberMemory();
+	}
+}
+
+void BuildTestMesh(uint32_t vertices, MeshData* pMesh)
+{
+	uint32_t side = (uint32_t)sqrtf((float)vertices / (float)kMeshOptSpheres);
+	if (side < 4)
+		side = 4;
+
+	uint64_t random = 0x5EED;
+	for (uint32_t s = 0; s < kMeshOptSpheres; s++)
+	{
+		MeshData sphere;
+		BuildSphereMesh(side - 1, side - 1, &sphere);
+
+		float offset[3];
+		for (int a = 0; a < 3; a++)
+		{
+			random = random * 6364136223846793005ull + 1442695040888963407ull;
+			offset[a] = (float)(random >> 40) / (float)(1 << 24) * 1.5f - 0.75f;
+		}
+
+		uint32_t base = (uint32_t)pMesh->Vertices.size();
+		for (size_t v = 0; v < sphere.Vertices.size(); v++)
+		{
+			MeshVertex vertex = sphere.Vertices[v];
+			for (int a = 0; a < 3; a++)
+				vertex.Position[a] += offset[a];
+			pMesh->Vertices.push_back(vertex);
+		}
+		for (size_t i = 0; i < sphere.Indices.size(); i++)
+			pMesh->Indices.push_back(sphere.Indices[i] + base);
+	}
+
+	// Fisher-Yates over whole triangles.
+	uint32_t triangles = (uint32_t)(pMesh->Indices.size() / 3);
+	for (uint32_t t = triangles - 1; t > 0; t--)
+	{
+		random = random * 6364136223846793005ull + 1442695040888963407ull;
+		uint32_t other = (uint32_t)((random >> 33) % (t + 1));
+		for (int k = 0; k < 3; k++)
+			std::swap(pMesh->Indices[t * 3 + k], pMesh->Indices[other * 3 + k]);
+	}
+}
+
+// Both eyes, one draw each, as RenderFrame draws the cube.
+void CountStereoDraw(const MeshData& mesh, uint64_t eyeInvocations[2])
+{
+	NullRenderBackend backend(4096);
+	backend.SetIndices(&mesh.Indices[0], mesh.Indices.size(), (uint32_t)mesh.Vertices.size());
+	for (uint32_t eye = 0; eye < 2; eye++)
+	{
+		backend.BeginEye(eye);
+		backend.DrawIndexed((uint32_t)mesh.Indices.size(), 0, 0);
+		backend.EndEye();
+	}
+	eyeInvocations[0] = backend.Counters().EyeVertexInvocations[0];
+	eyeInvocations[1] = backend.Counters().EyeVertexInvocations[1];
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are triangles.  The overdraw pass runs on the cache pass's output, as
+// OptimizeMesh runs it.
+//--------------------------------------------------------------------------------------
+void BenchMeshOptSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kMeshOptVertexCounts) / sizeof(kMeshOptVertexCounts[0]); n++)
+	{
+		uint32_t vertices = kMeshOptVertexCounts[n];
+		if (vertices > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "spheres/%u", vertices);
+		if (!runner.Enabled("meshopt", name))
+			continue;
+
+		MeshData mesh;
+		BuildTestMesh(vertices, &mesh);
+		uint32_t vertexCount = (uint32_t)mesh.Vertices.size();
+		double triangles = (double)(mesh.Indices.size() / 3);
+
+		OptimizeContext c;
+		c.pSource = &mesh;
+		c.CacheOrder.resize(mesh.Indices.size());
+		c.Result.resize(mesh.Indices.size());
+		OptimizeVertexCache(&c.CacheOrder[0], &mesh.Indices[0], mesh.Indices.size(), vertexCount);
+
+		// Before and after, the same for every variant.
+		MeshData optimized = mesh;
+		MeshOptimizeReport report;
+		OptimizeMesh(&optimized, &report);
+		float overdrawBefore = AnalyzeOverdraw(&mesh.Indices[0], mesh.Indices.size(), &mesh.Vertices[0], vertexCount);
+		float overdrawAfter = AnalyzeOverdraw(&optimized.Indices[0], optimized.Indices.size(), &optimized.Vertices[0],
+			(uint32_t)optimized.Vertices.size());
+		uint64_t eyeBefore[2];
+		uint64_t eyeAfter[2];
+		CountStereoDraw(mesh, eyeBefore);
+		CountStereoDraw(optimized, eyeAfter);
+
+		struct Variant
+		{
+			const char* Name;
+			BenchFunction Function;
+		};
+		const Variant variants[] =
+		{
+			{ "vcache", RunVertexCache },
+			{ "overdraw", RunOverdraw },
+			{ "fetch", RunVertexFetch },
+			{ "all", RunAll },
+		};
+
+		for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+		{
+			if (!runner.Run("meshopt", name, variants[v].Name, variants[v].Function, &c, triangles))
+				continue;
+			runner.AddCounter("vertices", (double)vertexCount);
+			runner.AddCounter("triangles", triangles);
+			runner.AddCounter("acmr_before", report.CacheBefore.Acmr);
+			runner.AddCounter("acmr_after", report.CacheAfter.Acmr);
+			runner.AddCounter("atvr_before", report.CacheBefore.Atvr);
+			runner.AddCounter("atvr_after", report.CacheAfter.Atvr);
+			runner.AddCounter("overfetch_before", report.FetchBefore.Overfetch);
+			runner.AddCounter("overfetch_after", report.FetchAfter.Overfetch);
+			runner.AddCounter("overdraw_before", overdrawBefore);
+			runner.AddCounter("overdraw_after", overdrawAfter);
+			runner.AddCounter("vs_left_before", (double)eyeBefore[0]);
+			runner.AddCounter("vs_right_before", (double)eyeBefore[1]);
+			runner.AddCounter("vs_left_after", (double)eyeAfter[0]);
+			runner.AddCounter("vs_right_after", (double)eyeAfter[1]);
+		}
+	}
+}
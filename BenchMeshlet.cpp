@@ -0,0 +1,271 @@
+//--------------------------------------------------------------------------------------
+// File: BenchMeshlet.cpp
+//
+// Meshlet build and the per-frame stereo cull, with what the cull saves.
+//
+// The test mesh is a 4 x 4 field of spheres merged into one mesh and
+// optimized, seen from the camera InitDevice() sets up, so some spheres are
+// outside both eyes and about half of each visible one faces away.  Past
+// 65536 vertices a flat index buffer has to be 32 bit; bytes_saved is what the
+// 16 bit groups save against it, less their duplicated vertices.
+//
+// "scattered" is the same field with its triangles shuffled, so every meshlet
+// takes its vertices from all over the mesh and every group has most of them
+// again.  That is the case where the duplicates outweigh what 16 bit indices
+// save, and the mesh has to stay one group of 32 bit indices.
+//
+// vs_left and vs_right are the vertex shader invocations NullRenderBackend
+// counts for the whole mesh in stereo, and the _meshlets counters the same for
+// only the meshlet draws that survive the cull.  After the build every
+// meshlet is drawn, and the draws' indices, read back through their group's
+// BaseVertex and VertexRemap, have to be the source triangles; matches is 1 if
+// they are and the index width is the one expected.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Mesh.h"
+#include "Meshlet.h"
+#include "MeshOptimize.h"
+#include "RenderBackend.h"
+#include "SceneRenderer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kMeshletVertexCounts[] = { 10000, 100000, 1000000 };
+static const uint32_t kMeshletFieldSide = 4;
+static const uint32_t kMeshletScatteredVertices = 100000;
+
+struct MeshletContext
+{
+	const MeshData* pMesh;
+	MeshletMesh Meshlets;
+	MeshletCullSpace Space;
+	std::vector<uint32_t> Visible;
+	std::vector<MeshletDraw> Draws;
+	MeshletCullStats Stats;
+};
+
+void RunBuild(void* pContext, uint64_t iterations)
+{
+	MeshletContext* c = static_cast<MeshletContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		BuildMeshlets(*c->pMesh, 0, (uint32_t)c->pMesh->Indices.size(), sizeof(MeshVertex), &c->Meshlets);
+		BenchClobberMemory();
+	}
+}
+
+// What RenderFrame does with -meshlets each frame, the cull space included.
+void RunCull(void* pContext, uint64_t iterations)
+{
+	MeshletContext* c = static_cast<MeshletContext*>(pContext);
+	StereoView view = DefaultStereoView(1280.0f / 720.0f);
+	SMMatrix world = StereoMathScalar::Identity();
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		BuildMeshletCullSpace(world, view.View, view.Projection, view.Separation, view.Convergence, &c->Space);
+		uint32_t visible = CullMeshlets(c->Meshlets, c->Space, &c->Visible[0], &c->Stats);
+		BuildMeshletDraws(c->Meshlets, &c->Visible[0], visible, &c->Draws);
+		BenchClobberMemory();
+	}
+}
+
+void BuildTestMesh(uint32_t vertices, MeshData* pMesh)
+{
+	uint32_t side = (uint32_t)sqrtf((float)vertices / (float)(kMeshletFieldSide * kMeshletFieldSide));
+	if (side < 4)
+		side = 4;
+
+	MeshData sphere;
+	BuildSphereMesh(side - 1, side - 1, &sphere);
+	for (uint32_t row = 0; row < kMeshletFieldSide; row++)
+	{
+		for (uint32_t column = 0; column < kMeshletFieldSide; column++)
+		{
+			uint32_t base = (uint32_t)pMesh->Vertices.size();
+			for (size_t v = 0; v < sphere.Vertices.size(); v++)
+			{
+				MeshVertex vertex = sphere.Vertices[v];
+				vertex.Position[0] += 4.0f * (float)column - 6.0f;
+				vertex.Position[2] += 4.0f * (float)row - 2.0f;
+				pMesh->Vertices.push_back(vertex);
+			}
+			for (size_t i = 0; i < sphere.Indices.size(); i++)
+				pMesh->Indices.push_back(sphere.Indices[i] + base);
+		}
+	}
+	OptimizeMesh(pMesh);
+}
+
+// Triangle order shuffled with a fixed seed, the vertices left as they are.
+void ScatterTriangles(MeshData* pMesh)
+{
+	uint32_t random = 1;
+	uint32_t triangles = (uint32_t)(pMesh->Indices.size() / 3);
+	for (uint32_t t = triangles - 1; t > 0; t--)
+	{
+		random = random * 1664525u + 1013904223u;
+		uint32_t other = (uint32_t)(((uint64_t)(random >> 8) * (t + 1)) >> 24);
+		for (uint32_t k = 0; k < 3; k++)
+			std::swap(pMesh->Indices[t * 3 + k], pMesh->Indices[other * 3 + k]);
+	}
+}
+
+// Every index the draws cover, through the group's BaseVertex and remap, is
+// the source index at the same position.  Returns how many were checked, or
+// -1 at the first that isn't.
+int64_t CheckDraws(const MeshData& mesh, const MeshletMesh& meshlets, const std::vector<MeshletDraw>& draws)
+{
+	int64_t checked = 0;
+	for (size_t d = 0; d < draws.size(); d++)
+	{
+		const MeshletDraw& draw = draws[d];
+		const MeshletGroup& group = meshlets.Groups[draw.Group];
+		for (uint32_t i = draw.StartIndex; i < draw.StartIndex + draw.IndexCount; i++)
+		{
+			uint32_t index = 0;
+			if (meshlets.IndexBytes == 2)
+			{
+				uint16_t narrow;
+				memcpy(&narrow, &meshlets.IndexData[(size_t)i * 2], sizeof(narrow));
+				index = narrow;
+			}
+			else
+			{
+				memcpy(&index, &meshlets.IndexData[(size_t)i * 4], sizeof(index));
+			}
+			index += group.BaseVertex;
+			if (!meshlets.VertexRemap.empty())
+				index = meshlets.VertexRemap[index];
+			if (index != mesh.Indices[i])
+				return -1;
+			checked++;
+		}
+	}
+	return checked;
+}
+
+// Both eyes, as RenderFrame draws them.  Meshlets keep the triangle order,
+// so their draws are ranges of the source indices too.
+void CountStereoDraws(const MeshData& mesh, const std::vector<MeshletDraw>* pDraws, uint64_t eyeInvocations[2])
+{
+	NullRenderBackend backend(4096);
+	backend.SetIndices(&mesh.Indices[0], mesh.Indices.size(), (uint32_t)mesh.Vertices.size());
+	for (uint32_t eye = 0; eye < 2; eye++)
+	{
+		backend.BeginEye(eye);
+		if (!pDraws)
+			backend.DrawIndexed((uint32_t)mesh.Indices.size(), 0, 0);
+		else
+			for (size_t d = 0; d < pDraws->size(); d++)
+				backend.DrawIndexed((*pDraws)[d].IndexCount, (*pDraws)[d].StartIndex, 0);
+		backend.EndEye();
+	}
+	eyeInvocations[0] = backend.Counters().EyeVertexInvocations[0];
+	eyeInvocations[1] = backend.Counters().EyeVertexInvocations[1];
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are triangles for the build and meshlets for the cull.
+//--------------------------------------------------------------------------------------
+static void BenchMeshletMesh(BenchRunner& runner, const char* name, const MeshData& mesh, uint32_t expectedIndexBytes)
+{
+	double triangles = (double)(mesh.Indices.size() / 3);
+
+	MeshletContext c;
+	c.pMesh = &mesh;
+	BuildMeshlets(mesh, 0, (uint32_t)mesh.Indices.size(), sizeof(MeshVertex), &c.Meshlets);
+	c.Visible.resize(c.Meshlets.Meshlets.size());
+	const MeshletMesh& m = c.Meshlets;
+
+	if (runner.Run("meshlet", name, "build", RunBuild, &c, triangles))
+	{
+		for (size_t i = 0; i < m.Meshlets.size(); i++)
+			c.Visible[i] = (uint32_t)i;
+		BuildMeshletDraws(m, &c.Visible[0], (uint32_t)m.Meshlets.size(), &c.Draws);
+		int64_t checked = CheckDraws(mesh, m, c.Draws);
+		bool matches = checked == (int64_t)mesh.Indices.size() && m.IndexBytes == expectedIndexBytes;
+		if (!matches)
+			fprintf(stderr, "meshlet/%s: %u bit indices, expected %u, and the draws %s the source triangles\n", name,
+				8 * m.IndexBytes, 8 * expectedIndexBytes, checked < 0 ? "don't match" : "don't cover");
+
+		runner.AddCounter("vertices", (double)mesh.Vertices.size());
+		runner.AddCounter("triangles", triangles);
+		runner.AddCounter("meshlets", (double)m.Meshlets.size());
+		runner.AddCounter("triangles_per_meshlet", triangles / (double)m.Meshlets.size());
+		runner.AddCounter("groups", (double)m.Groups.size());
+		runner.AddCounter("index_bits", 8.0 * m.IndexBytes);
+		runner.AddCounter("index_bytes", (double)m.IndexData.size());
+		runner.AddCounter("flat_index_bytes", (double)m.FlatIndexBytes());
+		runner.AddCounter("duplicated_vertices", m.VertexRemap.empty() ? 0.0 : (double)(m.VertexRemap.size() - m.UsedVertexCount));
+		runner.AddCounter("bytes_saved", (double)m.BytesSaved());
+		runner.AddCounter("matches", matches ? 1.0 : 0.0);
+	}
+
+	if (runner.Run("meshlet", name, "cull", RunCull, &c, (double)m.Meshlets.size()))
+	{
+		uint64_t eyeFull[2];
+		uint64_t eyeMeshlets[2];
+		CountStereoDraws(mesh, nullptr, eyeFull);
+		CountStereoDraws(mesh, &c.Draws, eyeMeshlets);
+		bool matches = CheckDraws(mesh, m, c.Draws) >= 0;
+		if (!matches)
+			fprintf(stderr, "meshlet/%s: the culled draws don't match the source triangles\n", name);
+
+		runner.AddCounter("meshlets", (double)c.Stats.Meshlets);
+		runner.AddCounter("visible", (double)c.Stats.Visible);
+		runner.AddCounter("frustum_culled", (double)c.Stats.FrustumCulled);
+		runner.AddCounter("backface_culled", (double)c.Stats.BackfaceCulled);
+		runner.AddCounter("triangles_culled", (double)c.Stats.TrianglesCulled);
+		runner.AddCounter("triangles_culled_percent", 100.0 * (double)c.Stats.TrianglesCulled / triangles);
+		runner.AddCounter("draws", (double)c.Draws.size());
+		runner.AddCounter("vs_left", (double)eyeFull[0]);
+		runner.AddCounter("vs_right", (double)eyeFull[1]);
+		runner.AddCounter("vs_left_meshlets", (double)eyeMeshlets[0]);
+		runner.AddCounter("vs_right_meshlets", (double)eyeMeshlets[1]);
+		runner.AddCounter("matches", matches ? 1.0 : 0.0);
+	}
+}
+
+void BenchMeshletSuite(BenchRunner& runner)
+{
+	char name[64];
+
+	// Up to 65536 vertices the indices are 16 bit, past it the groups make
+	// them 16 bit again.
+	for (size_t n = 0; n < sizeof(kMeshletVertexCounts) / sizeof(kMeshletVertexCounts[0]); n++)
+	{
+		uint32_t vertices = kMeshletVertexCounts[n];
+		if (vertices > runner.Options().MaxObjects)
+			continue;
+
+		sprintf(name, "field/%u", vertices);
+		if (!runner.Enabled("meshlet", name))
+			continue;
+
+		MeshData mesh;
+		BuildTestMesh(vertices, &mesh);
+		BenchMeshletMesh(runner, name, mesh, 2);
+	}
+
+	sprintf(name, "scattered/%u", kMeshletScatteredVertices);
+	if (kMeshletScatteredVertices <= runner.Options().MaxObjects && runner.Enabled("meshlet", name))
+	{
+		MeshData mesh;
+		BuildTestMesh(kMeshletScatteredVertices, &mesh);
+		ScatterTriangles(&mesh);
+		BenchMeshletMesh(runner, name, mesh, 4);
+	}
+}
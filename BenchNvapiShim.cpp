@@ -0,0 +1,228 @@
+//--------------------------------------------------------------------------------------
+// File: BenchNvapiShim.cpp
+//
+// The NVAPI shim over the stand-in, which can fail calls and take as long as
+// it is told to, so the shim's counters can be checked against what was done.
+//
+// "call" is NvAPI_Stereo_GetConvergence made directly and through the shim,
+// the difference being what the shim adds to every call.  "failures" fails
+// one call in four and checks the shim counted each call and each failure,
+// and that a thread's own counts only have that thread's calls.  "latency/<ns>"
+// makes every call take that long and checks the histogram bucket most calls
+// land in holds it.  matches is 1 if the checks pass.
+//
+// The shim's counters only ever grow, so the checks are on what a run adds.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+// Both the real calls and the Shim_ ones are made by name here.
+#define NVAPI_SHIM_ENABLED 0
+
+#include "Bench.h"
+#include "NvapiShim.h"
+#include "NvapiStandIn.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+static const uint64_t kLatencyNs[] = { 1000, 10000, 100000 };
+static const uint32_t kThreadCalls = 1000;
+
+struct ShimContext
+{
+	StereoHandle Handle;
+	float Convergence;
+};
+
+void CallDirect(void* pContext, uint64_t iterations)
+{
+	ShimContext* c = static_cast<ShimContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		NvAPI_Stereo_GetConvergence(c->Handle, &c->Convergence);
+		BenchClobberMemory();
+	}
+}
+
+void CallShim(void* pContext, uint64_t iterations)
+{
+	ShimContext* c = static_cast<ShimContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		Shim_NvAPI_Stereo_GetConvergence(c->Handle, &c->Convergence);
+		BenchClobberMemory();
+	}
+}
+
+// Four calls, the first failed by the stand-in.
+void CallFailing(void* pContext, uint64_t iterations)
+{
+	ShimContext* c = static_cast<ShimContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		NvapiStandInFailNextCalls(1);
+		for (uint32_t i = 0; i < 4; i++)
+			Shim_NvAPI_Stereo_GetSeparation(c->Handle, &c->Convergence);
+		BenchClobberMemory();
+	}
+}
+
+// The stand-in wants NvAPI_Initialize and a device before it hands out the
+// handle, and never looks at the device.
+bool OpenStandIn(StereoHandle* pHandle)
+{
+	static int s_Device;
+	NvapiStandInFailNextCalls(0);
+	NvapiStandInSetCallLatencyNs(0);
+	NvapiStandInSetStereoEnabled(true);
+	*pHandle = nullptr;
+	return NvAPI_Initialize() == NVAPI_OK &&
+		NvAPI_Stereo_CreateHandleFromIUnknown(reinterpret_cast<IUnknown*>(&s_Device), pHandle) == NVAPI_OK;
+}
+
+// What the calls since before added to one function's totals.
+NvapiCallStats StatsSince(const std::vector<NvapiCallStats>& before, NvapiShimFunction function)
+{
+	std::vector<NvapiCallStats> after(NVSHIM_COUNT);
+	NvapiShimGetStats(&after[0]);
+
+	NvapiCallStats s = after[function];
+	s.Calls -= before[function].Calls;
+	s.Failures -= before[function].Failures;
+	s.TotalNs -= before[function].TotalNs;
+	for (uint32_t b = 0; b < kNvapiShimBuckets; b++)
+		s.Buckets[b] -= before[function].Buckets[b];
+	return s;
+}
+
+// Two threads each make kThreadCalls calls.  Each should see only its own in
+// its thread counts, this thread none of them, and the totals all of them.
+bool CheckThreads(StereoHandle handle)
+{
+	std::vector<NvapiCallStats> before(NVSHIM_COUNT);
+	NvapiShimGetStats(&before[0]);
+	uint64_t mineBefore[NVSHIM_COUNT];
+	NvapiShimGetThreadCalls(mineBefore);
+
+	uint64_t theirs[2][NVSHIM_COUNT];
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < 2; t++)
+	{
+		threads.push_back(std::thread([handle, t, &theirs]()
+		{
+			NvU8 activated;
+			for (uint32_t i = 0; i < kThreadCalls; i++)
+				Shim_NvAPI_Stereo_IsActivated(handle, &activated);
+			NvapiShimGetThreadCalls(theirs[t]);
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	uint64_t mineAfter[NVSHIM_COUNT];
+	NvapiShimGetThreadCalls(mineAfter);
+	NvapiCallStats total = StatsSince(before, NVSHIM_Stereo_IsActivated);
+
+	return theirs[0][NVSHIM_Stereo_IsActivated] == kThreadCalls && theirs[1][NVSHIM_Stereo_IsActivated] == kThreadCalls &&
+		mineAfter[NVSHIM_Stereo_IsActivated] == mineBefore[NVSHIM_Stereo_IsActivated] &&
+		total.Calls == 2 * kThreadCalls && total.Failures == 0;
+}
+
+// The most populated bucket.
+uint32_t ModeBucket(const NvapiCallStats& stats)
+{
+	uint32_t mode = 0;
+	for (uint32_t b = 1; b < kNvapiShimBuckets; b++)
+		if (stats.Buckets[b] > stats.Buckets[mode])
+			mode = b;
+	return mode;
+}
+
+}
+
+
+void BenchNvapiShimSuite(BenchRunner& runner)
+{
+	char name[64];
+	ShimContext c;
+	c.Convergence = 0.0f;
+	if (!OpenStandIn(&c.Handle))
+	{
+		fprintf(stderr, "nvapishim: the stand-in gave no stereo handle\n");
+		return;
+	}
+
+	if (runner.Enabled("nvapishim", "call"))
+	{
+		BenchResult* pDirect = runner.Run("nvapishim", "call", "direct", CallDirect, &c);
+		double directNs = pDirect ? pDirect->MedianNs : 0.0;
+		BenchResult* pShim = runner.Run("nvapishim", "call", "shim", CallShim, &c);
+		if (pShim)
+			runner.AddCounter("overhead_ns", pShim->MedianNs - directNs);
+	}
+
+	if (runner.Enabled("nvapishim", "failures"))
+	{
+		std::vector<NvapiCallStats> before(NVSHIM_COUNT);
+		NvapiShimGetStats(&before[0]);
+		uint64_t mineBefore[NVSHIM_COUNT];
+		NvapiShimGetThreadCalls(mineBefore);
+
+		if (runner.Run("nvapishim", "failures", "1 in 4", CallFailing, &c, 4.0))
+		{
+			NvapiCallStats s = StatsSince(before, NVSHIM_Stereo_GetSeparation);
+			uint64_t mineAfter[NVSHIM_COUNT];
+			NvapiShimGetThreadCalls(mineAfter);
+
+			bool counted = s.Calls > 0 && s.Calls == 4 * s.Failures &&
+				mineAfter[NVSHIM_Stereo_GetSeparation] - mineBefore[NVSHIM_Stereo_GetSeparation] == s.Calls;
+			if (!counted)
+				fprintf(stderr, "nvapishim/failures: %llu calls and %llu failures, expected 4 calls a failure\n",
+					(unsigned long long)s.Calls, (unsigned long long)s.Failures);
+			bool threads = CheckThreads(c.Handle);
+			if (!threads)
+				fprintf(stderr, "nvapishim/failures: the per thread counts don't add up\n");
+
+			runner.AddCounter("calls", (double)s.Calls);
+			runner.AddCounter("failures", (double)s.Failures);
+			runner.AddCounter("matches", (counted && threads) ? 1.0 : 0.0);
+		}
+		NvapiStandInFailNextCalls(0);
+	}
+
+	for (size_t i = 0; i < sizeof(kLatencyNs) / sizeof(kLatencyNs[0]); i++)
+	{
+		uint64_t latencyNs = kLatencyNs[i];
+		sprintf(name, "latency/%llu", (unsigned long long)latencyNs);
+		if (!runner.Enabled("nvapishim", name))
+			continue;
+
+		std::vector<NvapiCallStats> before(NVSHIM_COUNT);
+		NvapiShimGetStats(&before[0]);
+		NvapiStandInSetCallLatencyNs(latencyNs);
+		BenchResult* pResult = runner.Run("nvapishim", name, "shim", CallShim, &c);
+		NvapiStandInSetCallLatencyNs(0);
+		if (!pResult)
+			continue;
+
+		// A call takes at least the latency, and a little more for the stand-in
+		// and the shim, so it lands in the bucket holding the latency or the next.
+		NvapiCallStats s = StatsSince(before, NVSHIM_Stereo_GetConvergence);
+		uint32_t mode = ModeBucket(s);
+		double startNs = s.BucketStartNs[mode];
+		double endNs = (mode + 1 < kNvapiShimBuckets) ? s.BucketStartNs[mode + 1] : s.MaxNs;
+		bool matches = s.Calls > 0 && endNs > (double)latencyNs && startNs <= 1.25 * (double)latencyNs;
+		if (!matches)
+			fprintf(stderr, "nvapishim/%s: most calls in [%.0f, %.0f) ns\n", name, startNs, endNs);
+
+		runner.AddCounter("mean_ns", s.Calls ? s.TotalNs / (double)s.Calls : 0.0);
+		runner.AddCounter("bucket_start_ns", startNs);
+		runner.AddCounter("bucket_end_ns", endNs);
+		runner.AddCounter("matches", matches ? 1.0 : 0.0);
+	}
+}
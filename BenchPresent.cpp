@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------
+// File: BenchPresent.cpp
+//
+// Frame pacing on the SimulatedDisplay, the way RenderFrame() drives a presenter:
+// WaitForNextFrame with the waitable object, the frame's work, Present, then
+// the PresentTracker fed with the statistics.  The display is 120Hz, and each
+// frame's work takes half a refresh, so the display sets the pace.
+//
+// Each op is a second of frames in virtual time, so the time is only what the
+// simulation costs.  The counters are from the frames after the queue filled.
+// queue is the deepest the queue got, present_ms the present to display latency
+// PresentTracker measured, and start_ms the frame's start to display, which is
+// the latency the waitable object is there to cut.  With Q frames allowed in the
+// queue and a refresh period of T:
+//
+//     blocking		Present waits for room, so queue Q, present Q * T, start (Q + 1) * T
+//     waitable		the frame waits for room, so queue Q, present Q * T - work, start Q * T
+//
+// Q is MaxFrameLatency, and for flip model no more than BufferCount - 1.
+// matches is 1 if the run came out at exactly that, with no missed refreshes.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Presenter.h"
+
+#include <stdio.h>
+
+
+namespace
+{
+
+static const uint32_t kRefreshHz = 120;
+static const uint64_t kRefreshNs = 1000000000ull / kRefreshHz;
+static const uint64_t kWorkNs = kRefreshNs / 2;
+static const uint32_t kFrames = kRefreshHz;
+static const uint32_t kSettleFrames = 16;		// Enough for the deepest queue to fill
+static const uint32_t kHistory = 16;
+
+struct PresentCase
+{
+	uint32_t BufferCount;
+	uint32_t MaxFrameLatency;
+	bool FlipModel;
+};
+
+static const PresentCase kCases[] =
+{
+	{ 1, 3, false },				// The original setup
+	{ 2, 1, true },
+	{ 2, 3, true },
+	{ 3, 1, true },
+	{ 3, 2, true },
+	{ 3, 3, true },
+	{ 4, 3, true },
+};
+
+struct PresentContext
+{
+	SwapChainConfig Config;
+
+	// From the last op.
+	uint32_t MaxQueued;
+	uint32_t MissedRefreshes;
+	uint64_t MinPresentNs, MaxPresentNs;
+	uint64_t MinStartNs, MaxStartNs;
+};
+
+void Include(uint64_t value, uint64_t* pMin, uint64_t* pMax)
+{
+	if (value < *pMin)
+		*pMin = value;
+	if (value > *pMax)
+		*pMax = value;
+}
+
+void RunFrames(void* pContext, uint64_t iterations)
+{
+	PresentContext* c = static_cast<PresentContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		SimulatedDisplay display(c->Config, kRefreshHz);
+		PresentTracker tracker(kRefreshNs);
+		uint64_t startNs[kHistory];
+		uint32_t lastShown = 0;
+
+		c->MaxQueued = 0;
+		c->MinPresentNs = c->MinStartNs = ~0ull;
+		c->MaxPresentNs = c->MaxStartNs = 0;
+		uint32_t missedBefore = 0;
+
+		for (uint32_t frame = 0; frame < kFrames; frame++)
+		{
+			if (c->Config.WaitableObject)
+				display.WaitForNextFrame(1000);
+
+			uint32_t presentId = display.GetLastPresentCount() + 1;
+			startNs[presentId & (kHistory - 1)] = display.NowNs();
+			display.AdvanceTime(kWorkNs);
+
+			display.Present(c->Config.SyncInterval);
+			tracker.OnPresent(display.GetLastPresentCount(), display.NowNs());
+			if (display.QueuedFrames() > c->MaxQueued && frame >= kSettleFrames)
+				c->MaxQueued = display.QueuedFrames();
+
+			PresentStatistics stats;
+			if (!display.GetFrameStatistics(&stats))
+				continue;
+			tracker.OnStatistics(stats);
+			if (frame == kSettleFrames)
+				missedBefore = tracker.MissedRefreshes();
+			if (frame < kSettleFrames || stats.PresentCount == lastShown)
+				continue;
+
+			uint64_t displayNs = stats.SyncTimeNs - (uint64_t)(stats.SyncRefreshCount - stats.PresentRefreshCount) * kRefreshNs;
+			Include(tracker.LastLatencyNs(), &c->MinPresentNs, &c->MaxPresentNs);
+			Include(displayNs - startNs[stats.PresentCount & (kHistory - 1)], &c->MinStartNs, &c->MaxStartNs);
+			lastShown = stats.PresentCount;
+		}
+		c->MissedRefreshes = tracker.MissedRefreshes() - missedBefore;
+		BenchClobberMemory();
+	}
+}
+
+}
+
+
+void BenchPresentSuite(BenchRunner& runner)
+{
+	char name[64];
+
+	for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); i++)
+	{
+		const PresentCase& pc = kCases[i];
+		for (int waitable = 0; waitable < 2; waitable++)
+		{
+			sprintf(name, "%s%u/latency%u/%s", pc.FlipModel ? "flip" : "blt", pc.BufferCount, pc.MaxFrameLatency,
+				waitable ? "waitable" : "blocking");
+			if (!runner.Enabled("present", name))
+				continue;
+
+			PresentContext c;
+			c.Config = DefaultSwapChainConfig();
+			c.Config.BufferCount = pc.BufferCount;
+			c.Config.MaxFrameLatency = pc.MaxFrameLatency;
+			c.Config.SyncInterval = 1;
+			c.Config.FlipModel = pc.FlipModel;
+			c.Config.WaitableObject = (waitable != 0);
+
+			if (!runner.Run("present", name, "simulated", RunFrames, &c, (double)kFrames))
+				continue;
+
+			uint32_t queue = pc.MaxFrameLatency;
+			if (pc.FlipModel && pc.BufferCount - 1 < queue)
+				queue = pc.BufferCount - 1;
+			uint64_t presentNs = queue * kRefreshNs - (waitable ? kWorkNs : 0);
+			uint64_t startNs = (queue + (waitable ? 0 : 1)) * kRefreshNs;
+
+			bool matches = c.MaxQueued == queue && c.MissedRefreshes == 0 &&
+				c.MinPresentNs == presentNs && c.MaxPresentNs == presentNs &&
+				c.MinStartNs == startNs && c.MaxStartNs == startNs;
+			if (!matches)
+				fprintf(stderr, "present/%s: queue %u, present %.3f-%.3f ms, start %.3f-%.3f ms, "
+					"expected queue %u, present %.3f ms, start %.3f ms\n", name, c.MaxQueued,
+					c.MinPresentNs / 1e6, c.MaxPresentNs / 1e6, c.MinStartNs / 1e6, c.MaxStartNs / 1e6,
+					queue, presentNs / 1e6, startNs / 1e6);
+
+			runner.AddCounter("queue", (double)c.MaxQueued);
+			runner.AddCounter("present_ms", (double)c.MaxPresentNs / 1e6);
+			runner.AddCounter("start_ms", (double)c.MaxStartNs / 1e6);
+			runner.AddCounter("missed", (double)c.MissedRefreshes);
+			runner.AddCounter("matches", matches ? 1.0 : 0.0);
+		}
+	}
+}
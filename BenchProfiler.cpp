@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------
+// File: BenchProfiler.cpp
+//
+// What a PROFILE_ZONE costs.  The Benchmarks build with PROFILER_ENABLED set,
+// so the zones here are the ones Debug and Profile builds of Tutorial07 record.
+//
+// Each op is kZonesPerOp empty zones, one after another, the times are per
+// zone.  "zone/enabled" records every zone, its buffer emptied between ops so
+// it never fills.  "zone/full" is the same zone with the buffer full, which is
+// only the count check and the dropped counter.  "zone/disabled" is the loop
+// with what PROFILE_ZONE becomes in Release, nothing, for the floor.  The zone
+// is meant to cost under kBudgetNs, under_budget says whether it does here.
+//--------------------------------------------------------------------------------------
+#include "Bench.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+
+
+namespace
+{
+
+static const uint32_t kZonesPerOp = 1024;
+static const double kBudgetNs = 50.0;
+
+#if PROFILER_ENABLED
+
+void RunEnabled(void*, uint64_t iterations)
+{
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (uint32_t z = 0; z < kZonesPerOp; z++)
+		{
+			PROFILE_ZONE("BenchZone");
+			BenchClobberMemory();
+		}
+		// This thread is the only writer, and nothing exports while it runs.
+		g_pProfileThreadBuffer->Count.store(0, std::memory_order_relaxed);
+	}
+}
+
+void RunFull(void*, uint64_t iterations)
+{
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (uint32_t z = 0; z < kZonesPerOp; z++)
+		{
+			PROFILE_ZONE("BenchZone");
+			BenchClobberMemory();
+		}
+	}
+}
+
+#endif
+
+void RunDisabled(void*, uint64_t iterations)
+{
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (uint32_t z = 0; z < kZonesPerOp; z++)
+		{
+			((void)0);
+			BenchClobberMemory();
+		}
+	}
+}
+
+}
+
+
+void BenchProfilerSuite(BenchRunner& runner)
+{
+	if (!runner.Enabled("profiler", "zone"))
+		return;
+
+#if PROFILER_ENABLED
+	// Every zone of an op fits, and this thread's buffer is made before timing starts.
+	ProfilerInit(kZonesPerOp);
+	ProfilerSetThreadName("Bench");
+
+	BenchResult* pResult = runner.Run("profiler", "zone", "enabled", RunEnabled, nullptr, (double)kZonesPerOp);
+	if (pResult)
+	{
+		double zoneNs = pResult->MedianNs / kZonesPerOp;
+		if (zoneNs >= kBudgetNs)
+			fprintf(stderr, "profiler/zone: %.1f ns a zone, the budget is %.0f ns\n", zoneNs, kBudgetNs);
+		runner.AddCounter("ns_per_zone", zoneNs);
+		runner.AddCounter("under_budget", zoneNs < kBudgetNs ? 1.0 : 0.0);
+	}
+
+	g_pProfileThreadBuffer->Count.store(g_pProfileThreadBuffer->Capacity, std::memory_order_relaxed);
+	pResult = runner.Run("profiler", "zone", "full", RunFull, nullptr, (double)kZonesPerOp);
+	if (pResult)
+		runner.AddCounter("ns_per_zone", pResult->MedianNs / kZonesPerOp);
+	g_pProfileThreadBuffer->Count.store(0, std::memory_order_relaxed);
+#else
+	fprintf(stderr, "profiler: built without PROFILER_ENABLED, only the disabled zone is timed\n");
+#endif
+
+	BenchResult* pDisabled = runner.Run("profiler", "zone", "disabled", RunDisabled, nullptr, (double)kZonesPerOp);
+	if (pDisabled)
+		runner.AddCounter("ns_per_zone", pDisabled->MedianNs / kZonesPerOp);
+}
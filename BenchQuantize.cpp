@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------
+// File: BenchQuantize.cpp
+//
+// The mesh vertex formats side by side: what each costs to write, what it
+// saves in vertex fetch a stereo frame, and the error it introduces.
+//
+// The mesh is a UV sphere, cache and fetch optimized first, since that is
+// how MeshConvert -optimize leaves a mesh and the fetch numbers mean most
+// there.  fetch_bytes_per_frame is AnalyzeVertexFetch's bytes for one draw
+// of the mesh, times two for the eyes.  Errors are in mesh units for a
+// radius 1 sphere, and texture widths.
+//
+// The octahedral variant encodes the sphere's normals, which are its
+// positions, as the format for normals would once meshes carry them.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshOptimize.h"
+#include "VertexQuantize.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kQuantizeVertexCounts[] = { 10000, 100000, 1000000 };
+
+struct QuantizeContext
+{
+	const MeshData* pMesh;
+	MeshVertexFormat Format;
+	std::vector<uint8_t> Image;
+	std::vector<int16_t> Normals;
+};
+
+void RunSerialize(void* pContext, uint64_t iterations)
+{
+	QuantizeContext* c = static_cast<QuantizeContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		SerializeMesh(*c->pMesh, &c->Image, c->Format);
+		BenchClobberMemory();
+	}
+}
+
+void RunOctahedral(void* pContext, uint64_t iterations)
+{
+	QuantizeContext* c = static_cast<QuantizeContext*>(pContext);
+	const std::vector<MeshVertex>& vertices = c->pMesh->Vertices;
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (size_t i = 0; i < vertices.size(); i++)
+			OctahedralEncode(vertices[i].Position, &c->Normals[i * 2]);
+		BenchClobberMemory();
+	}
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are vertices.
+//--------------------------------------------------------------------------------------
+void BenchQuantizeSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kQuantizeVertexCounts) / sizeof(kQuantizeVertexCounts[0]); n++)
+	{
+		uint32_t vertices = kQuantizeVertexCounts[n];
+		if (vertices > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "sphere/%u", vertices);
+		if (!runner.Enabled("quantize", name))
+			continue;
+
+		uint32_t side = (uint32_t)sqrtf((float)vertices);
+		MeshData sphere;
+		BuildSphereMesh(side - 1, side - 1, &sphere);
+		OptimizeMesh(&sphere);
+		uint32_t vertexCount = (uint32_t)sphere.Vertices.size();
+
+		QuantizeContext c;
+		c.pMesh = &sphere;
+		c.Normals.resize(sphere.Vertices.size() * 2);
+
+		for (int format = 0; format < MESH_VERTEX_FORMAT_COUNT; format++)
+		{
+			c.Format = (MeshVertexFormat)format;
+			if (!runner.Run("quantize", name, MeshVertexFormatName(c.Format), RunSerialize, &c, (double)vertexCount))
+				continue;
+
+			uint32_t stride = MeshVertexStride(c.Format);
+			VertexFetchStats fetch = AnalyzeVertexFetch(&sphere.Indices[0], sphere.Indices.size(), vertexCount, stride);
+			MeshQuantizeError error = MeasureQuantizeError(sphere, c.Format);
+			runner.AddCounter("vertices", (double)vertexCount);
+			runner.AddCounter("stride", (double)stride);
+			runner.AddCounter("vertex_mb", (double)vertexCount * stride / (1024.0 * 1024.0));
+			runner.AddCounter("fetch_bytes_per_frame", 2.0 * (double)fetch.BytesFetched);
+			runner.AddCounter("position_max_error", error.PositionMax);
+			runner.AddCounter("position_rms_error", error.PositionRms);
+			runner.AddCounter("texcoord_max_error", error.TexcoordMax);
+			runner.AddCounter("texcoord_rms_error", error.TexcoordRms);
+		}
+
+		if (!runner.Run("quantize", name, "octahedral", RunOctahedral, &c, (double)vertexCount))
+			continue;
+
+		double maxDegrees = 0.0;
+		double squares = 0.0;
+		for (size_t i = 0; i < sphere.Vertices.size(); i++)
+		{
+			const float* p = sphere.Vertices[i].Position;
+			float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			float decoded[3];
+			OctahedralDecode(&c.Normals[i * 2], decoded);
+			double cosine = (p[0] * decoded[0] + p[1] * decoded[1] + p[2] * decoded[2]) / length;
+			double degrees = acos((cosine > 1.0) ? 1.0 : cosine) * 57.29577951308232;
+			maxDegrees = (degrees > maxDegrees) ? degrees : maxDegrees;
+			squares += degrees * degrees;
+		}
+		runner.AddCounter("vertices", (double)vertexCount);
+		runner.AddCounter("normal_bytes", 4.0);
+		runner.AddCounter("normal_max_degrees", maxDegrees);
+		runner.AddCounter("normal_rms_degrees", sqrt(squares / (double)vertexCount));
+	}
+}
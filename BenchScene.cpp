@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------------------
+// File: BenchScene.cpp
+//
+// How stereo submission scales with the number of objects: one frame of
+// SceneRenderer::Submit into a NullRenderBackend, for each scene layout at
+// 1, 100, 10k and 1M cubes, with and without culling.  The seed is fixed so
+// every run draws the same scenes.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "SceneRenderer.h"
+
+#include <stdio.h>
+
+
+namespace
+{
+
+static const uint32_t kSceneSeed = 0x5EED;
+static const uint32_t kObjectCounts[] = { 1, 100, 10000, 1000000 };
+
+struct SceneContext
+{
+	Scene* pScene;
+	StereoView View;
+	SceneRenderer* pRenderer;
+	NullRenderBackend* pBackend;
+	float Time;
+};
+
+void SubmitFrame(void* pContext, uint64_t iterations)
+{
+	SceneContext* c = static_cast<SceneContext*>(pContext);
+	for (uint64_t i = 0; i < iterations; i++)
+	{
+		c->Time += 0.016f;
+		if (c->Time > 6.2831853f)
+			c->Time -= 6.2831853f;
+		c->pRenderer->Submit(*c->pScene, c->View, c->Time, c->pBackend);
+	}
+	BenchClobberMemory();
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// One op is a whole stereo frame, so items/s is objects/s.  Triangles count
+// both eyes.  resident_bytes is how much the process grew for the scene,
+// renderer and backend together.  Each scene runs without culling and with the
+// union frustum cull, which reports what it culled and the time it took, the
+// last frame's rather than a median.
+//--------------------------------------------------------------------------------------
+void BenchSceneSuite(BenchRunner& runner)
+{
+	for (int layout = 0; layout < SCENE_LAYOUT_COUNT; layout++)
+	{
+		for (size_t n = 0; n < sizeof(kObjectCounts) / sizeof(kObjectCounts[0]); n++)
+		{
+			uint32_t count = kObjectCounts[n];
+			if (count > runner.Options().MaxObjects)
+				continue;
+
+			char name[64];
+			sprintf(name, "%s/%u", SceneLayoutName((SceneLayout)layout), count);
+			if (!runner.Enabled("scene", name))
+				continue;
+
+			uint64_t residentBefore = BenchResidentBytes();
+
+			Scene scene;
+			GenerateScene((SceneLayout)layout, count, kSceneSeed, &scene);
+
+			for (int culled = 0; culled < 2; culled++)
+			{
+				SceneRenderer renderer;
+				renderer.SetCulling(culled != 0);
+				NullRenderBackend backend;
+
+				SceneContext c;
+				c.pScene = &scene;
+				c.View = DefaultStereoView(1280.0f / 720.0f);
+				c.pRenderer = &renderer;
+				c.pBackend = &backend;
+				c.Time = 0.0f;
+
+				// Once up front, so the memory and counts are for exactly one frame.
+				renderer.Submit(scene, c.View, c.Time, &backend);
+				RenderBackendCounters frame = backend.Counters();
+				uint64_t residentAfter = BenchResidentBytes();
+
+				BenchResult* pResult = runner.Run("scene", name, culled ? "stereo-culled" : "stereo", SubmitFrame, &c, (double)count);
+				if (!pResult)
+					continue;
+
+				// Triangles actually submitted, which culling cuts.
+				const SceneCullStats& cull = renderer.CullStats();
+				double triangles = (double)scene.TriangleCount() * (double)cull.Visible / (double)count;
+				runner.AddCounter("triangles_per_sec", triangles * 2.0 * 1e9 / pResult->MedianNs);
+				runner.AddCounter("submit_ms", pResult->MedianNs / 1e6);
+				runner.AddCounter("draws", (double)frame.Draws);
+				runner.AddCounter("constant_bytes", (double)frame.ConstantBytes);
+				if (culled)
+				{
+					runner.AddCounter("total", (double)cull.Total);
+					runner.AddCounter("culled", (double)(cull.Total - cull.Visible));
+					runner.AddCounter("cull_ms", (double)cull.CullNs / 1e6);
+				}
+				runner.AddCounter("scene_bytes", (double)scene.MemoryBytes());
+				runner.AddCounter("renderer_bytes", (double)renderer.MemoryBytes());
+				runner.AddCounter("backend_bytes", (double)backend.MemoryBytes());
+				runner.AddCounter("resident_bytes", (residentAfter > residentBefore) ? (double)(residentAfter - residentBefore) : 0.0);
+			}
+		}
+	}
+}
@@ -0,0 +1,155 @@
+//--------------------------------------------------------------------------------------
+// File: BenchShaderCache.cpp
+//
+// The shader archive's side of a warm start, what replaces D3DCompile when
+// every shader hits.  Compiling itself needs d3dcompiler, so its time is only
+// in Tutorial07's report.
+//
+// "key" builds the keys for a source the size of Tutorial07.fx, which is done
+// every launch, hit or not.  Each "hit" op opens an archive of that many
+// shaders, written to the working directory first and removed after so it is
+// in the file cache, finds every one and copies its bytecode out the way
+// Tutorial07 hands it to D3DCreateBlob.  The bytecode is random, 2KB to 8KB a
+// shader, about what Tutorial07's shaders come to.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "ShaderCache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kHitShaderCounts[] = { 4, 64, 1024 };
+static const uint32_t kSourceBytes = 6 * 1024;
+static const uint32_t kCompilerVersion = 47;
+
+struct KeyContext
+{
+	std::vector<char> Source;
+	ShaderCacheKey Keys[4];
+};
+
+void RunKey(void* pContext, uint64_t iterations)
+{
+	static const char* kEntryPoints[] = { "VS", "PS", "VSInstanced", "CullIndirect" };
+	static const char* kTargets[] = { "vs_4_0", "ps_4_0", "vs_4_0", "cs_5_0" };
+	KeyContext* c = static_cast<KeyContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (uint32_t s = 0; s < 4; s++)
+			MakeShaderCacheKey(&c->Source[0], c->Source.size(), "", 0x800, kEntryPoints[s], kTargets[s], kCompilerVersion, &c->Keys[s]);
+		BenchClobberMemory();
+	}
+}
+
+struct HitContext
+{
+	std::string Path;
+	std::vector<ShaderCacheKey> Keys;
+	std::vector<uint8_t> Blob;
+	uint64_t Bytes;
+	bool Failed;
+};
+
+void RunHit(void* pContext, uint64_t iterations)
+{
+	HitContext* c = static_cast<HitContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		ShaderCache cache;
+		if (!cache.Open(c->Path.c_str()))
+		{
+			c->Failed = true;
+			return;
+		}
+		c->Bytes = 0;
+		for (size_t k = 0; k < c->Keys.size(); k++)
+		{
+			size_t bytes = 0;
+			const void* pData = cache.Find(c->Keys[k], &bytes);
+			if (!pData)
+			{
+				c->Failed = true;
+				return;
+			}
+			memcpy(&c->Blob[0], pData, bytes);
+			c->Bytes += bytes;
+		}
+		BenchClobberMemory();
+	}
+}
+
+}
+
+
+void BenchShaderCacheSuite(BenchRunner& runner)
+{
+	char name[64];
+	uint32_t seed = 1;
+
+	if (runner.Enabled("shadercache", "key"))
+	{
+		KeyContext c;
+		c.Source.resize(kSourceBytes);
+		for (size_t i = 0; i < c.Source.size(); i++)
+			c.Source[i] = (char)(' ' + (i * 7 + i / 61) % 90);
+
+		BenchResult* pResult = runner.Run("shadercache", "key", "fnv1a", RunKey, &c, 4.0);
+		if (pResult)
+			runner.AddCounter("source_mb_per_sec", 4.0 * kSourceBytes / (1024.0 * 1024.0) * 1e9 / pResult->MedianNs);
+	}
+
+	for (size_t i = 0; i < sizeof(kHitShaderCounts) / sizeof(kHitShaderCounts[0]); i++)
+	{
+		uint32_t count = kHitShaderCounts[i];
+		sprintf(name, "hit/%u", count);
+		if (!runner.Enabled("shadercache", name) || count > runner.Options().MaxObjects)
+			continue;
+
+		HitContext c;
+		c.Path = "BenchShaderCache.tmp.bin";
+		c.Bytes = 0;
+		c.Failed = false;
+		c.Blob.resize(8192);
+
+		// Every shader a different entry point, so none replaces another.
+		ShaderCache cache;
+		uint64_t archiveBytes = 0;
+		for (uint32_t s = 0; s < count; s++)
+		{
+			char entryPoint[32];
+			sprintf(entryPoint, "Shader%u", s);
+			ShaderCacheKey key;
+			MakeShaderCacheKey(&s, sizeof(s), "", 0x800, entryPoint, "vs_4_0", kCompilerVersion, &key);
+			c.Keys.push_back(key);
+
+			std::vector<uint8_t> bytecode(2048 + (s * 613) % 6144);
+			for (size_t b = 0; b < bytecode.size(); b++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				bytecode[b] = (uint8_t)(seed >> 24);
+			}
+			cache.Add(key, &bytecode[0], bytecode.size(), 0);
+			archiveBytes += bytecode.size();
+		}
+		c.Failed = !cache.Save(c.Path.c_str());
+		cache.Close();
+
+		if (!c.Failed && runner.Run("shadercache", name, "find", RunHit, &c, (double)count) && !c.Failed)
+		{
+			runner.AddCounter("shaders", (double)count);
+			runner.AddCounter("bytecode_kb", (double)archiveBytes / 1024.0);
+			runner.AddCounter("copied_kb", (double)c.Bytes / 1024.0);
+		}
+		if (c.Failed)
+			fprintf(stderr, "shadercache/%s: the archive can't be written or read\n", name);
+		remove(c.Path.c_str());
+	}
+}
@@ -0,0 +1,196 @@
+//--------------------------------------------------------------------------------------
+// File: BenchStartup.cpp
+//
+// The startup timeline's budget check and report, on a timeline whose times
+// are known.
+//
+// The timeline is "Startup" with spans added as a loader thread would, so
+// their wall and CPU times are exact: Load at 10ms wall and 8ms CPU, Parse
+// under it at 4ms and 3ms, and Worker twice at 6ms and 5ms.  Spans whose parent
+// isn't in the table yet have to be refused.  The budget file,
+// written to the working directory and removed after, has
+//
+//     Startup/Load			20 10		passes
+//     Startup/Load/Parse		2			fails on wall time
+//     Startup/Worker		15 9		fails on CPU time, the two runs summed
+//     Startup/Missing		1			never ran, so passes
+//
+// Each op is StartupTimelineCheckBudget, reading the file and matching every
+// path.  matches is 1 if it failed overall and each check has the expected
+// times and result, and the report written from them has every phase and
+// check in it with "budget_passed":false.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "StartupTimeline.h"
+#include "Timing.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+static const char* kBudgetPath = "BenchStartup.tmp.budget";
+static const char* kReportPath = "BenchStartup.tmp.json";
+static const uint64_t kMs = 1000000;
+
+static const char* kBudget =
+	"# path                wall_ms  [cpu_ms]\n"
+	"Startup/Load          20       10\n"
+	"Startup/Load/Parse    2\n"
+	"Startup/Worker        15       9        # Two runs of 6 and 5\n"
+	"Startup/Missing       1\n";
+
+struct ExpectedCheck
+{
+	const char* Path;
+	double WallMs;
+	double CpuMs;
+	bool Ran;
+	bool Passed;
+};
+
+static const ExpectedCheck kExpected[] =
+{
+	{ "Startup/Load", 10.0, 8.0, true, true },
+	{ "Startup/Load/Parse", 4.0, 3.0, true, false },
+	{ "Startup/Worker", 12.0, 10.0, true, false },
+	{ "Startup/Missing", 0.0, 0.0, false, true },
+};
+
+struct BudgetContext
+{
+	std::vector<StartupBudgetCheck> Checks;
+	bool Passed;
+};
+
+void RunCheckBudget(void* pContext, uint64_t iterations)
+{
+	BudgetContext* c = static_cast<BudgetContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		c->Passed = StartupTimelineCheckBudget(kBudgetPath, &c->Checks);
+		BenchClobberMemory();
+	}
+}
+
+bool BuildTimeline()
+{
+	StartupTimelineBegin();
+	uint64_t startNs = GetTimeNs();
+	int load = StartupTimelineAddSpan("Load", -1, startNs, startNs + 10 * kMs, 8 * kMs);
+	int parse = StartupTimelineAddSpan("Parse", load, startNs + 2 * kMs, startNs + 6 * kMs, 3 * kMs);
+	int worker0 = StartupTimelineAddSpan("Worker", -1, startNs, startNs + 6 * kMs, 5 * kMs);
+	int worker1 = StartupTimelineAddSpan("Worker", -1, startNs + 6 * kMs, startNs + 12 * kMs, 5 * kMs);
+
+	// Parents not in the table yet, itself included, are refused.
+	uint32_t count = StartupTimelineCount();
+	bool refused = StartupTimelineAddSpan("Ahead", (int)count, startNs, startNs + kMs, 0) == -1 &&
+		StartupTimelineAddSpan("Ahead", (int)count + 100, startNs, startNs + kMs, 0) == -1 &&
+		StartupTimelineCount() == count;
+	if (!refused)
+		fprintf(stderr, "startup/budget: a span was added under a parent past the end of the table\n");
+	StartupTimelineEnd();
+	return load > 0 && parse > load && worker0 > parse && worker1 > worker0 && refused;
+}
+
+bool WriteBudget()
+{
+	FILE* f = fopen(kBudgetPath, "wb");
+	if (!f)
+		return false;
+	bool written = fputs(kBudget, f) >= 0;
+	return (fclose(f) == 0) && written;
+}
+
+bool CheckResults(const BudgetContext& c)
+{
+	const size_t expectedCount = sizeof(kExpected) / sizeof(kExpected[0]);
+	if (c.Passed || c.Checks.size() != expectedCount)
+		return false;
+	for (size_t i = 0; i < expectedCount; i++)
+	{
+		const StartupBudgetCheck& check = c.Checks[i];
+		const ExpectedCheck& e = kExpected[i];
+		if (check.Path != e.Path || check.Ran != e.Ran || check.Passed != e.Passed ||
+			fabs(check.WallMs - e.WallMs) > 1e-9 || fabs(check.CpuMs - e.CpuMs) > 1e-9)
+		{
+			fprintf(stderr, "startup/budget: %s ran %d passed %d at %.3f ms wall %.3f ms CPU, expected %d %d %.3f %.3f\n",
+				check.Path.c_str(), check.Ran, check.Passed, check.WallMs, check.CpuMs, e.Ran, e.Passed, e.WallMs, e.CpuMs);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CheckReport(const BudgetContext& c)
+{
+	if (!StartupTimelineWriteReport(kReportPath, &c.Checks))
+		return false;
+	std::string report;
+	FILE* f = fopen(kReportPath, "rb");
+	if (!f)
+		return false;
+	char buffer[4096];
+	size_t bytes;
+	while ((bytes = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		report.append(buffer, bytes);
+	fclose(f);
+
+	const char* expected[] =
+	{
+		"{\"path\":\"Startup/Load/Parse\",\"name\":\"Parse\",\"depth\":2,\"step\":false,",
+		"{\"path\":\"Startup/Load\",\"budget_wall_ms\":20.000,\"wall_ms\":10.000,\"budget_cpu_ms\":10.000,\"cpu_ms\":8.000,\"ran\":true,\"passed\":true}",
+		"{\"path\":\"Startup/Load/Parse\",\"budget_wall_ms\":2.000,\"wall_ms\":4.000,\"cpu_ms\":3.000,\"ran\":true,\"passed\":false}",
+		"{\"path\":\"Startup/Worker\",\"budget_wall_ms\":15.000,\"wall_ms\":12.000,\"budget_cpu_ms\":9.000,\"cpu_ms\":10.000,\"ran\":true,\"passed\":false}",
+		"{\"path\":\"Startup/Missing\",\"budget_wall_ms\":1.000,\"wall_ms\":0.000,\"cpu_ms\":0.000,\"ran\":false,\"passed\":true}",
+		"\"budget_passed\":false}",
+	};
+	for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+	{
+		if (report.find(expected[i]) == std::string::npos)
+		{
+			fprintf(stderr, "startup/budget: the report has no %s\n", expected[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are budget lines.
+//--------------------------------------------------------------------------------------
+void BenchStartupSuite(BenchRunner& runner)
+{
+	if (!runner.Enabled("startup", "budget"))
+		return;
+
+	if (!BuildTimeline() || !WriteBudget())
+	{
+		fprintf(stderr, "startup/budget: can't build the timeline or write %s\n", kBudgetPath);
+		remove(kBudgetPath);
+		return;
+	}
+
+	BudgetContext c;
+	c.Passed = true;
+	const double lines = (double)(sizeof(kExpected) / sizeof(kExpected[0]));
+	if (runner.Run("startup", "budget", "check", RunCheckBudget, &c, lines))
+	{
+		bool results = CheckResults(c);
+		bool report = results && CheckReport(c);
+		runner.AddCounter("phases", (double)StartupTimelineCount());
+		runner.AddCounter("checks", (double)c.Checks.size());
+		runner.AddCounter("matches", (results && report) ? 1.0 : 0.0);
+	}
+	remove(kBudgetPath);
+	remove(kReportPath);
+}
@@ -0,0 +1,204 @@
+//--------------------------------------------------------------------------------------
+// File: BenchStereoAudit.cpp
+//
+// The stereo audit against the stand-in NVAPI, with a scripted answer for each
+// NvAPI_Stereo_Debug_WasLastDrawStereoized so the report can be checked.
+//
+// "sites" samples every draw of a frame of 8 draws over three sites, 5 at
+// "Stereo", 2 at "Mono" and 1 at "Error", with the script "SSSSSMME", so each
+// site should get only its own answer.  matches is 1 if the per site counts,
+// and the report written from them, say exactly that.
+//
+// "sample/<rate>" is a frame of 256 draws spread over 8 sites, as a scene's
+// draws would be, at each sample rate.  The time is per draw, so off against
+// the others is what AfterDraw costs between samples and what the queries add.
+// The script is "SSSM", so the mono fraction should come out at 0.25 whichever
+// draws are sampled.  matches is 1 if the sampled fraction is within 5 sigma
+// of the rate.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "NvapiStandIn.h"
+#include "StereoAudit.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+static const double kSampleRates[] = { 0.0, 0.001, 1.0 / 64.0, 1.0 };
+static const uint32_t kFrameDraws = 256;
+static const uint32_t kFrameSites = 8;
+
+struct AuditContext
+{
+	StereoAudit Audit;
+	StereoHandle Handle;
+	std::vector<uint32_t> Draws;		// Site of each draw in a frame
+};
+
+void RunFrame(void* pContext, uint64_t iterations)
+{
+	AuditContext* c = static_cast<AuditContext*>(pContext);
+	const uint32_t* pSites = &c->Draws[0];
+	size_t count = c->Draws.size();
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (size_t d = 0; d < count; d++)
+			c->Audit.AfterDraw(pSites[d], c->Handle);
+		BenchClobberMemory();
+	}
+}
+
+// The stand-in wants NvAPI_Initialize and a device before it hands out the
+// handle, and never looks at the device.
+bool OpenStandIn(StereoHandle* pHandle)
+{
+	static int s_Device;
+	NvapiStandInFailNextCalls(0);
+	NvapiStandInSetCallLatencyNs(0);
+	NvapiStandInSetStereoEnabled(true);
+	*pHandle = nullptr;
+	return NvAPI_Initialize() == NVAPI_OK &&
+		NvAPI_Stereo_CreateHandleFromIUnknown(reinterpret_cast<IUnknown*>(&s_Device), pHandle) == NVAPI_OK;
+}
+
+bool ReportHas(const std::string& report, const StereoAuditSite& site)
+{
+	char expected[256];
+	sprintf(expected, "\"draws\":%llu,\"sampled\":%llu,\"stereo\":%llu,\"mono\":%llu,\"errors\":%llu,",
+		(unsigned long long)site.Draws, (unsigned long long)site.Sampled, (unsigned long long)site.Stereo,
+		(unsigned long long)site.Mono, (unsigned long long)site.Errors);
+	return report.find(std::string("\"name\":\"") + site.Name + "\"") != std::string::npos &&
+		report.find(expected) != std::string::npos;
+}
+
+bool ReadFile(const char* path, std::string* pText)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f)
+		return false;
+	char buffer[4096];
+	size_t bytes;
+	while ((bytes = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		pText->append(buffer, bytes);
+	fclose(f);
+	return true;
+}
+
+// Each site all one answer, and in the 5:2:1 the frame draws them.
+bool CheckSites(const StereoAudit& audit, const char* reportPath)
+{
+	const StereoAuditSite& stereo = audit.GetSite(0);
+	const StereoAuditSite& mono = audit.GetSite(1);
+	const StereoAuditSite& error = audit.GetSite(2);
+	uint64_t frames = error.Draws;
+
+	if (frames == 0 || stereo.Draws != 5 * frames || mono.Draws != 2 * frames)
+		return false;
+	if (stereo.Sampled != stereo.Draws || stereo.Stereo != stereo.Draws || stereo.Mono != 0 || stereo.Errors != 0)
+		return false;
+	if (mono.Sampled != mono.Draws || mono.Mono != mono.Draws || mono.Stereo != 0 || mono.Errors != 0)
+		return false;
+	if (error.Sampled != error.Draws || error.Errors != error.Draws || error.Stereo != 0 || error.Mono != 0)
+		return false;
+
+	std::string report;
+	if (!audit.WriteReport(reportPath) || !ReadFile(reportPath, &report))
+		return false;
+	return ReportHas(report, stereo) && ReportHas(report, mono) && ReportHas(report, error);
+}
+
+}
+
+
+void BenchStereoAuditSuite(BenchRunner& runner)
+{
+	char name[64];
+
+	if (runner.Enabled("audit", "sites"))
+	{
+		AuditContext c;
+		bool opened = OpenStandIn(&c.Handle);
+		c.Audit.Configure(1.0, 1);
+		uint32_t stereo = c.Audit.RegisterSite("Stereo", __FILE__, __LINE__);
+		uint32_t mono = c.Audit.RegisterSite("Mono", __FILE__, __LINE__);
+		uint32_t error = c.Audit.RegisterSite("Error", __FILE__, __LINE__);
+		const uint32_t frame[] = { stereo, stereo, stereo, stereo, stereo, mono, mono, error };
+		c.Draws.assign(frame, frame + sizeof(frame) / sizeof(frame[0]));
+		NvapiStandInSetStereoizedScript("SSSSSMME");
+
+		const char* reportPath = "BenchStereoAudit.tmp.json";
+		if (opened && runner.Run("audit", "sites", "rate 1", RunFrame, &c, (double)c.Draws.size()))
+		{
+			bool matches = CheckSites(c.Audit, reportPath);
+			if (!matches)
+				fprintf(stderr, "audit/sites: the per site counts don't follow the script\n");
+			runner.AddCounter("sites", (double)c.Audit.SiteCount());
+			runner.AddCounter("matches", matches ? 1.0 : 0.0);
+		}
+		if (!opened)
+			fprintf(stderr, "audit/sites: the stand-in gave no stereo handle\n");
+		remove(reportPath);
+		NvapiStandInSetStereoizedScript(nullptr);
+	}
+
+	for (size_t i = 0; i < sizeof(kSampleRates) / sizeof(kSampleRates[0]); i++)
+	{
+		double rate = kSampleRates[i];
+		sprintf(name, "sample/%g", rate);
+		if (!runner.Enabled("audit", name))
+			continue;
+
+		AuditContext c;
+		if (!OpenStandIn(&c.Handle))
+		{
+			fprintf(stderr, "audit/%s: the stand-in gave no stereo handle\n", name);
+			continue;
+		}
+		c.Audit.Configure(rate, 1);
+		for (uint32_t s = 0; s < kFrameSites; s++)
+		{
+			char siteName[32];
+			sprintf(siteName, "Site%u", s);
+			c.Audit.RegisterSite(siteName, __FILE__, __LINE__);
+		}
+		// Uneven, the way a scene's draws pile up on a few materials.
+		for (uint32_t d = 0; d < kFrameDraws; d++)
+			c.Draws.push_back((d * d + d / 3) % kFrameSites);
+		NvapiStandInSetStereoizedScript("SSSM");
+
+		if (runner.Run("audit", name, rate > 0.0 ? "sampled" : "off", RunFrame, &c, (double)kFrameDraws))
+		{
+			uint64_t draws = 0, sampled = 0, mono = 0, answered = 0, sampleNs = 0;
+			for (uint32_t s = 0; s < c.Audit.SiteCount(); s++)
+			{
+				const StereoAuditSite& site = c.Audit.GetSite(s);
+				draws += site.Draws;
+				sampled += site.Sampled;
+				mono += site.Mono;
+				answered += site.Stereo + site.Mono;
+				sampleNs += site.SampleNs;
+			}
+
+			double expected = rate * (double)draws;
+			double sigma = sqrt((double)draws * rate * (1.0 - rate));
+			bool matches = fabs((double)sampled - expected) <= 5.0 * sigma + 1.0;
+			if (!matches)
+				fprintf(stderr, "audit/%s: sampled %llu of %llu draws, expected about %.0f\n",
+					name, (unsigned long long)sampled, (unsigned long long)draws, expected);
+
+			runner.AddCounter("sampled_fraction", draws ? (double)sampled / (double)draws : 0.0);
+			runner.AddCounter("mono_fraction", answered ? (double)mono / (double)answered : 0.0);
+			runner.AddCounter("mean_sample_ns", sampled ? (double)sampleNs / (double)sampled : 0.0);
+			runner.AddCounter("matches", matches ? 1.0 : 0.0);
+		}
+		NvapiStandInSetStereoizedScript(nullptr);
+	}
+}
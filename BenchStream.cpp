@@ -0,0 +1,224 @@
+//--------------------------------------------------------------------------------------
+// File: BenchStream.cpp
+//
+// Loading a set of meshes before the first frame, against streaming them with
+// MeshStreamer while frames go on.
+//
+// Each op loads all the meshes, written to the working directory as sphere
+// mesh files first and removed after, so they are in the file cache.  "sync"
+// does what InitDevice() does for one mesh, for each of them, and nothing can
+// be drawn until it returns, so its time to first frame and worst frame are
+// the whole op.  "stream" calls Update in a loop standing in for the frames,
+// with the resident cap at half the meshes' size.  The meshes are in a ring
+// and each frame draws a window of kWorkingSet of them, touching those that
+// are resident and requesting the rest, nearest first.  Once the whole window
+// is resident it moves on by one mesh, the way a camera moving through the
+// scene would, until it has gone round the ring kStreamPasses times.  So each
+// mesh is loaded, evicted to make room for the ones ahead and loaded again.
+//
+// ttff_us is from the start of the op to the end of the first frame, and
+// worst_frame_us the longest frame, the hitch loading caused.  The streamed
+// counters are from the last op.  The cap is soft for meshes touched this
+// frame or the last, but the window is well inside it, so over_cap should be
+// 0 and peak_resident_mb at most the cap.  matches is 1 if they are and the
+// meshes were evicted.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshStream.h"
+#include "Timing.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kStreamVertexCounts[] = { 10000, 100000, 1000000 };
+static const uint32_t kStreamMeshes = 16;
+static const uint32_t kWorkingSet = 4;
+static const uint32_t kStreamPasses = 2;
+static const uint32_t kStreamLoads = kWorkingSet + kStreamPasses * kStreamMeshes;
+
+struct StreamContext
+{
+	std::vector<std::string> Paths;
+	uint64_t TotalBytes;
+	uint64_t TtffNs;
+	uint64_t WorstFrameNs;
+	uint64_t Frames;
+	MeshStreamStats Stats;
+	bool Failed;
+};
+
+void LoadSync(void* pContext, uint64_t iterations)
+{
+	StreamContext* c = static_cast<StreamContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		uint64_t startNs = GetTimeNs();
+		NullMeshStreamSink sink;
+		for (uint32_t m = 0; m < (uint32_t)c->Paths.size(); m++)
+		{
+			MappedFile file;
+			MeshFileView view;
+			if (!file.Open(c->Paths[m].c_str()) || !view.Parse(file.Data(), file.Size()))
+			{
+				c->Failed = true;
+				return;
+			}
+			sink.BeginMesh(m, view.Header());
+			sink.UploadChunk(m, MESH_STREAM_VERTICES, 0, view.Vertices(), view.VertexDataBytes());
+			sink.UploadChunk(m, MESH_STREAM_INDICES, 0, view.Indices(), view.IndexDataBytes());
+			sink.EndMesh(m);
+		}
+		c->TtffNs = GetTimeNs() - startNs;
+		c->WorstFrameNs = c->TtffNs;
+		BenchClobberMemory();
+	}
+}
+
+void LoadStreamed(void* pContext, uint64_t iterations)
+{
+	StreamContext* c = static_cast<StreamContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		uint64_t startNs = GetTimeNs();
+		NullMeshStreamSink sink;
+		MeshStreamConfig config = DefaultMeshStreamConfig();
+		config.ResidentCapBytes = c->TotalBytes / 2;
+		MeshStreamer streamer(config, &sink);
+		for (uint32_t m = 0; m < (uint32_t)c->Paths.size(); m++)
+			streamer.Register(c->Paths[m].c_str());
+
+		c->TtffNs = 0;
+		c->WorstFrameNs = 0;
+		c->Frames = 0;
+		uint32_t first = 0;
+		for (;;)
+		{
+			uint64_t frameStartNs = GetTimeNs();
+			bool ready = true;
+			for (uint32_t w = 0; w < kWorkingSet; w++)
+			{
+				uint32_t mesh = (first + w) % kStreamMeshes;
+				if (streamer.IsResident(mesh))
+					streamer.Touch(mesh);
+				else
+				{
+					streamer.Request(mesh, (float)(kWorkingSet - w));
+					ready = false;
+				}
+			}
+			streamer.Update();
+			uint64_t frameEndNs = GetTimeNs();
+			if (c->Frames++ == 0)
+				c->TtffNs = frameEndNs - startNs;
+			if (frameEndNs - frameStartNs > c->WorstFrameNs)
+				c->WorstFrameNs = frameEndNs - frameStartNs;
+
+			MeshStreamStats stats = streamer.Stats();
+			if (stats.Failed > 0 || (ready && first == kStreamPasses * kStreamMeshes))
+			{
+				c->Stats = stats;
+				c->Failed = c->Failed || stats.Failed > 0;
+				break;
+			}
+			if (ready)
+				first++;
+			std::this_thread::yield();
+		}
+		BenchClobberMemory();
+	}
+}
+
+void AddCounters(BenchRunner& runner, const StreamContext& c)
+{
+	runner.AddCounter("meshes", (double)kStreamMeshes);
+	runner.AddCounter("total_mb", (double)c.TotalBytes / (1024.0 * 1024.0));
+	runner.AddCounter("ttff_us", (double)c.TtffNs / 1000.0);
+	runner.AddCounter("worst_frame_us", (double)c.WorstFrameNs / 1000.0);
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are meshes.
+//--------------------------------------------------------------------------------------
+void BenchStreamSuite(BenchRunner& runner)
+{
+	for (size_t n = 0; n < sizeof(kStreamVertexCounts) / sizeof(kStreamVertexCounts[0]); n++)
+	{
+		uint32_t vertices = kStreamVertexCounts[n];
+		if (vertices > runner.Options().MaxObjects)
+			continue;
+
+		char name[64];
+		sprintf(name, "spheres/%u", vertices);
+		if (!runner.Enabled("stream", name))
+			continue;
+
+		uint32_t side = (uint32_t)sqrtf((float)vertices);
+		MeshData sphere;
+		BuildSphereMesh(side - 1, side - 1, &sphere);
+
+		StreamContext c;
+		c.TotalBytes = 0;
+		c.TtffNs = 0;
+		c.WorstFrameNs = 0;
+		c.Frames = 0;
+		c.Failed = false;
+		for (uint32_t m = 0; m < kStreamMeshes && !c.Failed; m++)
+		{
+			char path[64];
+			sprintf(path, "BenchStream.tmp%u.smsh", m);
+			c.Paths.push_back(path);
+			c.Failed = !WriteMeshFile(path, sphere);
+		}
+
+		if (!c.Failed)
+		{
+			MappedFile file;
+			MeshFileView view;
+			if (file.Open(c.Paths[0].c_str()) && view.Parse(file.Data(), file.Size()))
+				c.TotalBytes = (uint64_t)kStreamMeshes * (view.VertexDataBytes() + view.IndexDataBytes());
+
+			if (runner.Run("stream", name, "sync", LoadSync, &c, (double)kStreamMeshes))
+				AddCounters(runner, c);
+			if (runner.Run("stream", name, "stream", LoadStreamed, &c, (double)kStreamLoads))
+			{
+				uint64_t capBytes = c.TotalBytes / 2;
+				bool matches = c.Stats.OverCap == 0 && c.Stats.PeakResidentBytes <= capBytes &&
+					c.Stats.Loaded == kStreamLoads && c.Stats.Evicted > 0;
+				if (!matches)
+					fprintf(stderr, "stream/%s: %u loads, %u evicted, %u over the cap and a peak of %.1f MB against %.1f MB\n",
+						name, c.Stats.Loaded, c.Stats.Evicted, c.Stats.OverCap,
+						(double)c.Stats.PeakResidentBytes / (1024.0 * 1024.0), (double)capBytes / (1024.0 * 1024.0));
+
+				AddCounters(runner, c);
+				runner.AddCounter("loads", (double)c.Stats.Loaded);
+				runner.AddCounter("frames", (double)c.Frames);
+				runner.AddCounter("evicted", (double)c.Stats.Evicted);
+				runner.AddCounter("over_cap", (double)c.Stats.OverCap);
+				runner.AddCounter("peak_resident_mb", (double)c.Stats.PeakResidentBytes / (1024.0 * 1024.0));
+				runner.AddCounter("ring_waits", (double)c.Stats.RingWaits);
+				runner.AddCounter("max_update_us", (double)c.Stats.MaxUpdateNs / 1000.0);
+				runner.AddCounter("matches", matches ? 1.0 : 0.0);
+			}
+		}
+		if (c.Failed)
+			fprintf(stderr, "stream/%s: the mesh files can't be written or read\n", name);
+
+		for (size_t m = 0; m < c.Paths.size(); m++)
+			remove(c.Paths[m].c_str());
+	}
+}
@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------------------
+// File: BenchTexture.cpp
+//
+// Block compressed textures: the software decoder, scalar against SSE2, and
+// mip streaming over frames with the camera moving.
+//
+// The decode ops turn one 1024x1024 checker image, encoded with EncodeTexture,
+// back into RGBA8.  mb_per_sec is the RGBA8 written a second, input_mb_per_sec
+// the blocks read.
+//
+// Each stream op opens kStreamTextures texture files, written to the working
+// directory first and removed after so they are in the file cache, in turn
+// BC1, BC3 and BC7, and runs kStreamFrames frames through a TextureStreamer
+// with the CPU backend's sink, which decodes every mip it is handed.  Each
+// texture's distance swings back and forth on its own phase, so mips are
+// wanted, dropped and wanted again, and the resident cap is half the size of
+// every mip of every texture so the cap is hit.  The counters are from the
+// last op; resident_mb against requested_mb is how close the cap and budget
+// kept up with the requests on the last frame, and max_update_ms the worst
+// frame streaming added, decoding included.  The budget is the default's, in
+// bytes and in time, and time_limited counts the frames the time ended.  An
+// Update plans at most the budget's worth of expected time, or one mip if that
+// alone is over, so within_budget is 1 if max_update_ms is under the budget
+// plus max_mip_ms, the longest a single mip took.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Bench.h"
+#include "TextureCodec.h"
+#include "TextureFile.h"
+#include "TextureStream.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kDecodeSize = 1024;
+static const uint32_t kStreamSize = 1024;
+static const uint32_t kStreamTextures = 16;
+static const uint32_t kStreamFrames = 240;
+
+struct DecodeContext
+{
+	TextureFormat Format;
+	const std::vector<uint8_t>* pBlocks;
+	std::vector<uint8_t> Pixels;
+};
+
+void RunDecodeScalar(void* pContext, uint64_t iterations)
+{
+	DecodeContext* c = static_cast<DecodeContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		DecodeTextureScalar(c->Format, &(*c->pBlocks)[0], kDecodeSize, kDecodeSize, &c->Pixels[0], kDecodeSize * 4);
+		BenchClobberMemory();
+	}
+}
+
+void RunDecodeSIMD(void* pContext, uint64_t iterations)
+{
+	DecodeContext* c = static_cast<DecodeContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		DecodeTextureSIMD(c->Format, &(*c->pBlocks)[0], kDecodeSize, kDecodeSize, &c->Pixels[0], kDecodeSize * 4);
+		BenchClobberMemory();
+	}
+}
+
+struct StreamContext
+{
+	std::vector<std::string> Paths;
+	uint64_t FullBytes;
+	TextureStreamStats Stats;
+	uint64_t DecodeNs;
+	uint64_t DecodedPixelBytes;
+	bool Failed;
+};
+
+void RunStream(void* pContext, uint64_t iterations)
+{
+	StreamContext* c = static_cast<StreamContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		NullTextureStreamSink sink;
+		TextureStreamConfig config = DefaultTextureStreamConfig();
+		config.ResidentCapBytes = c->FullBytes / 2;
+		TextureStreamer streamer(config, &sink);
+
+		std::vector<uint32_t> textures;
+		for (size_t t = 0; t < c->Paths.size(); t++)
+		{
+			uint32_t texture = streamer.Open(c->Paths[t].c_str());
+			if (texture == UINT32_MAX)
+			{
+				c->Failed = true;
+				return;
+			}
+			textures.push_back(texture);
+		}
+
+		// From a texture's full size on screen close up to an eighth of it.
+		for (uint32_t frame = 0; frame < kStreamFrames; frame++)
+		{
+			for (size_t t = 0; t < textures.size(); t++)
+			{
+				float distance = 4.5f + 3.5f * sinf(0.05f * (float)frame + 0.7f * (float)t);
+				float pixels = (float)kStreamSize / distance;
+				streamer.Request(textures[t], TextureMipForScreenSize(streamer.Header(textures[t]), pixels));
+			}
+			streamer.Update();
+		}
+
+		c->Stats = streamer.Stats();
+		c->DecodeNs = sink.DecodeNs();
+		c->DecodedPixelBytes = sink.DecodedPixelBytes();
+		BenchClobberMemory();
+	}
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are pixels for the decode ops and frames for the stream op.
+//--------------------------------------------------------------------------------------
+void BenchTextureSuite(BenchRunner& runner)
+{
+	char name[64];
+	std::vector<uint8_t> image;
+	BuildCheckerImage(kDecodeSize, kDecodeSize, 16, &image);
+
+	for (int format = 0; format < TEXTURE_FORMAT_COUNT; format++)
+	{
+		sprintf(name, "%s/%u", TextureFormatName((TextureFormat)format), kDecodeSize);
+		if (!runner.Enabled("texture", name))
+			continue;
+
+		std::vector<uint8_t> blocks;
+		EncodeTexture((TextureFormat)format, &image[0], kDecodeSize, kDecodeSize, kDecodeSize * 4, &blocks);
+
+		DecodeContext c;
+		c.Format = (TextureFormat)format;
+		c.pBlocks = &blocks;
+		c.Pixels.resize(image.size());
+
+		double pixels = (double)kDecodeSize * kDecodeSize;
+		BenchResult* pResult = runner.Run("texture", name, "scalar", RunDecodeScalar, &c, pixels);
+		if (pResult)
+		{
+			runner.AddCounter("mb_per_sec", pixels * 4.0 / (1024.0 * 1024.0) * 1e9 / pResult->MedianNs);
+			runner.AddCounter("input_mb_per_sec", (double)blocks.size() / (1024.0 * 1024.0) * 1e9 / pResult->MedianNs);
+		}
+		pResult = runner.Run("texture", name, "sse2", RunDecodeSIMD, &c, pixels);
+		if (pResult)
+		{
+			runner.AddCounter("mb_per_sec", pixels * 4.0 / (1024.0 * 1024.0) * 1e9 / pResult->MedianNs);
+			runner.AddCounter("input_mb_per_sec", (double)blocks.size() / (1024.0 * 1024.0) * 1e9 / pResult->MedianNs);
+		}
+	}
+
+	sprintf(name, "stream/%u", kStreamTextures);
+	if (!runner.Enabled("texture", name) || kStreamTextures > runner.Options().MaxObjects)
+		return;
+
+	StreamContext c;
+	c.FullBytes = 0;
+	c.DecodeNs = 0;
+	c.DecodedPixelBytes = 0;
+	c.Failed = false;
+
+	BuildCheckerImage(kStreamSize, kStreamSize, 16, &image);
+	TextureData data[TEXTURE_FORMAT_COUNT];
+	for (int format = 0; format < TEXTURE_FORMAT_COUNT; format++)
+		BuildTexture((TextureFormat)format, &image[0], kStreamSize, kStreamSize, 0, &data[format]);
+	for (uint32_t t = 0; t < kStreamTextures && !c.Failed; t++)
+	{
+		char path[64];
+		sprintf(path, "BenchTexture.tmp%u.stex", t);
+		c.Paths.push_back(path);
+		const TextureData& texture = data[t % TEXTURE_FORMAT_COUNT];
+		c.Failed = !WriteTextureFile(path, texture);
+		for (size_t m = 0; m < texture.Mips.size(); m++)
+			c.FullBytes += texture.Mips[m].size();
+	}
+
+	if (!c.Failed && runner.Run("texture", name, "update", RunStream, &c, (double)kStreamFrames) && !c.Failed)
+	{
+		const double mb = 1024.0 * 1024.0;
+		runner.AddCounter("textures", (double)kStreamTextures);
+		runner.AddCounter("full_mb", (double)c.Stats.FullBytes / mb);
+		runner.AddCounter("requested_mb", (double)c.Stats.RequestedBytes / mb);
+		runner.AddCounter("resident_mb", (double)c.Stats.ResidentBytes / mb);
+		runner.AddCounter("peak_resident_mb", (double)c.Stats.PeakResidentBytes / mb);
+		runner.AddCounter("uploaded_mb", (double)c.Stats.BytesUploaded / mb);
+		runner.AddCounter("mips_loaded", (double)c.Stats.MipsLoaded);
+		runner.AddCounter("mips_dropped", (double)c.Stats.MipsDropped);
+		runner.AddCounter("cap_limited", (double)c.Stats.CapLimited);
+		runner.AddCounter("time_limited", (double)c.Stats.TimeLimited);
+		runner.AddCounter("max_update_ms", (double)c.Stats.MaxUpdateNs / 1e6);
+		runner.AddCounter("max_mip_ms", (double)c.Stats.MaxUploadMipNs / 1e6);
+		uint64_t boundNs = DefaultTextureStreamConfig().UploadBudgetNs + c.Stats.MaxUploadMipNs;
+		if (c.Stats.MaxUpdateNs > boundNs)
+			fprintf(stderr, "texture/%s: an update took %.2f ms, over the %.2f ms budget and longest mip\n", name,
+				(double)c.Stats.MaxUpdateNs / 1e6, (double)boundNs / 1e6);
+		runner.AddCounter("within_budget", c.Stats.MaxUpdateNs <= boundNs ? 1.0 : 0.0);
+		if (c.DecodeNs > 0)
+			runner.AddCounter("decode_mb_per_sec", (double)c.DecodedPixelBytes / mb * 1e9 / (double)c.DecodeNs);
+	}
+	if (c.Failed)
+		fprintf(stderr, "texture/%s: the texture files can't be written or read\n", name);
+
+	for (size_t t = 0; t < c.Paths.size(); t++)
+		remove(c.Paths[t].c_str());
+}
@@ -0,0 +1,212 @@
+//--------------------------------------------------------------------------------------
+// File: BenchTransforms.cpp
+//
+// World matrices per second for many transforms.  The baseline is what the
+// sample would do with DirectXMath: an array of transform structs, each made
+// into Scaling * RotationQuaternion * Translation with two matrix multiplies.
+// Against it, TransformStore with the scalar and SSE2 kernels, on one thread
+// and on a WorkerPool, with everything dirty and with a tenth of it dirty.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "AlignedAlloc.h"
+#include "Bench.h"
+#include "StereoMath.h"
+#include "TransformStore.h"
+#include "WorkerPool.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+
+namespace
+{
+
+static const uint32_t kTransformCounts[] = { 10000, 100000, 1000000 };
+
+struct AosTransform
+{
+	float Position[3];
+	float Rotation[4];
+	float Scale;
+};
+
+struct AosContext
+{
+	const AosTransform* pTransforms;
+	SMMatrix* pWorld;
+	uint32_t Count;
+};
+
+SMMatrix RotationQuaternion(const float q[4])
+{
+	SMMatrix r = StereoMathScalar::Identity();
+	r.m[0][0] = 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]);
+	r.m[0][1] = 2.0f * (q[0] * q[1] + q[3] * q[2]);
+	r.m[0][2] = 2.0f * (q[0] * q[2] - q[3] * q[1]);
+	r.m[1][0] = 2.0f * (q[0] * q[1] - q[3] * q[2]);
+	r.m[1][1] = 1.0f - 2.0f * (q[0] * q[0] + q[2] * q[2]);
+	r.m[1][2] = 2.0f * (q[1] * q[2] + q[3] * q[0]);
+	r.m[2][0] = 2.0f * (q[0] * q[2] + q[3] * q[1]);
+	r.m[2][1] = 2.0f * (q[1] * q[2] - q[3] * q[0]);
+	r.m[2][2] = 1.0f - 2.0f * (q[0] * q[0] + q[1] * q[1]);
+	return r;
+}
+
+void AosUpdate(void* pContext, uint64_t iterations)
+{
+	AosContext* c = static_cast<AosContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		for (uint32_t i = 0; i < c->Count; i++)
+		{
+			const AosTransform& t = c->pTransforms[i];
+			SMMatrix scaling = StereoMathScalar::Identity();
+			scaling.m[0][0] = scaling.m[1][1] = scaling.m[2][2] = t.Scale;
+			SMMatrix translation = StereoMathScalar::Identity();
+			translation.m[3][0] = t.Position[0];
+			translation.m[3][1] = t.Position[1];
+			translation.m[3][2] = t.Position[2];
+			c->pWorld[i] = StereoMathScalar::Multiply(StereoMathScalar::Multiply(scaling, RotationQuaternion(t.Rotation)), translation);
+		}
+		BenchClobberMemory();
+	}
+}
+
+
+struct SoaContext
+{
+	TransformStore* pStore;
+	TransformKernel Kernel;
+	WorkerPool* pPool;
+	const std::vector<uint32_t>* pDirty;	// Null for all of them
+	uint32_t Recomputed;
+};
+
+void SoaUpdate(void* pContext, uint64_t iterations)
+{
+	SoaContext* c = static_cast<SoaContext*>(pContext);
+	for (uint64_t n = 0; n < iterations; n++)
+	{
+		if (c->pDirty)
+		{
+			const std::vector<uint32_t>& dirty = *c->pDirty;
+			for (size_t i = 0; i < dirty.size(); i++)
+				c->pStore->SetScale(dirty[i], 1.0f);
+		}
+		else
+		{
+			c->pStore->MarkAllDirty();
+		}
+		c->Recomputed = c->pStore->UpdateWorld(c->Kernel, c->pPool);
+		BenchClobberMemory();
+	}
+}
+
+uint32_t NextRandom(uint32_t* pState)
+{
+	uint32_t x = *pState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*pState = x;
+	return x;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// Items are matrices, so items/s is matrices/s.  For the dirty runs that counts
+// only the tenth that changed, recomputed says how many were actually redone,
+// since the SIMD kernel works in blocks of four.
+//--------------------------------------------------------------------------------------
+void BenchTransformsSuite(BenchRunner& runner)
+{
+	// Started unpinned, or the workers would all share the runner's CPU.
+	BenchPinThread(-1);
+	WorkerPool pool(WorkerPool::DefaultWorkers());
+	BenchPinThread(runner.Options().Cpu);
+
+	for (size_t n = 0; n < sizeof(kTransformCounts) / sizeof(kTransformCounts[0]); n++)
+	{
+		uint32_t count = kTransformCounts[n];
+		if (count > runner.Options().MaxObjects)
+			continue;
+
+		char allName[64];
+		char dirtyName[64];
+		sprintf(allName, "all/%u", count);
+		sprintf(dirtyName, "dirty10/%u", count);
+		if (!runner.Enabled("transforms", allName) && !runner.Enabled("transforms", dirtyName))
+			continue;
+
+		// The same transforms in both layouts.
+		uint32_t random = 0x5EED;
+		std::vector<AosTransform> aos(count);
+		TransformStore store;
+		store.Resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			AosTransform& t = aos[i];
+			for (int k = 0; k < 3; k++)
+				t.Position[k] = (float)(NextRandom(&random) % 2000) * 0.1f - 100.0f;
+			float angle = (float)(NextRandom(&random) % 6283) * 0.001f;
+			t.Rotation[0] = 0.0f;
+			t.Rotation[1] = sinf(0.5f * angle);
+			t.Rotation[2] = 0.0f;
+			t.Rotation[3] = cosf(0.5f * angle);
+			t.Scale = 0.5f + (float)(NextRandom(&random) % 1000) * 0.001f;
+
+			store.SetPosition(i, t.Position[0], t.Position[1], t.Position[2]);
+			store.SetRotation(i, t.Rotation[0], t.Rotation[1], t.Rotation[2], t.Rotation[3]);
+			store.SetScale(i, t.Scale);
+		}
+
+		std::vector<uint32_t> dirty;
+		for (uint32_t i = 0; i < count; i++)
+			if (NextRandom(&random) % 10 == 0)
+				dirty.push_back(i);
+
+		SMMatrix* pAosWorld = static_cast<SMMatrix*>(AlignedAlloc(count * sizeof(SMMatrix), 16));
+		AosContext aosContext = { &aos[0], pAosWorld, count };
+		if (runner.Run("transforms", allName, "aos-xm", AosUpdate, &aosContext, (double)count))
+			runner.AddCounter("threads", 1.0);
+		AlignedFree(pAosWorld);
+
+		struct Variant
+		{
+			const char* Name;
+			TransformKernel Kernel;
+			WorkerPool* pPool;
+		};
+		const Variant variants[] =
+		{
+			{ "soa-scalar", TRANSFORM_KERNEL_SCALAR, nullptr },
+			{ "soa-simd", TRANSFORM_KERNEL_SIMD, nullptr },
+			{ "soa-simd-mt", TRANSFORM_KERNEL_SIMD, &pool },
+		};
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			const char* name = pass ? dirtyName : allName;
+			for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+			{
+				SoaContext c;
+				c.pStore = &store;
+				c.Kernel = variants[v].Kernel;
+				c.pPool = variants[v].pPool;
+				c.pDirty = pass ? &dirty : nullptr;
+				c.Recomputed = 0;
+
+				double items = pass ? (double)dirty.size() : (double)count;
+				if (!runner.Run("transforms", name, variants[v].Name, SoaUpdate, &c, items))
+					continue;
+				runner.AddCounter("threads", c.pPool ? (double)c.pPool->ThreadCount() : 1.0);
+				runner.AddCounter("recomputed", (double)c.Recomputed);
+				runner.AddCounter("store_bytes", (double)store.MemoryBytes());
+			}
+		}
+	}
+}
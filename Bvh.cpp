@@ -0,0 +1,550 @@
+//--------------------------------------------------------------------------------------
+// File: Bvh.cpp
+//
+// Binned SAH build, refit, and the two traversals.
+//--------------------------------------------------------------------------------------
+
+#include "Bvh.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+
+static_assert(sizeof(BvhNode) == 32, "two nodes to a cache line");
+
+// Relative to one sphere test.
+static const float kTraversalCost = 1.0f;
+
+// The spheres in build order, so every pass over a node's objects reads
+// memory in sequence instead of through the index array.
+struct BuildSphere
+{
+	float Center[3];
+	float Radius;
+	uint32_t Object;
+};
+
+struct Bvh::BuildContext
+{
+	struct Bin
+	{
+		float Min[3];
+		float Max[3];
+		uint32_t Count;
+	};
+
+	std::vector<BuildSphere> Spheres;
+	Bin Bins[kSahBins];
+	float RightArea[kSahBins];
+	uint32_t RightCount[kSahBins];
+};
+
+
+// Half the surface area, which is all the ratios need.
+static float HalfArea(const float min[3], const float max[3])
+{
+	float dx = max[0] - min[0];
+	float dy = max[1] - min[1];
+	float dz = max[2] - min[2];
+	if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+		return 0.0f;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static void EmptyBox(float min[3], float max[3])
+{
+	for (int a = 0; a < 3; a++)
+	{
+		min[a] = FLT_MAX;
+		max[a] = -FLT_MAX;
+	}
+}
+
+static void GrowBox(float min[3], float max[3], const float otherMin[3], const float otherMax[3])
+{
+	for (int a = 0; a < 3; a++)
+	{
+		min[a] = std::min(min[a], otherMin[a]);
+		max[a] = std::max(max[a], otherMax[a]);
+	}
+}
+
+
+Bvh::Bvh()
+{
+	m_pX = m_pY = m_pZ = m_pRadius = nullptr;
+	m_Count = 0;
+	m_Depth = 0;
+}
+
+void Bvh::Clear()
+{
+	m_Nodes.clear();
+	m_Indices.clear();
+	m_pX = m_pY = m_pZ = m_pRadius = nullptr;
+	m_Count = 0;
+	m_Depth = 0;
+}
+
+size_t Bvh::MemoryBytes() const
+{
+	return m_Nodes.capacity() * sizeof(BvhNode) + m_Indices.capacity() * sizeof(uint32_t);
+}
+
+void Bvh::LeafBounds(uint32_t first, uint32_t count, float min[3], float max[3]) const
+{
+	EmptyBox(min, max);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		uint32_t object = m_Indices[i];
+		float r = m_pRadius[object];
+		float center[3] = { m_pX[object], m_pY[object], m_pZ[object] };
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = std::min(min[a], center[a] - r);
+			max[a] = std::max(max[a], center[a] + r);
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Build
+//--------------------------------------------------------------------------------------
+void Bvh::Build(const float* pX, const float* pY, const float* pZ, const float* pRadius, uint32_t count)
+{
+	Clear();
+	if (count == 0)
+		return;
+
+	m_pX = pX;
+	m_pY = pY;
+	m_pZ = pZ;
+	m_pRadius = pRadius;
+	m_Count = count;
+
+	BuildContext context;
+	context.Spheres.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		BuildSphere& sphere = context.Spheres[i];
+		sphere.Center[0] = pX[i];
+		sphere.Center[1] = pY[i];
+		sphere.Center[2] = pZ[i];
+		sphere.Radius = pRadius[i];
+		sphere.Object = i;
+	}
+
+	// A binary tree with at least one object per leaf has under 2 * count nodes.
+	m_Nodes.reserve(2 * (size_t)count);
+	BuildNode(context, 0, count, 0);
+
+	m_Indices.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		m_Indices[i] = context.Spheres[i].Object;
+}
+
+//--------------------------------------------------------------------------------------
+// Objects are split by their centers, binned along the axis they spread
+// furthest on, and the split with the least SAH cost taken.  A few objects
+// stay a leaf if splitting them costs no less.  Past kMaxSahDepth, or when
+// every center is the same, the split is at the median instead.
+//--------------------------------------------------------------------------------------
+uint32_t Bvh::BuildNode(BuildContext& context, uint32_t first, uint32_t count, uint32_t depth)
+{
+	uint32_t index = (uint32_t)m_Nodes.size();
+	m_Nodes.push_back(BvhNode());
+	m_Depth = std::max(m_Depth, depth + 1);
+
+	BuildSphere* begin = &context.Spheres[first];
+	BuildSphere* end = begin + count;
+
+	float min[3], max[3];
+	float centerMin[3], centerMax[3];
+	EmptyBox(min, max);
+	EmptyBox(centerMin, centerMax);
+	for (const BuildSphere* p = begin; p < end; p++)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = std::min(min[a], p->Center[a] - p->Radius);
+			max[a] = std::max(max[a], p->Center[a] + p->Radius);
+			centerMin[a] = std::min(centerMin[a], p->Center[a]);
+			centerMax[a] = std::max(centerMax[a], p->Center[a]);
+		}
+	}
+
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+	float scale[3] = { 0.0f, 0.0f, 0.0f };
+
+	if (count > 1 && depth < kMaxSahDepth)
+	{
+		// Only along the widest spread of centers, a third of the binning for
+		// trees within a few percent of binning all three.
+		int a = 0;
+		for (int k = 1; k < 3; k++)
+			if (centerMax[k] - centerMin[k] > centerMax[a] - centerMin[a])
+				a = k;
+		float extent = centerMax[a] - centerMin[a];
+		if (extent > 0.0f)
+		{
+			scale[a] = (float)kSahBins / extent;
+			BuildContext::Bin* bins = context.Bins;
+			for (uint32_t b = 0; b < kSahBins; b++)
+			{
+				EmptyBox(bins[b].Min, bins[b].Max);
+				bins[b].Count = 0;
+			}
+			for (const BuildSphere* p = begin; p < end; p++)
+			{
+				uint32_t b = std::min((uint32_t)((p->Center[a] - centerMin[a]) * scale[a]), kSahBins - 1);
+				BuildContext::Bin& bin = bins[b];
+				for (int k = 0; k < 3; k++)
+				{
+					bin.Min[k] = std::min(bin.Min[k], p->Center[k] - p->Radius);
+					bin.Max[k] = std::max(bin.Max[k], p->Center[k] + p->Radius);
+				}
+				bin.Count++;
+			}
+
+			// Right to left for the right sides, then left to right trying each split.
+			float sideMin[3], sideMax[3];
+			EmptyBox(sideMin, sideMax);
+			uint32_t sideCount = 0;
+			for (uint32_t b = kSahBins - 1; b > 0; b--)
+			{
+				GrowBox(sideMin, sideMax, bins[b].Min, bins[b].Max);
+				sideCount += bins[b].Count;
+				context.RightArea[b] = HalfArea(sideMin, sideMax);
+				context.RightCount[b] = sideCount;
+			}
+
+			EmptyBox(sideMin, sideMax);
+			sideCount = 0;
+			for (uint32_t b = 1; b < kSahBins; b++)
+			{
+				GrowBox(sideMin, sideMax, bins[b - 1].Min, bins[b - 1].Max);
+				sideCount += bins[b - 1].Count;
+				if (sideCount == 0 || context.RightCount[b] == 0)
+					continue;
+				float cost = HalfArea(sideMin, sideMax) * sideCount + context.RightArea[b] * context.RightCount[b];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = a;
+					bestSplit = b;
+				}
+			}
+		}
+	}
+
+	float area = HalfArea(min, max);
+	if (bestAxis >= 0 && area > 0.0f)
+		bestCost = kTraversalCost + bestCost / area;
+
+	if (count == 1 || (count <= kMaxLeafSize && (bestAxis < 0 || bestCost >= (float)count)))
+	{
+		BvhNode& node = m_Nodes[index];
+		memcpy(node.Min, min, sizeof(min));
+		memcpy(node.Max, max, sizeof(max));
+		node.Offset = first;
+		node.Count = count;
+		return index;
+	}
+
+	uint32_t leftCount;
+	if (bestAxis >= 0)
+	{
+		int a = bestAxis;
+		float axisMin = centerMin[a];
+		float axisScale = scale[a];
+		BuildSphere* middle = std::partition(begin, end, [a, axisMin, axisScale, bestSplit](const BuildSphere& p)
+			{ return std::min((uint32_t)((p.Center[a] - axisMin) * axisScale), kSahBins - 1) < bestSplit; });
+		leftCount = (uint32_t)(middle - begin);
+	}
+	else
+	{
+		int a = 0;
+		for (int k = 1; k < 3; k++)
+			if (centerMax[k] - centerMin[k] > centerMax[a] - centerMin[a])
+				a = k;
+		leftCount = count / 2;
+		std::nth_element(begin, begin + leftCount, end,
+			[a](const BuildSphere& p, const BuildSphere& q) { return p.Center[a] < q.Center[a]; });
+	}
+
+	BuildNode(context, first, leftCount, depth + 1);
+	uint32_t right = BuildNode(context, first + leftCount, count - leftCount, depth + 1);
+
+	BvhNode& node = m_Nodes[index];
+	memcpy(node.Min, min, sizeof(min));
+	memcpy(node.Max, max, sizeof(max));
+	node.Offset = right;
+	node.Count = 0;
+	return index;
+}
+
+//--------------------------------------------------------------------------------------
+// Children always come after their parent, so one backward pass sees every
+// child before its parent.
+//--------------------------------------------------------------------------------------
+void Bvh::Refit()
+{
+	for (size_t i = m_Nodes.size(); i-- > 0;)
+	{
+		BvhNode& node = m_Nodes[i];
+		if (node.Count > 0)
+		{
+			LeafBounds(node.Offset, node.Count, node.Min, node.Max);
+			continue;
+		}
+		const BvhNode& left = m_Nodes[i + 1];
+		const BvhNode& right = m_Nodes[node.Offset];
+		for (int a = 0; a < 3; a++)
+		{
+			node.Min[a] = std::min(left.Min[a], right.Min[a]);
+			node.Max[a] = std::max(left.Max[a], right.Max[a]);
+		}
+	}
+}
+
+double Bvh::SahCost() const
+{
+	if (m_Nodes.empty())
+		return 0.0;
+
+	double rootArea = HalfArea(m_Nodes[0].Min, m_Nodes[0].Max);
+	if (rootArea <= 0.0)
+		return (double)m_Count;
+
+	double cost = 0.0;
+	for (size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		const BvhNode& node = m_Nodes[i];
+		double share = HalfArea(node.Min, node.Max) / rootArea;
+		cost += share * (node.Count ? (double)node.Count : kTraversalCost);
+	}
+	return cost;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Frustum query.  Each stack entry carries the planes its parent was not
+// already entirely inside, so deeper nodes test fewer, and a node inside all
+// six takes its whole run of objects untested.
+//--------------------------------------------------------------------------------------
+uint32_t Bvh::QueryFrustum(const StereoFrustum& frustum, uint32_t* pVisible, BvhQueryStats* pStats) const
+{
+	uint32_t visible = 0;
+	uint32_t nodesVisited = 0;
+	uint32_t spheresTested = 0;
+
+	struct Entry
+	{
+		uint32_t Node;
+		uint32_t Planes;
+	};
+	Entry stack[kMaxDepth * 2];
+	uint32_t stackSize = 0;
+	if (!m_Nodes.empty())
+	{
+		stack[0].Node = 0;
+		stack[0].Planes = (1u << CULL_PLANE_COUNT) - 1;
+		stackSize = 1;
+	}
+
+	while (stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+		uint32_t nodeIndex = entry.Node;
+		const BvhNode* node = &m_Nodes[nodeIndex];
+		nodesVisited++;
+
+		float center[3], extent[3];
+		for (int a = 0; a < 3; a++)
+		{
+			center[a] = 0.5f * (node->Max[a] + node->Min[a]);
+			extent[a] = 0.5f * (node->Max[a] - node->Min[a]);
+		}
+
+		uint32_t planes = entry.Planes;
+		bool outside = false;
+		for (int k = 0; k < CULL_PLANE_COUNT && !outside; k++)
+		{
+			if (!(planes & (1u << k)))
+				continue;
+			const float* p = frustum.Planes[k];
+			float distance = p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3];
+			float radius = fabsf(p[0]) * extent[0] + fabsf(p[1]) * extent[1] + fabsf(p[2]) * extent[2];
+			if (distance + radius < 0.0f)
+				outside = true;
+			else if (distance - radius >= 0.0f)
+				planes &= ~(1u << k);
+		}
+		if (outside)
+			continue;
+
+		if (planes == 0)
+		{
+			// The subtree's objects run from its leftmost leaf to its rightmost.
+			const BvhNode* leftmost = node;
+			uint32_t i = nodeIndex;
+			while (leftmost->Count == 0)
+				leftmost = &m_Nodes[++i];
+			const BvhNode* rightmost = node;
+			while (rightmost->Count == 0)
+				rightmost = &m_Nodes[rightmost->Offset];
+			for (uint32_t j = leftmost->Offset; j < rightmost->Offset + rightmost->Count; j++)
+				pVisible[visible++] = m_Indices[j];
+			continue;
+		}
+
+		if (node->Count > 0)
+		{
+			for (uint32_t j = node->Offset; j < node->Offset + node->Count; j++)
+			{
+				uint32_t object = m_Indices[j];
+				bool inside = true;
+				for (int k = 0; k < CULL_PLANE_COUNT && inside; k++)
+				{
+					if (!(planes & (1u << k)))
+						continue;
+					const float* p = frustum.Planes[k];
+					inside = (p[0] * m_pX[object] + p[1] * m_pY[object] + p[2] * m_pZ[object] + p[3] >= -m_pRadius[object]);
+				}
+				if (inside)
+					pVisible[visible++] = object;
+			}
+			spheresTested += node->Count;
+			continue;
+		}
+
+		// Left on top, so the output comes out in index array order.
+		stack[stackSize].Node = node->Offset;
+		stack[stackSize].Planes = planes;
+		stack[stackSize + 1].Node = nodeIndex + 1;
+		stack[stackSize + 1].Planes = planes;
+		stackSize += 2;
+	}
+
+	if (pStats)
+	{
+		pStats->NodesVisited = nodesVisited;
+		pStats->SpheresTested = spheresTested;
+	}
+	return visible;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Picking.  Slab test for the boxes, nearer child first, and anything starting
+// beyond the nearest hit so far is skipped.
+//--------------------------------------------------------------------------------------
+static bool RayBox(const BvhNode& node, const float origin[3], const float inverse[3], float maxT, float* pNear)
+{
+	float tNear = 0.0f;
+	float tFar = maxT;
+	for (int a = 0; a < 3; a++)
+	{
+		float t0 = (node.Min[a] - origin[a]) * inverse[a];
+		float t1 = (node.Max[a] - origin[a]) * inverse[a];
+		tNear = std::max(tNear, std::min(t0, t1));
+		tFar = std::min(tFar, std::max(t0, t1));
+	}
+	*pNear = tNear;
+	return tNear <= tFar;
+}
+
+bool Bvh::Pick(const float origin[3], const float direction[3], float maxT, BvhHit* pHit, BvhQueryStats* pStats) const
+{
+	uint32_t nodesVisited = 0;
+	uint32_t spheresTested = 0;
+	bool hit = false;
+	float bestT = maxT;
+	uint32_t bestObject = 0;
+
+	float inverse[3];
+	for (int a = 0; a < 3; a++)
+		inverse[a] = (direction[a] != 0.0f) ? 1.0f / direction[a] : FLT_MAX;
+	float dd = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+
+	float rootNear;
+	uint32_t stack[kMaxDepth * 2];
+	uint32_t stackSize = 0;
+	if (!m_Nodes.empty() && dd > 0.0f && RayBox(m_Nodes[0], origin, inverse, bestT, &rootNear))
+		stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		uint32_t nodeIndex = stack[--stackSize];
+		const BvhNode& node = m_Nodes[nodeIndex];
+		nodesVisited++;
+
+		if (node.Count > 0)
+		{
+			for (uint32_t j = node.Offset; j < node.Offset + node.Count; j++)
+			{
+				uint32_t object = m_Indices[j];
+				float oc[3] = { origin[0] - m_pX[object], origin[1] - m_pY[object], origin[2] - m_pZ[object] };
+				float r = m_pRadius[object];
+				float b = oc[0] * direction[0] + oc[1] * direction[1] + oc[2] * direction[2];
+				float c = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - r * r;
+				float discriminant = b * b - dd * c;
+				if (discriminant < 0.0f)
+					continue;
+
+				// Starting inside the sphere counts as a hit at 0.
+				float t = (c <= 0.0f) ? 0.0f : (-b - sqrtf(discriminant)) / dd;
+				if (t >= 0.0f && t < bestT)
+				{
+					bestT = t;
+					bestObject = object;
+					hit = true;
+				}
+			}
+			spheresTested += node.Count;
+			continue;
+		}
+
+		uint32_t left = nodeIndex + 1;
+		uint32_t right = node.Offset;
+		float leftNear, rightNear;
+		bool leftHit = RayBox(m_Nodes[left], origin, inverse, bestT, &leftNear);
+		bool rightHit = RayBox(m_Nodes[right], origin, inverse, bestT, &rightNear);
+
+		// Push the farther one first, so the nearer is popped next.
+		if (leftHit && rightHit)
+		{
+			if (leftNear <= rightNear)
+			{
+				stack[stackSize++] = right;
+				stack[stackSize++] = left;
+			}
+			else
+			{
+				stack[stackSize++] = left;
+				stack[stackSize++] = right;
+			}
+		}
+		else if (leftHit)
+			stack[stackSize++] = left;
+		else if (rightHit)
+			stack[stackSize++] = right;
+	}
+
+	if (hit && pHit)
+	{
+		pHit->Object = bestObject;
+		pHit->T = bestT;
+	}
+	if (pStats)
+	{
+		pStats->NodesVisited = nodesVisited;
+		pStats->SpheresTested = spheresTested;
+	}
+	return hit;
+}
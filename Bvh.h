@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------
+// File: Bvh.h
+//
+// Bounding volume hierarchy over bounding spheres, for culling and picking
+// without touching every object.
+//
+// Built top down with the surface area heuristic, binned, so a build is a few
+// linear passes per level rather than a sort.  Past kMaxSahDepth levels it
+// splits at the median instead, which keeps the depth bounded on bad input.
+//
+// Nodes are 32 bytes, two to a cache line, in depth first order: a node's left
+// child is the next node, and only the right child's index is stored.  The
+// objects under any node are one contiguous run of the index array, so a node
+// entirely inside the frustum is taken whole without testing its children.
+//
+// Refit recomputes every node's box from the current spheres, bottom up,
+// without changing the tree.  That is right for objects that move a little,
+// which only loosens the boxes; after a lot of movement build again.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "StereoCull.h"
+
+
+struct BvhNode
+{
+	float Min[3];
+	uint32_t Offset;		// Leaf: first index in the index array.  Inner: right child.
+	float Max[3];
+	uint32_t Count;			// Leaf: objects.  Inner: 0.
+};
+
+struct BvhHit
+{
+	uint32_t Object;
+	float T;				// Along the ray, in units of its direction
+};
+
+// How much of the tree a query touched.
+struct BvhQueryStats
+{
+	uint32_t NodesVisited;
+	uint32_t SpheresTested;
+};
+
+
+class Bvh
+{
+public:
+	static const uint32_t kMaxLeafSize = 4;
+	static const uint32_t kSahBins = 16;
+	static const uint32_t kMaxSahDepth = 48;
+	static const uint32_t kMaxDepth = 96;
+
+	Bvh();
+
+	// The sphere arrays are the same as StereoCull takes, and must stay alive
+	// and unmoved for Refit and the queries.
+	void Build(const float* pX, const float* pY, const float* pZ, const float* pRadius, uint32_t count);
+	void Refit();
+	void Clear();
+
+	bool Empty() const { return m_Nodes.empty(); }
+	uint32_t ObjectCount() const { return m_Count; }
+	uint32_t NodeCount() const { return (uint32_t)m_Nodes.size(); }
+	uint32_t Depth() const { return m_Depth; }
+	size_t MemoryBytes() const;
+
+	// SAH cost of the tree, traversal steps plus sphere tests per random ray.
+	double SahCost() const;
+
+	// Objects at least partly inside, the same ones StereoCullSpheres finds,
+	// but in tree order.  pVisible needs room for ObjectCount().
+	uint32_t QueryFrustum(const StereoFrustum& frustum, uint32_t* pVisible, BvhQueryStats* pStats = nullptr) const;
+
+	// Nearest sphere the ray enters, or starts inside, before maxT.
+	bool Pick(const float origin[3], const float direction[3], float maxT, BvhHit* pHit, BvhQueryStats* pStats = nullptr) const;
+
+private:
+	struct BuildContext;
+
+	uint32_t BuildNode(BuildContext& context, uint32_t first, uint32_t count, uint32_t depth);
+	void LeafBounds(uint32_t first, uint32_t count, float min[3], float max[3]) const;
+
+	std::vector<BvhNode> m_Nodes;
+	std::vector<uint32_t> m_Indices;
+	const float* m_pX;
+	const float* m_pY;
+	const float* m_pZ;
+	const float* m_pRadius;
+	uint32_t m_Count;
+	uint32_t m_Depth;
+};
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11GpuTimer.cpp
+//
+// Timestamp query backend.  Results are always read with DONOTFLUSH, so a query
+// that isn't done yet just comes back S_FALSE and the frame is tried again later.
+//--------------------------------------------------------------------------------------
+
+#include "D3D11GpuTimer.h"
+
+
+D3D11GpuTimer::D3D11GpuTimer()
+{
+	m_pContext = nullptr;
+	ZeroMemory(m_pDisjoint, sizeof(m_pDisjoint));
+	ZeroMemory(m_pTimestamps, sizeof(m_pTimestamps));
+}
+
+D3D11GpuTimer::~D3D11GpuTimer()
+{
+	for (UINT slot = 0; slot < kRingSize; slot++)
+	{
+		if (m_pDisjoint[slot]) m_pDisjoint[slot]->Release();
+		for (UINT query = 0; query < kQueriesPerFrame; query++)
+			if (m_pTimestamps[slot][query]) m_pTimestamps[slot][query]->Release();
+	}
+	if (m_pContext) m_pContext->Release();
+}
+
+HRESULT D3D11GpuTimer::Init(ID3D11Device* pDevice, ID3D11DeviceContext* pContext)
+{
+	HRESULT hr;
+
+	D3D11_QUERY_DESC desc;
+	desc.MiscFlags = 0;
+
+	for (UINT slot = 0; slot < kRingSize; slot++)
+	{
+		desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+		hr = pDevice->CreateQuery(&desc, &m_pDisjoint[slot]);
+		if (FAILED(hr))
+			return hr;
+
+		desc.Query = D3D11_QUERY_TIMESTAMP;
+		for (UINT query = 0; query < kQueriesPerFrame; query++)
+		{
+			hr = pDevice->CreateQuery(&desc, &m_pTimestamps[slot][query]);
+			if (FAILED(hr))
+				return hr;
+		}
+	}
+
+	m_pContext = pContext;
+	m_pContext->AddRef();
+	return S_OK;
+}
+
+void D3D11GpuTimer::IssueFrameBegin(uint32_t slot)
+{
+	m_pContext->Begin(m_pDisjoint[slot]);
+}
+
+void D3D11GpuTimer::IssueTimestamp(uint32_t slot, uint32_t query)
+{
+	m_pContext->End(m_pTimestamps[slot][query]);
+}
+
+void D3D11GpuTimer::IssueFrameEnd(uint32_t slot)
+{
+	m_pContext->End(m_pDisjoint[slot]);
+}
+
+//--------------------------------------------------------------------------------------
+// Queries that weren't issued this frame still hold an old value, or never
+// complete at all, so only wait on the pairs the frame actually used.
+//--------------------------------------------------------------------------------------
+GpuTimer::ReadResult D3D11GpuTimer::TryReadFrame(uint32_t slot, uint32_t spanMask, uint64_t* pTimestamps, uint64_t* pFrequency)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	HRESULT hr = m_pContext->GetData(m_pDisjoint[slot], &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	if (hr != S_OK)
+		return READ_NOT_READY;
+	if (disjoint.Disjoint)
+		return READ_DISJOINT;
+
+	for (UINT query = 0; query < kQueriesPerFrame; query++)
+	{
+		pTimestamps[query] = 0;
+		if (!(spanMask & (1u << (query / 2))))
+			continue;
+
+		UINT64 timestamp = 0;
+		hr = m_pContext->GetData(m_pTimestamps[slot][query], &timestamp, sizeof(timestamp), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		if (hr == S_FALSE)
+			return READ_NOT_READY;
+		if (SUCCEEDED(hr))
+			pTimestamps[query] = timestamp;
+	}
+
+	*pFrequency = disjoint.Frequency;
+	return READ_READY;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Timestamp queries are required on feature level 10+, but WARP and some remote
+// sessions still come back without them.
+//--------------------------------------------------------------------------------------
+GpuTimer* CreateGpuTimer(ID3D11Device* pDevice, ID3D11DeviceContext* pContext)
+{
+	D3D11GpuTimer* pTimer = new D3D11GpuTimer();
+	if (SUCCEEDED(pTimer->Init(pDevice, pContext)))
+		return pTimer;
+
+	delete pTimer;
+	return new CpuGpuTimer();
+}
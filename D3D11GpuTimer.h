@@ -0,0 +1,37 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11GpuTimer.h
+//
+// GpuTimer backend on D3D11 timestamp queries.  One TIMESTAMP_DISJOINT query
+// brackets each frame, and each eye/stage gets a pair of TIMESTAMP queries.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+
+#include "GpuTimer.h"
+
+
+class D3D11GpuTimer : public GpuTimer
+{
+public:
+	D3D11GpuTimer();
+	~D3D11GpuTimer();
+
+	HRESULT Init(ID3D11Device* pDevice, ID3D11DeviceContext* pContext);
+
+protected:
+	void IssueFrameBegin(uint32_t slot);
+	void IssueTimestamp(uint32_t slot, uint32_t query);
+	void IssueFrameEnd(uint32_t slot);
+	ReadResult TryReadFrame(uint32_t slot, uint32_t spanMask, uint64_t* pTimestamps, uint64_t* pFrequency);
+
+private:
+	ID3D11DeviceContext* m_pContext;
+	ID3D11Query* m_pDisjoint[kRingSize];
+	ID3D11Query* m_pTimestamps[kRingSize][kQueriesPerFrame];
+};
+
+
+// The query backend if the device can do it, otherwise the CPU clock.
+GpuTimer* CreateGpuTimer(ID3D11Device* pDevice, ID3D11DeviceContext* pContext);
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11MeshStream.cpp
+//
+// Streamed mesh buffers on the immediate context.
+//--------------------------------------------------------------------------------------
+
+#include "D3D11MeshStream.h"
+
+#include <string.h>
+
+
+D3D11MeshStreamSink::D3D11MeshStreamSink(ID3D11Device* pDevice, ID3D11DeviceContext* pContext)
+{
+	m_pDevice = pDevice;
+	m_pDevice->AddRef();
+	m_pContext = pContext;
+	m_pContext->AddRef();
+	m_UploadBytes = 0;
+}
+
+D3D11MeshStreamSink::~D3D11MeshStreamSink()
+{
+	for (uint32_t m = 0; m < (uint32_t)m_Meshes.size(); m++)
+		EvictMesh(m);
+	m_pContext->Release();
+	m_pDevice->Release();
+}
+
+bool D3D11MeshStreamSink::BeginMesh(uint32_t mesh, const MeshFileHeader& header)
+{
+	if (m_Meshes.size() <= mesh)
+	{
+		Mesh empty;
+		memset(&empty, 0, sizeof(empty));
+		m_Meshes.resize(mesh + 1, empty);
+	}
+	EvictMesh(mesh);
+	m_Meshes[mesh].Header = header;
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = header.VertexCount * header.VertexStride;
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	if (FAILED(m_pDevice->CreateBuffer(&bd, nullptr, &m_Meshes[mesh].pBuffers[MESH_STREAM_VERTICES])))
+		return false;
+
+	bd.ByteWidth = header.IndexCount * header.IndexBytes;
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	if (FAILED(m_pDevice->CreateBuffer(&bd, nullptr, &m_Meshes[mesh].pBuffers[MESH_STREAM_INDICES])))
+	{
+		EvictMesh(mesh);
+		return false;
+	}
+	return true;
+}
+
+void D3D11MeshStreamSink::UploadChunk(uint32_t mesh, MeshStreamBlob blob, uint64_t offset, const void* pData, size_t bytes)
+{
+	ID3D11Buffer* pBuffer = m_Meshes[mesh].pBuffers[blob];
+	if (!pBuffer)
+		return;
+
+	D3D11_BOX box;
+	box.left = (UINT)offset;
+	box.right = (UINT)(offset + bytes);
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	m_pContext->UpdateSubresource(pBuffer, 0, &box, pData, 0, 0);
+	m_UploadBytes += bytes;
+}
+
+void D3D11MeshStreamSink::EndMesh(uint32_t mesh)
+{
+	UNREFERENCED_PARAMETER(mesh);
+}
+
+void D3D11MeshStreamSink::EvictMesh(uint32_t mesh)
+{
+	if (mesh >= m_Meshes.size())
+		return;
+	for (int blob = 0; blob < 2; blob++)
+	{
+		if (m_Meshes[mesh].pBuffers[blob]) m_Meshes[mesh].pBuffers[blob]->Release();
+		m_Meshes[mesh].pBuffers[blob] = nullptr;
+	}
+}
+
+uint64_t D3D11MeshStreamSink::TakeUploadBytes()
+{
+	uint64_t bytes = m_UploadBytes;
+	m_UploadBytes = 0;
+	return bytes;
+}
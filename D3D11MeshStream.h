@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11MeshStream.h
+//
+// MeshStreamSink making D3D11 buffers, for streaming meshes in Tutorial07.
+// Each mesh gets a default usage vertex and index buffer created empty, which
+// the chunks fill with UpdateSubresource on the immediate context, so the
+// driver copies at most the upload budget a frame.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+#include <vector>
+
+#include "MeshStream.h"
+
+
+class D3D11MeshStreamSink : public MeshStreamSink
+{
+public:
+	D3D11MeshStreamSink(ID3D11Device* pDevice, ID3D11DeviceContext* pContext);
+	~D3D11MeshStreamSink();
+
+	bool BeginMesh(uint32_t mesh, const MeshFileHeader& header);
+	void UploadChunk(uint32_t mesh, MeshStreamBlob blob, uint64_t offset, const void* pData, size_t bytes);
+	void EndMesh(uint32_t mesh);
+	void EvictMesh(uint32_t mesh);
+
+	// Null until the mesh's header is through, and after eviction.  Only
+	// drawable once the streamer says it is resident.
+	ID3D11Buffer* GetVertexBuffer(uint32_t mesh) const { return (mesh < m_Meshes.size()) ? m_Meshes[mesh].pBuffers[MESH_STREAM_VERTICES] : nullptr; }
+	ID3D11Buffer* GetIndexBuffer(uint32_t mesh) const { return (mesh < m_Meshes.size()) ? m_Meshes[mesh].pBuffers[MESH_STREAM_INDICES] : nullptr; }
+	const MeshFileHeader& Header(uint32_t mesh) const { return m_Meshes[mesh].Header; }
+
+	// Bytes copied with UpdateSubresource since the last call.
+	uint64_t TakeUploadBytes();
+
+private:
+	D3D11MeshStreamSink(const D3D11MeshStreamSink&);
+	D3D11MeshStreamSink& operator=(const D3D11MeshStreamSink&);
+
+	struct Mesh
+	{
+		ID3D11Buffer* pBuffers[2];
+		MeshFileHeader Header;
+	};
+
+	ID3D11Device* m_pDevice;
+	ID3D11DeviceContext* m_pContext;
+	std::vector<Mesh> m_Meshes;
+	uint64_t m_UploadBytes;
+};
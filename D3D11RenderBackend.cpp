@@ -0,0 +1,301 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11RenderBackend.cpp
+//
+// Scene drawing on the immediate context.
+//--------------------------------------------------------------------------------------
+
+#include "D3D11RenderBackend.h"
+
+#include <string.h>
+
+#include "nvapi.h"
+
+// Thread groups of CullIndirect in Tutorial07.fx.
+static const UINT kCullGroupSize = 64;
+
+
+D3D11RenderBackend::D3D11RenderBackend()
+{
+	m_pDevice = nullptr;
+	m_pContext = nullptr;
+	m_pSharedCB = nullptr;
+	m_pInstanceBuffer = nullptr;
+	m_InstanceBytes = 0;
+	m_UploadBytes = 0;
+	m_pCullShader = nullptr;
+	m_pCullCB = nullptr;
+	m_pIndirectObjects = nullptr;
+	m_pIndirectObjectsSRV = nullptr;
+	m_pIndirectArgs = nullptr;
+	m_pIndirectArgsUAV = nullptr;
+	m_pIndirectInstances = nullptr;
+	m_pIndirectInstancesUAV = nullptr;
+	m_pIndirectTemplate = nullptr;
+	m_IndirectObjectCount = 0;
+	m_IndirectDrawCount = 0;
+	m_MultiDraw = true;
+	m_pAudit = nullptr;
+	m_StereoHandle = nullptr;
+	m_AuditIndexed = 0;
+	m_AuditInstanced = 0;
+	m_AuditIndirect = 0;
+}
+
+D3D11RenderBackend::~D3D11RenderBackend()
+{
+	ReleaseIndirectScene();
+	if (m_pCullCB) m_pCullCB->Release();
+	if (m_pCullShader) m_pCullShader->Release();
+	if (m_pInstanceBuffer) m_pInstanceBuffer->Release();
+	if (m_pSharedCB) m_pSharedCB->Release();
+	if (m_pContext) m_pContext->Release();
+	if (m_pDevice) m_pDevice->Release();
+}
+
+HRESULT D3D11RenderBackend::Init(ID3D11Device* pDevice, ID3D11DeviceContext* pContext, ID3D11Buffer* pSharedCB, UINT maxInstances)
+{
+	if (maxInstances > 0)
+	{
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = maxInstances * GetInstanceStride();
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		HRESULT hr = pDevice->CreateBuffer(&bd, nullptr, &m_pInstanceBuffer);
+		if (FAILED(hr))
+			return hr;
+		m_InstanceBytes = bd.ByteWidth;
+	}
+
+	m_pDevice = pDevice;
+	m_pDevice->AddRef();
+	m_pContext = pContext;
+	m_pContext->AddRef();
+	m_pSharedCB = pSharedCB;
+	m_pSharedCB->AddRef();
+	return S_OK;
+}
+
+HRESULT D3D11RenderBackend::InitIndirect(ID3D11ComputeShader* pCullShader)
+{
+	if (m_pDevice->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
+		return E_NOTIMPL;
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = sizeof(IndirectCullConstants);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	HRESULT hr = m_pDevice->CreateBuffer(&bd, nullptr, &m_pCullCB);
+	if (FAILED(hr))
+		return hr;
+
+	m_pCullShader = pCullShader;
+	m_pCullShader->AddRef();
+	return S_OK;
+}
+
+void D3D11RenderBackend::ReleaseIndirectScene()
+{
+	if (m_pIndirectObjectsSRV) m_pIndirectObjectsSRV->Release();
+	if (m_pIndirectObjects) m_pIndirectObjects->Release();
+	if (m_pIndirectArgsUAV) m_pIndirectArgsUAV->Release();
+	if (m_pIndirectArgs) m_pIndirectArgs->Release();
+	if (m_pIndirectInstancesUAV) m_pIndirectInstancesUAV->Release();
+	if (m_pIndirectInstances) m_pIndirectInstances->Release();
+	delete[] m_pIndirectTemplate;
+	m_pIndirectObjectsSRV = nullptr;
+	m_pIndirectObjects = nullptr;
+	m_pIndirectArgsUAV = nullptr;
+	m_pIndirectArgs = nullptr;
+	m_pIndirectInstancesUAV = nullptr;
+	m_pIndirectInstances = nullptr;
+	m_pIndirectTemplate = nullptr;
+	m_IndirectObjectCount = 0;
+	m_IndirectDrawCount = 0;
+}
+
+void D3D11RenderBackend::SetStereoAudit(StereoAudit* pAudit, StereoHandle handle)
+{
+	m_pAudit = pAudit;
+	m_StereoHandle = handle;
+	if (!pAudit)
+		return;
+	m_AuditIndexed = pAudit->RegisterSite("Scene DrawIndexed", __FILE__, __LINE__);
+	m_AuditInstanced = pAudit->RegisterSite("Scene DrawIndexedInstanced", __FILE__, __LINE__);
+	m_AuditIndirect = pAudit->RegisterSite("Scene DrawIndirect", __FILE__, __LINE__);
+}
+
+uint64_t D3D11RenderBackend::TakeUploadBytes()
+{
+	uint64_t bytes = m_UploadBytes;
+	m_UploadBytes = 0;
+	return bytes;
+}
+
+void D3D11RenderBackend::BeginEye(uint32_t)
+{
+}
+
+void D3D11RenderBackend::UpdateConstants(const void* pData, size_t bytes)
+{
+	m_pContext->UpdateSubresource(m_pSharedCB, 0, nullptr, pData, 0, 0);
+	m_UploadBytes += bytes;
+}
+
+void D3D11RenderBackend::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	m_pContext->DrawIndexed(indexCount, startIndex, baseVertex);
+	AuditDraw(m_AuditIndexed);
+}
+
+void D3D11RenderBackend::SetShader(uint32_t)
+{
+}
+
+void D3D11RenderBackend::SetMaterial(uint32_t)
+{
+}
+
+void D3D11RenderBackend::EndEye()
+{
+}
+
+//--------------------------------------------------------------------------------------
+// Anything past the buffer is dropped, Init sized it for the whole scene.
+//--------------------------------------------------------------------------------------
+void D3D11RenderBackend::UpdateInstances(const void* pData, size_t bytes)
+{
+	if (!m_pInstanceBuffer)
+		return;
+	if (bytes > m_InstanceBytes)
+		bytes = m_InstanceBytes;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(m_pContext->Map(m_pInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, pData, bytes);
+	m_pContext->Unmap(m_pInstanceBuffer, 0);
+	m_UploadBytes += bytes;
+}
+
+void D3D11RenderBackend::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount,
+	uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	m_pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	AuditDraw(m_AuditInstanced);
+}
+
+//--------------------------------------------------------------------------------------
+// The argument records and the instances are written by the cull pass only,
+// through raw views, which is what lets one buffer be both a UAV and an
+// argument or vertex buffer.
+//--------------------------------------------------------------------------------------
+bool D3D11RenderBackend::SetIndirectScene(const IndirectObject* pObjects, uint32_t objectCount,
+	const IndirectDrawArgs* pArgs, uint32_t drawCount)
+{
+	ReleaseIndirectScene();
+	if (!m_pCullShader || objectCount == 0 || drawCount == 0)
+		return false;
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_IMMUTABLE;
+	bd.ByteWidth = objectCount * sizeof(IndirectObject);
+	bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bd.StructureByteStride = sizeof(IndirectObject);
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = pObjects;
+	bool ok = SUCCEEDED(m_pDevice->CreateBuffer(&bd, &InitData, &m_pIndirectObjects)) &&
+		SUCCEEDED(m_pDevice->CreateShaderResourceView(m_pIndirectObjects, nullptr, &m_pIndirectObjectsSRV));
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavd;
+	ZeroMemory(&uavd, sizeof(uavd));
+	uavd.Format = DXGI_FORMAT_R32_TYPELESS;
+	uavd.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavd.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = drawCount * sizeof(IndirectDrawArgs);
+	bd.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	uavd.Buffer.NumElements = bd.ByteWidth / 4;
+	ok = ok && SUCCEEDED(m_pDevice->CreateBuffer(&bd, nullptr, &m_pIndirectArgs)) &&
+		SUCCEEDED(m_pDevice->CreateUnorderedAccessView(m_pIndirectArgs, &uavd, &m_pIndirectArgsUAV));
+
+	bd.ByteWidth = objectCount * GetInstanceStride();
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	uavd.Buffer.NumElements = bd.ByteWidth / 4;
+	ok = ok && SUCCEEDED(m_pDevice->CreateBuffer(&bd, nullptr, &m_pIndirectInstances)) &&
+		SUCCEEDED(m_pDevice->CreateUnorderedAccessView(m_pIndirectInstances, &uavd, &m_pIndirectInstancesUAV));
+	if (!ok)
+	{
+		ReleaseIndirectScene();
+		return false;
+	}
+
+	m_pIndirectTemplate = new IndirectDrawArgs[drawCount];
+	memcpy(m_pIndirectTemplate, pArgs, drawCount * sizeof(IndirectDrawArgs));
+	m_IndirectObjectCount = objectCount;
+	m_IndirectDrawCount = drawCount;
+	return true;
+}
+
+void D3D11RenderBackend::CullIndirect(const IndirectCullConstants& constants)
+{
+	if (!m_pIndirectArgs)
+		return;
+
+	m_pContext->UpdateSubresource(m_pIndirectArgs, 0, nullptr, m_pIndirectTemplate, 0, 0);
+	m_pContext->UpdateSubresource(m_pCullCB, 0, nullptr, &constants, 0, 0);
+	m_UploadBytes += m_IndirectDrawCount * sizeof(IndirectDrawArgs) + sizeof(constants);
+
+	// The instance buffer can't be an input while the pass writes it.
+	ID3D11Buffer* pNullBuffer = nullptr;
+	UINT zero = 0;
+	m_pContext->IASetVertexBuffers(1, 1, &pNullBuffer, &zero, &zero);
+
+	ID3D11UnorderedAccessView* pUAVs[] = { m_pIndirectArgsUAV, m_pIndirectInstancesUAV };
+	m_pContext->CSSetShader(m_pCullShader, nullptr, 0);
+	m_pContext->CSSetConstantBuffers(2, 1, &m_pCullCB);
+	m_pContext->CSSetShaderResources(1, 1, &m_pIndirectObjectsSRV);
+	m_pContext->CSSetUnorderedAccessViews(0, ARRAYSIZE(pUAVs), pUAVs, nullptr);
+	m_pContext->Dispatch((m_IndirectObjectCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+	ID3D11UnorderedAccessView* pNullUAVs[] = { nullptr, nullptr };
+	ID3D11ShaderResourceView* pNullSRV = nullptr;
+	m_pContext->CSSetUnorderedAccessViews(0, ARRAYSIZE(pNullUAVs), pNullUAVs, nullptr);
+	m_pContext->CSSetShaderResources(1, 1, &pNullSRV);
+	m_pContext->CSSetShader(nullptr, nullptr, 0);
+
+	UINT stride = GetInstanceStride();
+	UINT offset = 0;
+	m_pContext->IASetVertexBuffers(1, 1, &m_pIndirectInstances, &stride, &offset);
+}
+
+void D3D11RenderBackend::DrawIndirect()
+{
+	if (!m_pIndirectArgs)
+		return;
+
+	if (m_MultiDraw)
+	{
+		if (NvAPI_D3D11_MultiDrawIndexedInstancedIndirect(m_pContext, m_IndirectDrawCount, m_pIndirectArgs,
+			0, sizeof(IndirectDrawArgs)) == NVAPI_OK)
+		{
+			AuditDraw(m_AuditIndirect);
+			return;
+		}
+		m_MultiDraw = false;
+	}
+	for (UINT d = 0; d < m_IndirectDrawCount; d++)
+	{
+		m_pContext->DrawIndexedInstancedIndirect(m_pIndirectArgs, d * sizeof(IndirectDrawArgs));
+		AuditDraw(m_AuditIndirect);
+	}
+}
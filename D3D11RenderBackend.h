@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11RenderBackend.h
+//
+// IRenderBackend on the immediate context, for drawing a Scene in Tutorial07.
+// Constants go to SharedCB with UpdateSubresource, as RenderFrame() does, and
+// the instances to a dynamic vertex buffer mapped with discard once a frame.
+//
+// The eye is already set with NvAPI_Stereo_SetActiveEye by the time a scene is
+// drawn, so BeginEye and EndEye do nothing.  Tutorial07's scene is all one
+// shader and material, which Render() binds, so SetShader and SetMaterial
+// do nothing either.
+//
+// Indirect needs feature level 11_0 and InitIndirect's cull shader.  The
+// objects go to a structured buffer, and the cull pass writes the argument
+// records and the world matrices through raw views, the matrices into an
+// instance buffer of their own that CullIndirect binds to slot 1 once the
+// pass is done.  Each eye is one NvAPI_D3D11_MultiDrawIndexedInstancedIndirect
+// call, or where the driver doesn't have it, which the first call finds out,
+// one DrawIndexedInstancedIndirect per record.
+//
+// With SetStereoAudit every draw call goes to the audit, one site for each kind
+// of draw, so each draw is a sampling candidate rather than the scene as a
+// whole.  A multi-draw is one call, and the driver only answers for its last
+// draw, so it counts as one.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+
+#include "RenderBackend.h"
+#include "StereoAudit.h"
+
+
+class D3D11RenderBackend : public IRenderBackend
+{
+public:
+	D3D11RenderBackend();
+	~D3D11RenderBackend();
+
+	// maxInstances of 0 makes no instance buffer, for per-object drawing only.
+	HRESULT Init(ID3D11Device* pDevice, ID3D11DeviceContext* pContext, ID3D11Buffer* pSharedCB, UINT maxInstances);
+
+	// CullIndirect from Tutorial07.fx, after Init.
+	HRESULT InitIndirect(ID3D11ComputeShader* pCullShader);
+
+	// False once an indirect draw has found NVAPI can't do it.
+	bool GetMultiDraw() const { return m_MultiDraw; }
+
+	// For IASetVertexBuffers slot 1, one row-major world matrix per instance.
+	ID3D11Buffer* GetInstanceBuffer() const { return m_pInstanceBuffer; }
+	UINT GetInstanceStride() const { return sizeof(float) * 16; }
+
+	// Null turns the audit off, as it starts.  The handle has to outlive the backend's use of it.
+	void SetStereoAudit(StereoAudit* pAudit, StereoHandle handle);
+
+	// Bytes of constants and instances uploaded since the last call.
+	uint64_t TakeUploadBytes();
+
+	void BeginEye(uint32_t eye);
+	void SetShader(uint32_t shader);
+	void SetMaterial(uint32_t material);
+	void UpdateConstants(const void* pData, size_t bytes);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void EndEye();
+	void UpdateInstances(const void* pData, size_t bytes);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount,
+		uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	bool SetIndirectScene(const IndirectObject* pObjects, uint32_t objectCount,
+		const IndirectDrawArgs* pArgs, uint32_t drawCount);
+	void CullIndirect(const IndirectCullConstants& constants);
+	void DrawIndirect();
+
+private:
+	D3D11RenderBackend(const D3D11RenderBackend&);
+	D3D11RenderBackend& operator=(const D3D11RenderBackend&);
+
+	void ReleaseIndirectScene();
+
+	void AuditDraw(uint32_t site)
+	{
+		if (m_pAudit)
+			m_pAudit->AfterDraw(site, m_StereoHandle);
+	}
+
+	ID3D11Device* m_pDevice;
+	ID3D11DeviceContext* m_pContext;
+	ID3D11Buffer* m_pSharedCB;
+	ID3D11Buffer* m_pInstanceBuffer;
+	UINT m_InstanceBytes;
+	uint64_t m_UploadBytes;
+
+	ID3D11ComputeShader* m_pCullShader;
+	ID3D11Buffer* m_pCullCB;
+	ID3D11Buffer* m_pIndirectObjects;
+	ID3D11ShaderResourceView* m_pIndirectObjectsSRV;
+	ID3D11Buffer* m_pIndirectArgs;
+	ID3D11UnorderedAccessView* m_pIndirectArgsUAV;
+	ID3D11Buffer* m_pIndirectInstances;
+	ID3D11UnorderedAccessView* m_pIndirectInstancesUAV;
+	IndirectDrawArgs* m_pIndirectTemplate;		// Instance counts 0, the reset each frame
+	UINT m_IndirectObjectCount;
+	UINT m_IndirectDrawCount;
+	bool m_MultiDraw;
+
+	StereoAudit* m_pAudit;
+	StereoHandle m_StereoHandle;
+	uint32_t m_AuditIndexed;
+	uint32_t m_AuditInstanced;
+	uint32_t m_AuditIndirect;
+};
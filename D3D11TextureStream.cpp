@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11TextureStream.cpp
+//
+// Streamed textures on the immediate context.
+//--------------------------------------------------------------------------------------
+
+#include "D3D11TextureStream.h"
+
+#include <string.h>
+
+
+static const DXGI_FORMAT kDxgiFormats[TEXTURE_FORMAT_COUNT] =
+{
+	DXGI_FORMAT_BC1_UNORM,
+	DXGI_FORMAT_BC3_UNORM,
+	DXGI_FORMAT_BC7_UNORM,
+};
+
+D3D11TextureStreamSink::D3D11TextureStreamSink(ID3D11Device* pDevice, ID3D11DeviceContext* pContext)
+{
+	m_pDevice = pDevice;
+	m_pDevice->AddRef();
+	m_pContext = pContext;
+	m_pContext->AddRef();
+	m_UploadBytes = 0;
+}
+
+D3D11TextureStreamSink::~D3D11TextureStreamSink()
+{
+	for (size_t t = 0; t < m_Textures.size(); t++)
+	{
+		if (m_Textures[t].pSRV) m_Textures[t].pSRV->Release();
+		if (m_Textures[t].pTexture) m_Textures[t].pTexture->Release();
+	}
+	m_pContext->Release();
+	m_pDevice->Release();
+}
+
+bool D3D11TextureStreamSink::SetResidentMips(uint32_t texture, const TextureFileHeader& header, uint32_t finestMip)
+{
+	if (m_Textures.size() <= texture)
+	{
+		Texture empty;
+		memset(&empty, 0, sizeof(empty));
+		m_Textures.resize(texture + 1, empty);
+	}
+	Texture& t = m_Textures[texture];
+
+	D3D11_TEXTURE2D_DESC td;
+	ZeroMemory(&td, sizeof(td));
+	td.Width = TextureMipSize(header.Width, finestMip);
+	td.Height = TextureMipSize(header.Height, finestMip);
+	td.MipLevels = header.MipCount - finestMip;
+	td.ArraySize = 1;
+	td.Format = kDxgiFormats[header.Format];
+	td.SampleDesc.Count = 1;
+	td.Usage = D3D11_USAGE_DEFAULT;
+	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ID3D11Texture2D* pTexture = nullptr;
+	if (FAILED(m_pDevice->CreateTexture2D(&td, nullptr, &pTexture)))
+		return false;
+	ID3D11ShaderResourceView* pSRV = nullptr;
+	if (FAILED(m_pDevice->CreateShaderResourceView(pTexture, nullptr, &pSRV)))
+	{
+		pTexture->Release();
+		return false;
+	}
+
+	// Mips both textures hold move over on the GPU.
+	if (t.pTexture)
+	{
+		uint32_t first = (finestMip > t.FinestMip) ? finestMip : t.FinestMip;
+		for (uint32_t m = first; m < header.MipCount; m++)
+			m_pContext->CopySubresourceRegion(pTexture, m - finestMip, 0, 0, 0, t.pTexture, m - t.FinestMip, nullptr);
+		t.pSRV->Release();
+		t.pTexture->Release();
+	}
+	t.pTexture = pTexture;
+	t.pSRV = pSRV;
+	t.FinestMip = finestMip;
+	return true;
+}
+
+void D3D11TextureStreamSink::UploadMip(uint32_t texture, uint32_t mip, const TextureMip& layout, const void* pData)
+{
+	Texture& t = m_Textures[texture];
+	if (!t.pTexture || mip < t.FinestMip)
+		return;
+
+	m_pContext->UpdateSubresource(t.pTexture, mip - t.FinestMip, nullptr, pData, layout.RowBytes, layout.Bytes);
+	m_UploadBytes += layout.Bytes;
+}
+
+uint64_t D3D11TextureStreamSink::TakeUploadBytes()
+{
+	uint64_t bytes = m_UploadBytes;
+	m_UploadBytes = 0;
+	return bytes;
+}
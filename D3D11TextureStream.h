@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11TextureStream.h
+//
+// TextureStreamSink making D3D11 textures, for streamed textures in Tutorial07.
+// D3D11 textures can't grow or lose mips in place, so each change of resident
+// mips makes a new default usage texture with just those mips, copies over
+// the ones both have on the GPU with CopySubresourceRegion, and fills the new
+// ones with UpdateSubresource.  The old texture is released once its copy is
+// queued, so for that moment both are held.  BC textures want their top mip a
+// multiple of 4 on each side, which a power of two file always gives.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+#include <vector>
+
+#include "TextureStream.h"
+
+
+class D3D11TextureStreamSink : public TextureStreamSink
+{
+public:
+	D3D11TextureStreamSink(ID3D11Device* pDevice, ID3D11DeviceContext* pContext);
+	~D3D11TextureStreamSink();
+
+	bool SetResidentMips(uint32_t texture, const TextureFileHeader& header, uint32_t finestMip);
+	void UploadMip(uint32_t texture, uint32_t mip, const TextureMip& layout, const void* pData);
+
+	// Null if the texture never got its tail.  Changes whenever the resident
+	// mips do, so look it up each frame.
+	ID3D11ShaderResourceView* GetShaderResourceView(uint32_t texture) const { return (texture < m_Textures.size()) ? m_Textures[texture].pSRV : nullptr; }
+
+	// Bytes copied with UpdateSubresource since the last call.
+	uint64_t TakeUploadBytes();
+
+private:
+	D3D11TextureStreamSink(const D3D11TextureStreamSink&);
+	D3D11TextureStreamSink& operator=(const D3D11TextureStreamSink&);
+
+	struct Texture
+	{
+		ID3D11Texture2D* pTexture;
+		ID3D11ShaderResourceView* pSRV;
+		uint32_t FinestMip;
+	};
+
+	ID3D11Device* m_pDevice;
+	ID3D11DeviceContext* m_pContext;
+	std::vector<Texture> m_Textures;
+	uint64_t m_UploadBytes;
+};
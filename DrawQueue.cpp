@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------
+// File: DrawQueue.cpp
+//
+// Draw keys and their radix sort.
+//--------------------------------------------------------------------------------------
+
+#include "DrawQueue.h"
+#include "Timing.h"
+
+#include <string.h>
+
+
+// Big enough that a chunk's histogram and scatter outweigh handing it out.
+static const uint32_t kSortChunkKeys = 16384;
+
+
+DrawQueue::DrawQueue()
+{
+	m_Chunks = 0;
+	m_ChunkSize = 0;
+	m_Shift = 0;
+	m_SortNs = 0;
+	m_SortPasses = 0;
+	Clear();
+}
+
+void DrawQueue::Clear()
+{
+	m_Keys.clear();
+	m_Values.clear();
+	m_KeyAnd = ~(uint64_t)0;
+	m_KeyOr = 0;
+}
+
+void DrawQueue::Reserve(uint32_t count)
+{
+	m_Keys.reserve(count);
+	m_Values.reserve(count);
+}
+
+size_t DrawQueue::MemoryBytes() const
+{
+	return (m_Keys.capacity() + m_ScratchKeys.capacity()) * sizeof(uint64_t) +
+		(m_Values.capacity() + m_ScratchValues.capacity() + m_Offsets.capacity()) * sizeof(uint32_t);
+}
+
+void DrawQueue::HistogramTask(void* pContext, uint32_t begin, uint32_t end)
+{
+	DrawQueue* q = static_cast<DrawQueue*>(pContext);
+	uint32_t count = (uint32_t)q->m_Keys.size();
+	const uint64_t* pKeys = &q->m_Keys[0];
+	uint32_t shift = q->m_Shift;
+	uint32_t chunkSize = q->m_ChunkSize;
+	for (uint32_t chunk = begin; chunk < end; chunk++)
+	{
+		uint32_t* pCounts = &q->m_Offsets[chunk * 256];
+		memset(pCounts, 0, 256 * sizeof(uint32_t));
+		uint32_t last = (count - chunk * chunkSize > chunkSize) ? (chunk + 1) * chunkSize : count;
+		for (uint32_t i = chunk * chunkSize; i < last; i++)
+			pCounts[(pKeys[i] >> shift) & 0xFF]++;
+	}
+}
+
+void DrawQueue::ScatterTask(void* pContext, uint32_t begin, uint32_t end)
+{
+	DrawQueue* q = static_cast<DrawQueue*>(pContext);
+	uint32_t count = (uint32_t)q->m_Keys.size();
+	const uint64_t* pKeys = &q->m_Keys[0];
+	const uint32_t* pValues = &q->m_Values[0];
+	uint64_t* pOutKeys = &q->m_ScratchKeys[0];
+	uint32_t* pOutValues = &q->m_ScratchValues[0];
+	uint32_t shift = q->m_Shift;
+	uint32_t chunkSize = q->m_ChunkSize;
+	for (uint32_t chunk = begin; chunk < end; chunk++)
+	{
+		uint32_t* pNext = &q->m_Offsets[chunk * 256];
+		uint32_t last = (count - chunk * chunkSize > chunkSize) ? (chunk + 1) * chunkSize : count;
+		for (uint32_t i = chunk * chunkSize; i < last; i++)
+		{
+			uint32_t to = pNext[(pKeys[i] >> shift) & 0xFF]++;
+			pOutKeys[to] = pKeys[i];
+			pOutValues[to] = pValues[i];
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Per pass, each chunk counts its digits, then a digit's keys from chunk c go
+// after all the smaller digits' and after the same digit's from chunks before
+// c, which keeps the sort stable, and each chunk scatters its own keys there.
+//--------------------------------------------------------------------------------------
+void DrawQueue::Sort(WorkerPool* pPool)
+{
+	uint64_t start = GetTimeNs();
+	uint32_t count = (uint32_t)m_Keys.size();
+	m_SortPasses = 0;
+	if (count < 2)
+	{
+		m_SortNs = GetTimeNs() - start;
+		return;
+	}
+
+	m_ChunkSize = pPool ? kSortChunkKeys : count;
+	m_Chunks = (count + m_ChunkSize - 1) / m_ChunkSize;
+	m_Offsets.resize(m_Chunks * 256);
+	m_ScratchKeys.resize(count);
+	m_ScratchValues.resize(count);
+
+	uint64_t differs = m_KeyAnd ^ m_KeyOr;
+	for (m_Shift = 0; m_Shift < 64; m_Shift += 8)
+	{
+		if (((differs >> m_Shift) & 0xFF) == 0)
+			continue;
+
+		if (pPool && m_Chunks > 1)
+			pPool->ParallelFor(m_Chunks, 1, HistogramTask, this);
+		else
+			HistogramTask(this, 0, m_Chunks);
+
+		uint32_t total = 0;
+		for (uint32_t digit = 0; digit < 256; digit++)
+		{
+			for (uint32_t chunk = 0; chunk < m_Chunks; chunk++)
+			{
+				uint32_t n = m_Offsets[chunk * 256 + digit];
+				m_Offsets[chunk * 256 + digit] = total;
+				total += n;
+			}
+		}
+
+		if (pPool && m_Chunks > 1)
+			pPool->ParallelFor(m_Chunks, 1, ScatterTask, this);
+		else
+			ScatterTask(this, 0, m_Chunks);
+
+		m_Keys.swap(m_ScratchKeys);
+		m_Values.swap(m_ScratchValues);
+		m_SortPasses++;
+	}
+
+	m_SortNs = GetTimeNs() - start;
+}
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// File: DrawQueue.h
+//
+// A frame's draws as 64 bit sort keys, sorted so that draws sharing state end
+// up next to each other and the state is set once per run of them.
+//
+// Most significant first, a key is
+//
+//     shader     8 bits
+//     material  16 bits
+//     mesh      16 bits
+//     depth     24 bits, front to back
+//
+// so the costliest change, the shader, happens least, and draws with the
+// same state go front to back for early depth rejection.  Depth is the top
+// bits of the float after the sign, which order the same as the positive
+// floats they came from.
+//
+// Each key carries a 32 bit value, what the caller needs to make the draw.
+// The sort is an LSD radix sort, 8 bits a pass, skipping passes where every
+// key has the same digit, which with few shaders and materials is most of the
+// high ones.  Given a WorkerPool, each pass histograms and then scatters
+// fixed chunks of the keys in parallel.  It is stable, so equal keys keep
+// the order they were added in.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "WorkerPool.h"
+
+
+static const uint32_t kDrawKeyShaderBits = 8;
+static const uint32_t kDrawKeyMaterialBits = 16;
+static const uint32_t kDrawKeyMeshBits = 16;
+static const uint32_t kDrawKeyDepthBits = 24;
+
+// Fields wider than their bits are cut, depth at or behind 0 is 0.
+inline uint64_t MakeDrawKey(uint32_t shader, uint32_t material, uint32_t mesh, float depth)
+{
+	union { float f; uint32_t u; } bits;
+	bits.f = (depth > 0.0f) ? depth : 0.0f;
+	uint64_t key = shader & ((1u << kDrawKeyShaderBits) - 1);
+	key = (key << kDrawKeyMaterialBits) | (material & ((1u << kDrawKeyMaterialBits) - 1));
+	key = (key << kDrawKeyMeshBits) | (mesh & ((1u << kDrawKeyMeshBits) - 1));
+	key = (key << kDrawKeyDepthBits) | ((bits.u >> (31 - kDrawKeyDepthBits)) & ((1u << kDrawKeyDepthBits) - 1));
+	return key;
+}
+
+inline uint32_t DrawKeyShader(uint64_t key) { return (uint32_t)(key >> (64 - kDrawKeyShaderBits)); }
+inline uint32_t DrawKeyMaterial(uint64_t key) { return (uint32_t)(key >> (kDrawKeyMeshBits + kDrawKeyDepthBits)) & ((1u << kDrawKeyMaterialBits) - 1); }
+inline uint32_t DrawKeyMesh(uint64_t key) { return (uint32_t)(key >> kDrawKeyDepthBits) & ((1u << kDrawKeyMeshBits) - 1); }
+
+
+class DrawQueue
+{
+public:
+	DrawQueue();
+
+	// Empties the queue, keeping the memory.
+	void Clear();
+	void Reserve(uint32_t count);
+
+	void Add(uint64_t key, uint32_t value)
+	{
+		m_KeyAnd &= key;
+		m_KeyOr |= key;
+		m_Keys.push_back(key);
+		m_Values.push_back(value);
+	}
+
+	// Null sorts on the calling thread.
+	void Sort(WorkerPool* pPool);
+
+	uint32_t Count() const { return (uint32_t)m_Keys.size(); }
+	uint64_t Key(uint32_t i) const { return m_Keys[i]; }
+	uint32_t Value(uint32_t i) const { return m_Values[i]; }
+
+	// Of the last Sort.
+	uint64_t SortNs() const { return m_SortNs; }
+	uint32_t SortPasses() const { return m_SortPasses; }
+
+	size_t MemoryBytes() const;
+
+private:
+	DrawQueue(const DrawQueue&);
+	DrawQueue& operator=(const DrawQueue&);
+
+	static void HistogramTask(void* pContext, uint32_t begin, uint32_t end);
+	static void ScatterTask(void* pContext, uint32_t begin, uint32_t end);
+
+	std::vector<uint64_t> m_Keys;
+	std::vector<uint32_t> m_Values;
+	std::vector<uint64_t> m_ScratchKeys;
+	std::vector<uint32_t> m_ScratchValues;
+	std::vector<uint32_t> m_Offsets;		// 256 per chunk, counts and then where each digit goes
+	uint64_t m_KeyAnd;
+	uint64_t m_KeyOr;
+	uint32_t m_Chunks;
+	uint32_t m_ChunkSize;
+	uint32_t m_Shift;						// Of the pass being run
+	uint64_t m_SortNs;
+	uint32_t m_SortPasses;
+};
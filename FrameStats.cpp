@@ -0,0 +1,337 @@
+//--------------------------------------------------------------------------------------
+// File: FrameStats.cpp
+//
+// Frame statistics ring, P-square quantiles, and the export thread.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "FrameStats.h"
+#include "Timing.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+
+//--------------------------------------------------------------------------------------
+// P2Quantile
+//
+// Marker positions are 1-based, as in the paper.
+//--------------------------------------------------------------------------------------
+P2Quantile::P2Quantile(double quantile)
+{
+	m_Quantile = quantile;
+	m_Count = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		m_Heights[i] = 0.0;
+		m_Positions[i] = i + 1.0;
+	}
+
+	m_Desired[0] = 1.0;
+	m_Desired[1] = 1.0 + 2.0 * quantile;
+	m_Desired[2] = 1.0 + 4.0 * quantile;
+	m_Desired[3] = 3.0 + 2.0 * quantile;
+	m_Desired[4] = 5.0;
+
+	m_Increments[0] = 0.0;
+	m_Increments[1] = quantile / 2.0;
+	m_Increments[2] = quantile;
+	m_Increments[3] = (1.0 + quantile) / 2.0;
+	m_Increments[4] = 1.0;
+}
+
+void P2Quantile::Add(double x)
+{
+	if (m_Count < 5)
+	{
+		m_Heights[m_Count++] = x;
+		if (m_Count == 5)
+			std::sort(m_Heights, m_Heights + 5);
+		return;
+	}
+	m_Count++;
+
+	// Find the cell x falls in, stretching the ends if needed.
+	int k;
+	if (x < m_Heights[0])
+	{
+		m_Heights[0] = x;
+		k = 0;
+	}
+	else if (x >= m_Heights[4])
+	{
+		m_Heights[4] = x;
+		k = 3;
+	}
+	else
+	{
+		k = 0;
+		while (x >= m_Heights[k + 1])
+			k++;
+	}
+
+	for (int i = k + 1; i < 5; i++)
+		m_Positions[i] += 1.0;
+	for (int i = 0; i < 5; i++)
+		m_Desired[i] += m_Increments[i];
+
+	// Move the middle markers toward where they should be.
+	for (int i = 1; i <= 3; i++)
+	{
+		double d = m_Desired[i] - m_Positions[i];
+		if ((d >= 1.0 && m_Positions[i + 1] - m_Positions[i] > 1.0) ||
+			(d <= -1.0 && m_Positions[i - 1] - m_Positions[i] < -1.0))
+		{
+			int step = (d > 0.0) ? 1 : -1;
+			double h = Parabolic(i, step);
+			if (m_Heights[i - 1] < h && h < m_Heights[i + 1])
+				m_Heights[i] = h;
+			else
+				m_Heights[i] = Linear(i, step);
+			m_Positions[i] += step;
+		}
+	}
+}
+
+double P2Quantile::Parabolic(int i, double d) const
+{
+	const double* q = m_Heights;
+	const double* n = m_Positions;
+	return q[i] + d / (n[i + 1] - n[i - 1]) *
+		((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+		 (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+}
+
+double P2Quantile::Linear(int i, int d) const
+{
+	return m_Heights[i] + d * (m_Heights[i + d] - m_Heights[i]) / (m_Positions[i + d] - m_Positions[i]);
+}
+
+//--------------------------------------------------------------------------------------
+// With fewer than five samples there are no markers yet, just pick from the
+// sorted samples.
+//--------------------------------------------------------------------------------------
+double P2Quantile::Value() const
+{
+	if (m_Count == 0)
+		return 0.0;
+	if (m_Count < 5)
+	{
+		double sorted[5];
+		memcpy(sorted, m_Heights, sizeof(sorted));
+		std::sort(sorted, sorted + m_Count);
+		size_t index = (size_t)(m_Quantile * (double)(m_Count - 1) + 0.5);
+		return sorted[index];
+	}
+	return m_Heights[2];
+}
+
+
+//--------------------------------------------------------------------------------------
+// Once a second, to the working directory.
+//--------------------------------------------------------------------------------------
+FrameStatsConfig DefaultFrameStatsConfig()
+{
+	FrameStatsConfig config;
+	config.BudgetNs = 1000000000ull / 120;
+	config.ExportIntervalMs = 1000;
+	config.CsvPath = "Tutorial07_frames.csv";
+	config.JsonPath = "Tutorial07_frames.json";
+	return config;
+}
+
+
+//--------------------------------------------------------------------------------------
+// FrameStats
+//--------------------------------------------------------------------------------------
+FrameStats::FrameStats()
+	: m_P50(0.5), m_P95(0.95), m_P99(0.99), m_P999(0.999)
+{
+	m_Config = DefaultFrameStatsConfig();
+	m_Head.store(0);
+	m_Tail.store(0);
+	m_Dropped.store(0);
+	m_Running.store(false);
+
+	m_Frames = 0;
+	m_TotalMs = 0.0;
+	m_MaxMs = 0.0;
+	m_FramesOverBudget = 0;
+	m_MissedVblanks = 0;
+	m_TotalImbalanceMs = 0.0;
+	m_MaxImbalanceMs = 0.0;
+
+	memset(&m_Summary, 0, sizeof(m_Summary));
+	m_CsvHeaderWritten = false;
+}
+
+FrameStats::~FrameStats()
+{
+	Stop();
+}
+
+void FrameStats::Start(const FrameStatsConfig& config)
+{
+	if (m_Running.load())
+		return;
+
+	m_Config = config;
+	m_Running.store(true);
+	m_Thread = std::thread(&FrameStats::ThreadMain, this);
+}
+
+void FrameStats::Stop()
+{
+	if (!m_Running.exchange(false))
+		return;
+	m_Thread.join();
+}
+
+//--------------------------------------------------------------------------------------
+// Single producer: only this thread writes m_Head, only the stats thread writes
+// m_Tail.  One slot stays empty so full and empty can be told apart.
+//--------------------------------------------------------------------------------------
+void FrameStats::Record(const FrameSample& sample)
+{
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	uint32_t next = (head + 1) & (kRingSize - 1);
+	if (next == m_Tail.load(std::memory_order_acquire))
+	{
+		m_Dropped.store(m_Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+
+	m_Ring[head] = sample;
+	m_Head.store(next, std::memory_order_release);
+}
+
+FrameStatsSummary FrameStats::GetSummary()
+{
+	std::lock_guard<std::mutex> lock(m_SummaryMutex);
+	return m_Summary;
+}
+
+void FrameStats::ThreadMain()
+{
+	uint64_t nextExport = GetTimeNs() + (uint64_t)m_Config.ExportIntervalMs * 1000000ull;
+
+	while (m_Running.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		Drain();
+
+		uint64_t now = GetTimeNs();
+		if (now >= nextExport)
+		{
+			Export();
+			nextExport = now + (uint64_t)m_Config.ExportIntervalMs * 1000000ull;
+		}
+	}
+
+	// Whatever came in after the last pass.
+	Drain();
+	Export();
+}
+
+//--------------------------------------------------------------------------------------
+// Consume everything in the ring, then publish a new summary.
+//--------------------------------------------------------------------------------------
+void FrameStats::Drain()
+{
+	uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+	uint32_t head = m_Head.load(std::memory_order_acquire);
+
+	while (tail != head)
+	{
+		const FrameSample& s = m_Ring[tail];
+		double frameMs = (double)s.FrameNs / 1e6;
+
+		m_P50.Add(frameMs);
+		m_P95.Add(frameMs);
+		m_P99.Add(frameMs);
+		m_P999.Add(frameMs);
+		m_Frames++;
+		m_TotalMs += frameMs;
+		m_MaxMs = std::max(m_MaxMs, frameMs);
+
+		// A frame that took 2.5 budgets was on screen for 3 refreshes, so 2 were missed.
+		if (s.FrameNs > m_Config.BudgetNs)
+		{
+			m_FramesOverBudget++;
+			m_MissedVblanks += (s.FrameNs - 1) / m_Config.BudgetNs;
+		}
+
+		double imbalanceMs = (s.EyeNs[0] > s.EyeNs[1] ? s.EyeNs[0] - s.EyeNs[1] : s.EyeNs[1] - s.EyeNs[0]) / 1e6;
+		m_TotalImbalanceMs += imbalanceMs;
+		m_MaxImbalanceMs = std::max(m_MaxImbalanceMs, imbalanceMs);
+
+		tail = (tail + 1) & (kRingSize - 1);
+	}
+	m_Tail.store(tail, std::memory_order_release);
+
+	FrameStatsSummary summary;
+	summary.Frames = m_Frames;
+	summary.DroppedSamples = m_Dropped.load(std::memory_order_relaxed);
+	summary.MeanMs = m_Frames ? m_TotalMs / (double)m_Frames : 0.0;
+	summary.P50Ms = m_P50.Value();
+	summary.P95Ms = m_P95.Value();
+	summary.P99Ms = m_P99.Value();
+	summary.P999Ms = m_P999.Value();
+	summary.MaxMs = m_MaxMs;
+	summary.OnePercentLowFps = (summary.P99Ms > 0.0) ? 1000.0 / summary.P99Ms : 0.0;
+	summary.FramesOverBudget = m_FramesOverBudget;
+	summary.MissedVblanks = m_MissedVblanks;
+	summary.MeanEyeImbalanceMs = m_Frames ? m_TotalImbalanceMs / (double)m_Frames : 0.0;
+	summary.MaxEyeImbalanceMs = m_MaxImbalanceMs;
+
+	std::lock_guard<std::mutex> lock(m_SummaryMutex);
+	m_Summary = summary;
+}
+
+//--------------------------------------------------------------------------------------
+// CSV gets a row per export, the JSON file always holds just the latest.
+//--------------------------------------------------------------------------------------
+void FrameStats::Export()
+{
+	FrameStatsSummary s = GetSummary();
+	double uptimeSec = (double)GetTimeNs() / 1e9;
+
+	if (!m_Config.CsvPath.empty())
+	{
+		FILE* f = fopen(m_Config.CsvPath.c_str(), m_CsvHeaderWritten ? "ab" : "wb");
+		if (f)
+		{
+			if (!m_CsvHeaderWritten)
+			{
+				fprintf(f, "time_s,frames,dropped,mean_ms,p50_ms,p95_ms,p99_ms,p999_ms,max_ms,one_percent_low_fps,"
+					"over_budget,missed_vblanks,mean_eye_imbalance_ms,max_eye_imbalance_ms\n");
+				m_CsvHeaderWritten = true;
+			}
+			fprintf(f, "%.3f,%llu,%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%llu,%llu,%.4f,%.4f\n",
+				uptimeSec, (unsigned long long)s.Frames, (unsigned long long)s.DroppedSamples,
+				s.MeanMs, s.P50Ms, s.P95Ms, s.P99Ms, s.P999Ms, s.MaxMs, s.OnePercentLowFps,
+				(unsigned long long)s.FramesOverBudget, (unsigned long long)s.MissedVblanks,
+				s.MeanEyeImbalanceMs, s.MaxEyeImbalanceMs);
+			fclose(f);
+		}
+	}
+
+	if (!m_Config.JsonPath.empty())
+	{
+		FILE* f = fopen(m_Config.JsonPath.c_str(), "wb");
+		if (f)
+		{
+			fprintf(f, "{\"time_s\":%.3f,\"budget_ms\":%.4f,\"frames\":%llu,\"dropped\":%llu,"
+				"\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"p999_ms\":%.4f,\"max_ms\":%.4f,"
+				"\"one_percent_low_fps\":%.2f,\"over_budget\":%llu,\"missed_vblanks\":%llu,"
+				"\"mean_eye_imbalance_ms\":%.4f,\"max_eye_imbalance_ms\":%.4f}\n",
+				uptimeSec, (double)m_Config.BudgetNs / 1e6, (unsigned long long)s.Frames, (unsigned long long)s.DroppedSamples,
+				s.MeanMs, s.P50Ms, s.P95Ms, s.P99Ms, s.P999Ms, s.MaxMs, s.OnePercentLowFps,
+				(unsigned long long)s.FramesOverBudget, (unsigned long long)s.MissedVblanks,
+				s.MeanEyeImbalanceMs, s.MaxEyeImbalanceMs);
+			fclose(f);
+		}
+	}
+}
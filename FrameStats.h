@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------
+// File: FrameStats.h
+//
+// Frame time statistics for judging stereo smoothness.
+//
+// RenderFrame() hands one FrameSample per frame to Record, which only writes it
+// into a fixed-size single-producer/single-consumer ring, no locks and no
+// allocation.  A background thread drains the ring, keeps streaming estimates of
+// the p50/p95/p99/p99.9 frame time with the P-square algorithm (so no samples are
+// kept), counts frames that blew the 120Hz budget, tracks left/right eye
+// imbalance, and periodically appends to a CSV and rewrites a JSON snapshot.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+//--------------------------------------------------------------------------------------
+// What RenderFrame measures.  Eye times are the CPU time of each eye's block.
+//--------------------------------------------------------------------------------------
+struct FrameSample
+{
+	uint64_t FrameNs;		// Start of this frame to start of the next
+	uint64_t EyeNs[2];
+};
+
+
+//--------------------------------------------------------------------------------------
+// Streaming estimate of one quantile, Jain & Chlamtac's P-square algorithm.
+// Five markers, constant memory, no sorting after the first five samples.
+//--------------------------------------------------------------------------------------
+class P2Quantile
+{
+public:
+	explicit P2Quantile(double quantile);
+
+	void Add(double x);
+	double Value() const;
+	uint64_t Count() const { return m_Count; }
+
+private:
+	double Parabolic(int i, double d) const;
+	double Linear(int i, int d) const;
+
+	double m_Quantile;
+	uint64_t m_Count;
+	double m_Heights[5];
+	double m_Positions[5];
+	double m_Desired[5];
+	double m_Increments[5];
+};
+
+
+struct FrameStatsConfig
+{
+	uint64_t BudgetNs;			// 8.33ms for 120Hz
+	uint32_t ExportIntervalMs;
+	std::string CsvPath;		// Empty to skip
+	std::string JsonPath;		// Empty to skip
+};
+
+FrameStatsConfig DefaultFrameStatsConfig();
+
+
+//--------------------------------------------------------------------------------------
+// Everything computed so far, since Start.
+//--------------------------------------------------------------------------------------
+struct FrameStatsSummary
+{
+	uint64_t Frames;
+	uint64_t DroppedSamples;		// Ring was full, the consumer fell behind
+	double MeanMs;
+	double P50Ms;
+	double P95Ms;
+	double P99Ms;
+	double P999Ms;
+	double MaxMs;
+	double OnePercentLowFps;		// Frame rate at the p99 frame time
+	uint64_t FramesOverBudget;
+	uint64_t MissedVblanks;			// Extra refreshes waited, summed over all slow frames
+	double MeanEyeImbalanceMs;		// |left - right|
+	double MaxEyeImbalanceMs;
+};
+
+
+class FrameStats
+{
+public:
+	static const uint32_t kRingSize = 4096;		// Power of two, ~30s at 120Hz
+
+	FrameStats();
+	~FrameStats();
+
+	void Start(const FrameStatsConfig& config);
+	void Stop();
+
+	// Frame path.  Never blocks or allocates, drops the sample if the ring is full.
+	void Record(const FrameSample& sample);
+
+	FrameStatsSummary GetSummary();
+
+private:
+	void ThreadMain();
+	void Drain();
+	void Export();
+
+	FrameStatsConfig m_Config;
+
+	// Ring, written by Record, read by the stats thread.
+	FrameSample m_Ring[kRingSize];
+	std::atomic<uint32_t> m_Head;
+	std::atomic<uint32_t> m_Tail;
+	std::atomic<uint64_t> m_Dropped;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Running;
+
+	// Only touched by the stats thread, except under m_SummaryMutex.
+	P2Quantile m_P50;
+	P2Quantile m_P95;
+	P2Quantile m_P99;
+	P2Quantile m_P999;
+	uint64_t m_Frames;
+	double m_TotalMs;
+	double m_MaxMs;
+	uint64_t m_FramesOverBudget;
+	uint64_t m_MissedVblanks;
+	double m_TotalImbalanceMs;
+	double m_MaxImbalanceMs;
+
+	std::mutex m_SummaryMutex;
+	FrameStatsSummary m_Summary;
+	bool m_CsvHeaderWritten;
+};
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// File: GpuTimer.cpp
+//
+// Frame ring, rolling windows, and the CPU clock backend.
+//--------------------------------------------------------------------------------------
+
+#include "GpuTimer.h"
+#include "Timing.h"
+
+#include <string.h>
+
+
+//--------------------------------------------------------------------------------------
+// GpuTimeWindow
+//--------------------------------------------------------------------------------------
+GpuTimeWindow::GpuTimeWindow()
+{
+	memset(m_Samples, 0, sizeof(m_Samples));
+	m_Next = 0;
+	m_Count = 0;
+	m_Sum = 0;
+	m_Last = 0;
+}
+
+void GpuTimeWindow::Add(uint64_t ns)
+{
+	if (m_Count == kSamples)
+		m_Sum -= m_Samples[m_Next];
+	else
+		m_Count++;
+
+	m_Samples[m_Next] = ns;
+	m_Sum += ns;
+	m_Last = ns;
+	m_Next = (m_Next + 1) % kSamples;
+}
+
+uint64_t GpuTimeWindow::Min() const
+{
+	if (m_Count == 0)
+		return 0;
+	uint64_t result = m_Samples[0];
+	for (uint32_t i = 1; i < m_Count; i++)
+		if (m_Samples[i] < result)
+			result = m_Samples[i];
+	return result;
+}
+
+uint64_t GpuTimeWindow::Max() const
+{
+	uint64_t result = 0;
+	for (uint32_t i = 0; i < m_Count; i++)
+		if (m_Samples[i] > result)
+			result = m_Samples[i];
+	return result;
+}
+
+double GpuTimeWindow::Mean() const
+{
+	if (m_Count == 0)
+		return 0.0;
+	return (double)m_Sum / (double)m_Count;
+}
+
+
+//--------------------------------------------------------------------------------------
+// GpuTimer
+//--------------------------------------------------------------------------------------
+GpuTimer::GpuTimer()
+{
+	m_Frame = 0;
+	m_OldestPending = 0;
+	memset(m_SpanMask, 0, sizeof(m_SpanMask));
+	m_FramesCollected = 0;
+	m_FramesDropped = 0;
+}
+
+void GpuTimer::BeginFrame()
+{
+	uint32_t slot = (uint32_t)(m_Frame % kRingSize);
+
+	// The ring is full, the frame that used this slot gets one last chance.
+	if (m_OldestPending + kRingSize <= m_Frame)
+	{
+		Collect(slot, true);
+		m_OldestPending++;
+	}
+
+	m_SpanMask[slot] = 0;
+	IssueFrameBegin(slot);
+}
+
+void GpuTimer::Begin(uint32_t eye, GpuTimerStage stage)
+{
+	uint32_t slot = (uint32_t)(m_Frame % kRingSize);
+	uint32_t span = eye * GPU_STAGE_COUNT + stage;
+	m_SpanMask[slot] |= 1u << span;
+	IssueTimestamp(slot, span * 2);
+}
+
+void GpuTimer::End(uint32_t eye, GpuTimerStage stage)
+{
+	uint32_t slot = (uint32_t)(m_Frame % kRingSize);
+	uint32_t span = eye * GPU_STAGE_COUNT + stage;
+	IssueTimestamp(slot, span * 2 + 1);
+}
+
+//--------------------------------------------------------------------------------------
+// Finish this frame, then pick up whatever older frames are done, oldest first.
+//--------------------------------------------------------------------------------------
+void GpuTimer::EndFrame()
+{
+	uint32_t slot = (uint32_t)(m_Frame % kRingSize);
+	IssueFrameEnd(slot);
+	m_Frame++;
+
+	while (m_OldestPending < m_Frame)
+	{
+		if (!Collect((uint32_t)(m_OldestPending % kRingSize), false))
+			break;
+		m_OldestPending++;
+	}
+}
+
+const GpuTimeWindow& GpuTimer::GetWindow(uint32_t eye, GpuTimerStage stage) const
+{
+	return m_Windows[eye * GPU_STAGE_COUNT + stage];
+}
+
+const GpuTimeWindow& GpuTimer::GetEyeWindow(uint32_t eye) const
+{
+	return m_EyeWindows[eye];
+}
+
+//--------------------------------------------------------------------------------------
+// Returns false if the frame isn't done yet and we can come back for it later.
+//--------------------------------------------------------------------------------------
+bool GpuTimer::Collect(uint32_t slot, bool last)
+{
+	uint64_t timestamps[kQueriesPerFrame];
+	uint64_t frequency = 0;
+
+	ReadResult result = TryReadFrame(slot, m_SpanMask[slot], timestamps, &frequency);
+	if (result == READ_NOT_READY && !last)
+		return false;
+	if (result != READ_READY || frequency == 0)
+	{
+		m_FramesDropped++;
+		return true;
+	}
+
+	uint64_t eyeTotal[kGpuTimerEyes] = { 0 };
+	bool eyeSeen[kGpuTimerEyes] = { false };
+	for (uint32_t span = 0; span < kSpans; span++)
+	{
+		if (!(m_SpanMask[slot] & (1u << span)))
+			continue;
+
+		uint64_t begin = timestamps[span * 2];
+		uint64_t end = timestamps[span * 2 + 1];
+		uint64_t ticks = (end > begin) ? end - begin : 0;
+		uint64_t ns = (uint64_t)((double)ticks * 1e9 / (double)frequency);
+
+		m_Windows[span].Add(ns);
+		eyeTotal[span / GPU_STAGE_COUNT] += ns;
+		eyeSeen[span / GPU_STAGE_COUNT] = true;
+	}
+
+	for (uint32_t eye = 0; eye < kGpuTimerEyes; eye++)
+		if (eyeSeen[eye])
+			m_EyeWindows[eye].Add(eyeTotal[eye]);
+
+	m_FramesCollected++;
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CpuGpuTimer
+//--------------------------------------------------------------------------------------
+void CpuGpuTimer::IssueFrameBegin(uint32_t slot)
+{
+	memset(m_Timestamps[slot], 0, sizeof(m_Timestamps[slot]));
+}
+
+void CpuGpuTimer::IssueTimestamp(uint32_t slot, uint32_t query)
+{
+	m_Timestamps[slot][query] = GetTimeNs();
+}
+
+void CpuGpuTimer::IssueFrameEnd(uint32_t)
+{
+}
+
+GpuTimer::ReadResult CpuGpuTimer::TryReadFrame(uint32_t slot, uint32_t, uint64_t* pTimestamps, uint64_t* pFrequency)
+{
+	memcpy(pTimestamps, m_Timestamps[slot], sizeof(m_Timestamps[slot]));
+	*pFrequency = 1000000000ull;
+	return READ_READY;
+}
@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// File: GpuTimer.h
+//
+// Per-eye GPU timing, split into the clear and draw stages of Render().
+//
+// Every frame gets a begin/end timestamp pair per eye and stage.  The results
+// are read back kRingSize frames later, by which time the GPU is long done, so
+// reading never stalls.  A frame whose results are still not ready when its
+// slot comes around again is dropped rather than waited on.
+//
+// GpuTimer holds the ring and the statistics, the backends only issue and read
+// timestamps.  D3D11GpuTimer (D3D11GpuTimer.h) uses timestamp queries,
+// CpuGpuTimer here just reads the CPU clock, for the software path and for
+// running the same code on Linux.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+
+enum GpuTimerStage
+{
+	GPU_STAGE_CLEAR = 0,
+	GPU_STAGE_DRAW,
+	GPU_STAGE_COUNT
+};
+
+static const uint32_t kGpuTimerEyes = 2;
+
+
+//--------------------------------------------------------------------------------------
+// Last N samples of one measurement, in ns.
+//--------------------------------------------------------------------------------------
+class GpuTimeWindow
+{
+public:
+	static const uint32_t kSamples = 120;	// One second at 120Hz
+
+	GpuTimeWindow();
+
+	void Add(uint64_t ns);
+
+	uint32_t Count() const { return m_Count; }
+	uint64_t Last() const { return m_Last; }
+	uint64_t Min() const;
+	uint64_t Max() const;
+	double Mean() const;
+
+private:
+	uint64_t m_Samples[kSamples];
+	uint32_t m_Next;
+	uint32_t m_Count;
+	uint64_t m_Sum;
+	uint64_t m_Last;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Frame ring and statistics, shared by all backends.
+//--------------------------------------------------------------------------------------
+class GpuTimer
+{
+public:
+	static const uint32_t kRingSize = 4;
+	static const uint32_t kSpans = kGpuTimerEyes * GPU_STAGE_COUNT;
+	static const uint32_t kQueriesPerFrame = kSpans * 2;
+
+	GpuTimer();
+	virtual ~GpuTimer() {}
+
+	void BeginFrame();
+	void Begin(uint32_t eye, GpuTimerStage stage);
+	void End(uint32_t eye, GpuTimerStage stage);
+	void EndFrame();
+
+	// Rolling results for one eye and stage, or the whole eye.
+	const GpuTimeWindow& GetWindow(uint32_t eye, GpuTimerStage stage) const;
+	const GpuTimeWindow& GetEyeWindow(uint32_t eye) const;
+
+	uint64_t FramesCollected() const { return m_FramesCollected; }
+	uint64_t FramesDropped() const { return m_FramesDropped; }
+
+protected:
+	enum ReadResult
+	{
+		READ_READY,
+		READ_NOT_READY,
+		READ_DISJOINT,		// The clock changed under us, results are garbage
+	};
+
+	virtual void IssueFrameBegin(uint32_t slot) = 0;
+	virtual void IssueTimestamp(uint32_t slot, uint32_t query) = 0;
+	virtual void IssueFrameEnd(uint32_t slot) = 0;
+
+	// Fill kQueriesPerFrame timestamps, only the spans in spanMask need be valid.
+	virtual ReadResult TryReadFrame(uint32_t slot, uint32_t spanMask, uint64_t* pTimestamps, uint64_t* pFrequency) = 0;
+
+private:
+	bool Collect(uint32_t slot, bool last);
+
+	uint64_t m_Frame;
+	uint64_t m_OldestPending;
+	uint32_t m_SpanMask[kRingSize];
+
+	GpuTimeWindow m_Windows[kSpans];
+	GpuTimeWindow m_EyeWindows[kGpuTimerEyes];
+	uint64_t m_FramesCollected;
+	uint64_t m_FramesDropped;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Timestamps from the CPU clock.  On a real GPU that only measures submission,
+// but with a software rasterizer, or no device at all, it's the work itself.
+//--------------------------------------------------------------------------------------
+class CpuGpuTimer : public GpuTimer
+{
+protected:
+	void IssueFrameBegin(uint32_t slot);
+	void IssueTimestamp(uint32_t slot, uint32_t query);
+	void IssueFrameEnd(uint32_t slot);
+	ReadResult TryReadFrame(uint32_t slot, uint32_t spanMask, uint64_t* pTimestamps, uint64_t* pFrequency);
+
+private:
+	uint64_t m_Timestamps[kRingSize][kQueriesPerFrame];
+};
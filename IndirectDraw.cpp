@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------
+// File: IndirectDraw.cpp
+//
+// The GPU cull pass's data, and the pass on the CPU.
+//--------------------------------------------------------------------------------------
+
+#include "IndirectDraw.h"
+
+#include <math.h>
+#include <string.h>
+
+
+static_assert(sizeof(IndirectDrawArgs) == 20, "IndirectDrawArgs is D3D11's argument layout");
+static_assert(sizeof(IndirectObject) == 32, "IndirectObject is the cull shader's structure");
+static_assert(sizeof(IndirectCullConstants) % 16 == 0, "IndirectCullConstants is a constant buffer");
+
+void BuildIndirectScene(const Scene& scene, std::vector<IndirectObject>* pObjects, std::vector<IndirectDrawArgs>* pArgs)
+{
+	std::vector<uint32_t> counts(scene.Meshes.size(), 0);
+	pObjects->resize(scene.Objects.size());
+	for (size_t i = 0; i < scene.Objects.size(); i++)
+	{
+		const SceneObject& object = scene.Objects[i];
+		IndirectObject& o = (*pObjects)[i];
+		memcpy(o.Position, object.Position, sizeof(o.Position));
+		o.Radius = scene.Meshes[object.Mesh].Radius * object.Scale;
+		o.Scale = object.Scale;
+		o.Phase = object.Phase;
+		o.Draw = object.Mesh;
+		o.Pad = 0;
+		counts[object.Mesh]++;
+	}
+
+	uint32_t start = 0;
+	pArgs->resize(scene.Meshes.size());
+	for (size_t m = 0; m < scene.Meshes.size(); m++)
+	{
+		const SceneMesh& mesh = scene.Meshes[m];
+		IndirectDrawArgs& args = (*pArgs)[m];
+		args.IndexCountPerInstance = mesh.IndexCount;
+		args.InstanceCount = 0;
+		args.StartIndexLocation = mesh.StartIndex;
+		args.BaseVertexLocation = mesh.BaseVertex;
+		args.StartInstanceLocation = start;
+		start += counts[m];
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// The test is StereoCullSpheresScalar's and the matrix BuildWorldMatrices', so
+// the results match the CPU path exactly.
+//--------------------------------------------------------------------------------------
+uint32_t EmulateIndirectCull(const IndirectCullConstants& constants, const IndirectObject* pObjects,
+	IndirectDrawArgs* pArgs, SMMatrix* pInstances)
+{
+	uint32_t visible = 0;
+	for (uint32_t i = 0; i < constants.ObjectCount; i++)
+	{
+		const IndirectObject& object = pObjects[i];
+		bool inside = true;
+		for (int k = 0; k < CULL_PLANE_COUNT && inside; k++)
+		{
+			const float* p = constants.Frustum.Planes[k];
+			inside = (p[0] * object.Position[0] + p[1] * object.Position[1] + p[2] * object.Position[2] + p[3] >= -object.Radius);
+		}
+		if (!inside)
+			continue;
+
+		IndirectDrawArgs& args = pArgs[object.Draw];
+		float s = sinf(constants.Time + object.Phase) * object.Scale;
+		float c = cosf(constants.Time + object.Phase) * object.Scale;
+
+		SMMatrix& world = pInstances[args.StartInstanceLocation + args.InstanceCount++];
+		world.m[0][0] = c;    world.m[0][1] = 0.0f;         world.m[0][2] = -s;   world.m[0][3] = 0.0f;
+		world.m[1][0] = 0.0f; world.m[1][1] = object.Scale; world.m[1][2] = 0.0f; world.m[1][3] = 0.0f;
+		world.m[2][0] = s;    world.m[2][1] = 0.0f;         world.m[2][2] = c;    world.m[2][3] = 0.0f;
+		world.m[3][0] = object.Position[0];
+		world.m[3][1] = object.Position[1];
+		world.m[3][2] = object.Position[2];
+		world.m[3][3] = 1.0f;
+		visible++;
+	}
+	return visible;
+}
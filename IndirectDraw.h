@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------
+// File: IndirectDraw.h
+//
+// GPU driven drawing of a Scene: what the cull pass reads and writes, and the
+// same pass on the CPU.
+//
+// The objects go to the GPU once, and one argument record per mesh, in
+// D3D11's DrawIndexedInstancedIndirect layout, with the mesh's index range
+// and a first instance far enough along the instance buffer for every object
+// of that mesh.  Each frame the argument records' instance counts are reset
+// and CullIndirect in Tutorial07.fx, one thread per object, tests the object
+// against the union of both eyes' frusta, see StereoCull.h, and if it is
+// visible takes the next instance of its mesh's record with an atomic add and
+// writes its world matrix there.  Both eyes then draw every record, one
+// NvAPI_D3D11_MultiDrawIndexedInstancedIndirect call each, so the CPU's work
+// a frame is the same for ten objects and a million.
+//
+// EmulateIndirectCull is that shader on the CPU, for NullRenderBackend, so the
+// submission can be checked against the CPU cull and timed without a device.
+// It takes the instances in object order, where the GPU's atomics take them
+// in whatever order the threads get there.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Scene.h"
+#include "StereoCull.h"
+#include "StereoMath.h"
+
+
+// D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS.
+struct IndirectDrawArgs
+{
+	uint32_t IndexCountPerInstance;
+	uint32_t InstanceCount;
+	uint32_t StartIndexLocation;
+	int32_t BaseVertexLocation;
+	uint32_t StartInstanceLocation;
+};
+
+// One object as the cull pass reads it, IndirectObject in Tutorial07.fx.
+struct IndirectObject
+{
+	float Position[3];
+	float Radius;			// Of its bounding sphere, the mesh's scaled
+	float Scale;
+	float Phase;
+	uint32_t Draw;			// Its mesh's argument record
+	uint32_t Pad;
+};
+
+// cbIndirectCull in Tutorial07.fx.
+struct IndirectCullConstants
+{
+	StereoFrustum Frustum;
+	float Time;
+	uint32_t ObjectCount;
+	uint32_t Pad[2];
+};
+
+
+// The objects, and one argument record per mesh with its instance count 0.
+// Meshes no object uses get a record too, which draws nothing.
+void BuildIndirectScene(const Scene& scene, std::vector<IndirectObject>* pObjects, std::vector<IndirectDrawArgs>* pArgs);
+
+// pArgs starts as BuildIndirectScene left it and gets the instance counts,
+// pInstances gets a world matrix at each record's instances, as
+// SceneRenderer builds them.  Returns the number of visible objects.
+uint32_t EmulateIndirectCull(const IndirectCullConstants& constants, const IndirectObject* pObjects,
+	IndirectDrawArgs* pArgs, SMMatrix* pInstances);
@@ -0,0 +1,250 @@
+//--------------------------------------------------------------------------------------
+// File: LiveMetrics.cpp
+//
+// Shared memory mapping and the seqlock.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "LiveMetrics.h"
+
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// LiveMetricsWriter
+//--------------------------------------------------------------------------------------
+LiveMetricsWriter::LiveMetricsWriter()
+{
+	m_pShared = nullptr;
+#if defined(_WIN32)
+	m_Mapping = nullptr;
+#else
+	m_Name[0] = '\0';
+#endif
+}
+
+LiveMetricsWriter::~LiveMetricsWriter()
+{
+	Close();
+}
+
+bool LiveMetricsWriter::Open(const char* name, const char* const* nvapiNames, uint32_t nvapiCount)
+{
+	Close();
+
+	void* pView = nullptr;
+	uint32_t size = sizeof(LiveMetricsShared);
+
+#if defined(_WIN32)
+	m_Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, size, name);
+	if (!m_Mapping)
+		return false;
+	pView = MapViewOfFile(m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!pView)
+	{
+		CloseHandle(m_Mapping);
+		m_Mapping = nullptr;
+		return false;
+	}
+#else
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, size) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	pView = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pView == MAP_FAILED)
+		return false;
+	strncpy(m_Name, name, sizeof(m_Name) - 1);
+	m_Name[sizeof(m_Name) - 1] = '\0';
+#endif
+
+	// A segment left over from a crashed run is just overwritten.
+	m_pShared = static_cast<LiveMetricsShared*>(pView);
+	LiveMetricsHeader& header = m_pShared->Header;
+	header.Magic.store(0, std::memory_order_relaxed);
+	header.Version = kLiveMetricsVersion;
+	header.Size = size;
+	header.NvapiCount = (nvapiCount < kLiveMetricsNvapiSlots) ? nvapiCount : kLiveMetricsNvapiSlots;
+#if defined(_WIN32)
+	header.WriterProcessId = GetCurrentProcessId();
+#else
+	header.WriterProcessId = (uint64_t)getpid();
+#endif
+	memset(header.NvapiNames, 0, sizeof(header.NvapiNames));
+	for (uint32_t i = 0; i < header.NvapiCount; i++)
+		strncpy(header.NvapiNames[i], nvapiNames[i], kLiveMetricsNameLength - 1);
+
+	m_pShared->Sequence.store(0, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < kLiveMetricsWords; i++)
+		m_pShared->Words[i].store(0, std::memory_order_relaxed);
+
+	header.Magic.store(kLiveMetricsMagic, std::memory_order_release);
+	return true;
+}
+
+void LiveMetricsWriter::Close()
+{
+	if (!m_pShared)
+		return;
+
+	// Readers that still have it mapped see a zero magic, not a frozen frame.
+	m_pShared->Header.Magic.store(0, std::memory_order_release);
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_pShared);
+	CloseHandle(m_Mapping);
+	m_Mapping = nullptr;
+#else
+	munmap(m_pShared, sizeof(LiveMetricsShared));
+	shm_unlink(m_Name);
+#endif
+	m_pShared = nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+// Seqlock write.  Only one writer, so the sequence needs no read-modify-write.
+//--------------------------------------------------------------------------------------
+void LiveMetricsWriter::Publish(const LiveMetricsSnapshot& snapshot)
+{
+	if (!m_pShared)
+		return;
+
+	uint64_t words[kLiveMetricsWords];
+	memcpy(words, &snapshot, sizeof(words));
+
+	uint64_t sequence = m_pShared->Sequence.load(std::memory_order_relaxed);
+	m_pShared->Sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (uint32_t i = 0; i < kLiveMetricsWords; i++)
+		m_pShared->Words[i].store(words[i], std::memory_order_relaxed);
+
+	m_pShared->Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+
+//--------------------------------------------------------------------------------------
+// LiveMetricsReader
+//
+// The view is mapped writable even though nothing is written, 64-bit atomic
+// loads on 32-bit x86 are done with cmpxchg8b, which faults on a read-only page.
+//--------------------------------------------------------------------------------------
+LiveMetricsReader::LiveMetricsReader()
+{
+	m_pShared = nullptr;
+#if defined(_WIN32)
+	m_Mapping = nullptr;
+#endif
+}
+
+LiveMetricsReader::~LiveMetricsReader()
+{
+	Close();
+}
+
+LiveMetricsReader::OpenResult LiveMetricsReader::Open(const char* name)
+{
+	Close();
+
+	void* pView = nullptr;
+	uint32_t size = sizeof(LiveMetricsShared);
+
+#if defined(_WIN32)
+	m_Mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+	if (!m_Mapping)
+		return OPEN_NOT_FOUND;
+	pView = MapViewOfFile(m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!pView)
+	{
+		CloseHandle(m_Mapping);
+		m_Mapping = nullptr;
+		return OPEN_NOT_FOUND;
+	}
+#else
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return OPEN_NOT_FOUND;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < size)
+	{
+		close(fd);
+		return OPEN_BAD_VERSION;
+	}
+	pView = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pView == MAP_FAILED)
+		return OPEN_NOT_FOUND;
+#endif
+
+	m_pShared = static_cast<const LiveMetricsShared*>(pView);
+
+	const LiveMetricsHeader& header = m_pShared->Header;
+	if (header.Magic.load(std::memory_order_acquire) != kLiveMetricsMagic)
+	{
+		Close();
+		return OPEN_NOT_FOUND;
+	}
+	if (header.Version != kLiveMetricsVersion || header.Size != size)
+	{
+		Close();
+		return OPEN_BAD_VERSION;
+	}
+	return OPEN_OK;
+}
+
+void LiveMetricsReader::Close()
+{
+	if (!m_pShared)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_pShared);
+	CloseHandle(m_Mapping);
+	m_Mapping = nullptr;
+#else
+	munmap(const_cast<LiveMetricsShared*>(m_pShared), sizeof(LiveMetricsShared));
+#endif
+	m_pShared = nullptr;
+}
+
+//--------------------------------------------------------------------------------------
+// Seqlock read.  A copy is only good if the sequence was even before and
+// unchanged after.
+//--------------------------------------------------------------------------------------
+bool LiveMetricsReader::Read(LiveMetricsSnapshot* pSnapshot, uint32_t maxTries) const
+{
+	if (!m_pShared)
+		return false;
+
+	uint64_t words[kLiveMetricsWords];
+	for (uint32_t attempt = 0; attempt < maxTries; attempt++)
+	{
+		uint64_t before = m_pShared->Sequence.load(std::memory_order_acquire);
+		if (before & 1)
+			continue;
+
+		for (uint32_t i = 0; i < kLiveMetricsWords; i++)
+			words[i] = m_pShared->Words[i].load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = m_pShared->Sequence.load(std::memory_order_relaxed);
+		if (before == after)
+		{
+			memcpy(pSnapshot, words, sizeof(words));
+			return true;
+		}
+	}
+	return false;
+}
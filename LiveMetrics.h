@@ -0,0 +1,145 @@
+//--------------------------------------------------------------------------------------
+// File: LiveMetrics.h
+//
+// Live frame metrics in shared memory, for monitoring from another process.
+//
+// The app maps a small named segment, a pagefile-backed file mapping on Windows
+// and a POSIX shm_open segment elsewhere, and RenderFrame() publishes a
+// LiveMetricsSnapshot into it every frame.  Publishing is a seqlock write: bump
+// the sequence to odd, store the words, bump it back to even.  That is a handful
+// of plain stores, no locks and no system calls.  A reader copies the words and
+// retries if the sequence was odd or changed under it.  The writer never waits
+// for readers, so a slow or hung dashboard can't stall a frame.
+//
+// The layout is versioned.  Anything that changes LiveMetricsSnapshot or the
+// header must bump kLiveMetricsVersion, and readers refuse other versions.
+// LiveMetricsMonitor.cpp is a small console reader.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+
+static const uint32_t kLiveMetricsMagic = 0x4D443353;		// "S3DM"
+static const uint32_t kLiveMetricsVersion = 1;
+static const uint32_t kLiveMetricsNvapiSlots = 32;
+static const uint32_t kLiveMetricsNameLength = 48;
+
+#if defined(_WIN32)
+#define LIVE_METRICS_DEFAULT_NAME "Local\\Tutorial07_LiveMetrics"
+#else
+#define LIVE_METRICS_DEFAULT_NAME "/Tutorial07_LiveMetrics"
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// One frame's worth of metrics.  Every field is 8 bytes so the snapshot can be
+// copied as whole atomic words.
+//--------------------------------------------------------------------------------------
+struct LiveMetricsSnapshot
+{
+	uint64_t FrameIndex;
+	uint64_t TimestampNs;				// GetTimeNs when published
+	uint64_t FrameNs;					// Start of the previous frame to start of this one
+	uint64_t EyeCpuNs[2];
+	uint64_t EyeGpuNs[2];				// Latest GPU results, a few frames old
+	double Convergence;
+	double Separation;					// Percent
+	double EyeSeparation;
+	uint64_t UploadBytesFrame;			// UpdateSubresource and Map traffic this frame
+	uint64_t UploadBytesTotal;
+	uint64_t NvapiCalls[kLiveMetricsNvapiSlots];	// Cumulative, see LiveMetricsHeader::NvapiNames
+};
+
+static const uint32_t kLiveMetricsWords = sizeof(LiveMetricsSnapshot) / sizeof(uint64_t);
+static_assert(sizeof(LiveMetricsSnapshot) % sizeof(uint64_t) == 0, "LiveMetricsSnapshot must be whole words");
+
+
+//--------------------------------------------------------------------------------------
+// Written once when the segment is created.  Magic is stored last, so a reader
+// that sees it can trust the rest of the header.
+//--------------------------------------------------------------------------------------
+struct LiveMetricsHeader
+{
+	std::atomic<uint32_t> Magic;
+	uint32_t Version;
+	uint32_t Size;						// sizeof(LiveMetricsShared)
+	uint32_t NvapiCount;				// Used entries of NvapiCalls
+	uint64_t WriterProcessId;
+	char NvapiNames[kLiveMetricsNvapiSlots][kLiveMetricsNameLength];
+};
+
+struct LiveMetricsShared
+{
+	LiveMetricsHeader Header;
+	std::atomic<uint64_t> Sequence;		// Odd while a write is in progress
+	std::atomic<uint64_t> Words[kLiveMetricsWords];
+};
+
+
+//--------------------------------------------------------------------------------------
+// Owns the segment.  Publish is the only call made per frame.
+//--------------------------------------------------------------------------------------
+class LiveMetricsWriter
+{
+public:
+	LiveMetricsWriter();
+	~LiveMetricsWriter();
+
+	bool Open(const char* name, const char* const* nvapiNames, uint32_t nvapiCount);
+	void Close();
+	bool IsOpen() const { return m_pShared != nullptr; }
+
+	void Publish(const LiveMetricsSnapshot& snapshot);
+
+private:
+	LiveMetricsWriter(const LiveMetricsWriter&);
+	LiveMetricsWriter& operator=(const LiveMetricsWriter&);
+
+	LiveMetricsShared* m_pShared;
+#if defined(_WIN32)
+	HANDLE m_Mapping;
+#else
+	char m_Name[256];
+#endif
+};
+
+
+//--------------------------------------------------------------------------------------
+// Maps an existing segment.  Never writes to it.
+//--------------------------------------------------------------------------------------
+class LiveMetricsReader
+{
+public:
+	enum OpenResult
+	{
+		OPEN_OK,
+		OPEN_NOT_FOUND,			// The app isn't running
+		OPEN_BAD_VERSION,
+	};
+
+	LiveMetricsReader();
+	~LiveMetricsReader();
+
+	OpenResult Open(const char* name);
+	void Close();
+
+	const LiveMetricsHeader& Header() const { return m_pShared->Header; }
+
+	// False if the writer was mid-update on every try.
+	bool Read(LiveMetricsSnapshot* pSnapshot, uint32_t maxTries) const;
+
+private:
+	LiveMetricsReader(const LiveMetricsReader&);
+	LiveMetricsReader& operator=(const LiveMetricsReader&);
+
+	const LiveMetricsShared* m_pShared;
+#if defined(_WIN32)
+	HANDLE m_Mapping;
+#endif
+};
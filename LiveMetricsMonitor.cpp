@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// File: LiveMetricsMonitor.cpp
+//
+// Console reader for the live metrics Tutorial07 publishes, see LiveMetrics.h.
+//
+//     LiveMetricsMonitor [-name segment] [-interval ms] [-once] [-json]
+//
+// Prints one line per interval, or with -json one JSON object per line for
+// piping into a dashboard.  Waits for the app if it isn't running yet.
+//
+// Builds on its own on Linux too:
+//     g++ -std=c++11 -O2 LiveMetricsMonitor.cpp LiveMetrics.cpp -o LiveMetricsMonitor -lrt
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "LiveMetrics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+
+static void SleepMs(uint32_t ms)
+{
+#if defined(_WIN32)
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+static void PrintText(const LiveMetricsHeader& header, const LiveMetricsSnapshot& s, const LiveMetricsSnapshot& previous)
+{
+	double fps = 0.0;
+	if (s.TimestampNs > previous.TimestampNs && s.FrameIndex > previous.FrameIndex)
+		fps = (double)(s.FrameIndex - previous.FrameIndex) * 1e9 / (double)(s.TimestampNs - previous.TimestampNs);
+
+	printf("frame %llu  %.1f fps  %.3fms  eyes cpu %.3f/%.3fms gpu %.3f/%.3fms  conv %.3f sep %.1f%%  upload %llu B/frame",
+		(unsigned long long)s.FrameIndex, fps, (double)s.FrameNs / 1e6,
+		(double)s.EyeCpuNs[0] / 1e6, (double)s.EyeCpuNs[1] / 1e6,
+		(double)s.EyeGpuNs[0] / 1e6, (double)s.EyeGpuNs[1] / 1e6,
+		s.Convergence, s.Separation, (unsigned long long)s.UploadBytesFrame);
+
+	// Only the calls made since the last line.
+	for (uint32_t i = 0; i < header.NvapiCount; i++)
+	{
+		uint64_t calls = s.NvapiCalls[i] - previous.NvapiCalls[i];
+		if (calls)
+			printf("  %s %llu", header.NvapiNames[i], (unsigned long long)calls);
+	}
+	printf("\n");
+}
+
+static void PrintJson(const LiveMetricsHeader& header, const LiveMetricsSnapshot& s)
+{
+	printf("{\"frame\":%llu,\"timestamp_ns\":%llu,\"frame_ns\":%llu,\"eye_cpu_ns\":[%llu,%llu],\"eye_gpu_ns\":[%llu,%llu],"
+		"\"convergence\":%g,\"separation\":%g,\"eye_separation\":%g,\"upload_bytes_frame\":%llu,\"upload_bytes_total\":%llu,\"nvapi_calls\":{",
+		(unsigned long long)s.FrameIndex, (unsigned long long)s.TimestampNs, (unsigned long long)s.FrameNs,
+		(unsigned long long)s.EyeCpuNs[0], (unsigned long long)s.EyeCpuNs[1],
+		(unsigned long long)s.EyeGpuNs[0], (unsigned long long)s.EyeGpuNs[1],
+		s.Convergence, s.Separation, s.EyeSeparation,
+		(unsigned long long)s.UploadBytesFrame, (unsigned long long)s.UploadBytesTotal);
+	for (uint32_t i = 0; i < header.NvapiCount; i++)
+		printf("%s\"%s\":%llu", (i > 0) ? "," : "", header.NvapiNames[i], (unsigned long long)s.NvapiCalls[i]);
+	printf("}}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* name = LIVE_METRICS_DEFAULT_NAME;
+	uint32_t intervalMs = 1000;
+	bool once = false;
+	bool json = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc);
+
+		if (strcmp(argv[i], "-name") == 0 && hasValue)
+			name = argv[++i];
+		else if (strcmp(argv[i], "-interval") == 0 && hasValue)
+			intervalMs = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-once") == 0)
+			once = true;
+		else if (strcmp(argv[i], "-json") == 0)
+			json = true;
+		else
+		{
+			fprintf(stderr, "usage: %s [-name segment] [-interval ms] [-once] [-json]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	LiveMetricsReader reader;
+	LiveMetricsSnapshot previous;
+	memset(&previous, 0, sizeof(previous));
+	bool connected = false;
+
+	for (;;)
+	{
+		if (!connected)
+		{
+			LiveMetricsReader::OpenResult result = reader.Open(name);
+			if (result == LiveMetricsReader::OPEN_BAD_VERSION)
+			{
+				fprintf(stderr, "%s has a different layout version, expected %u\n", name, kLiveMetricsVersion);
+				return 1;
+			}
+			connected = (result == LiveMetricsReader::OPEN_OK);
+			if (!connected)
+			{
+				if (once)
+				{
+					fprintf(stderr, "%s not found, is Tutorial07 running?\n", name);
+					return 1;
+				}
+				SleepMs(intervalMs);
+				continue;
+			}
+		}
+
+		// The app exited, wait for the next one.
+		if (reader.Header().Magic.load(std::memory_order_acquire) != kLiveMetricsMagic)
+		{
+			reader.Close();
+			connected = false;
+			memset(&previous, 0, sizeof(previous));
+			continue;
+		}
+
+		LiveMetricsSnapshot snapshot;
+		if (reader.Read(&snapshot, 1000))
+		{
+			if (json)
+				PrintJson(reader.Header(), snapshot);
+			else
+				PrintText(reader.Header(), snapshot, previous);
+			fflush(stdout);
+			previous = snapshot;
+		}
+
+		if (once)
+			return 0;
+		SleepMs(intervalMs);
+	}
+}
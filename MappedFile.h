@@ -0,0 +1,44 @@
+//--------------------------------------------------------------------------------------
+// File: MappedFile.h
+//
+// A whole file mapped read only, MapViewOfFile on Windows and mmap elsewhere.
+//
+// Nothing is read at Open.  Pages come in from the file cache as they are first
+// touched, so handing Data() straight to CreateBuffer reads the file exactly
+// once, into the buffer, with no copy in between.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// False if it can't be opened or is empty.
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+	const void* Data() const { return m_pData; }
+	size_t Size() const { return m_Size; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	void* m_pData;
+	size_t m_Size;
+#if defined(_WIN32)
+	HANDLE m_File;
+	HANDLE m_Mapping;
+#endif
+};
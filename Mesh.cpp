@@ -0,0 +1,167 @@
+//--------------------------------------------------------------------------------------
+// File: Mesh.cpp
+//
+// Bounds and the built in meshes.
+//--------------------------------------------------------------------------------------
+
+#include "Mesh.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+
+static_assert(sizeof(MeshVertex) == 20, "MeshVertex must match SimpleVertex");
+static_assert(sizeof(MeshLod) == 16, "MeshLod is written to files as is");
+
+
+MeshBounds MeshData::Bounds() const
+{
+	MeshBounds bounds;
+	if (Vertices.empty())
+	{
+		memset(&bounds, 0, sizeof(bounds));
+		return bounds;
+	}
+
+	for (int a = 0; a < 3; a++)
+	{
+		bounds.Min[a] = FLT_MAX;
+		bounds.Max[a] = -FLT_MAX;
+	}
+	for (size_t i = 0; i < Vertices.size(); i++)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			float p = Vertices[i].Position[a];
+			bounds.Min[a] = (p < bounds.Min[a]) ? p : bounds.Min[a];
+			bounds.Max[a] = (p > bounds.Max[a]) ? p : bounds.Max[a];
+		}
+	}
+
+	float radiusSquared = 0.0f;
+	for (int a = 0; a < 3; a++)
+		bounds.Center[a] = 0.5f * (bounds.Min[a] + bounds.Max[a]);
+	for (size_t i = 0; i < Vertices.size(); i++)
+	{
+		const float* p = Vertices[i].Position;
+		float dx = p[0] - bounds.Center[0];
+		float dy = p[1] - bounds.Center[1];
+		float dz = p[2] - bounds.Center[2];
+		float d = dx * dx + dy * dy + dz * dz;
+		radiusSquared = (d > radiusSquared) ? d : radiusSquared;
+	}
+	bounds.Radius = sqrtf(radiusSquared);
+	return bounds;
+}
+
+size_t MeshData::MemoryBytes() const
+{
+	return Vertices.capacity() * sizeof(MeshVertex) + Indices.capacity() * sizeof(uint32_t) + Lods.capacity() * sizeof(MeshLod);
+}
+
+
+void BuildCubeMesh(MeshData* pMesh)
+{
+	static const MeshVertex vertices[] =
+	{
+		{ { -1.0f, 1.0f, -1.0f }, { 1.0f, 0.0f } },
+		{ { 1.0f, 1.0f, -1.0f }, { 0.0f, 0.0f } },
+		{ { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } },
+		{ { -1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } },
+
+		{ { -1.0f, -1.0f, -1.0f }, { 0.0f, 0.0f } },
+		{ { 1.0f, -1.0f, -1.0f }, { 1.0f, 0.0f } },
+		{ { 1.0f, -1.0f, 1.0f }, { 1.0f, 1.0f } },
+		{ { -1.0f, -1.0f, 1.0f }, { 0.0f, 1.0f } },
+
+		{ { -1.0f, -1.0f, 1.0f }, { 0.0f, 1.0f } },
+		{ { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f } },
+		{ { -1.0f, 1.0f, -1.0f }, { 1.0f, 0.0f } },
+		{ { -1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+
+		{ { 1.0f, -1.0f, 1.0f }, { 1.0f, 1.0f } },
+		{ { 1.0f, -1.0f, -1.0f }, { 0.0f, 1.0f } },
+		{ { 1.0f, 1.0f, -1.0f }, { 0.0f, 0.0f } },
+		{ { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+
+		{ { -1.0f, -1.0f, -1.0f }, { 0.0f, 1.0f } },
+		{ { 1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f } },
+		{ { 1.0f, 1.0f, -1.0f }, { 1.0f, 0.0f } },
+		{ { -1.0f, 1.0f, -1.0f }, { 0.0f, 0.0f } },
+
+		{ { -1.0f, -1.0f, 1.0f }, { 1.0f, 1.0f } },
+		{ { 1.0f, -1.0f, 1.0f }, { 0.0f, 1.0f } },
+		{ { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+		{ { -1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+	};
+
+	static const uint32_t indices[] =
+	{
+		3, 1, 0,
+		2, 1, 3,
+
+		6, 4, 5,
+		7, 4, 6,
+
+		11, 9, 8,
+		10, 9, 11,
+
+		14, 12, 13,
+		15, 12, 14,
+
+		19, 17, 16,
+		18, 17, 19,
+
+		22, 20, 21,
+		23, 20, 22
+	};
+
+	pMesh->Vertices.assign(vertices, vertices + sizeof(vertices) / sizeof(vertices[0]));
+	pMesh->Indices.assign(indices, indices + sizeof(indices) / sizeof(indices[0]));
+	pMesh->Lods.clear();
+}
+
+//--------------------------------------------------------------------------------------
+// Rows from the north pole down, each with a seam vertex repeated at the end so
+// the texture wraps once.  Wound clockwise seen from outside, like the cube.
+//--------------------------------------------------------------------------------------
+void BuildSphereMesh(uint32_t rings, uint32_t segments, MeshData* pMesh)
+{
+	rings = (rings < 2) ? 2 : rings;
+	segments = (segments < 3) ? 3 : segments;
+
+	pMesh->Vertices.resize((size_t)(rings + 1) * (segments + 1));
+	for (uint32_t r = 0; r <= rings; r++)
+	{
+		float theta = 3.14159265f * (float)r / (float)rings;
+		for (uint32_t s = 0; s <= segments; s++)
+		{
+			float phi = 6.28318531f * (float)s / (float)segments;
+			MeshVertex& v = pMesh->Vertices[(size_t)r * (segments + 1) + s];
+			v.Position[0] = sinf(theta) * cosf(phi);
+			v.Position[1] = cosf(theta);
+			v.Position[2] = sinf(theta) * sinf(phi);
+			v.Texcoord[0] = (float)s / (float)segments;
+			v.Texcoord[1] = (float)r / (float)rings;
+		}
+	}
+
+	pMesh->Indices.clear();
+	pMesh->Indices.reserve((size_t)rings * segments * 6);
+	for (uint32_t r = 0; r < rings; r++)
+	{
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			uint32_t a = r * (segments + 1) + s;
+			uint32_t b = a + segments + 1;
+			pMesh->Indices.push_back(a);
+			pMesh->Indices.push_back(a + 1);
+			pMesh->Indices.push_back(b);
+			pMesh->Indices.push_back(b);
+			pMesh->Indices.push_back(a + 1);
+			pMesh->Indices.push_back(b + 1);
+		}
+	}
+	pMesh->Lods.clear();
+}
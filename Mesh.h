@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------
+// File: Mesh.h
+//
+// A triangle mesh in memory, what the converters and optimizers work on before
+// it is written out with MeshFile.  Vertices are SimpleVertex from
+// Tutorial07.cpp, indices are always 32 bit here and only narrowed on write.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+// Same layout as SimpleVertex.
+struct MeshVertex
+{
+	float Position[3];
+	float Texcoord[2];
+};
+
+// A level of detail is a range of the index buffer over the shared vertices.
+struct MeshLod
+{
+	uint32_t StartIndex;
+	uint32_t IndexCount;
+	float Error;			// Largest distance from the full mesh, in mesh units, 0 for the full mesh
+	uint32_t Reserved;
+};
+
+struct MeshBounds
+{
+	float Min[3];
+	float Max[3];
+	float Center[3];		// Sphere about the box center
+	float Radius;
+};
+
+
+struct MeshData
+{
+	std::vector<MeshVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<MeshLod> Lods;		// Empty means one, all of Indices
+
+	MeshBounds Bounds() const;
+	size_t MemoryBytes() const;
+};
+
+
+// The 24 vertex, 36 index textured cube InitDevice() used to build inline.
+void BuildCubeMesh(MeshData* pMesh);
+
+// A UV sphere of radius 1, (rings + 1) * (segments + 1) vertices, for tests
+// and benchmarks that need a mesh of a given size.
+void BuildSphereMesh(uint32_t rings, uint32_t segments, MeshData* pMesh);
@@ -0,0 +1,284 @@
+//--------------------------------------------------------------------------------------
+// File: MeshConvert.cpp
+//
+// Writes mesh files for Tutorial07's -mesh option, see MeshFile.h.
+//
+//     MeshConvert [-optimize] [-format float|half|unorm] input.obj output.smsh
+//     MeshConvert [-optimize] [-format float|half|unorm] -cube output.smsh
+//     MeshConvert -info file.smsh
+//     MeshConvert -texture bc1|bc3|bc7 input.ppm|-checker output.stex
+//
+// -cube writes the cube InitDevice() draws without -mesh.  -info loads a mesh
+// file the way Tutorial07 does, checks every index, and prints what it holds
+// and how it does in the vertex cache.  -optimize reorders the mesh for the
+// vertex cache, overdraw and vertex fetch first, see MeshOptimize.h, and
+// prints the measurements before and after.  -format picks the vertex format,
+// see MeshFile.h, and a quantized one prints the error it introduces.
+//
+// -texture writes a texture file for Tutorial07's -texture option, see
+// TextureFile.h, from a binary PPM or the checker Tutorial07 draws without
+// one, with every mip down to 1x1.  The compression is EncodeTexture's quick
+// one, good for trying out streaming rather than for shipping.
+//
+// Builds on Linux too:
+//     g++ -std=c++11 -O2 -msse2 MeshConvert.cpp Mesh.cpp MeshFile.cpp MeshOptimize.cpp MappedFile.cpp ObjImport.cpp
+//         TextureCodec.cpp TextureFile.cpp -o MeshConvert
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshOptimize.h"
+#include "ObjImport.h"
+#include "TextureCodec.h"
+#include "TextureFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static void PrintMesh(const MeshFileView& view, size_t fileBytes)
+{
+	const MeshBounds& b = view.Bounds();
+	printf("%u vertices (%s), %u triangles, %u bit indices, %u LODs, %llu bytes\n",
+		view.VertexCount(), MeshVertexFormatName(view.VertexFormat()), view.IndexCount() / 3, view.IndexBytes() * 8,
+		view.LodCount(), (unsigned long long)fileBytes);
+	printf("bounds (%g %g %g) - (%g %g %g), radius %g\n", b.Min[0], b.Min[1], b.Min[2], b.Max[0], b.Max[1], b.Max[2], b.Radius);
+	if (view.VertexFormat() != MESH_VERTEX_POSITION_TEXCOORD)
+	{
+		const MeshVertexDecode& d = view.Decode();
+		printf("decode position * (%g %g %g) + (%g %g %g), texcoord * (%g %g) + (%g %g)\n",
+			d.PositionScale[0], d.PositionScale[1], d.PositionScale[2], d.PositionOffset[0], d.PositionOffset[1], d.PositionOffset[2],
+			d.TexcoordScale[0], d.TexcoordScale[1], d.TexcoordOffset[0], d.TexcoordOffset[1]);
+	}
+}
+
+static void PrintCache(const char* label, const VertexCacheStats& cache, const VertexFetchStats& fetch, float overdraw)
+{
+	printf("%-8s ACMR %.3f, ATVR %.3f, overfetch %.3f, overdraw %.3f\n", label, cache.Acmr, cache.Atvr, fetch.Overfetch, overdraw);
+}
+
+static void PrintCache(const char* label, const MeshData& mesh, uint32_t vertexStride)
+{
+	uint32_t vertexCount = (uint32_t)mesh.Vertices.size();
+	PrintCache(label, AnalyzeVertexCache(&mesh.Indices[0], mesh.Indices.size(), vertexCount),
+		AnalyzeVertexFetch(&mesh.Indices[0], mesh.Indices.size(), vertexCount, vertexStride),
+		AnalyzeOverdraw(&mesh.Indices[0], mesh.Indices.size(), &mesh.Vertices[0], vertexCount));
+}
+
+static int Info(const char* path)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		fprintf(stderr, "can't open %s\n", path);
+		return 1;
+	}
+
+	MeshFileView view;
+	std::string error;
+	if (!view.Parse(file.Data(), file.Size(), &error))
+	{
+		fprintf(stderr, "%s: %s\n", path, error.c_str());
+		return 1;
+	}
+	if (!view.CheckIndices())
+	{
+		fprintf(stderr, "%s: index past the last vertex\n", path);
+		return 1;
+	}
+	PrintMesh(view, file.Size());
+
+	MeshData mesh;
+	if (view.ToMeshData(&mesh) && !mesh.Indices.empty())
+		PrintCache("", mesh, view.VertexStride());
+	return 0;
+}
+
+static int Write(MeshData& mesh, const char* path, bool optimize, MeshVertexFormat format)
+{
+	if (optimize && !mesh.Indices.empty())
+	{
+		PrintCache("before", mesh, MeshVertexStride(format));
+		OptimizeMesh(&mesh);
+		PrintCache("after", mesh, MeshVertexStride(format));
+	}
+	if (format != MESH_VERTEX_POSITION_TEXCOORD)
+	{
+		MeshQuantizeError error = MeasureQuantizeError(mesh, format);
+		printf("%s error: position %g max, %g rms; texcoord %g max, %g rms\n", MeshVertexFormatName(format),
+			error.PositionMax, error.PositionRms, error.TexcoordMax, error.TexcoordRms);
+	}
+
+	std::vector<uint8_t> image;
+	MeshFileView view;
+	if (!SerializeMesh(mesh, &image, format) || !view.Parse(&image[0], image.size()) || !view.CheckIndices())
+	{
+		fprintf(stderr, "%s: mesh is empty or inconsistent\n", path);
+		return 1;
+	}
+
+	FILE* f = fopen(path, "wb");
+	if (!f || fwrite(&image[0], 1, image.size(), f) != image.size() || fclose(f) != 0)
+	{
+		fprintf(stderr, "can't write %s\n", path);
+		return 1;
+	}
+	PrintMesh(view, image.size());
+	return 0;
+}
+
+// Reads a binary PPM, P6 with 8 bit channels, as RGBA with alpha 255.
+static bool ReadPpm(const char* path, uint32_t* pWidth, uint32_t* pHeight, std::vector<uint8_t>* pRGBA)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f)
+		return false;
+
+	// The header is the magic and three numbers, with comments to the end of a line.
+	char magic[3] = {};
+	unsigned int values[3] = {};
+	bool ok = (fread(magic, 1, 2, f) == 2 && strcmp(magic, "P6") == 0);
+	for (int v = 0; v < 3 && ok; v++)
+	{
+		int c = fgetc(f);
+		while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			if (c == '#')
+				while (c != '\n' && c != EOF)
+					c = fgetc(f);
+			c = fgetc(f);
+		}
+		ok = (c != EOF && ungetc(c, f) != EOF && fscanf(f, "%u", &values[v]) == 1);
+	}
+	ok = ok && fgetc(f) != EOF && values[0] > 0 && values[1] > 0 && values[0] <= 16384 && values[1] <= 16384 && values[2] == 255;
+
+	std::vector<uint8_t> rgb;
+	if (ok)
+	{
+		rgb.resize((size_t)values[0] * values[1] * 3);
+		ok = (fread(&rgb[0], 1, rgb.size(), f) == rgb.size());
+	}
+	fclose(f);
+	if (!ok)
+		return false;
+
+	*pWidth = values[0];
+	*pHeight = values[1];
+	pRGBA->resize(rgb.size() / 3 * 4);
+	for (size_t i = 0; i < rgb.size() / 3; i++)
+	{
+		(*pRGBA)[i * 4 + 0] = rgb[i * 3 + 0];
+		(*pRGBA)[i * 4 + 1] = rgb[i * 3 + 1];
+		(*pRGBA)[i * 4 + 2] = rgb[i * 3 + 2];
+		(*pRGBA)[i * 4 + 3] = 255;
+	}
+	return true;
+}
+
+static int WriteTexture(const char* formatName, const char* input, const char* path)
+{
+	TextureFormat format = TEXTURE_FORMAT_COUNT;
+	for (int f = 0; f < TEXTURE_FORMAT_COUNT; f++)
+		if (strcmp(formatName, TextureFormatName((TextureFormat)f)) == 0)
+			format = (TextureFormat)f;
+	if (format == TEXTURE_FORMAT_COUNT)
+	{
+		fprintf(stderr, "unknown texture format %s\n", formatName);
+		return 2;
+	}
+
+	uint32_t width = 256;
+	uint32_t height = 256;
+	std::vector<uint8_t> rgba;
+	if (strcmp(input, "-checker") == 0)
+		BuildCheckerImage(width, height, 8, &rgba);
+	else if (!ReadPpm(input, &width, &height, &rgba))
+	{
+		fprintf(stderr, "%s: can't read it as a binary PPM\n", input);
+		return 1;
+	}
+
+	TextureData texture;
+	BuildTexture(format, &rgba[0], width, height, 0, &texture);
+	std::vector<uint8_t> image;
+	TextureFileView view;
+	if (!SerializeTexture(texture, &image) || !view.Parse(&image[0], image.size()))
+	{
+		fprintf(stderr, "%s: texture is inconsistent\n", path);
+		return 1;
+	}
+
+	FILE* f = fopen(path, "wb");
+	if (!f || fwrite(&image[0], 1, image.size(), f) != image.size() || fclose(f) != 0)
+	{
+		fprintf(stderr, "can't write %s\n", path);
+		return 1;
+	}
+	printf("%ux%u %s, %u mips, tail from mip %u (%llu bytes), %llu bytes\n", width, height, TextureFormatName(format),
+		view.MipCount(), view.TailMip(), (unsigned long long)view.Header().TailBytes, (unsigned long long)image.size());
+	if ((width & 3) != 0 || (height & 3) != 0)
+		printf("not a multiple of 4 on each side, which D3D11 wants of a BC texture's top mip\n");
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 3 && strcmp(argv[1], "-info") == 0)
+		return Info(argv[2]);
+	if (argc == 5 && strcmp(argv[1], "-texture") == 0)
+		return WriteTexture(argv[2], argv[3], argv[4]);
+
+	const char* program = argv[0];
+	bool optimize = false;
+	MeshVertexFormat format = MESH_VERTEX_POSITION_TEXCOORD;
+	bool usage = false;
+	while (argc > 1 && !usage)
+	{
+		if (strcmp(argv[1], "-optimize") == 0)
+		{
+			optimize = true;
+			argc--;
+			argv++;
+		}
+		else if (strcmp(argv[1], "-format") == 0 && argc > 2)
+		{
+			format = MESH_VERTEX_FORMAT_COUNT;
+			for (int f = 0; f < MESH_VERTEX_FORMAT_COUNT; f++)
+				if (strcmp(argv[2], MeshVertexFormatName((MeshVertexFormat)f)) == 0)
+					format = (MeshVertexFormat)f;
+			usage = (format == MESH_VERTEX_FORMAT_COUNT);
+			argc -= 2;
+			argv += 2;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	MeshData mesh;
+	if (!usage && argc == 3 && strcmp(argv[1], "-cube") == 0)
+	{
+		BuildCubeMesh(&mesh);
+		return Write(mesh, argv[2], optimize, format);
+	}
+
+	if (!usage && argc == 3 && argv[1][0] != '-')
+	{
+		std::string error;
+		if (!ImportObj(argv[1], &mesh, &error))
+		{
+			fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+			return 1;
+		}
+		return Write(mesh, argv[2], optimize, format);
+	}
+
+	fprintf(stderr, "usage: %s [-optimize] [-format float|half|unorm] input.obj output.smsh\n"
+		"       %s [-optimize] [-format float|half|unorm] -cube output.smsh\n       %s -info file.smsh\n"
+		"       %s -texture bc1|bc3|bc7 input.ppm|-checker output.stex\n",
+		program, program, program, program);
+	return 2;
+}
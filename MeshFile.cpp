@@ -0,0 +1,365 @@
+//--------------------------------------------------------------------------------------
+// File: MeshFile.cpp
+//
+// Writing and checking mesh files.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "MeshFile.h"
+#include "VertexQuantize.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+
+static_assert(sizeof(MeshFileHeader) == 152, "MeshFileHeader is written to files as is");
+static_assert(sizeof(MeshQuantizedVertex) == 12, "MeshQuantizedVertex is written to files as is");
+
+uint32_t MeshVertexStride(MeshVertexFormat format)
+{
+	switch (format)
+	{
+	case MESH_VERTEX_POSITION_TEXCOORD:	return sizeof(MeshVertex);
+	case MESH_VERTEX_UNORM16_HALF:		return sizeof(MeshQuantizedVertex);
+	case MESH_VERTEX_UNORM16_UNORM16:	return sizeof(MeshQuantizedVertex);
+	default:							return 0;
+	}
+}
+
+const char* MeshVertexFormatName(MeshVertexFormat format)
+{
+	switch (format)
+	{
+	case MESH_VERTEX_POSITION_TEXCOORD:	return "float";
+	case MESH_VERTEX_UNORM16_HALF:		return "half";
+	case MESH_VERTEX_UNORM16_UNORM16:	return "unorm";
+	default:							return "unknown";
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Quantization.  Positions span the bounding box, and UNORM texcoords their own
+// box, with a zero scale on any axis that is flat.
+//--------------------------------------------------------------------------------------
+MeshVertexDecode ComputeVertexDecode(const MeshData& mesh, MeshVertexFormat format)
+{
+	MeshVertexDecode decode;
+	for (int a = 0; a < 3; a++)
+	{
+		decode.PositionScale[a] = 1.0f;
+		decode.PositionOffset[a] = 0.0f;
+	}
+	for (int a = 0; a < 2; a++)
+	{
+		decode.TexcoordScale[a] = 1.0f;
+		decode.TexcoordOffset[a] = 0.0f;
+	}
+	if (format == MESH_VERTEX_POSITION_TEXCOORD || mesh.Vertices.empty())
+		return decode;
+
+	MeshBounds bounds = mesh.Bounds();
+	for (int a = 0; a < 3; a++)
+	{
+		decode.PositionScale[a] = bounds.Max[a] - bounds.Min[a];
+		decode.PositionOffset[a] = bounds.Min[a];
+	}
+
+	if (format == MESH_VERTEX_UNORM16_UNORM16)
+	{
+		float min[2] = { FLT_MAX, FLT_MAX };
+		float max[2] = { -FLT_MAX, -FLT_MAX };
+		for (size_t i = 0; i < mesh.Vertices.size(); i++)
+		{
+			for (int a = 0; a < 2; a++)
+			{
+				min[a] = std::min(min[a], mesh.Vertices[i].Texcoord[a]);
+				max[a] = std::max(max[a], mesh.Vertices[i].Texcoord[a]);
+			}
+		}
+		for (int a = 0; a < 2; a++)
+		{
+			decode.TexcoordScale[a] = max[a] - min[a];
+			decode.TexcoordOffset[a] = min[a];
+		}
+	}
+	return decode;
+}
+
+static uint16_t QuantizeRange(float value, float scale, float offset)
+{
+	return (scale > 0.0f) ? QuantizeUnorm16((value - offset) / scale) : 0;
+}
+
+static void EncodeVertex(const MeshVertex& v, MeshVertexFormat format, const MeshVertexDecode& decode, MeshQuantizedVertex* pOut)
+{
+	for (int a = 0; a < 3; a++)
+		pOut->Position[a] = QuantizeRange(v.Position[a], decode.PositionScale[a], decode.PositionOffset[a]);
+	pOut->Position[3] = 0xFFFF;
+
+	for (int a = 0; a < 2; a++)
+	{
+		if (format == MESH_VERTEX_UNORM16_HALF)
+			pOut->Texcoord[a] = FloatToHalf(v.Texcoord[a]);
+		else
+			pOut->Texcoord[a] = QuantizeRange(v.Texcoord[a], decode.TexcoordScale[a], decode.TexcoordOffset[a]);
+	}
+}
+
+static void DecodeVertex(const MeshQuantizedVertex& q, MeshVertexFormat format, const MeshVertexDecode& decode, MeshVertex* pOut)
+{
+	for (int a = 0; a < 3; a++)
+		pOut->Position[a] = DequantizeUnorm16(q.Position[a]) * decode.PositionScale[a] + decode.PositionOffset[a];
+
+	for (int a = 0; a < 2; a++)
+	{
+		float value = (format == MESH_VERTEX_UNORM16_HALF) ? HalfToFloat(q.Texcoord[a]) : DequantizeUnorm16(q.Texcoord[a]);
+		pOut->Texcoord[a] = value * decode.TexcoordScale[a] + decode.TexcoordOffset[a];
+	}
+}
+
+MeshQuantizeError MeasureQuantizeError(const MeshData& mesh, MeshVertexFormat format)
+{
+	MeshQuantizeError error;
+	memset(&error, 0, sizeof(error));
+	if (format == MESH_VERTEX_POSITION_TEXCOORD || mesh.Vertices.empty())
+		return error;
+
+	MeshVertexDecode decode = ComputeVertexDecode(mesh, format);
+	double positionSquares = 0.0;
+	double texcoordSquares = 0.0;
+	for (size_t i = 0; i < mesh.Vertices.size(); i++)
+	{
+		const MeshVertex& v = mesh.Vertices[i];
+		MeshQuantizedVertex q;
+		MeshVertex back;
+		EncodeVertex(v, format, decode, &q);
+		DecodeVertex(q, format, decode, &back);
+
+		float dp[3] = { back.Position[0] - v.Position[0], back.Position[1] - v.Position[1], back.Position[2] - v.Position[2] };
+		float dt[2] = { back.Texcoord[0] - v.Texcoord[0], back.Texcoord[1] - v.Texcoord[1] };
+		float position = dp[0] * dp[0] + dp[1] * dp[1] + dp[2] * dp[2];
+		float texcoord = dt[0] * dt[0] + dt[1] * dt[1];
+		error.PositionMax = std::max(error.PositionMax, sqrtf(position));
+		error.TexcoordMax = std::max(error.TexcoordMax, sqrtf(texcoord));
+		positionSquares += position;
+		texcoordSquares += texcoord;
+	}
+	error.PositionRms = (float)sqrt(positionSquares / (double)mesh.Vertices.size());
+	error.TexcoordRms = (float)sqrt(texcoordSquares / (double)mesh.Vertices.size());
+	return error;
+}
+
+static uint64_t AlignUp(uint64_t offset)
+{
+	return (offset + kMeshFileAlignment - 1) & ~(uint64_t)(kMeshFileAlignment - 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writing
+//--------------------------------------------------------------------------------------
+bool SerializeMesh(const MeshData& mesh, std::vector<uint8_t>* pImage, MeshVertexFormat format)
+{
+	if (mesh.Vertices.empty() || mesh.Indices.empty() || MeshVertexStride(format) == 0)
+		return false;
+
+	std::vector<MeshLod> lods = mesh.Lods;
+	if (lods.empty())
+	{
+		MeshLod all;
+		all.StartIndex = 0;
+		all.IndexCount = (uint32_t)mesh.Indices.size();
+		all.Error = 0.0f;
+		all.Reserved = 0;
+		lods.push_back(all);
+	}
+	for (size_t i = 0; i < lods.size(); i++)
+		if ((uint64_t)lods[i].StartIndex + lods[i].IndexCount > mesh.Indices.size())
+			return false;
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Magic = kMeshFileMagic;
+	header.Version = kMeshFileVersion;
+	header.HeaderBytes = sizeof(MeshFileHeader);
+	header.VertexFormat = format;
+	header.VertexStride = MeshVertexStride(format);
+	header.VertexCount = (uint32_t)mesh.Vertices.size();
+	header.IndexBytes = (mesh.Vertices.size() <= 0x10000) ? 2 : 4;
+	header.IndexCount = (uint32_t)mesh.Indices.size();
+	header.LodCount = (uint32_t)lods.size();
+	header.LodOffset = sizeof(MeshFileHeader);
+	header.VertexOffset = AlignUp(header.LodOffset + lods.size() * sizeof(MeshLod));
+	header.IndexOffset = AlignUp(header.VertexOffset + (uint64_t)header.VertexCount * header.VertexStride);
+	header.FileBytes = header.IndexOffset + (uint64_t)header.IndexCount * header.IndexBytes;
+	header.Bounds = mesh.Bounds();
+	header.Decode = ComputeVertexDecode(mesh, format);
+
+	pImage->assign((size_t)header.FileBytes, 0);
+	uint8_t* pBase = &(*pImage)[0];
+	memcpy(pBase, &header, sizeof(header));
+	memcpy(pBase + header.LodOffset, &lods[0], lods.size() * sizeof(MeshLod));
+	if (format == MESH_VERTEX_POSITION_TEXCOORD)
+	{
+		memcpy(pBase + header.VertexOffset, &mesh.Vertices[0], mesh.Vertices.size() * sizeof(MeshVertex));
+	}
+	else
+	{
+		MeshQuantizedVertex* pVertices = reinterpret_cast<MeshQuantizedVertex*>(pBase + header.VertexOffset);
+		for (size_t i = 0; i < mesh.Vertices.size(); i++)
+			EncodeVertex(mesh.Vertices[i], format, header.Decode, &pVertices[i]);
+	}
+	if (header.IndexBytes == 2)
+	{
+		uint16_t* pIndices = reinterpret_cast<uint16_t*>(pBase + header.IndexOffset);
+		for (size_t i = 0; i < mesh.Indices.size(); i++)
+			pIndices[i] = (uint16_t)mesh.Indices[i];
+	}
+	else
+	{
+		memcpy(pBase + header.IndexOffset, &mesh.Indices[0], mesh.Indices.size() * sizeof(uint32_t));
+	}
+	return true;
+}
+
+bool WriteMeshFile(const char* path, const MeshData& mesh, MeshVertexFormat format)
+{
+	std::vector<uint8_t> image;
+	if (!SerializeMesh(mesh, &image, format))
+		return false;
+
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	bool written = (fwrite(&image[0], 1, image.size(), f) == image.size());
+	return (fclose(f) == 0) && written;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reading
+//--------------------------------------------------------------------------------------
+MeshFileView::MeshFileView()
+{
+	m_pBase = nullptr;
+	m_pHeader = nullptr;
+	m_pLods = nullptr;
+}
+
+static bool Fail(std::string* pError, const char* message)
+{
+	if (pError)
+		*pError = message;
+	return false;
+}
+
+// Whether [offset, offset + bytes) is inside the file, without overflowing.
+static bool InFile(uint64_t offset, uint64_t bytes, uint64_t fileBytes)
+{
+	return offset <= fileBytes && bytes <= fileBytes - offset;
+}
+
+bool MeshFileView::Parse(const void* pData, size_t bytes, std::string* pError)
+{
+	m_pBase = nullptr;
+	m_pHeader = nullptr;
+	m_pLods = nullptr;
+
+	if (!pData || bytes < sizeof(MeshFileHeader))
+		return Fail(pError, "too small for a mesh file");
+	// Mapped files start on a page, so the blobs come out cache line aligned,
+	// but an image in memory only needs to be aligned for the header.
+	if (((uintptr_t)pData & (sizeof(uint64_t) - 1)) != 0)
+		return Fail(pError, "image is not aligned");
+
+	const MeshFileHeader* pHeader = static_cast<const MeshFileHeader*>(pData);
+	if (pHeader->Magic != kMeshFileMagic)
+		return Fail(pError, "not a mesh file");
+	if (pHeader->Version != kMeshFileVersion)
+		return Fail(pError, "unsupported mesh file version");
+	if (pHeader->HeaderBytes < sizeof(MeshFileHeader) || pHeader->FileBytes > bytes)
+		return Fail(pError, "truncated");
+
+	MeshVertexFormat format = (MeshVertexFormat)pHeader->VertexFormat;
+	if (pHeader->VertexFormat >= MESH_VERTEX_FORMAT_COUNT || pHeader->VertexStride != MeshVertexStride(format))
+		return Fail(pError, "unknown vertex format");
+	if (pHeader->IndexBytes != 2 && pHeader->IndexBytes != 4)
+		return Fail(pError, "bad index size");
+	if (pHeader->VertexCount == 0 || pHeader->IndexCount == 0 || pHeader->LodCount == 0)
+		return Fail(pError, "empty mesh");
+
+	uint64_t fileBytes = pHeader->FileBytes;
+	if ((pHeader->VertexOffset | pHeader->IndexOffset) & (kMeshFileAlignment - 1))
+		return Fail(pError, "blobs are not aligned");
+	if ((pHeader->LodOffset & (sizeof(uint32_t) - 1)) != 0 ||
+		!InFile(pHeader->LodOffset, (uint64_t)pHeader->LodCount * sizeof(MeshLod), fileBytes) ||
+		!InFile(pHeader->VertexOffset, (uint64_t)pHeader->VertexCount * pHeader->VertexStride, fileBytes) ||
+		!InFile(pHeader->IndexOffset, (uint64_t)pHeader->IndexCount * pHeader->IndexBytes, fileBytes))
+		return Fail(pError, "offsets outside the file");
+
+	const uint8_t* pBase = static_cast<const uint8_t*>(pData);
+	const MeshLod* pLods = reinterpret_cast<const MeshLod*>(pBase + pHeader->LodOffset);
+	for (uint32_t i = 0; i < pHeader->LodCount; i++)
+		if ((uint64_t)pLods[i].StartIndex + pLods[i].IndexCount > pHeader->IndexCount)
+			return Fail(pError, "LOD outside the indices");
+
+	m_pBase = pBase;
+	m_pHeader = pHeader;
+	m_pLods = pLods;
+	return true;
+}
+
+bool MeshFileView::CheckIndices() const
+{
+	uint32_t vertexCount = m_pHeader->VertexCount;
+	if (m_pHeader->IndexBytes == 2)
+	{
+		const uint16_t* pIndices = static_cast<const uint16_t*>(Indices());
+		for (uint32_t i = 0; i < m_pHeader->IndexCount; i++)
+			if (pIndices[i] >= vertexCount)
+				return false;
+	}
+	else
+	{
+		const uint32_t* pIndices = static_cast<const uint32_t*>(Indices());
+		for (uint32_t i = 0; i < m_pHeader->IndexCount; i++)
+			if (pIndices[i] >= vertexCount)
+				return false;
+	}
+	return true;
+}
+
+bool MeshFileView::ToMeshData(MeshData* pMesh) const
+{
+	if (VertexFormat() == MESH_VERTEX_POSITION_TEXCOORD)
+	{
+		const MeshVertex* pVertices = static_cast<const MeshVertex*>(Vertices());
+		pMesh->Vertices.assign(pVertices, pVertices + VertexCount());
+	}
+	else
+	{
+		const MeshQuantizedVertex* pVertices = static_cast<const MeshQuantizedVertex*>(Vertices());
+		pMesh->Vertices.resize(VertexCount());
+		for (uint32_t i = 0; i < VertexCount(); i++)
+			DecodeVertex(pVertices[i], VertexFormat(), Decode(), &pMesh->Vertices[i]);
+	}
+
+	pMesh->Indices.resize(IndexCount());
+	if (IndexBytes() == 2)
+	{
+		const uint16_t* pIndices = static_cast<const uint16_t*>(Indices());
+		for (uint32_t i = 0; i < IndexCount(); i++)
+			pMesh->Indices[i] = pIndices[i];
+	}
+	else
+	{
+		memcpy(&pMesh->Indices[0], Indices(), IndexDataBytes());
+	}
+
+	pMesh->Lods.assign(m_pLods, m_pLods + LodCount());
+	return true;
+}
@@ -0,0 +1,153 @@
+//--------------------------------------------------------------------------------------
+// File: MeshFile.h
+//
+// Binary mesh container, laid out so a loaded file needs no parsing and no
+// copying: map it, check the header, and hand the vertex and index blobs to
+// CreateBuffer as they are.
+//
+//     MeshFileHeader
+//     MeshLod table
+//     vertices			kMeshFileAlignment aligned
+//     indices			kMeshFileAlignment aligned, 16 bit when every index fits
+//
+// Everything is little endian.  Offsets are from the start of the file, and
+// the header records its own size so later versions can add fields to it.
+// Parse only checks that the header and tables are consistent with the file
+// size, which is constant time; it doesn't read the blobs, so no page of them
+// is touched until the GPU upload.  CheckIndices does the full check for
+// tools, and the converter checks before writing.
+//
+// Vertices are either SimpleVertex floats or one of the quantized formats,
+// 12 bytes instead of 20: positions as UNORM16 within the mesh bounds, and
+// texcoords as half floats or as UNORM16 within their own bounds.  The header
+// carries the scale and offset that undo the quantization, which the vertex
+// shader applies, so the blob still goes to CreateBuffer as it is.  For the
+// float format they are 1 and 0, and the same shader reads either.
+//
+// Any change to the layout bumps kMeshFileVersion, and Parse refuses other
+// versions.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+
+static const uint32_t kMeshFileMagic = 0x48534D53;		// "SMSH"
+static const uint32_t kMeshFileVersion = 2;
+static const uint32_t kMeshFileAlignment = 64;
+
+enum MeshVertexFormat
+{
+	MESH_VERTEX_POSITION_TEXCOORD = 0,		// float3 position, float2 texcoord, SimpleVertex
+	MESH_VERTEX_UNORM16_HALF,				// unorm16x4 position, half2 texcoord, MeshQuantizedVertex
+	MESH_VERTEX_UNORM16_UNORM16,			// unorm16x4 position, unorm16x2 texcoord, MeshQuantizedVertex
+	MESH_VERTEX_FORMAT_COUNT
+};
+
+uint32_t MeshVertexStride(MeshVertexFormat format);
+const char* MeshVertexFormatName(MeshVertexFormat format);		// "float", "half", "unorm"
+
+// Position w is always 0xFFFF, so it reads as 1 like a float3 does.
+struct MeshQuantizedVertex
+{
+	uint16_t Position[4];
+	uint16_t Texcoord[2];
+};
+
+// What the vertex shader does to the values the input assembler reads:
+// value * Scale + Offset.
+struct MeshVertexDecode
+{
+	float PositionScale[3];
+	float PositionOffset[3];
+	float TexcoordScale[2];
+	float TexcoordOffset[2];
+};
+
+MeshVertexDecode ComputeVertexDecode(const MeshData& mesh, MeshVertexFormat format);
+
+// Largest and RMS distance between each vertex and what the GPU will read
+// back, positions in mesh units, texcoords in texture widths.
+struct MeshQuantizeError
+{
+	float PositionMax;
+	float PositionRms;
+	float TexcoordMax;
+	float TexcoordRms;
+};
+
+MeshQuantizeError MeasureQuantizeError(const MeshData& mesh, MeshVertexFormat format);
+
+
+struct MeshFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderBytes;
+	uint32_t VertexFormat;			// MeshVertexFormat
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexBytes;			// 2 or 4
+	uint32_t IndexCount;
+	uint32_t LodCount;				// At least one
+	uint32_t Reserved;
+	uint64_t LodOffset;
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+	uint64_t FileBytes;
+	MeshBounds Bounds;
+	MeshVertexDecode Decode;
+};
+
+
+// The whole file image, and the file.  False if the mesh is empty or its LODs
+// are outside its indices.
+bool SerializeMesh(const MeshData& mesh, std::vector<uint8_t>* pImage,
+	MeshVertexFormat format = MESH_VERTEX_POSITION_TEXCOORD);
+bool WriteMeshFile(const char* path, const MeshData& mesh, MeshVertexFormat format = MESH_VERTEX_POSITION_TEXCOORD);
+
+
+//--------------------------------------------------------------------------------------
+// A file image in memory, mapped or otherwise.  Points into the image, which
+// must outlive it.
+//--------------------------------------------------------------------------------------
+class MeshFileView
+{
+public:
+	MeshFileView();
+
+	bool Parse(const void* pData, size_t bytes, std::string* pError = nullptr);
+
+	const MeshFileHeader& Header() const { return *m_pHeader; }
+	MeshVertexFormat VertexFormat() const { return (MeshVertexFormat)m_pHeader->VertexFormat; }
+	uint32_t VertexStride() const { return m_pHeader->VertexStride; }
+	uint32_t VertexCount() const { return m_pHeader->VertexCount; }
+	uint32_t IndexBytes() const { return m_pHeader->IndexBytes; }
+	uint32_t IndexCount() const { return m_pHeader->IndexCount; }
+	uint32_t LodCount() const { return m_pHeader->LodCount; }
+	const MeshBounds& Bounds() const { return m_pHeader->Bounds; }
+	const MeshVertexDecode& Decode() const { return m_pHeader->Decode; }
+
+	const void* Vertices() const { return m_pBase + m_pHeader->VertexOffset; }
+	size_t VertexDataBytes() const { return (size_t)m_pHeader->VertexCount * m_pHeader->VertexStride; }
+	const void* Indices() const { return m_pBase + m_pHeader->IndexOffset; }
+	size_t IndexDataBytes() const { return (size_t)m_pHeader->IndexCount * m_pHeader->IndexBytes; }
+	const MeshLod& Lod(uint32_t lod) const { return m_pLods[lod]; }
+
+	// Reads every index, so only for tools.
+	bool CheckIndices() const;
+
+	// A copy back into memory, for the tools that rewrite meshes.  Quantized
+	// vertices are decoded.
+	bool ToMeshData(MeshData* pMesh) const;
+
+private:
+	const uint8_t* m_pBase;
+	const MeshFileHeader* m_pHeader;
+	const MeshLod* m_pLods;
+};
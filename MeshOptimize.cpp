@@ -0,0 +1,501 @@
+//--------------------------------------------------------------------------------------
+// File: MeshOptimize.cpp
+//
+// Cache simulation, Tipsify, overdraw clustering and the overdraw rasterizer.
+//--------------------------------------------------------------------------------------
+
+#include "MeshOptimize.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Analysis
+//--------------------------------------------------------------------------------------
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	memset(&stats, 0, sizeof(stats));
+	stats.Triangles = (uint32_t)(indexCount / 3);
+
+	// A vertex is in the FIFO if it went in fewer than cacheSize misses ago.
+	std::vector<uint64_t> insertedAt(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint64_t misses = 0;
+	for (size_t i = 0; i < stats.Triangles * (size_t)3; i++)
+	{
+		uint32_t v = pIndices[i];
+		if (v >= vertexCount)
+			continue;
+		if (!used[v])
+		{
+			used[v] = 1;
+			stats.Vertices++;
+		}
+		if (insertedAt[v] == 0 || misses + 1 - insertedAt[v] >= cacheSize)
+		{
+			misses++;
+			insertedAt[v] = misses;
+		}
+	}
+
+	stats.Transforms = misses;
+	stats.Acmr = stats.Triangles ? (float)misses / (float)stats.Triangles : 0.0f;
+	stats.Atvr = stats.Vertices ? (float)misses / (float)stats.Vertices : 0.0f;
+	return stats;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t vertexStride)
+{
+	static const uint32_t kLineBytes = 64;
+	static const uint32_t kLines = 256;
+
+	VertexFetchStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint64_t usedVertices = 0;
+	uint64_t lines[kLines];
+	for (uint32_t i = 0; i < kLines; i++)
+		lines[i] = ~0ull;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t v = pIndices[i];
+		if (v >= vertexCount)
+			continue;
+		if (!used[v])
+		{
+			used[v] = 1;
+			usedVertices++;
+		}
+
+		uint64_t first = (uint64_t)v * vertexStride / kLineBytes;
+		uint64_t last = ((uint64_t)v * vertexStride + vertexStride - 1) / kLineBytes;
+		for (uint64_t line = first; line <= last; line++)
+		{
+			if (lines[line % kLines] != line)
+			{
+				lines[line % kLines] = line;
+				stats.BytesFetched += kLineBytes;
+			}
+		}
+	}
+
+	stats.Overfetch = usedVertices ? (float)((double)stats.BytesFetched / (double)(usedVertices * vertexStride)) : 0.0f;
+	return stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Tipsify.  Fans around one vertex at a time, and picks the next fanning vertex
+// from the ones just emitted that will still be in the cache once its
+// remaining triangles are emitted.  With none, it backs up the dead end stack
+// of recently emitted vertices, and past that takes the next vertex in index
+// order that still has triangles.
+//--------------------------------------------------------------------------------------
+namespace
+{
+
+struct Adjacency
+{
+	std::vector<uint32_t> Offsets;		// Per vertex into Triangles, vertexCount + 1
+	std::vector<uint32_t> Triangles;
+};
+
+void BuildAdjacency(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, Adjacency* pAdjacency)
+{
+	pAdjacency->Offsets.assign(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		pAdjacency->Offsets[pIndices[i] + 1]++;
+	for (uint32_t v = 0; v < vertexCount; v++)
+		pAdjacency->Offsets[v + 1] += pAdjacency->Offsets[v];
+
+	pAdjacency->Triangles.resize(indexCount);
+	std::vector<uint32_t> fill(pAdjacency->Offsets.begin(), pAdjacency->Offsets.end() - 1);
+	for (size_t i = 0; i < indexCount; i++)
+		pAdjacency->Triangles[fill[pIndices[i]]++] = (uint32_t)(i / 3);
+}
+
+}
+
+void OptimizeVertexCache(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	Adjacency adjacency;
+	BuildAdjacency(pIndices, triangleCount * 3, vertexCount, &adjacency);
+
+	std::vector<uint32_t> live(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++)
+		live[v] = adjacency.Offsets[v + 1] - adjacency.Offsets[v];
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnd;
+	deadEnd.reserve(triangleCount * 3);
+	std::vector<uint32_t> candidates;
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+	size_t written = 0;
+	int64_t fanning = 0;
+
+	while (fanning >= 0)
+	{
+		uint32_t f = (uint32_t)fanning;
+		candidates.clear();
+		for (uint32_t a = adjacency.Offsets[f]; a < adjacency.Offsets[f + 1]; a++)
+		{
+			uint32_t t = adjacency.Triangles[a];
+			if (emitted[t])
+				continue;
+			emitted[t] = 1;
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = pIndices[t * 3 + k];
+				pDestination[written++] = v;
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+		}
+
+		// The candidate that is oldest in the cache yet will stay in it.
+		fanning = -1;
+		uint32_t best = 0;
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			uint32_t v = candidates[c];
+			if (live[v] == 0)
+				continue;
+			uint32_t priority = 0;
+			if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = time - cacheTime[v];
+			if (fanning < 0 || priority > best)
+			{
+				best = priority;
+				fanning = v;
+			}
+		}
+
+		while (fanning < 0 && !deadEnd.empty())
+		{
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				fanning = v;
+		}
+		while (fanning < 0 && cursor < vertexCount)
+		{
+			if (live[cursor] > 0)
+				fanning = cursor;
+			cursor++;
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Overdraw.  A cluster starts wherever a triangle misses the cache on all three
+// vertices, and those are split again where the ACMR so far is within
+// threshold of the whole run's.  Clusters are then sorted by how far they
+// face out from the mesh center, most first.
+//--------------------------------------------------------------------------------------
+namespace
+{
+
+struct Cluster
+{
+	uint32_t First;		// Triangle
+	uint32_t Count;
+	float Sort;
+};
+
+// Misses for one triangle.  misses only ever counts up, and the cache counts
+// as empty from when it was at start, so starting over is free.
+uint32_t SimulateMisses(const uint32_t* pIndices, uint32_t triangle, std::vector<uint64_t>& insertedAt, uint64_t start,
+	uint64_t* pMisses)
+{
+	uint32_t missed = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		uint32_t v = pIndices[triangle * 3 + k];
+		if (insertedAt[v] <= start || *pMisses + 1 - insertedAt[v] >= kVertexCacheSize)
+		{
+			(*pMisses)++;
+			insertedAt[v] = *pMisses;
+			missed++;
+		}
+	}
+	return missed;
+}
+
+}
+
+void OptimizeOverdraw(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const MeshVertex* pVertices,
+	uint32_t vertexCount, float threshold)
+{
+	uint32_t triangleCount = (uint32_t)(indexCount / 3);
+	if (triangleCount == 0)
+		return;
+
+	// Hard boundaries.
+	std::vector<uint32_t> hard;
+	std::vector<uint64_t> insertedAt(vertexCount, 0);
+	uint64_t misses = 0;
+	for (uint32_t t = 0; t < triangleCount; t++)
+		if (SimulateMisses(pIndices, t, insertedAt, 0, &misses) == 3 || t == 0)
+			hard.push_back(t);
+	hard.push_back(triangleCount);
+
+	// Soft boundaries inside each, once the ACMR from its start is low enough.
+	std::vector<Cluster> clusters;
+	for (size_t h = 0; h + 1 < hard.size(); h++)
+	{
+		uint32_t start = hard[h];
+		uint32_t end = hard[h + 1];
+
+		uint64_t runStart = misses;
+		for (uint32_t t = start; t < end; t++)
+			SimulateMisses(pIndices, t, insertedAt, runStart, &misses);
+		float limit = threshold * (float)(misses - runStart) / (float)(end - start);
+
+		uint64_t clusterMisses = misses;
+		uint32_t clusterStart = start;
+		for (uint32_t t = start; t < end; t++)
+		{
+			SimulateMisses(pIndices, t, insertedAt, clusterMisses, &misses);
+			if ((float)(misses - clusterMisses) / (float)(t + 1 - clusterStart) <= limit && t + 1 < end)
+			{
+				Cluster c = { clusterStart, t + 1 - clusterStart, 0.0f };
+				clusters.push_back(c);
+				clusterStart = t + 1;
+				clusterMisses = misses;
+			}
+		}
+		Cluster c = { clusterStart, end - clusterStart, 0.0f };
+		clusters.push_back(c);
+	}
+
+	// Area weighted centroid of the mesh, then each cluster's.
+	float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	std::vector<float> clusterData(clusters.size() * 7, 0.0f);		// Centroid times area, area, normal
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		float* data = &clusterData[c * 7];
+		for (uint32_t t = clusters[c].First; t < clusters[c].First + clusters[c].Count; t++)
+		{
+			const float* p0 = pVertices[pIndices[t * 3 + 0]].Position;
+			const float* p1 = pVertices[pIndices[t * 3 + 1]].Position;
+			const float* p2 = pVertices[pIndices[t * 3 + 2]].Position;
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int a = 0; a < 3; a++)
+			{
+				float centroid = (p0[a] + p1[a] + p2[a]) / 3.0f;
+				data[a] += centroid * area;
+				data[4 + a] += n[a];
+				meshCenter[a] += centroid * area;
+			}
+			data[3] += area;
+			meshArea += area;
+		}
+	}
+	for (int a = 0; a < 3; a++)
+		meshCenter[a] = (meshArea > 0.0f) ? meshCenter[a] / meshArea : 0.0f;
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const float* data = &clusterData[c * 7];
+		float length = sqrtf(data[4] * data[4] + data[5] * data[5] + data[6] * data[6]);
+		if (data[3] <= 0.0f || length <= 0.0f)
+			continue;
+		float sort = 0.0f;
+		for (int a = 0; a < 3; a++)
+			sort += (data[a] / data[3] - meshCenter[a]) * data[4 + a] / length;
+		clusters[c].Sort = sort;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.Sort > b.Sort; });
+
+	size_t written = 0;
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		memcpy(pDestination + written, pIndices + clusters[c].First * 3, clusters[c].Count * 3 * sizeof(uint32_t));
+		written += clusters[c].Count * 3;
+	}
+}
+
+
+uint32_t OptimizeVertexFetch(MeshData* pMesh)
+{
+	uint32_t vertexCount = (uint32_t)pMesh->Vertices.size();
+	std::vector<uint32_t> remap(vertexCount, ~0u);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(vertexCount);
+
+	for (size_t i = 0; i < pMesh->Indices.size(); i++)
+	{
+		uint32_t& index = pMesh->Indices[i];
+		if (remap[index] == ~0u)
+		{
+			remap[index] = (uint32_t)vertices.size();
+			vertices.push_back(pMesh->Vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	pMesh->Vertices.swap(vertices);
+	return (uint32_t)pMesh->Vertices.size();
+}
+
+
+void OptimizeMesh(MeshData* pMesh, MeshOptimizeReport* pReport)
+{
+	uint32_t vertexCount = (uint32_t)pMesh->Vertices.size();
+	if (pReport)
+	{
+		pReport->CacheBefore = AnalyzeVertexCache(&pMesh->Indices[0], pMesh->Indices.size(), vertexCount);
+		pReport->FetchBefore = AnalyzeVertexFetch(&pMesh->Indices[0], pMesh->Indices.size(), vertexCount, sizeof(MeshVertex));
+	}
+
+	std::vector<MeshLod> lods = pMesh->Lods;
+	if (lods.empty())
+	{
+		MeshLod all = { 0, (uint32_t)pMesh->Indices.size(), 0.0f, 0 };
+		lods.push_back(all);
+	}
+
+	std::vector<uint32_t> cacheOrder;
+	for (size_t l = 0; l < lods.size(); l++)
+	{
+		uint32_t* pRange = &pMesh->Indices[lods[l].StartIndex];
+		size_t count = lods[l].IndexCount - lods[l].IndexCount % 3;
+		if (count == 0)
+			continue;
+		cacheOrder.resize(count);
+		OptimizeVertexCache(&cacheOrder[0], pRange, count, vertexCount);
+		OptimizeOverdraw(pRange, &cacheOrder[0], count, &pMesh->Vertices[0], vertexCount);
+	}
+	vertexCount = OptimizeVertexFetch(pMesh);
+
+	if (pReport)
+	{
+		pReport->CacheAfter = AnalyzeVertexCache(&pMesh->Indices[0], pMesh->Indices.size(), vertexCount);
+		pReport->FetchAfter = AnalyzeVertexFetch(&pMesh->Indices[0], pMesh->Indices.size(), vertexCount, sizeof(MeshVertex));
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Overdraw measurement.  A small depth buffer per view, triangles scan
+// converted over their bounding box with edge functions at pixel centers.
+//--------------------------------------------------------------------------------------
+float AnalyzeOverdraw(const uint32_t* pIndices, size_t indexCount, const MeshVertex* pVertices, uint32_t vertexCount)
+{
+	static const int kResolution = 256;
+
+	if (indexCount < 3 || vertexCount == 0)
+		return 0.0f;
+
+	float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = std::min(min[a], pVertices[v].Position[a]);
+			max[a] = std::max(max[a], pVertices[v].Position[a]);
+		}
+	}
+	float extent = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+	float scale = (extent > 0.0f) ? (float)(kResolution - 1) / extent : 0.0f;
+
+	std::vector<float> depth((size_t)kResolution * kResolution);
+	std::vector<uint8_t> covered((size_t)kResolution * kResolution);
+	uint64_t shadedTotal = 0;
+	uint64_t coveredTotal = 0;
+
+	for (int view = 0; view < 6; view++)
+	{
+		// Looking down axis, forward or back, with the other two on screen.
+		int axis = view / 2;
+		float sign = (view & 1) ? -1.0f : 1.0f;
+		int sx = (axis + 1) % 3;
+		int sy = (axis + 2) % 3;
+		std::fill(depth.begin(), depth.end(), FLT_MAX);
+		std::fill(covered.begin(), covered.end(), 0);
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const float* p[3] = { pVertices[pIndices[i]].Position, pVertices[pIndices[i + 1]].Position, pVertices[pIndices[i + 2]].Position };
+
+			// Back faces have their normal along the view direction.
+			float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float normal = e1[(axis + 1) % 3] * e2[(axis + 2) % 3] - e1[(axis + 2) % 3] * e2[(axis + 1) % 3];
+			if (normal * sign >= 0.0f)
+				continue;
+
+			float x[3], y[3], z[3];
+			for (int k = 0; k < 3; k++)
+			{
+				x[k] = (p[k][sx] - min[sx]) * scale;
+				y[k] = (p[k][sy] - min[sy]) * scale;
+				z[k] = sign * p[k][axis];
+			}
+
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (area == 0.0f)
+				continue;
+			float inverseArea = 1.0f / area;
+
+			int x0 = std::max(0, (int)floorf(std::min(x[0], std::min(x[1], x[2]))));
+			int x1 = std::min(kResolution - 1, (int)ceilf(std::max(x[0], std::max(x[1], x[2]))));
+			int y0 = std::max(0, (int)floorf(std::min(y[0], std::min(y[1], y[2]))));
+			int y1 = std::min(kResolution - 1, (int)ceilf(std::max(y[0], std::max(y[1], y[2]))));
+
+			for (int py = y0; py <= y1; py++)
+			{
+				float cy = (float)py + 0.5f;
+				for (int px = x0; px <= x1; px++)
+				{
+					float cx = (float)px + 0.5f;
+					float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) * inverseArea;
+					float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) * inverseArea;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+
+					size_t pixel = (size_t)py * kResolution + px;
+					float d = w0 * z[0] + w1 * z[1] + w2 * z[2];
+					if (d < depth[pixel])
+					{
+						depth[pixel] = d;
+						shadedTotal++;
+						if (!covered[pixel])
+						{
+							covered[pixel] = 1;
+							coveredTotal++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return coveredTotal ? (float)((double)shadedTotal / (double)coveredTotal) : 0.0f;
+}
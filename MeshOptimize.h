@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------------------
+// File: MeshOptimize.h
+//
+// Index and vertex reordering for the GPU's post-transform vertex cache, for
+// overdraw and for vertex fetch, with the measurements to check it.
+//
+// Every vertex the cache misses runs the vertex shader again, and in stereo
+// every draw runs twice, so a miss costs two invocations a frame.  ACMR is
+// vertex shader runs per triangle, 0.5 at best for a large regular mesh and 3
+// at worst; ATVR is runs per vertex, 1 at best.  Both are measured with a FIFO
+// cache of kVertexCacheSize entries, which is close to what D3D11 hardware does
+// for lists, and what NullRenderBackend counts with when given the indices.
+//
+// OptimizeVertexCache is Tipsify (Sander, Nehab and Barczak 2007), linear time
+// and tuned to the cache size.  OptimizeOverdraw then splits that order into
+// clusters at points where the cache starts over, so cutting there costs
+// little, and orders clusters so those facing out from the mesh center come
+// first and occlude the rest.  OptimizeVertexFetch renumbers vertices in the
+// order the indices first use them, so fetches walk memory forward.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Mesh.h"
+
+
+static const uint32_t kVertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+	uint64_t Transforms;		// Vertex shader runs
+	uint32_t Triangles;
+	uint32_t Vertices;			// Distinct vertices used
+	float Acmr;
+	float Atvr;
+};
+
+struct VertexFetchStats
+{
+	uint64_t BytesFetched;		// 64 byte lines read through a 16KB direct mapped cache
+	float Overfetch;			// Over the bytes of the vertices used, 1 at best
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats CacheBefore;
+	VertexCacheStats CacheAfter;
+	VertexFetchStats FetchBefore;
+	VertexFetchStats FetchAfter;
+};
+
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize = kVertexCacheSize);
+
+VertexFetchStats AnalyzeVertexFetch(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t vertexStride);
+
+// Pixels shaded per pixel covered, averaged over orthographic views down the
+// six axes, with depth test and back face culling.  1 is no overdraw.
+float AnalyzeOverdraw(const uint32_t* pIndices, size_t indexCount, const MeshVertex* pVertices, uint32_t vertexCount);
+
+
+// pDestination must not be pIndices.
+void OptimizeVertexCache(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize = kVertexCacheSize);
+
+// pIndices should already be cache optimized.  threshold is how much worse
+// than that the ACMR may get, 1.05 is 5%.
+void OptimizeOverdraw(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const MeshVertex* pVertices,
+	uint32_t vertexCount, float threshold = 1.05f);
+
+// Renumbers the vertices in first use order and drops unused ones.  Returns
+// how many are left.
+uint32_t OptimizeVertexFetch(MeshData* pMesh);
+
+
+// All three, each LOD's range of indices on its own.
+void OptimizeMesh(MeshData* pMesh, MeshOptimizeReport* pReport = nullptr);
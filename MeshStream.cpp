@@ -0,0 +1,460 @@
+//--------------------------------------------------------------------------------------
+// File: MeshStream.cpp
+//
+// The loader thread, the upload ring and residency.
+//
+// Ring records are a RingRecord and its payload, padded to 32 bytes, so the
+// space left before the end of the ring always fits a padding record when the
+// next record doesn't fit there.
+//--------------------------------------------------------------------------------------
+
+#include "MeshStream.h"
+
+#include <string.h>
+
+#include "MappedFile.h"
+#include "Timing.h"
+
+
+namespace
+{
+
+enum RingRecordType
+{
+	RECORD_PAD = 0,
+	RECORD_BEGIN,			// Payload is the MeshFileHeader
+	RECORD_CHUNK,
+	RECORD_END
+};
+
+struct RingRecord
+{
+	uint32_t Type;
+	uint32_t Mesh;
+	uint32_t Blob;
+	uint32_t Bytes;			// Payload
+	uint64_t Offset;		// In the blob
+	uint64_t Reserved;
+};
+
+static_assert(sizeof(RingRecord) == 32, "Records are padded to 32 bytes");
+
+inline uint64_t RecordBytes(size_t payload)
+{
+	return (sizeof(RingRecord) + payload + 31) & ~(uint64_t)31;
+}
+
+}
+
+
+//--------------------------------------------------------------------------------------
+// NullMeshStreamSink
+//--------------------------------------------------------------------------------------
+NullMeshStreamSink::~NullMeshStreamSink()
+{
+	for (uint32_t m = 0; m < (uint32_t)m_Meshes.size(); m++)
+		EvictMesh(m);
+}
+
+bool NullMeshStreamSink::BeginMesh(uint32_t mesh, const MeshFileHeader& header)
+{
+	if (m_Meshes.size() <= mesh)
+	{
+		Mesh empty = { { nullptr, nullptr }, { 0, 0 } };
+		m_Meshes.resize(mesh + 1, empty);
+	}
+	EvictMesh(mesh);
+
+	Mesh& m = m_Meshes[mesh];
+	m.Bytes[MESH_STREAM_VERTICES] = (size_t)header.VertexCount * header.VertexStride;
+	m.Bytes[MESH_STREAM_INDICES] = (size_t)header.IndexCount * header.IndexBytes;
+	for (int blob = 0; blob < 2; blob++)
+		m.pData[blob] = new uint8_t[m.Bytes[blob]];
+	return true;
+}
+
+void NullMeshStreamSink::UploadChunk(uint32_t mesh, MeshStreamBlob blob, uint64_t offset, const void* pData, size_t bytes)
+{
+	Mesh& m = m_Meshes[mesh];
+	if (m.pData[blob] && offset + bytes <= m.Bytes[blob])
+		memcpy(m.pData[blob] + offset, pData, bytes);
+}
+
+void NullMeshStreamSink::EndMesh(uint32_t mesh)
+{
+	(void)mesh;
+}
+
+void NullMeshStreamSink::EvictMesh(uint32_t mesh)
+{
+	if (mesh >= m_Meshes.size())
+		return;
+	for (int blob = 0; blob < 2; blob++)
+	{
+		delete[] m_Meshes[mesh].pData[blob];
+		m_Meshes[mesh].pData[blob] = nullptr;
+		m_Meshes[mesh].Bytes[blob] = 0;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// 4MB a frame is 240MB/s at 60Hz, about what a SATA SSD reads.
+//--------------------------------------------------------------------------------------
+MeshStreamConfig DefaultMeshStreamConfig()
+{
+	MeshStreamConfig config;
+	config.RingBytes = 16 << 20;
+	config.ChunkBytes = 1 << 20;
+	config.UploadBudgetBytes = 4 << 20;
+	config.ResidentCapBytes = 256ull << 20;
+	return config;
+}
+
+
+MeshStreamer::MeshStreamer(const MeshStreamConfig& config, MeshStreamSink* pSink)
+	: m_Config(config), m_pSink(pSink)
+{
+	m_Config.RingBytes = (m_Config.RingBytes + 31) & ~(size_t)31;
+	if (m_Config.RingBytes < 4096)
+		m_Config.RingBytes = 4096;
+	if (m_Config.ChunkBytes > m_Config.RingBytes / 4)
+		m_Config.ChunkBytes = m_Config.RingBytes / 4;
+
+	m_pRing = new uint8_t[m_Config.RingBytes];
+	m_RingRead = 0;
+	m_RingWrite = 0;
+	m_RingReserved = 0;
+	m_Frame = 0;
+	m_Quit = false;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	m_Loader = std::thread(&MeshStreamer::LoaderMain, this);
+}
+
+MeshStreamer::~MeshStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_Work.notify_all();
+	m_Space.notify_all();
+	m_Loader.join();
+	delete[] m_pRing;
+}
+
+uint32_t MeshStreamer::Register(const char* path)
+{
+	Mesh mesh;
+	mesh.Path = path;
+	mesh.State = MESH_STREAM_UNLOADED;
+	mesh.Priority = 0.0f;
+	mesh.Bytes = 0;
+	mesh.LastTouched = 0;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Meshes.push_back(mesh);
+	return (uint32_t)m_Meshes.size() - 1;
+}
+
+void MeshStreamer::Request(uint32_t mesh, float priority)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Mesh& m = m_Meshes[mesh];
+		m.Priority = priority;
+		if (m.State != MESH_STREAM_UNLOADED)
+			return;
+		m.State = MESH_STREAM_QUEUED;
+		m_Stats.Requests++;
+	}
+	m_Work.notify_one();
+}
+
+void MeshStreamer::Touch(uint32_t mesh)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Meshes[mesh].LastTouched = m_Frame;
+}
+
+MeshStreamState MeshStreamer::State(uint32_t mesh) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Meshes[mesh].State;
+}
+
+bool MeshStreamer::Idle() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_RingRead != m_RingWrite)
+		return false;
+	for (size_t i = 0; i < m_Meshes.size(); i++)
+		if (m_Meshes[i].State == MESH_STREAM_QUEUED || m_Meshes[i].State == MESH_STREAM_LOADING)
+			return false;
+	return true;
+}
+
+MeshStreamStats MeshStreamer::Stats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Loader thread
+//--------------------------------------------------------------------------------------
+void MeshStreamer::LoaderMain()
+{
+	for (;;)
+	{
+		uint32_t mesh = 0;
+		std::string path;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			for (;;)
+			{
+				if (m_Quit)
+					return;
+
+				bool found = false;
+				for (uint32_t i = 0; i < (uint32_t)m_Meshes.size(); i++)
+				{
+					if (m_Meshes[i].State == MESH_STREAM_QUEUED && (!found || m_Meshes[i].Priority > m_Meshes[mesh].Priority))
+					{
+						mesh = i;
+						found = true;
+					}
+				}
+				if (found)
+					break;
+				m_Work.wait(lock);
+			}
+			m_Meshes[mesh].State = MESH_STREAM_LOADING;
+			path = m_Meshes[mesh].Path;
+		}
+
+		if (!LoadMesh(mesh, path))
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Quit)
+				return;
+			m_Meshes[mesh].State = MESH_STREAM_FAILED;
+			m_Stats.Failed++;
+		}
+	}
+}
+
+// False if the file can't be used, or on quit.  Only the header is checked,
+// as MeshFileView::Parse does, so this touches each page of the file once.
+bool MeshStreamer::LoadMesh(uint32_t mesh, const std::string& path)
+{
+	MappedFile file;
+	MeshFileView view;
+	if (!file.Open(path.c_str()) || !view.Parse(file.Data(), file.Size()))
+		return false;
+
+	uint8_t* p = BeginRecord(RECORD_BEGIN, mesh, 0, 0, sizeof(MeshFileHeader));
+	if (!p)
+		return false;
+	memcpy(p, &view.Header(), sizeof(MeshFileHeader));
+	EndRecord();
+
+	const uint8_t* blobs[2] = { static_cast<const uint8_t*>(view.Vertices()), static_cast<const uint8_t*>(view.Indices()) };
+	size_t blobBytes[2] = { view.VertexDataBytes(), view.IndexDataBytes() };
+	for (uint32_t blob = 0; blob < 2; blob++)
+	{
+		for (size_t offset = 0; offset < blobBytes[blob]; offset += m_Config.ChunkBytes)
+		{
+			size_t bytes = (blobBytes[blob] - offset < m_Config.ChunkBytes) ? blobBytes[blob] - offset : m_Config.ChunkBytes;
+			p = BeginRecord(RECORD_CHUNK, mesh, blob, offset, bytes);
+			if (!p)
+				return false;
+			memcpy(p, blobs[blob] + offset, bytes);
+			EndRecord();
+		}
+	}
+
+	if (!BeginRecord(RECORD_END, mesh, 0, 0, 0))
+		return false;
+	EndRecord();
+	return true;
+}
+
+// Waits for space, and returns where the payload goes, or null on quit.  The
+// record isn't visible to Update until EndRecord.
+uint8_t* MeshStreamer::BeginRecord(uint32_t type, uint32_t mesh, uint32_t blob, uint64_t offset, size_t bytes)
+{
+	uint64_t size = m_Config.RingBytes;
+	uint64_t recordBytes = RecordBytes(bytes);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	bool waited = false;
+	for (;;)
+	{
+		if (m_Quit)
+			return nullptr;
+		uint64_t toEnd = size - m_RingWrite % size;
+		uint64_t needed = recordBytes + ((toEnd < recordBytes) ? toEnd : 0);
+		if (m_RingWrite + needed - m_RingRead <= size)
+			break;
+		if (!waited)
+			m_Stats.RingWaits++;
+		waited = true;
+		m_Space.wait(lock);
+	}
+
+	uint64_t toEnd = size - m_RingWrite % size;
+	if (toEnd < recordBytes)
+	{
+		RingRecord pad;
+		memset(&pad, 0, sizeof(pad));
+		pad.Type = RECORD_PAD;
+		pad.Bytes = (uint32_t)(toEnd - sizeof(RingRecord));
+		memcpy(&m_pRing[(size_t)(m_RingWrite % size)], &pad, sizeof(pad));
+		m_RingWrite += toEnd;
+	}
+
+	RingRecord record;
+	memset(&record, 0, sizeof(record));
+	record.Type = type;
+	record.Mesh = mesh;
+	record.Blob = blob;
+	record.Bytes = (uint32_t)bytes;
+	record.Offset = offset;
+	uint8_t* p = &m_pRing[(size_t)(m_RingWrite % size)];
+	memcpy(p, &record, sizeof(record));
+	m_RingReserved = m_RingWrite + recordBytes;
+	m_Stats.BytesRead += bytes;
+	return p + sizeof(RingRecord);
+}
+
+void MeshStreamer::EndRecord()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_RingWrite = m_RingReserved;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Render thread
+//--------------------------------------------------------------------------------------
+
+// Least recently touched first, and not if touched since the last Update.
+// Called with m_Mutex held; the victims are marked unloaded here and released
+// in the sink by the caller.
+void MeshStreamer::EvictFor(uint64_t bytes)
+{
+	while (m_Stats.ResidentBytes + bytes > m_Config.ResidentCapBytes)
+	{
+		uint32_t victim = UINT32_MAX;
+		for (uint32_t i = 0; i < (uint32_t)m_Meshes.size(); i++)
+		{
+			const Mesh& m = m_Meshes[i];
+			if (m.State == MESH_STREAM_RESIDENT && m.LastTouched + 1 < m_Frame &&
+				(victim == UINT32_MAX || m.LastTouched < m_Meshes[victim].LastTouched))
+				victim = i;
+		}
+		if (victim == UINT32_MAX)
+		{
+			m_Stats.OverCap++;
+			return;
+		}
+
+		m_Meshes[victim].State = MESH_STREAM_UNLOADED;
+		m_Stats.ResidentBytes -= m_Meshes[victim].Bytes;
+		m_Stats.Evicted++;
+		m_Evicting.push_back(victim);
+	}
+}
+
+void MeshStreamer::Update()
+{
+	uint64_t startNs = GetTimeNs();
+	uint64_t size = m_Config.RingBytes;
+
+	uint64_t read;
+	uint64_t write;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		read = m_RingRead;
+		write = m_RingWrite;
+	}
+
+	// The records between read and write are complete and the loader won't
+	// touch them, so they are handed over without the lock.
+	uint64_t uploaded = 0;
+	while (read < write)
+	{
+		const uint8_t* p = &m_pRing[(size_t)(read % size)];
+		RingRecord record;
+		memcpy(&record, p, sizeof(record));
+		if (record.Type == RECORD_CHUNK && uploaded > 0 && uploaded + record.Bytes > m_Config.UploadBudgetBytes)
+			break;
+		read += RecordBytes(record.Bytes);
+		const uint8_t* pPayload = p + sizeof(RingRecord);
+
+		MeshStreamState state;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			state = m_Meshes[record.Mesh].State;
+		}
+
+		if (record.Type == RECORD_BEGIN)
+		{
+			MeshFileHeader header;
+			memcpy(&header, pPayload, sizeof(header));
+			uint64_t bytes = (uint64_t)header.VertexCount * header.VertexStride + (uint64_t)header.IndexCount * header.IndexBytes;
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				EvictFor(bytes);
+			}
+			for (size_t i = 0; i < m_Evicting.size(); i++)
+				m_pSink->EvictMesh(m_Evicting[i]);
+			m_Evicting.clear();
+
+			bool begun = m_pSink->BeginMesh(record.Mesh, header);
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Mesh& m = m_Meshes[record.Mesh];
+			if (begun)
+			{
+				m.State = MESH_STREAM_UPLOADING;
+				m.Bytes = bytes;
+				m_Stats.ResidentBytes += bytes;
+				if (m_Stats.ResidentBytes > m_Stats.PeakResidentBytes)
+					m_Stats.PeakResidentBytes = m_Stats.ResidentBytes;
+			}
+			else
+			{
+				m.State = MESH_STREAM_FAILED;
+				m_Stats.Failed++;
+			}
+		}
+		else if (record.Type == RECORD_CHUNK && state == MESH_STREAM_UPLOADING)
+		{
+			m_pSink->UploadChunk(record.Mesh, (MeshStreamBlob)record.Blob, record.Offset, pPayload, record.Bytes);
+			uploaded += record.Bytes;
+		}
+		else if (record.Type == RECORD_END && state == MESH_STREAM_UPLOADING)
+		{
+			m_pSink->EndMesh(record.Mesh);
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Meshes[record.Mesh].State = MESH_STREAM_RESIDENT;
+			m_Meshes[record.Mesh].LastTouched = m_Frame;		// Not evicted before it is first drawn
+			m_Stats.Loaded++;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_RingRead = read;
+		m_Stats.BytesUploaded += uploaded;
+		m_Frame++;
+
+		uint64_t updateNs = GetTimeNs() - startNs;
+		if (updateNs > m_Stats.MaxUpdateNs)
+			m_Stats.MaxUpdateNs = updateNs;
+	}
+	m_Space.notify_one();
+}
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// File: MeshStream.h
+//
+// Mesh files loaded in the background while frames keep going.
+//
+// Meshes are registered by path and requested with a priority.  A loader
+// thread takes the highest priority request, maps the file, and copies its
+// header and then its vertex and index blobs, in chunks, into a fixed size
+// ring.  Copying out of the mapping is what reads the file, so the disk waits
+// all happen on the loader thread.  When the ring is full the loader waits for
+// the render thread to drain it.
+//
+// The render thread calls Update once a frame, which hands ring records to a
+// MeshStreamSink, the part that owns the GPU buffers, up to an upload budget
+// in bytes, so no frame uploads more than that however much is loaded.  A mesh
+// is resident once its last chunk is through.
+//
+// Residency is capped in bytes.  Meshes drawn in a frame are marked with
+// Touch, and before a mesh's buffers are created, resident meshes are evicted
+// least recently touched first until it fits, never one touched this frame or
+// the last, whose buffers the GPU may still be reading.  So the cap is soft:
+// if everything resident is that recent the mesh goes over it, which is
+// counted in OverCap.  An evicted mesh can be requested again.
+//
+// Register, Request, Touch and Update are for the render thread; the loader
+// thread only ever talks to it through the ring and the request list.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MeshFile.h"
+
+
+enum MeshStreamState
+{
+	MESH_STREAM_UNLOADED = 0,
+	MESH_STREAM_QUEUED,
+	MESH_STREAM_LOADING,		// The loader is on it
+	MESH_STREAM_UPLOADING,		// Buffers created, chunks arriving
+	MESH_STREAM_RESIDENT,
+	MESH_STREAM_FAILED
+};
+
+enum MeshStreamBlob
+{
+	MESH_STREAM_VERTICES = 0,
+	MESH_STREAM_INDICES
+};
+
+
+//--------------------------------------------------------------------------------------
+// Where the data goes, called from Update on the render thread.
+//--------------------------------------------------------------------------------------
+class MeshStreamSink
+{
+public:
+	virtual ~MeshStreamSink() {}
+
+	// Create the buffers, empty.  False fails the mesh.
+	virtual bool BeginMesh(uint32_t mesh, const MeshFileHeader& header) = 0;
+
+	// bytes of the blob at offset.  pData is only valid during the call.
+	virtual void UploadChunk(uint32_t mesh, MeshStreamBlob blob, uint64_t offset, const void* pData, size_t bytes) = 0;
+
+	virtual void EndMesh(uint32_t mesh) = 0;
+
+	// Release the buffers, also for a mesh that failed part way.
+	virtual void EvictMesh(uint32_t mesh) = 0;
+};
+
+
+// Keeps the blobs in memory, the copy standing in for the upload.  Like
+// CreateBuffer without initial data, BeginMesh doesn't touch the memory.
+class NullMeshStreamSink : public MeshStreamSink
+{
+public:
+	NullMeshStreamSink() {}
+	virtual ~NullMeshStreamSink();
+
+	virtual bool BeginMesh(uint32_t mesh, const MeshFileHeader& header);
+	virtual void UploadChunk(uint32_t mesh, MeshStreamBlob blob, uint64_t offset, const void* pData, size_t bytes);
+	virtual void EndMesh(uint32_t mesh);
+	virtual void EvictMesh(uint32_t mesh);
+
+	// Null when not resident.
+	const uint8_t* Blob(uint32_t mesh, MeshStreamBlob blob) const { return (mesh < m_Meshes.size()) ? m_Meshes[mesh].pData[blob] : nullptr; }
+
+private:
+	NullMeshStreamSink(const NullMeshStreamSink&);
+	NullMeshStreamSink& operator=(const NullMeshStreamSink&);
+
+	struct Mesh
+	{
+		uint8_t* pData[2];
+		size_t Bytes[2];
+	};
+	std::vector<Mesh> m_Meshes;
+};
+
+
+struct MeshStreamConfig
+{
+	size_t RingBytes;
+	size_t ChunkBytes;				// Largest record, at most a quarter of the ring
+	size_t UploadBudgetBytes;		// Per Update, at least one record goes through
+	uint64_t ResidentCapBytes;		// Vertex and index bytes of the resident meshes
+};
+
+MeshStreamConfig DefaultMeshStreamConfig();
+
+
+struct MeshStreamStats
+{
+	uint32_t Requests;
+	uint32_t Loaded;
+	uint32_t Failed;
+	uint32_t Evicted;
+	uint32_t OverCap;				// Loads that couldn't evict enough
+	uint64_t BytesRead;				// By the loader
+	uint64_t BytesUploaded;
+	uint64_t ResidentBytes;
+	uint64_t PeakResidentBytes;
+	uint64_t RingWaits;				// Times the loader found the ring full
+	uint64_t MaxUpdateNs;			// Longest Update, the worst hitch streaming added
+};
+
+
+class MeshStreamer
+{
+public:
+	MeshStreamer(const MeshStreamConfig& config, MeshStreamSink* pSink);
+	~MeshStreamer();
+
+	// Returns the mesh's id, the one the sink sees.
+	uint32_t Register(const char* path);
+
+	// Queues the mesh unless it is already resident or on its way, in which
+	// case only its priority changes.  Higher loads first.
+	void Request(uint32_t mesh, float priority);
+
+	// The mesh is drawn this frame.
+	void Touch(uint32_t mesh);
+
+	// Hands loaded data to the sink, and evicts.  Starts a new frame for Touch.
+	void Update();
+
+	MeshStreamState State(uint32_t mesh) const;
+	bool IsResident(uint32_t mesh) const { return State(mesh) == MESH_STREAM_RESIDENT; }
+
+	// Between Updates there may be more in the ring.
+	bool Idle() const;
+
+	MeshStreamStats Stats() const;
+
+private:
+	MeshStreamer(const MeshStreamer&);
+	MeshStreamer& operator=(const MeshStreamer&);
+
+	struct Mesh
+	{
+		std::string Path;
+		MeshStreamState State;
+		float Priority;
+		uint64_t Bytes;				// Once the header is through
+		uint64_t LastTouched;		// Frame
+	};
+
+	void LoaderMain();
+	bool LoadMesh(uint32_t mesh, const std::string& path);
+	uint8_t* BeginRecord(uint32_t type, uint32_t mesh, uint32_t blob, uint64_t offset, size_t bytes);
+	void EndRecord();
+	void EvictFor(uint64_t bytes);
+
+	MeshStreamConfig m_Config;
+	MeshStreamSink* m_pSink;
+	std::thread m_Loader;
+	std::vector<uint32_t> m_Evicting;		// Render thread only
+
+	// Everything below is under m_Mutex, except the ring bytes between
+	// m_RingRead and m_RingWrite, which belong to the render thread until it
+	// moves m_RingRead past them.
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Work;			// A request, or quit
+	std::condition_variable m_Space;		// Ring space, or quit
+	std::vector<Mesh> m_Meshes;
+	uint8_t* m_pRing;						// Not cleared, pages come in as the loader first writes them
+	uint64_t m_RingRead;					// Both count bytes ever, the ring offset is mod its size
+	uint64_t m_RingWrite;
+	uint64_t m_RingReserved;				// The record being written ends here
+	uint64_t m_Frame;
+	bool m_Quit;
+	MeshStreamStats m_Stats;
+};
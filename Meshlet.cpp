@@ -0,0 +1,405 @@
+//--------------------------------------------------------------------------------------
+// File: Meshlet.cpp
+//
+// Meshlet building, grouping, and the stereo cull.
+//--------------------------------------------------------------------------------------
+
+#include "Meshlet.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+
+size_t MeshletMesh::MemoryBytes() const
+{
+	return Meshlets.capacity() * sizeof(Meshlet) + Groups.capacity() * sizeof(MeshletGroup) + IndexData.capacity() +
+		VertexRemap.capacity() * sizeof(uint32_t);
+}
+
+int64_t MeshletMesh::BytesSaved() const
+{
+	int64_t duplicated = VertexRemap.empty() ? 0 : (int64_t)(VertexRemap.size() - UsedVertexCount);
+	return (int64_t)FlatIndexBytes() - (int64_t)IndexData.size() - duplicated * VertexStride;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Bounds and cone of one meshlet.  The sphere is about the box center, and the
+// cone test is the one meshoptimizer uses, which needs no apex: with axis a,
+// cutoff s and sphere (c, r), a viewer at e sees only back faces when
+// dot(c - e, a) >= s * |c - e| + r.
+//--------------------------------------------------------------------------------------
+static void ComputeMeshletBounds(const MeshData& mesh, const uint32_t* pIndices, uint32_t triangleCount,
+	const std::vector<uint32_t>& vertices, Meshlet* pMeshlet)
+{
+	float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const float* p = mesh.Vertices[vertices[v]].Position;
+		for (int a = 0; a < 3; a++)
+		{
+			min[a] = std::min(min[a], p[a]);
+			max[a] = std::max(max[a], p[a]);
+		}
+	}
+	for (int a = 0; a < 3; a++)
+		pMeshlet->Center[a] = 0.5f * (min[a] + max[a]);
+
+	float radius = 0.0f;
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const float* p = mesh.Vertices[vertices[v]].Position;
+		float d[3] = { p[0] - pMeshlet->Center[0], p[1] - pMeshlet->Center[1], p[2] - pMeshlet->Center[2] };
+		radius = std::max(radius, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	}
+	pMeshlet->Radius = sqrtf(radius);
+
+	// Unit normals, so big triangles don't hide the spread of small ones.
+	std::vector<float> normals;
+	normals.reserve(triangleCount * 3);
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const float* p0 = mesh.Vertices[pIndices[t * 3 + 0]].Position;
+		const float* p1 = mesh.Vertices[pIndices[t * 3 + 1]].Position;
+		const float* p2 = mesh.Vertices[pIndices[t * 3 + 2]].Position;
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length <= 0.0f)
+			continue;
+		for (int a = 0; a < 3; a++)
+		{
+			normals.push_back(n[a] / length);
+			axis[a] += n[a] / length;
+		}
+	}
+
+	float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	float minDot = -1.0f;
+	if (length > 0.0f)
+	{
+		minDot = 1.0f;
+		for (int a = 0; a < 3; a++)
+			axis[a] /= length;
+		for (size_t n = 0; n < normals.size(); n += 3)
+			minDot = std::min(minDot, normals[n] * axis[0] + normals[n + 1] * axis[1] + normals[n + 2] * axis[2]);
+	}
+	for (int a = 0; a < 3; a++)
+		pMeshlet->ConeAxis[a] = axis[a];
+
+	// Past about 84 degrees the test would hardly ever pass, so don't make it.
+	pMeshlet->ConeCutoff = (minDot <= 0.1f) ? 1.0f : sqrtf(1.0f - minDot * minDot);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Triangles go into the current meshlet until one would take it past either
+// limit.
+//--------------------------------------------------------------------------------------
+static void SplitMeshlets(const MeshData& mesh, const uint32_t* pIndices, uint32_t triangleCount,
+	std::vector<Meshlet>* pMeshlets, std::vector<uint32_t>* pMeshletVertices)
+{
+	// Which meshlet last used each vertex, plus one.
+	std::vector<uint32_t> usedBy(mesh.Vertices.size(), 0);
+	std::vector<uint32_t> vertices;
+	vertices.reserve(kMeshletMaxVertices);
+
+	uint32_t first = 0;
+	for (uint32_t t = 0; t <= triangleCount; t++)
+	{
+		uint32_t id = (uint32_t)pMeshlets->size() + 1;
+		if (t < triangleCount)
+		{
+			uint32_t added = 0;
+			for (int k = 0; k < 3; k++)
+				if (usedBy[pIndices[t * 3 + k]] != id)
+					added++;
+			if (vertices.size() + added <= kMeshletMaxVertices && t - first < kMeshletMaxTriangles)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t v = pIndices[t * 3 + k];
+					if (usedBy[v] != id)
+					{
+						usedBy[v] = id;
+						vertices.push_back(v);
+					}
+				}
+				continue;
+			}
+		}
+
+		// Close the meshlet at first, then start the next with this triangle.
+		Meshlet meshlet;
+		memset(&meshlet, 0, sizeof(meshlet));
+		meshlet.StartIndex = first * 3;
+		meshlet.TriangleCount = t - first;
+		meshlet.VertexCount = (uint32_t)vertices.size();
+		ComputeMeshletBounds(mesh, pIndices + first * 3, t - first, vertices, &meshlet);
+		pMeshlets->push_back(meshlet);
+		pMeshletVertices->insert(pMeshletVertices->end(), vertices.begin(), vertices.end());
+
+		vertices.clear();
+		first = t;
+		if (t < triangleCount)
+			t--;		// Retry it in the new meshlet
+	}
+}
+
+// Consecutive meshlets go into a group until it would pass 65536 vertices.
+// Each group's vertices are copied to a range of their own, so a vertex used
+// by two groups is in the remap twice.
+static void GroupMeshlets(std::vector<Meshlet>& meshlets, const std::vector<uint32_t>& meshletVertices,
+	uint32_t vertexCount, std::vector<MeshletGroup>* pGroups, std::vector<uint32_t>* pRemap)
+{
+	// Which group last used each vertex, plus one.
+	std::vector<uint32_t> usedBy(vertexCount, 0);
+	size_t meshletVertex = 0;
+	for (uint32_t m = 0; m < (uint32_t)meshlets.size(); m++)
+	{
+		const uint32_t* pVertices = &meshletVertices[meshletVertex];
+		meshletVertex += meshlets[m].VertexCount;
+
+		uint32_t id = (uint32_t)pGroups->size();
+		uint32_t added = 0;
+		for (uint32_t v = 0; v < meshlets[m].VertexCount; v++)
+			if (usedBy[pVertices[v]] != id)
+				added++;
+
+		if (pGroups->empty() || pGroups->back().VertexCount + added > 0x10000)
+		{
+			MeshletGroup group;
+			group.FirstMeshlet = m;
+			group.MeshletCount = 0;
+			group.BaseVertex = (uint32_t)pRemap->size();
+			group.VertexCount = 0;
+			pGroups->push_back(group);
+			id++;
+		}
+
+		MeshletGroup& group = pGroups->back();
+		for (uint32_t v = 0; v < meshlets[m].VertexCount; v++)
+		{
+			if (usedBy[pVertices[v]] != id)
+			{
+				usedBy[pVertices[v]] = id;
+				pRemap->push_back(pVertices[v]);
+				group.VertexCount++;
+			}
+		}
+		group.MeshletCount++;
+		meshlets[m].Group = id - 1;
+	}
+}
+
+bool BuildMeshlets(const MeshData& mesh, uint32_t startIndex, uint32_t indexCount, uint32_t vertexStride,
+	MeshletMesh* pMeshlets)
+{
+	pMeshlets->Meshlets.clear();
+	pMeshlets->Groups.clear();
+	pMeshlets->IndexData.clear();
+	pMeshlets->VertexRemap.clear();
+	pMeshlets->IndexBytes = 4;
+	pMeshlets->UsedVertexCount = 0;
+	pMeshlets->VertexStride = vertexStride;
+
+	indexCount -= indexCount % 3;
+	pMeshlets->TriangleCount = indexCount / 3;
+	if (indexCount == 0 || (uint64_t)startIndex + indexCount > mesh.Indices.size())
+		return false;
+
+	const uint32_t* pIndices = &mesh.Indices[startIndex];
+	std::vector<uint32_t> meshletVertices;
+	SplitMeshlets(mesh, pIndices, indexCount / 3, &pMeshlets->Meshlets, &meshletVertices);
+
+	std::vector<bool> used(mesh.Vertices.size(), false);
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		if (!used[pIndices[i]])
+		{
+			used[pIndices[i]] = true;
+			pMeshlets->UsedVertexCount++;
+		}
+	}
+
+	// A mesh that fits needs no groups.  Past that, 16 bit groups cost their
+	// duplicated vertices, and win unless those outweigh the index bytes saved.
+	std::vector<uint32_t> remap;
+	uint32_t vertexCount = (uint32_t)mesh.Vertices.size();
+	if (vertexCount <= 0x10000)
+	{
+		pMeshlets->IndexBytes = 2;
+	}
+	else
+	{
+		GroupMeshlets(pMeshlets->Meshlets, meshletVertices, vertexCount, &pMeshlets->Groups, &remap);
+		uint64_t duplicateBytes = (uint64_t)(remap.size() - pMeshlets->UsedVertexCount) * vertexStride;
+		if (duplicateBytes < (uint64_t)indexCount * 2)
+		{
+			pMeshlets->IndexBytes = 2;
+			pMeshlets->VertexRemap.swap(remap);
+		}
+	}
+
+	if (pMeshlets->VertexRemap.empty())
+	{
+		MeshletGroup group = { 0, (uint32_t)pMeshlets->Meshlets.size(), 0, vertexCount };
+		pMeshlets->Groups.assign(1, group);
+		for (size_t m = 0; m < pMeshlets->Meshlets.size(); m++)
+			pMeshlets->Meshlets[m].Group = 0;
+	}
+
+	// Indices relative to the group's BaseVertex, which DrawIndexed adds back.
+	std::vector<uint32_t> local;
+	if (!pMeshlets->VertexRemap.empty())
+		local.resize(vertexCount);
+
+	pMeshlets->IndexData.resize((size_t)indexCount * pMeshlets->IndexBytes);
+	uint8_t* pOut = &pMeshlets->IndexData[0];
+	for (size_t g = 0; g < pMeshlets->Groups.size(); g++)
+	{
+		const MeshletGroup& group = pMeshlets->Groups[g];
+		for (uint32_t v = 0; v < group.VertexCount && !local.empty(); v++)
+			local[pMeshlets->VertexRemap[group.BaseVertex + v]] = v;
+
+		for (uint32_t m = group.FirstMeshlet; m < group.FirstMeshlet + group.MeshletCount; m++)
+		{
+			const Meshlet& meshlet = pMeshlets->Meshlets[m];
+			for (uint32_t i = meshlet.StartIndex; i < meshlet.StartIndex + meshlet.TriangleCount * 3; i++)
+			{
+				uint32_t index = local.empty() ? pIndices[i] : local[pIndices[i]];
+				if (pMeshlets->IndexBytes == 2)
+				{
+					uint16_t narrow = (uint16_t)index;
+					memcpy(pOut + (size_t)i * 2, &narrow, sizeof(narrow));
+				}
+				else
+				{
+					memcpy(pOut + (size_t)i * 4, &index, sizeof(index));
+				}
+			}
+		}
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Culling
+//--------------------------------------------------------------------------------------
+
+// The eyes sit where each eye projection's x doesn't depend on depth: with
+// the _31 and _41 edits, x = eyeSign * convergence / _11 in view space.
+void BuildMeshletCullSpace(const SMMatrix& world, const SMMatrix& view, const SMMatrix& projection,
+	float separation, float convergence, MeshletCullSpace* pSpace)
+{
+	SMMatrix worldView = StereoMathScalar::Multiply(world, view);
+	BuildStereoUnionFrustum(worldView, projection, separation, convergence, &pSpace->Frustum);
+
+	// Mesh space is p * A + t = view space, so p = (v - t) * A^-1.
+	const float (*m)[4] = worldView.m;
+	float cofactor[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+			int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			cofactor[i][j] = m[i1][j1] * m[i2][j2] - m[i1][j2] * m[i2][j1];
+		}
+	}
+	float determinant = m[0][0] * cofactor[0][0] + m[0][1] * cofactor[0][1] + m[0][2] * cofactor[0][2];
+	float inverseDeterminant = (determinant != 0.0f) ? 1.0f / determinant : 0.0f;
+
+	for (int eye = 0; eye < 2; eye++)
+	{
+		float eyeSign = eye ? 1.0f : -1.0f;
+		float v[3] = { eyeSign * convergence / projection.m[0][0] - m[3][0], -m[3][1], -m[3][2] };
+
+		// The inverse is the transposed cofactors over the determinant, and a
+		// row vector times it is the cofactor matrix times the column.
+		for (int j = 0; j < 3; j++)
+			pSpace->Eyes[eye][j] = (v[0] * cofactor[j][0] + v[1] * cofactor[j][1] + v[2] * cofactor[j][2]) * inverseDeterminant;
+	}
+}
+
+static bool BackFacing(const Meshlet& meshlet, const float eye[3])
+{
+	float d[3] = { meshlet.Center[0] - eye[0], meshlet.Center[1] - eye[1], meshlet.Center[2] - eye[2] };
+	float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	return d[0] * meshlet.ConeAxis[0] + d[1] * meshlet.ConeAxis[1] + d[2] * meshlet.ConeAxis[2] >=
+		meshlet.ConeCutoff * distance + meshlet.Radius;
+}
+
+uint32_t CullMeshlets(const MeshletMesh& meshlets, const MeshletCullSpace& space, uint32_t* pVisible,
+	MeshletCullStats* pStats)
+{
+	uint32_t visible = 0;
+	uint32_t frustumCulled = 0;
+	uint32_t backfaceCulled = 0;
+	uint64_t trianglesCulled = 0;
+
+	for (uint32_t i = 0; i < (uint32_t)meshlets.Meshlets.size(); i++)
+	{
+		const Meshlet& meshlet = meshlets.Meshlets[i];
+
+		bool inside = true;
+		for (int k = 0; k < CULL_PLANE_COUNT && inside; k++)
+		{
+			const float* p = space.Frustum.Planes[k];
+			inside = p[0] * meshlet.Center[0] + p[1] * meshlet.Center[1] + p[2] * meshlet.Center[2] + p[3] >= -meshlet.Radius;
+		}
+		if (!inside)
+		{
+			frustumCulled++;
+			trianglesCulled += meshlet.TriangleCount;
+			continue;
+		}
+
+		if (meshlet.ConeCutoff < 1.0f && BackFacing(meshlet, space.Eyes[0]) && BackFacing(meshlet, space.Eyes[1]))
+		{
+			backfaceCulled++;
+			trianglesCulled += meshlet.TriangleCount;
+			continue;
+		}
+
+		pVisible[visible++] = i;
+	}
+
+	if (pStats)
+	{
+		pStats->Meshlets = (uint32_t)meshlets.Meshlets.size();
+		pStats->Visible = visible;
+		pStats->FrustumCulled = frustumCulled;
+		pStats->BackfaceCulled = backfaceCulled;
+		pStats->Triangles = meshlets.TriangleCount;
+		pStats->TrianglesCulled = trianglesCulled;
+	}
+	return visible;
+}
+
+void BuildMeshletDraws(const MeshletMesh& meshlets, const uint32_t* pVisible, uint32_t visibleCount,
+	std::vector<MeshletDraw>* pDraws)
+{
+	pDraws->clear();
+	for (uint32_t i = 0; i < visibleCount; i++)
+	{
+		const Meshlet& meshlet = meshlets.Meshlets[pVisible[i]];
+		if (!pDraws->empty())
+		{
+			MeshletDraw& last = pDraws->back();
+			if (last.Group == meshlet.Group && last.StartIndex + last.IndexCount == meshlet.StartIndex)
+			{
+				last.IndexCount += meshlet.TriangleCount * 3;
+				continue;
+			}
+		}
+		MeshletDraw draw = { meshlet.Group, meshlet.StartIndex, meshlet.TriangleCount * 3 };
+		pDraws->push_back(draw);
+	}
+}
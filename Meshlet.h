@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// File: Meshlet.h
+//
+// Meshes split into small clusters of triangles, culled on the CPU against
+// both eyes before they are drawn.
+//
+// A meshlet is at most kMeshletMaxVertices vertices and kMeshletMaxTriangles
+// triangles, taken in index order, so the mesh should be cache optimized first
+// (OptimizeMesh in MeshOptimize.h) for the meshlets to be compact.  Each has a
+// bounding sphere and a cone around its triangles' normals.  A meshlet is
+// culled when its sphere is outside the union of the eye frusta, see
+// StereoCull.h, or when both eyes are inside the back side of its cone, so
+// every triangle in it faces away from both.
+//
+// Without mesh shaders a meshlet is drawn as its range of an index buffer,
+// and the index width is picked per mesh.  Up to 65536 vertices that is 16
+// bits.  Past it, consecutive meshlets are grouped up to 65536 vertices each,
+// each group gets its own copy of its vertices, VertexRemap, and its indices
+// are 16 bit relative to that range, with BaseVertex added back by
+// DrawIndexed.  Vertices shared by two groups are stored twice, so groups are
+// only used when that costs less than the 16 bit indices save, which is
+// nearly always; otherwise the mesh stays one group of 32 bit indices.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Mesh.h"
+#include "StereoCull.h"
+
+
+static const uint32_t kMeshletMaxVertices = 64;
+static const uint32_t kMeshletMaxTriangles = 124;
+
+struct Meshlet
+{
+	uint32_t StartIndex;
+	uint32_t TriangleCount;
+	uint32_t VertexCount;
+	uint32_t Group;
+	float Center[3];
+	float Radius;
+	float ConeAxis[3];			// Average of the outward normals
+	float ConeCutoff;			// Sine of their spread, 1 when they spread too far to ever cull
+};
+
+struct MeshletGroup
+{
+	uint32_t FirstMeshlet;
+	uint32_t MeshletCount;
+	uint32_t BaseVertex;		// Into VertexRemap, or the mesh's vertices without one
+	uint32_t VertexCount;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> Meshlets;
+	std::vector<MeshletGroup> Groups;
+	std::vector<uint8_t> IndexData;			// The range's indices, meshlet by meshlet
+	std::vector<uint32_t> VertexRemap;		// Source vertex of each vertex the groups index, empty to use the mesh's
+	uint32_t IndexBytes;					// 2 or 4
+	uint32_t UsedVertexCount;				// Distinct vertices in the range
+	uint32_t VertexStride;
+	uint64_t TriangleCount;
+
+	// The same indices as one 32 bit buffer, what a mesh past 65536 vertices
+	// needs without groups, and how much less the meshlets take with their
+	// duplicated vertices counted against them.
+	size_t FlatIndexBytes() const { return (size_t)TriangleCount * 3 * sizeof(uint32_t); }
+	int64_t BytesSaved() const;
+	size_t MemoryBytes() const;
+};
+
+// Splits indices [startIndex, startIndex + indexCount) of the mesh, a LOD say.
+// vertexStride is the vertex buffer's, for weighing duplicated vertices.
+// False if the range is empty or outside the mesh.
+bool BuildMeshlets(const MeshData& mesh, uint32_t startIndex, uint32_t indexCount, uint32_t vertexStride,
+	MeshletMesh* pMeshlets);
+
+
+//--------------------------------------------------------------------------------------
+// Culling, in mesh space.  MeshletCullSpace moves the union frustum and the
+// two eye positions there, for a world matrix with uniform scale.
+//--------------------------------------------------------------------------------------
+struct MeshletCullSpace
+{
+	StereoFrustum Frustum;
+	float Eyes[2][3];
+};
+
+void BuildMeshletCullSpace(const SMMatrix& world, const SMMatrix& view, const SMMatrix& projection,
+	float separation, float convergence, MeshletCullSpace* pSpace);
+
+struct MeshletCullStats
+{
+	uint32_t Meshlets;
+	uint32_t Visible;
+	uint32_t FrustumCulled;
+	uint32_t BackfaceCulled;
+	uint64_t Triangles;
+	uint64_t TrianglesCulled;
+};
+
+// Writes the visible meshlets to pVisible, in order, and returns how many.
+// pVisible holds Meshlets.size().
+uint32_t CullMeshlets(const MeshletMesh& meshlets, const MeshletCullSpace& space, uint32_t* pVisible,
+	MeshletCullStats* pStats = nullptr);
+
+
+// A DrawIndexed, consecutive visible meshlets of one group merged.
+struct MeshletDraw
+{
+	uint32_t Group;
+	uint32_t StartIndex;
+	uint32_t IndexCount;
+};
+
+void BuildMeshletDraws(const MeshletMesh& meshlets, const uint32_t* pVisible, uint32_t visibleCount,
+	std::vector<MeshletDraw>* pDraws);
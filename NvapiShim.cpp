@@ -0,0 +1,359 @@
+//--------------------------------------------------------------------------------------
+// File: NvapiShim.cpp
+//
+// Timed wrappers for the NVAPI stereo calls, and the per-thread counters.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#define NVAPI_SHIM_IMPLEMENTATION
+
+#include "NvapiShim.h"
+#include "Timing.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#define NVSHIM_THREAD_LOCAL __declspec(thread)
+#else
+#define NVSHIM_THREAD_LOCAL __thread
+#endif
+
+
+static const char* s_FunctionNames[NVSHIM_COUNT] =
+{
+	"NvAPI_Initialize",
+	"NvAPI_Stereo_Enable",
+	"NvAPI_Stereo_Disable",
+	"NvAPI_Stereo_IsEnabled",
+	"NvAPI_Stereo_CreateHandleFromIUnknown",
+	"NvAPI_Stereo_DestroyHandle",
+	"NvAPI_Stereo_Activate",
+	"NvAPI_Stereo_Deactivate",
+	"NvAPI_Stereo_IsActivated",
+	"NvAPI_Stereo_GetSeparation",
+	"NvAPI_Stereo_SetSeparation",
+	"NvAPI_Stereo_GetConvergence",
+	"NvAPI_Stereo_SetConvergence",
+	"NvAPI_Stereo_SetActiveEye",
+	"NvAPI_Stereo_SetDriverMode",
+	"NvAPI_Stereo_GetEyeSeparation",
+	"NvAPI_Stereo_IsWindowedModeSupported",
+	"NvAPI_Stereo_SetSurfaceCreationMode",
+	"NvAPI_Stereo_GetSurfaceCreationMode",
+	"NvAPI_Stereo_Debug_WasLastDrawStereoized",
+	"NvAPI_Stereo_SetDefaultProfile",
+	"NvAPI_Stereo_GetDefaultProfile",
+};
+
+
+//--------------------------------------------------------------------------------------
+// Counters for one thread.  Only the owning thread writes them, so a relaxed
+// load and store is enough, there is no need for a locked add.  Readers may see
+// a slightly stale value, which is fine for statistics.
+//--------------------------------------------------------------------------------------
+struct NvapiThreadCounters
+{
+	std::atomic<uint64_t> Calls[NVSHIM_COUNT];
+	std::atomic<uint64_t> Failures[NVSHIM_COUNT];
+	std::atomic<uint64_t> Cycles[NVSHIM_COUNT];
+	std::atomic<uint64_t> MaxCycles[NVSHIM_COUNT];
+	std::atomic<uint64_t> Buckets[NVSHIM_COUNT][kNvapiShimBuckets];
+	NvapiThreadCounters* Next;
+};
+
+static NVSHIM_THREAD_LOCAL NvapiThreadCounters* s_pThreadCounters = nullptr;
+static std::mutex s_ListMutex;
+static NvapiThreadCounters* s_pFirstCounters = nullptr;
+static CycleCalibration s_Calibration;
+
+
+static NvapiThreadCounters* CreateThreadCounters()
+{
+	NvapiThreadCounters* pCounters = new NvapiThreadCounters;
+	for (uint32_t f = 0; f < NVSHIM_COUNT; f++)
+	{
+		pCounters->Calls[f].store(0, std::memory_order_relaxed);
+		pCounters->Failures[f].store(0, std::memory_order_relaxed);
+		pCounters->Cycles[f].store(0, std::memory_order_relaxed);
+		pCounters->MaxCycles[f].store(0, std::memory_order_relaxed);
+		for (uint32_t b = 0; b < kNvapiShimBuckets; b++)
+			pCounters->Buckets[f][b].store(0, std::memory_order_relaxed);
+	}
+
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	if (!s_pFirstCounters)
+		s_Calibration.Begin();
+	pCounters->Next = s_pFirstCounters;
+	s_pFirstCounters = pCounters;
+
+	s_pThreadCounters = pCounters;
+	return pCounters;
+}
+
+static inline uint32_t BucketIndex(uint64_t cycles)
+{
+	if (cycles == 0)
+		return 0;
+	if (cycles > 0xFFFFFFFFull)
+		return kNvapiShimBuckets - 1;
+
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, (unsigned long)cycles);
+	return (uint32_t)index;
+#else
+	return 31 - (uint32_t)__builtin_clz((uint32_t)cycles);
+#endif
+}
+
+static inline void Bump(std::atomic<uint64_t>& counter, uint64_t amount)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static inline NvAPI_Status Record(NvapiShimFunction function, uint64_t start, NvAPI_Status status)
+{
+	uint64_t cycles = ReadCycleCounter() - start;
+
+	NvapiThreadCounters* pCounters = s_pThreadCounters;
+	if (!pCounters)
+		pCounters = CreateThreadCounters();
+
+	Bump(pCounters->Calls[function], 1);
+	if (status != NVAPI_OK)
+		Bump(pCounters->Failures[function], 1);
+	Bump(pCounters->Cycles[function], cycles);
+	if (cycles > pCounters->MaxCycles[function].load(std::memory_order_relaxed))
+		pCounters->MaxCycles[function].store(cycles, std::memory_order_relaxed);
+	Bump(pCounters->Buckets[function][BucketIndex(cycles)], 1);
+
+	return status;
+}
+
+#define NVSHIM_TIMED(function, call) \
+	uint64_t start = ReadCycleCounter(); \
+	return Record(function, start, call)
+
+
+//--------------------------------------------------------------------------------------
+// The wrappers
+//--------------------------------------------------------------------------------------
+NvAPI_Status Shim_NvAPI_Initialize()
+{
+	NVSHIM_TIMED(NVSHIM_Initialize, NvAPI_Initialize());
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_Enable()
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_Enable, NvAPI_Stereo_Enable());
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_Disable()
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_Disable, NvAPI_Stereo_Disable());
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_IsEnabled(NvU8* pIsStereoEnabled)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_IsEnabled, NvAPI_Stereo_IsEnabled(pIsStereoEnabled));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_CreateHandleFromIUnknown(IUnknown* pDevice, StereoHandle* pStereoHandle)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_CreateHandleFromIUnknown, NvAPI_Stereo_CreateHandleFromIUnknown(pDevice, pStereoHandle));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_DestroyHandle(StereoHandle stereoHandle)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_DestroyHandle, NvAPI_Stereo_DestroyHandle(stereoHandle));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_Activate(StereoHandle stereoHandle)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_Activate, NvAPI_Stereo_Activate(stereoHandle));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_Deactivate(StereoHandle stereoHandle)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_Deactivate, NvAPI_Stereo_Deactivate(stereoHandle));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_IsActivated(StereoHandle stereoHandle, NvU8* pIsStereoOn)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_IsActivated, NvAPI_Stereo_IsActivated(stereoHandle, pIsStereoOn));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_GetSeparation(StereoHandle stereoHandle, float* pSeparationPercentage)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_GetSeparation, NvAPI_Stereo_GetSeparation(stereoHandle, pSeparationPercentage));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_SetSeparation(StereoHandle stereoHandle, float newSeparationPercentage)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_SetSeparation, NvAPI_Stereo_SetSeparation(stereoHandle, newSeparationPercentage));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_GetConvergence(StereoHandle stereoHandle, float* pConvergence)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_GetConvergence, NvAPI_Stereo_GetConvergence(stereoHandle, pConvergence));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_SetConvergence(StereoHandle stereoHandle, float newConvergence)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_SetConvergence, NvAPI_Stereo_SetConvergence(stereoHandle, newConvergence));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_SetActiveEye(StereoHandle hStereoHandle, NV_STEREO_ACTIVE_EYE StereoEye)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_SetActiveEye, NvAPI_Stereo_SetActiveEye(hStereoHandle, StereoEye));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_SetDriverMode(NV_STEREO_DRIVER_MODE mode)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_SetDriverMode, NvAPI_Stereo_SetDriverMode(mode));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_GetEyeSeparation(StereoHandle hStereoHandle, float* pSeparation)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_GetEyeSeparation, NvAPI_Stereo_GetEyeSeparation(hStereoHandle, pSeparation));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_IsWindowedModeSupported(NvU8* bSupported)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_IsWindowedModeSupported, NvAPI_Stereo_IsWindowedModeSupported(bSupported));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_SetSurfaceCreationMode(StereoHandle hStereoHandle, NVAPI_STEREO_SURFACECREATEMODE creationMode)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_SetSurfaceCreationMode, NvAPI_Stereo_SetSurfaceCreationMode(hStereoHandle, creationMode));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_GetSurfaceCreationMode(StereoHandle hStereoHandle, NVAPI_STEREO_SURFACECREATEMODE* pCreationMode)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_GetSurfaceCreationMode, NvAPI_Stereo_GetSurfaceCreationMode(hStereoHandle, pCreationMode));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_Debug_WasLastDrawStereoized(StereoHandle hStereoHandle, NvU8* pWasStereoized)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_Debug_WasLastDrawStereoized, NvAPI_Stereo_Debug_WasLastDrawStereoized(hStereoHandle, pWasStereoized));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_SetDefaultProfile(const char* szProfileName)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_SetDefaultProfile, NvAPI_Stereo_SetDefaultProfile(szProfileName));
+}
+
+NvAPI_Status Shim_NvAPI_Stereo_GetDefaultProfile(NvU32 cbSizeIn, char* szProfileName, NvU32* pcbSizeOut)
+{
+	NVSHIM_TIMED(NVSHIM_Stereo_GetDefaultProfile, NvAPI_Stereo_GetDefaultProfile(cbSizeIn, szProfileName, pcbSizeOut));
+}
+
+
+const char* NvapiShimFunctionName(NvapiShimFunction function)
+{
+	return s_FunctionNames[function];
+}
+
+void NvapiShimGetThreadCalls(uint64_t calls[NVSHIM_COUNT])
+{
+	NvapiThreadCounters* pCounters = s_pThreadCounters;
+	for (uint32_t f = 0; f < NVSHIM_COUNT; f++)
+		calls[f] = pCounters ? pCounters->Calls[f].load(std::memory_order_relaxed) : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reporting
+//--------------------------------------------------------------------------------------
+void NvapiShimGetStats(NvapiCallStats stats[NVSHIM_COUNT])
+{
+	memset(stats, 0, sizeof(NvapiCallStats) * NVSHIM_COUNT);
+
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	if (s_pFirstCounters)
+		s_Calibration.End();
+	double nsPerCycle = s_Calibration.NsPerCycle;
+
+	for (uint32_t f = 0; f < NVSHIM_COUNT; f++)
+	{
+		NvapiCallStats& s = stats[f];
+		s.Name = s_FunctionNames[f];
+
+		uint64_t cycles = 0;
+		uint64_t maxCycles = 0;
+		for (NvapiThreadCounters* p = s_pFirstCounters; p; p = p->Next)
+		{
+			s.Calls += p->Calls[f].load(std::memory_order_relaxed);
+			s.Failures += p->Failures[f].load(std::memory_order_relaxed);
+			cycles += p->Cycles[f].load(std::memory_order_relaxed);
+			uint64_t threadMax = p->MaxCycles[f].load(std::memory_order_relaxed);
+			if (threadMax > maxCycles)
+				maxCycles = threadMax;
+			for (uint32_t b = 0; b < kNvapiShimBuckets; b++)
+				s.Buckets[b] += p->Buckets[f][b].load(std::memory_order_relaxed);
+		}
+
+		s.TotalNs = (double)cycles * nsPerCycle;
+		s.MaxNs = (double)maxCycles * nsPerCycle;
+		for (uint32_t b = 0; b < kNvapiShimBuckets; b++)
+			s.BucketStartNs[b] = (b == 0) ? 0.0 : (double)(1ull << b) * nsPerCycle;
+	}
+}
+
+double NvapiShimPercentileNs(const NvapiCallStats& stats, double fraction)
+{
+	if (stats.Calls == 0)
+		return 0.0;
+
+	uint64_t target = (uint64_t)(fraction * (double)stats.Calls);
+	uint64_t seen = 0;
+	for (uint32_t b = 0; b < kNvapiShimBuckets - 1; b++)
+	{
+		seen += stats.Buckets[b];
+		if (seen > target)
+			return (stats.BucketStartNs[b + 1] < stats.MaxNs) ? stats.BucketStartNs[b + 1] : stats.MaxNs;
+	}
+	return stats.MaxNs;
+}
+
+bool NvapiShimWriteReport(const char* path)
+{
+	NvapiCallStats stats[NVSHIM_COUNT];
+	NvapiShimGetStats(stats);
+
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+
+	fprintf(f, "{\"functions\":[\n");
+	bool first = true;
+	for (uint32_t i = 0; i < NVSHIM_COUNT; i++)
+	{
+		const NvapiCallStats& s = stats[i];
+		if (s.Calls == 0)
+			continue;
+
+		fprintf(f, "%s{\"name\":\"%s\",\"calls\":%llu,\"failures\":%llu,\"mean_ns\":%.1f,\"p50_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"histogram\":[",
+			first ? "" : ",\n", s.Name, (unsigned long long)s.Calls, (unsigned long long)s.Failures,
+			s.TotalNs / (double)s.Calls, NvapiShimPercentileNs(s, 0.5), NvapiShimPercentileNs(s, 0.99), s.MaxNs);
+
+		// Only the populated range, as [start_ns, count] pairs.
+		bool firstBucket = true;
+		for (uint32_t b = 0; b < kNvapiShimBuckets; b++)
+		{
+			if (s.Buckets[b] == 0)
+				continue;
+			fprintf(f, "%s[%.1f,%llu]", firstBucket ? "" : ",", s.BucketStartNs[b], (unsigned long long)s.Buckets[b]);
+			firstBucket = false;
+		}
+		fprintf(f, "]}");
+		first = false;
+	}
+	fprintf(f, "\n]}\n");
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	return ok;
+}
@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------
+// File: NvapiShim.h
+//
+// Interposer over the NVAPI stereo entry points.
+//
+// Including this after the NVAPI headers redirects every NvAPI_Stereo_* call (and
+// NvAPI_Initialize) in that file to a Shim_ version, which times the real call and
+// counts it.  The counters are per thread, written only by their own thread with
+// plain relaxed stores, so recording costs two cycle counter reads and a few adds.
+//
+// Set NVAPI_SHIM_ENABLED to 0 to call NVAPI directly.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+#include "NvapiStereo.h"
+
+#ifndef NVAPI_SHIM_ENABLED
+#define NVAPI_SHIM_ENABLED 1
+#endif
+
+
+enum NvapiShimFunction
+{
+	NVSHIM_Initialize = 0,
+	NVSHIM_Stereo_Enable,
+	NVSHIM_Stereo_Disable,
+	NVSHIM_Stereo_IsEnabled,
+	NVSHIM_Stereo_CreateHandleFromIUnknown,
+	NVSHIM_Stereo_DestroyHandle,
+	NVSHIM_Stereo_Activate,
+	NVSHIM_Stereo_Deactivate,
+	NVSHIM_Stereo_IsActivated,
+	NVSHIM_Stereo_GetSeparation,
+	NVSHIM_Stereo_SetSeparation,
+	NVSHIM_Stereo_GetConvergence,
+	NVSHIM_Stereo_SetConvergence,
+	NVSHIM_Stereo_SetActiveEye,
+	NVSHIM_Stereo_SetDriverMode,
+	NVSHIM_Stereo_GetEyeSeparation,
+	NVSHIM_Stereo_IsWindowedModeSupported,
+	NVSHIM_Stereo_SetSurfaceCreationMode,
+	NVSHIM_Stereo_GetSurfaceCreationMode,
+	NVSHIM_Stereo_Debug_WasLastDrawStereoized,
+	NVSHIM_Stereo_SetDefaultProfile,
+	NVSHIM_Stereo_GetDefaultProfile,
+	NVSHIM_COUNT
+};
+
+// Bucket i holds calls that took [2^i, 2^(i+1)) cycles, the last bucket is open ended.
+static const uint32_t kNvapiShimBuckets = 32;
+
+
+//--------------------------------------------------------------------------------------
+// Totals for one function over all threads.
+//--------------------------------------------------------------------------------------
+struct NvapiCallStats
+{
+	const char* Name;
+	uint64_t Calls;
+	uint64_t Failures;			// Anything other than NVAPI_OK
+	double TotalNs;
+	double MaxNs;
+	uint64_t Buckets[kNvapiShimBuckets];
+	double BucketStartNs[kNvapiShimBuckets];
+};
+
+void NvapiShimGetStats(NvapiCallStats stats[NVSHIM_COUNT]);
+
+const char* NvapiShimFunctionName(NvapiShimFunction function);
+
+// Call counts made on the calling thread only.  No lock, cheap enough per frame.
+void NvapiShimGetThreadCalls(uint64_t calls[NVSHIM_COUNT]);
+
+// Upper edge of the histogram bucket holding the given fraction of calls, capped at the max.
+double NvapiShimPercentileNs(const NvapiCallStats& stats, double fraction);
+
+// JSON, one object per function that has been called.
+bool NvapiShimWriteReport(const char* path);
+
+
+//--------------------------------------------------------------------------------------
+// Shim entry points, same signatures as NVAPI.
+//--------------------------------------------------------------------------------------
+NvAPI_Status Shim_NvAPI_Initialize();
+NvAPI_Status Shim_NvAPI_Stereo_Enable();
+NvAPI_Status Shim_NvAPI_Stereo_Disable();
+NvAPI_Status Shim_NvAPI_Stereo_IsEnabled(NvU8* pIsStereoEnabled);
+NvAPI_Status Shim_NvAPI_Stereo_CreateHandleFromIUnknown(IUnknown* pDevice, StereoHandle* pStereoHandle);
+NvAPI_Status Shim_NvAPI_Stereo_DestroyHandle(StereoHandle stereoHandle);
+NvAPI_Status Shim_NvAPI_Stereo_Activate(StereoHandle stereoHandle);
+NvAPI_Status Shim_NvAPI_Stereo_Deactivate(StereoHandle stereoHandle);
+NvAPI_Status Shim_NvAPI_Stereo_IsActivated(StereoHandle stereoHandle, NvU8* pIsStereoOn);
+NvAPI_Status Shim_NvAPI_Stereo_GetSeparation(StereoHandle stereoHandle, float* pSeparationPercentage);
+NvAPI_Status Shim_NvAPI_Stereo_SetSeparation(StereoHandle stereoHandle, float newSeparationPercentage);
+NvAPI_Status Shim_NvAPI_Stereo_GetConvergence(StereoHandle stereoHandle, float* pConvergence);
+NvAPI_Status Shim_NvAPI_Stereo_SetConvergence(StereoHandle stereoHandle, float newConvergence);
+NvAPI_Status Shim_NvAPI_Stereo_SetActiveEye(StereoHandle hStereoHandle, NV_STEREO_ACTIVE_EYE StereoEye);
+NvAPI_Status Shim_NvAPI_Stereo_SetDriverMode(NV_STEREO_DRIVER_MODE mode);
+NvAPI_Status Shim_NvAPI_Stereo_GetEyeSeparation(StereoHandle hStereoHandle, float* pSeparation);
+NvAPI_Status Shim_NvAPI_Stereo_IsWindowedModeSupported(NvU8* bSupported);
+NvAPI_Status Shim_NvAPI_Stereo_SetSurfaceCreationMode(StereoHandle hStereoHandle, NVAPI_STEREO_SURFACECREATEMODE creationMode);
+NvAPI_Status Shim_NvAPI_Stereo_GetSurfaceCreationMode(StereoHandle hStereoHandle, NVAPI_STEREO_SURFACECREATEMODE* pCreationMode);
+NvAPI_Status Shim_NvAPI_Stereo_Debug_WasLastDrawStereoized(StereoHandle hStereoHandle, NvU8* pWasStereoized);
+NvAPI_Status Shim_NvAPI_Stereo_SetDefaultProfile(const char* szProfileName);
+NvAPI_Status Shim_NvAPI_Stereo_GetDefaultProfile(NvU32 cbSizeIn, char* szProfileName, NvU32* pcbSizeOut);
+
+
+#if NVAPI_SHIM_ENABLED && !defined(NVAPI_SHIM_IMPLEMENTATION)
+#define NvAPI_Initialize						Shim_NvAPI_Initialize
+#define NvAPI_Stereo_Enable						Shim_NvAPI_Stereo_Enable
+#define NvAPI_Stereo_Disable					Shim_NvAPI_Stereo_Disable
+#define NvAPI_Stereo_IsEnabled					Shim_NvAPI_Stereo_IsEnabled
+#define NvAPI_Stereo_CreateHandleFromIUnknown	Shim_NvAPI_Stereo_CreateHandleFromIUnknown
+#define NvAPI_Stereo_DestroyHandle				Shim_NvAPI_Stereo_DestroyHandle
+#define NvAPI_Stereo_Activate					Shim_NvAPI_Stereo_Activate
+#define NvAPI_Stereo_Deactivate					Shim_NvAPI_Stereo_Deactivate
+#define NvAPI_Stereo_IsActivated				Shim_NvAPI_Stereo_IsActivated
+#define NvAPI_Stereo_GetSeparation				Shim_NvAPI_Stereo_GetSeparation
+#define NvAPI_Stereo_SetSeparation				Shim_NvAPI_Stereo_SetSeparation
+#define NvAPI_Stereo_GetConvergence				Shim_NvAPI_Stereo_GetConvergence
+#define NvAPI_Stereo_SetConvergence				Shim_NvAPI_Stereo_SetConvergence
+#define NvAPI_Stereo_SetActiveEye				Shim_NvAPI_Stereo_SetActiveEye
+#define NvAPI_Stereo_SetDriverMode				Shim_NvAPI_Stereo_SetDriverMode
+#define NvAPI_Stereo_GetEyeSeparation			Shim_NvAPI_Stereo_GetEyeSeparation
+#define NvAPI_Stereo_IsWindowedModeSupported	Shim_NvAPI_Stereo_IsWindowedModeSupported
+#define NvAPI_Stereo_SetSurfaceCreationMode		Shim_NvAPI_Stereo_SetSurfaceCreationMode
+#define NvAPI_Stereo_GetSurfaceCreationMode		Shim_NvAPI_Stereo_GetSurfaceCreationMode
+#define NvAPI_Stereo_Debug_WasLastDrawStereoized	Shim_NvAPI_Stereo_Debug_WasLastDrawStereoized
+#define NvAPI_Stereo_SetDefaultProfile			Shim_NvAPI_Stereo_SetDefaultProfile
+#define NvAPI_Stereo_GetDefaultProfile			Shim_NvAPI_Stereo_GetDefaultProfile
+#endif
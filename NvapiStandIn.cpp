@@ -0,0 +1,317 @@
+//--------------------------------------------------------------------------------------
+// File: NvapiStandIn.cpp
+//
+// Stand-in for the NVAPI stereo functions, see NvapiStandIn.h.
+//
+// Keeps the values the getters return, starting from the driver defaults of
+// 15% separation and a convergence of 4, and one stereo handle.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "NvapiStereo.h"
+#include "NvapiStandIn.h"
+#include "Timing.h"
+
+#include <string.h>
+
+
+static struct StandInState
+{
+	bool Initialized;
+	bool StereoEnabled;
+	bool Activated;
+	NV_STEREO_DRIVER_MODE DriverMode;
+	NVAPI_STEREO_SURFACECREATEMODE SurfaceCreationMode;
+	NV_STEREO_ACTIVE_EYE ActiveEye;
+	float SeparationPercentage;
+	float Convergence;
+	float EyeSeparation;
+	char DefaultProfile[64];
+	uint32_t FailNext;
+	uint64_t CallLatencyNs;
+	char StereoizedScript[256];
+	uint32_t StereoizedNext;
+} s_State =
+{
+	false, true, false,
+	NVAPI_STEREO_DRIVER_MODE_AUTOMATIC,
+	NVAPI_STEREO_SURFACECREATEMODE_AUTO,
+	NVAPI_STEREO_EYE_MONO,
+	15.0f, 4.0f, 6.0f,
+	"",
+	0, 0,
+	"", 0
+};
+
+// Any non-null value works as the one handle we hand out.
+static int s_HandleStorage;
+static const StereoHandle s_Handle = &s_HandleStorage;
+
+
+void NvapiStandInSetStereoEnabled(bool enabled)
+{
+	s_State.StereoEnabled = enabled;
+}
+
+void NvapiStandInFailNextCalls(uint32_t count)
+{
+	s_State.FailNext = count;
+}
+
+void NvapiStandInSetCallLatencyNs(uint64_t ns)
+{
+	s_State.CallLatencyNs = ns;
+}
+
+void NvapiStandInSetStereoizedScript(const char* script)
+{
+	s_State.StereoizedScript[0] = '\0';
+	if (script)
+	{
+		strncpy(s_State.StereoizedScript, script, sizeof(s_State.StereoizedScript) - 1);
+		s_State.StereoizedScript[sizeof(s_State.StereoizedScript) - 1] = '\0';
+	}
+	s_State.StereoizedNext = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Common entry for every call: the simulated latency, then the scripted failures,
+// then the usual argument checks.
+//--------------------------------------------------------------------------------------
+static NvAPI_Status Enter(bool needsInit)
+{
+	if (s_State.CallLatencyNs)
+	{
+		uint64_t end = GetTimeNs() + s_State.CallLatencyNs;
+		while (GetTimeNs() < end)
+			;
+	}
+
+	if (s_State.FailNext)
+	{
+		s_State.FailNext--;
+		return NVAPI_ERROR;
+	}
+
+	if (needsInit && !s_State.Initialized)
+		return NVAPI_API_NOT_INITIALIZED;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status EnterWithHandle(StereoHandle handle)
+{
+	NvAPI_Status status = Enter(true);
+	if (status != NVAPI_OK)
+		return status;
+	if (handle != s_Handle)
+		return NVAPI_INVALID_ARGUMENT;
+	return NVAPI_OK;
+}
+
+#define STANDIN_CHECK(expr) { NvAPI_Status status = (expr); if (status != NVAPI_OK) return status; }
+
+
+extern "C" {
+
+NvAPI_Status __cdecl NvAPI_Initialize()
+{
+	STANDIN_CHECK(Enter(false));
+	s_State.Initialized = true;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_Enable()
+{
+	STANDIN_CHECK(Enter(true));
+	s_State.StereoEnabled = true;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_Disable()
+{
+	STANDIN_CHECK(Enter(true));
+	s_State.StereoEnabled = false;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_IsEnabled(NvU8* pIsStereoEnabled)
+{
+	STANDIN_CHECK(Enter(true));
+	if (!pIsStereoEnabled)
+		return NVAPI_INVALID_ARGUMENT;
+	*pIsStereoEnabled = s_State.StereoEnabled ? 1 : 0;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_CreateHandleFromIUnknown(IUnknown* pDevice, StereoHandle* pStereoHandle)
+{
+	STANDIN_CHECK(Enter(true));
+	if (!pDevice || !pStereoHandle)
+		return NVAPI_INVALID_ARGUMENT;
+	if (!s_State.StereoEnabled)
+		return NVAPI_STEREO_NOT_ENABLED;
+	*pStereoHandle = s_Handle;
+	s_State.Activated = true;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_DestroyHandle(StereoHandle stereoHandle)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	s_State.Activated = false;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_Activate(StereoHandle stereoHandle)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	s_State.Activated = true;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_Deactivate(StereoHandle stereoHandle)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	s_State.Activated = false;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_IsActivated(StereoHandle stereoHandle, NvU8* pIsStereoOn)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	if (!pIsStereoOn)
+		return NVAPI_INVALID_ARGUMENT;
+	*pIsStereoOn = s_State.Activated ? 1 : 0;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_GetSeparation(StereoHandle stereoHandle, float* pSeparationPercentage)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	if (!pSeparationPercentage)
+		return NVAPI_INVALID_ARGUMENT;
+	*pSeparationPercentage = s_State.SeparationPercentage;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_SetSeparation(StereoHandle stereoHandle, float newSeparationPercentage)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	if (newSeparationPercentage < 0.0f || newSeparationPercentage > 100.0f)
+		return NVAPI_INVALID_ARGUMENT;
+	s_State.SeparationPercentage = newSeparationPercentage;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_GetConvergence(StereoHandle stereoHandle, float* pConvergence)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	if (!pConvergence)
+		return NVAPI_INVALID_ARGUMENT;
+	*pConvergence = s_State.Convergence;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_SetConvergence(StereoHandle stereoHandle, float newConvergence)
+{
+	STANDIN_CHECK(EnterWithHandle(stereoHandle));
+	s_State.Convergence = newConvergence;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_SetActiveEye(StereoHandle hStereoHandle, NV_STEREO_ACTIVE_EYE StereoEye)
+{
+	STANDIN_CHECK(EnterWithHandle(hStereoHandle));
+	if (s_State.DriverMode != NVAPI_STEREO_DRIVER_MODE_DIRECT)
+		return NVAPI_INVALID_CALL;
+	s_State.ActiveEye = StereoEye;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_SetDriverMode(NV_STEREO_DRIVER_MODE mode)
+{
+	STANDIN_CHECK(Enter(true));
+	s_State.DriverMode = mode;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_GetEyeSeparation(StereoHandle hStereoHandle, float* pSeparation)
+{
+	STANDIN_CHECK(EnterWithHandle(hStereoHandle));
+	if (!pSeparation)
+		return NVAPI_INVALID_ARGUMENT;
+	*pSeparation = s_State.EyeSeparation;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_IsWindowedModeSupported(NvU8* bSupported)
+{
+	STANDIN_CHECK(Enter(true));
+	if (!bSupported)
+		return NVAPI_INVALID_ARGUMENT;
+	*bSupported = 0;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_SetSurfaceCreationMode(StereoHandle hStereoHandle, NVAPI_STEREO_SURFACECREATEMODE creationMode)
+{
+	STANDIN_CHECK(EnterWithHandle(hStereoHandle));
+	s_State.SurfaceCreationMode = creationMode;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_GetSurfaceCreationMode(StereoHandle hStereoHandle, NVAPI_STEREO_SURFACECREATEMODE* pCreationMode)
+{
+	STANDIN_CHECK(EnterWithHandle(hStereoHandle));
+	if (!pCreationMode)
+		return NVAPI_INVALID_ARGUMENT;
+	*pCreationMode = s_State.SurfaceCreationMode;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_Debug_WasLastDrawStereoized(StereoHandle hStereoHandle, NvU8* pWasStereoized)
+{
+	STANDIN_CHECK(EnterWithHandle(hStereoHandle));
+	if (!pWasStereoized)
+		return NVAPI_INVALID_ARGUMENT;
+
+	if (s_State.StereoizedScript[0])
+	{
+		char answer = s_State.StereoizedScript[s_State.StereoizedNext++];
+		if (!s_State.StereoizedScript[s_State.StereoizedNext])
+			s_State.StereoizedNext = 0;
+		if (answer == 'E')
+			return NVAPI_ERROR;
+		*pWasStereoized = (answer == 'S') ? 1 : 0;
+		return NVAPI_OK;
+	}
+
+	*pWasStereoized = s_State.Activated ? 1 : 0;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_SetDefaultProfile(const char* szProfileName)
+{
+	STANDIN_CHECK(Enter(true));
+	if (!szProfileName)
+		return NVAPI_INVALID_ARGUMENT;
+	strncpy(s_State.DefaultProfile, szProfileName, sizeof(s_State.DefaultProfile) - 1);
+	s_State.DefaultProfile[sizeof(s_State.DefaultProfile) - 1] = 0;
+	return NVAPI_OK;
+}
+
+NvAPI_Status __cdecl NvAPI_Stereo_GetDefaultProfile(NvU32 cbSizeIn, char* szProfileName, NvU32* pcbSizeOut)
+{
+	STANDIN_CHECK(Enter(true));
+	if (!pcbSizeOut)
+		return NVAPI_INVALID_ARGUMENT;
+
+	NvU32 needed = (NvU32)strlen(s_State.DefaultProfile) + 1;
+	*pcbSizeOut = needed;
+	if (szProfileName && cbSizeIn >= needed)
+		memcpy(szProfileName, s_State.DefaultProfile, needed);
+	return NVAPI_OK;
+}
+
+}
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------------------------
+// File: NvapiStandIn.h
+//
+// Controls for the stand-in NVAPI in NvapiStandIn.cpp.  The stand-in implements
+// the stereo entry points with a little bit of state and no driver, so the code
+// that calls NVAPI can be built and run on Linux, or on a machine without 3D Vision.
+// Tutorial07 links nvapi.lib instead, the Benchmarks link this everywhere.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+
+// What NvAPI_Stereo_IsEnabled reports, enabled by default.
+void NvapiStandInSetStereoEnabled(bool enabled);
+
+// The next count calls, to any function, return NVAPI_ERROR.
+void NvapiStandInFailNextCalls(uint32_t count);
+
+// Busy-wait this long inside every call, to stand in for driver cost.
+void NvapiStandInSetCallLatencyNs(uint64_t ns);
+
+// Answers for NvAPI_Stereo_Debug_WasLastDrawStereoized, one character per call,
+// 'S' stereoized, 'M' mono, 'E' NVAPI_ERROR, repeating from the start when it
+// runs out.  Null or empty goes back to answering with the activation state.
+void NvapiStandInSetStereoizedScript(const char* script);
@@ -0,0 +1,35 @@
+//--------------------------------------------------------------------------------------
+// File: NvapiStereo.h
+//
+// The NVAPI declarations the app uses.
+//
+// On Windows this is just the SDK headers.  Elsewhere only the lite headers
+// compile, with a couple of Windows-isms stubbed out, and the functions come
+// from the stand-in in NvapiStandIn.cpp.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#if defined(_WIN32)
+
+#include "nvapi.h"
+#include "nvapi_lite_stereo.h"
+
+#else
+
+#ifndef __cdecl
+#define __cdecl
+#endif
+struct IUnknown;
+
+// The device entry points are only declared once a D3D header has been seen.
+#ifndef __d3d11_h__
+#define __d3d11_h__
+#endif
+
+#include "nvapi_lite_common.h"
+#include "nvapi_lite_stereo.h"
+
+// From nvapi.h, which needs the Windows SDK.
+extern "C" NvAPI_Status __cdecl NvAPI_Initialize();
+
+#endif
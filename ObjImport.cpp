@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------
+// File: ObjImport.cpp
+//
+// OBJ parsing.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "ObjImport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+
+static bool Fail(std::string* pError, const char* message, uint32_t line)
+{
+	if (pError)
+	{
+		char text[128];
+		sprintf(text, "line %u: %s", line, message);
+		*pError = text;
+	}
+	return false;
+}
+
+static const char* SkipSpaces(const char* p)
+{
+	while (*p == ' ' || *p == '\t')
+		p++;
+	return p;
+}
+
+static const char* NextLine(const char* p)
+{
+	while (*p && *p != '\n')
+		p++;
+	return *p ? p + 1 : p;
+}
+
+// 1 based, or negative from the end, to 0 based.  -1 if out of range.
+static int64_t ResolveIndex(long index, size_t count)
+{
+	if (index > 0 && (size_t)index <= count)
+		return index - 1;
+	if (index < 0 && (size_t)-index <= count)
+		return (int64_t)count + index;
+	return -1;
+}
+
+bool ImportObjText(const char* pText, MeshData* pMesh, std::string* pError)
+{
+	std::vector<float> positions;
+	std::vector<float> texcoords;
+	std::unordered_map<uint64_t, uint32_t> vertexMap;
+	std::vector<uint32_t> face;
+
+	pMesh->Vertices.clear();
+	pMesh->Indices.clear();
+	pMesh->Lods.clear();
+
+	uint32_t line = 1;
+	for (const char* p = pText; *p; p = NextLine(p), line++)
+	{
+		p = SkipSpaces(p);
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			char* end;
+			float x = strtof(p + 2, &end);
+			float y = strtof(end, &end);
+			float z = strtof(end, &end);
+			positions.push_back(x);
+			positions.push_back(y);
+			positions.push_back(0.0f - z);
+		}
+		else if (p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			char* end;
+			float u = strtof(p + 3, &end);
+			float v = strtof(end, &end);
+			texcoords.push_back(u);
+			texcoords.push_back(1.0f - v);
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			face.clear();
+			const char* q = SkipSpaces(p + 2);
+			while (*q && *q != '\n' && *q != '\r' && *q != '#')
+			{
+				char* end;
+				long position = strtol(q, &end, 10);
+				if (end == q)
+					return Fail(pError, "bad face corner", line);
+				q = end;
+
+				long texcoord = 0;
+				if (*q == '/')
+				{
+					q++;
+					if (*q != '/')
+					{
+						texcoord = strtol(q, &end, 10);
+						q = end;
+					}
+					// The normal, unused.
+					if (*q == '/')
+					{
+						strtol(q + 1, &end, 10);
+						q = end;
+					}
+				}
+
+				int64_t pi = ResolveIndex(position, positions.size() / 3);
+				int64_t ti = texcoord ? ResolveIndex(texcoord, texcoords.size() / 2) : -1;
+				if (pi < 0 || (texcoord && ti < 0))
+					return Fail(pError, "index out of range", line);
+
+				uint64_t key = ((uint64_t)pi << 32) | (uint32_t)(ti + 1);
+				std::unordered_map<uint64_t, uint32_t>::iterator it = vertexMap.find(key);
+				if (it == vertexMap.end())
+				{
+					MeshVertex v;
+					memcpy(v.Position, &positions[(size_t)pi * 3], sizeof(v.Position));
+					v.Texcoord[0] = (ti >= 0) ? texcoords[(size_t)ti * 2] : 0.0f;
+					v.Texcoord[1] = (ti >= 0) ? texcoords[(size_t)ti * 2 + 1] : 0.0f;
+					it = vertexMap.insert(std::make_pair(key, (uint32_t)pMesh->Vertices.size())).first;
+					pMesh->Vertices.push_back(v);
+				}
+				face.push_back(it->second);
+				q = SkipSpaces(q);
+			}
+
+			if (face.size() < 3)
+				return Fail(pError, "face with fewer than three corners", line);
+
+			// Fanned, and reversed for the flipped z.
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				pMesh->Indices.push_back(face[0]);
+				pMesh->Indices.push_back(face[i]);
+				pMesh->Indices.push_back(face[i - 1]);
+			}
+		}
+	}
+
+	if (pMesh->Indices.empty())
+		return Fail(pError, "no faces", line);
+	return true;
+}
+
+bool ImportObj(const char* path, MeshData* pMesh, std::string* pError)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f)
+	{
+		if (pError)
+			*pError = std::string("can't open ") + path;
+		return false;
+	}
+
+	std::vector<char> text;
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		text.insert(text.end(), buffer, buffer + read);
+	fclose(f);
+	text.push_back('\0');
+
+	return ImportObjText(&text[0], pMesh, pError);
+}
@@ -0,0 +1,25 @@
+//--------------------------------------------------------------------------------------
+// File: ObjImport.h
+//
+// Wavefront OBJ to MeshData, for MeshConvert.
+//
+// Reads v, vt and f; normals, groups and materials are ignored, since
+// SimpleVertex has no use for them.  Faces with more than three corners are
+// fanned, negative indices count back from the end, and each distinct
+// position and texcoord pair becomes one vertex.
+//
+// OBJ is right handed with counterclockwise front faces and v up the texture,
+// so z is negated, winding reversed and v flipped, to match the left handed,
+// clockwise, v down conventions of D3D and the cube.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <string>
+
+#include "Mesh.h"
+
+
+bool ImportObj(const char* path, MeshData* pMesh, std::string* pError = nullptr);
+
+// The same from text in memory, which must end in a zero.
+bool ImportObjText(const char* pText, MeshData* pMesh, std::string* pError = nullptr);
@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------
+// File: Presenter.cpp
+//
+// Present tracking and the simulated display.  No Windows dependencies here.
+//--------------------------------------------------------------------------------------
+
+#include "Presenter.h"
+
+#include <string.h>
+
+
+//--------------------------------------------------------------------------------------
+// The original sample setup: single buffer blt-model, no vsync, and the DXGI
+// default of 3 frames queued.
+//--------------------------------------------------------------------------------------
+SwapChainConfig DefaultSwapChainConfig()
+{
+	SwapChainConfig config;
+	config.BufferCount = 1;
+	config.MaxFrameLatency = 3;
+	config.SyncInterval = 0;
+	config.FlipModel = false;
+	config.WaitableObject = false;
+	return config;
+}
+
+
+//--------------------------------------------------------------------------------------
+// PresentTracker
+//--------------------------------------------------------------------------------------
+PresentTracker::PresentTracker(uint64_t refreshPeriodNs)
+{
+	m_RefreshPeriodNs = refreshPeriodNs;
+	memset(m_SubmitTimeNs, 0, sizeof(m_SubmitTimeNs));
+	m_LastPresentId = 0;
+	memset(&m_LastStats, 0, sizeof(m_LastStats));
+	m_HaveStats = false;
+
+	m_FramesDisplayed = 0;
+	m_MissedRefreshes = 0;
+	m_LastLatencyNs = 0;
+	m_MaxLatencyNs = 0;
+	m_TotalLatencyNs = 0;
+	m_LatencySamples = 0;
+}
+
+void PresentTracker::OnPresent(uint32_t presentId, uint64_t submitTimeNs)
+{
+	m_SubmitTimeNs[presentId & (kHistory - 1)] = submitTimeNs;
+	m_LastPresentId = presentId;
+}
+
+//--------------------------------------------------------------------------------------
+// The statistics only describe the latest frame on screen, so frames that were
+// replaced before we looked are counted, but do not get a latency sample.
+//
+// A refresh is missed when more vblanks went by than new frames showed up.  With
+// sync interval 0 several frames can land on one vblank, which is not a miss.
+//--------------------------------------------------------------------------------------
+void PresentTracker::OnStatistics(const PresentStatistics& stats)
+{
+	if (m_HaveStats && stats.PresentCount == m_LastStats.PresentCount)
+	{
+		m_LastStats.SyncRefreshCount = stats.SyncRefreshCount;
+		m_LastStats.SyncTimeNs = stats.SyncTimeNs;
+		return;
+	}
+
+	if (m_HaveStats)
+	{
+		uint32_t newFrames = stats.PresentCount - m_LastStats.PresentCount;
+		uint32_t refreshes = stats.PresentRefreshCount - m_LastStats.PresentRefreshCount;
+		m_FramesDisplayed += newFrames;
+		if (refreshes > newFrames)
+			m_MissedRefreshes += refreshes - newFrames;
+	}
+	else
+	{
+		m_FramesDisplayed += 1;
+	}
+
+	// Back the vblank time up to the refresh where this frame actually flipped.
+	uint32_t age = m_LastPresentId - stats.PresentCount;
+	if (age < kHistory)
+	{
+		uint64_t displayNs = stats.SyncTimeNs -
+			(uint64_t)(stats.SyncRefreshCount - stats.PresentRefreshCount) * m_RefreshPeriodNs;
+		uint64_t submitNs = m_SubmitTimeNs[stats.PresentCount & (kHistory - 1)];
+		if (displayNs >= submitNs)
+		{
+			m_LastLatencyNs = displayNs - submitNs;
+			if (m_LastLatencyNs > m_MaxLatencyNs)
+				m_MaxLatencyNs = m_LastLatencyNs;
+			m_TotalLatencyNs += m_LastLatencyNs;
+			m_LatencySamples++;
+		}
+	}
+
+	m_LastStats = stats;
+	m_HaveStats = true;
+}
+
+double PresentTracker::AverageLatencyNs() const
+{
+	if (m_LatencySamples == 0)
+		return 0.0;
+	return (double)m_TotalLatencyNs / (double)m_LatencySamples;
+}
+
+
+//--------------------------------------------------------------------------------------
+// SimulatedDisplay
+//--------------------------------------------------------------------------------------
+SimulatedDisplay::SimulatedDisplay(const SwapChainConfig& config, uint32_t refreshRateHz)
+{
+	m_RefreshPeriodNs = 1000000000ull / (refreshRateHz ? refreshRateHz : 60);
+	m_NowNs = 0;
+	m_NextVblankNs = m_RefreshPeriodNs;
+
+	uint32_t maxQueued = config.MaxFrameLatency;
+	if (config.FlipModel && config.BufferCount > 1 && config.BufferCount - 1 < maxQueued)
+		maxQueued = config.BufferCount - 1;
+	if (maxQueued < 1)
+		maxQueued = 1;
+	if (maxQueued > kMaxQueue)
+		maxQueued = kMaxQueue;
+	m_MaxQueued = maxQueued;
+
+	m_QueueHead = 0;
+	m_QueueCount = 0;
+
+	m_PresentId = 0;
+	m_FramesDropped = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_HaveStats = false;
+}
+
+//--------------------------------------------------------------------------------------
+// Like the waitable object, this is signaled whenever the queue has room.
+//--------------------------------------------------------------------------------------
+bool SimulatedDisplay::WaitForNextFrame(uint32_t timeoutMs)
+{
+	uint64_t deadline = m_NowNs + (uint64_t)timeoutMs * 1000000ull;
+
+	while (m_QueueCount >= m_MaxQueued)
+	{
+		if (m_NextVblankNs > deadline)
+		{
+			m_NowNs = deadline;
+			return false;
+		}
+		RunVblanksUntil(m_NextVblankNs);
+	}
+	return true;
+}
+
+bool SimulatedDisplay::Present(uint32_t syncInterval)
+{
+	// A full queue stalls Present until the next flip makes room.
+	while (m_QueueCount >= m_MaxQueued)
+		RunVblanksUntil(m_NextVblankNs);
+
+	m_PresentId++;
+	uint32_t slot = (m_QueueHead + m_QueueCount) % kMaxQueue;
+	m_QueueIds[slot] = m_PresentId;
+	m_QueueSync[slot] = syncInterval;
+	m_QueueCount++;
+	return true;
+}
+
+uint32_t SimulatedDisplay::GetLastPresentCount()
+{
+	return m_PresentId;
+}
+
+bool SimulatedDisplay::GetFrameStatistics(PresentStatistics* pStats)
+{
+	if (!m_HaveStats)
+		return false;
+	*pStats = m_Stats;
+	return true;
+}
+
+uint64_t SimulatedDisplay::NowNs()
+{
+	return m_NowNs;
+}
+
+void SimulatedDisplay::AdvanceTime(uint64_t ns)
+{
+	RunVblanksUntil(m_NowNs + ns);
+}
+
+void SimulatedDisplay::RunVblanksUntil(uint64_t timeNs)
+{
+	while (m_NextVblankNs <= timeNs)
+	{
+		m_NowNs = m_NextVblankNs;
+		OnVblank();
+		m_NextVblankNs += m_RefreshPeriodNs;
+	}
+	m_NowNs = timeNs;
+}
+
+void SimulatedDisplay::OnVblank()
+{
+	m_Stats.SyncRefreshCount++;
+	m_Stats.SyncTimeNs = m_NowNs;
+
+	if (m_QueueCount == 0)
+		return;
+
+	// Sync interval 0 frames do not wait their turn, the newest one wins.
+	uint32_t shown = 1;
+	if (m_QueueSync[m_QueueHead] == 0)
+	{
+		while (shown < m_QueueCount && m_QueueSync[(m_QueueHead + shown) % kMaxQueue] == 0)
+			shown++;
+		m_FramesDropped += shown - 1;
+	}
+
+	uint32_t last = (m_QueueHead + shown - 1) % kMaxQueue;
+	m_Stats.PresentCount = m_QueueIds[last];
+	m_Stats.PresentRefreshCount = m_Stats.SyncRefreshCount;
+	m_HaveStats = true;
+
+	m_QueueHead = (m_QueueHead + shown) % kMaxQueue;
+	m_QueueCount -= shown;
+}
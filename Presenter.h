@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------------------
+// File: Presenter.h
+//
+// Presentation abstraction used by RenderFrame().
+//
+// The app talks to an IPresenter instead of straight to the IDXGISwapChain, so the
+// frame pacing logic (latency wait, Present, frame statistics) can be driven either
+// by the real DXGI swap chain (see SwapChain.h), or by the SimulatedDisplay here,
+// which models a 120Hz display with a bounded present queue in virtual time.
+// The simulated display has no Windows dependencies, so the latency behavior of
+// the different buffer count / max latency settings can be checked without a GPU,
+// which the Benchmarks' present suite does.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+
+//--------------------------------------------------------------------------------------
+// Same information as DXGI_FRAME_STATISTICS, with the QPC time converted to ns.
+//--------------------------------------------------------------------------------------
+struct PresentStatistics
+{
+	uint32_t PresentCount;			// Present() id of the last frame put on screen
+	uint32_t PresentRefreshCount;	// vblank count when that frame was put on screen
+	uint32_t SyncRefreshCount;		// vblank count of the most recent vblank
+	uint64_t SyncTimeNs;			// time of the most recent vblank
+};
+
+
+//--------------------------------------------------------------------------------------
+// Swap chain settings selected from the command line.
+//--------------------------------------------------------------------------------------
+struct SwapChainConfig
+{
+	uint32_t BufferCount;			// Back buffers, 1 is the original blt-model setup
+	uint32_t MaxFrameLatency;		// Frames the CPU may queue ahead of the display
+	uint32_t SyncInterval;			// Present() sync interval, 0 for no vsync
+	bool FlipModel;					// Ask for FLIP_SEQUENTIAL, falls back to blt
+	bool WaitableObject;			// Use the frame latency waitable object if available
+};
+
+SwapChainConfig DefaultSwapChainConfig();
+
+
+//--------------------------------------------------------------------------------------
+// Interface for whatever is putting our frames on screen.
+//--------------------------------------------------------------------------------------
+class IPresenter
+{
+public:
+	virtual ~IPresenter() {}
+
+	// Block until the display can take another frame.  This is the frame latency
+	// waitable object on DXGI, it should be called before starting a new frame.
+	// Returns false on timeout.
+	virtual bool WaitForNextFrame(uint32_t timeoutMs) = 0;
+
+	// Queue the current back buffer for display.
+	virtual bool Present(uint32_t syncInterval) = 0;
+
+	// Id of the last frame handed to Present, same as IDXGISwapChain::GetLastPresentCount.
+	virtual uint32_t GetLastPresentCount() = 0;
+
+	// Returns false when no statistics are available yet, which is normal for
+	// the first few frames, and always the case for windowed blt-model.
+	virtual bool GetFrameStatistics(PresentStatistics* pStats) = 0;
+
+	// Current time on the presenter's clock, in ns.
+	virtual uint64_t NowNs() = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Matches each Present() against the frame statistics that come back later, to
+// get the present-to-display latency and count missed refreshes.
+//--------------------------------------------------------------------------------------
+class PresentTracker
+{
+public:
+	PresentTracker(uint64_t refreshPeriodNs);
+
+	// Call right after Present, with the id from GetLastPresentCount.
+	void OnPresent(uint32_t presentId, uint64_t submitTimeNs);
+
+	// Call with fresh statistics, once per frame is fine.
+	void OnStatistics(const PresentStatistics& stats);
+
+	uint32_t FramesDisplayed() const { return m_FramesDisplayed; }
+	uint32_t MissedRefreshes() const { return m_MissedRefreshes; }
+	uint32_t QueuedFrames() const { return m_LastPresentId - m_LastStats.PresentCount; }
+	uint64_t LastLatencyNs() const { return m_LastLatencyNs; }
+	uint64_t MaxLatencyNs() const { return m_MaxLatencyNs; }
+	double AverageLatencyNs() const;
+
+private:
+	static const uint32_t kHistory = 16;	// Power of two, more than any queue depth
+
+	uint64_t m_RefreshPeriodNs;
+	uint64_t m_SubmitTimeNs[kHistory];
+	uint32_t m_LastPresentId;
+	PresentStatistics m_LastStats;
+	bool m_HaveStats;
+
+	uint32_t m_FramesDisplayed;
+	uint32_t m_MissedRefreshes;
+	uint64_t m_LastLatencyNs;
+	uint64_t m_MaxLatencyNs;
+	uint64_t m_TotalLatencyNs;
+	uint32_t m_LatencySamples;
+};
+
+
+//--------------------------------------------------------------------------------------
+// A display that runs on a virtual clock.
+//
+// Frames go into a queue of at most MaxFrameLatency entries, further limited to
+// BufferCount - 1 for flip model, since one buffer is always on screen.  Each vblank flips the
+// oldest queued frame to the screen (sync interval 1), or the newest one, dropping
+// the rest (sync interval 0).  Present blocks when the queue is full, the same way
+// DXGI does, and WaitForNextFrame blocks the same way the waitable object does.
+// Blocking simply moves the virtual clock forward, the caller models its CPU work
+// by calling AdvanceTime.
+//--------------------------------------------------------------------------------------
+class SimulatedDisplay : public IPresenter
+{
+public:
+	SimulatedDisplay(const SwapChainConfig& config, uint32_t refreshRateHz);
+
+	bool WaitForNextFrame(uint32_t timeoutMs);
+	bool Present(uint32_t syncInterval);
+	uint32_t GetLastPresentCount();
+	bool GetFrameStatistics(PresentStatistics* pStats);
+	uint64_t NowNs();
+
+	// Simulate CPU or GPU work taking the given time.
+	void AdvanceTime(uint64_t ns);
+
+	uint32_t QueuedFrames() const { return m_QueueCount; }
+	uint32_t FramesDropped() const { return m_FramesDropped; }
+
+private:
+	void RunVblanksUntil(uint64_t timeNs);
+	void OnVblank();
+
+	static const uint32_t kMaxQueue = 16;
+
+	uint64_t m_RefreshPeriodNs;
+	uint64_t m_NowNs;
+	uint64_t m_NextVblankNs;
+	uint32_t m_MaxQueued;
+
+	uint32_t m_QueueIds[kMaxQueue];
+	uint32_t m_QueueSync[kMaxQueue];
+	uint32_t m_QueueHead;
+	uint32_t m_QueueCount;
+
+	uint32_t m_PresentId;
+	uint32_t m_FramesDropped;
+	PresentStatistics m_Stats;
+	bool m_HaveStats;
+};
@@ -0,0 +1,273 @@
+//--------------------------------------------------------------------------------------
+// File: Profiler.cpp
+//
+// Thread buffer registration and the trace writers.
+//
+// Binary format, all little-endian:
+//
+//	char     Magic[4]			"PRFB"
+//	uint32   Version			1
+//	double   NsPerCycle
+//	uint64   BaseCycles			timestamps are relative to this
+//	uint32   NameCount
+//	uint32   ThreadCount
+//	NameCount times:
+//		uint16 Length, char Name[Length]
+//	ThreadCount times:
+//		uint32 ThreadId
+//		uint16 Length, char Name[Length]
+//		uint32 EventCount
+//		EventCount times, as LEB128 varints:
+//			NameIndex, Depth, zigzag(Start - previous Start), End - Start
+//
+// Events are stored in the order zones ended, so a parent comes after its
+// children and the start deltas can go negative, hence the zigzag.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+PROFILER_THREAD_LOCAL ProfileThreadBuffer* g_pProfileThreadBuffer = nullptr;
+PROFILER_THREAD_LOCAL uint32_t g_ProfileDepth = 0;
+
+static std::mutex s_ListMutex;
+static ProfileThreadBuffer* s_pFirstBuffer = nullptr;
+static uint32_t s_EventsPerThread = 1 << 16;
+static CycleCalibration s_Calibration;
+static bool s_Calibrated = false;
+
+
+static uint32_t CurrentThreadId()
+{
+#if defined(_WIN32)
+	return GetCurrentThreadId();
+#else
+	return (uint32_t)syscall(SYS_gettid);
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Setup
+//--------------------------------------------------------------------------------------
+void ProfilerInit(uint32_t eventsPerThread)
+{
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	s_EventsPerThread = eventsPerThread;
+	s_Calibration.Begin();
+	s_Calibrated = true;
+}
+
+ProfileThreadBuffer* ProfilerCreateThreadBuffer()
+{
+	ProfileThreadBuffer* pBuffer = new ProfileThreadBuffer;
+	pBuffer->Count.store(0, std::memory_order_relaxed);
+	pBuffer->Dropped.store(0, std::memory_order_relaxed);
+	pBuffer->ThreadId = CurrentThreadId();
+	pBuffer->Name[0] = 0;
+
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	if (!s_Calibrated)
+	{
+		s_Calibration.Begin();
+		s_Calibrated = true;
+	}
+	pBuffer->Capacity = s_EventsPerThread;
+	pBuffer->Events = new ProfileEvent[s_EventsPerThread];
+	pBuffer->Next = s_pFirstBuffer;
+	s_pFirstBuffer = pBuffer;
+
+	g_pProfileThreadBuffer = pBuffer;
+	return pBuffer;
+}
+
+void ProfilerSetThreadName(const char* name)
+{
+	ProfileThreadBuffer* pBuffer = g_pProfileThreadBuffer;
+	if (!pBuffer)
+		pBuffer = ProfilerCreateThreadBuffer();
+
+	strncpy(pBuffer->Name, name, sizeof(pBuffer->Name) - 1);
+	pBuffer->Name[sizeof(pBuffer->Name) - 1] = 0;
+}
+
+uint64_t ProfilerDroppedEvents()
+{
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	uint64_t dropped = 0;
+	for (ProfileThreadBuffer* p = s_pFirstBuffer; p; p = p->Next)
+		dropped += p->Dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Export helpers
+//--------------------------------------------------------------------------------------
+static void WriteJsonString(FILE* f, const char* s)
+{
+	fputc('"', f);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fputc('\\', f);
+		if ((unsigned char)*s >= 0x20)
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void WriteVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((uint8_t)v);
+}
+
+static void WriteBytes(std::vector<uint8_t>& out, const void* p, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(p);
+	out.insert(out.end(), bytes, bytes + size);
+}
+
+static void WriteShortString(std::vector<uint8_t>& out, const char* s)
+{
+	uint16_t length = (uint16_t)strlen(s);
+	WriteBytes(out, &length, sizeof(length));
+	WriteBytes(out, s, length);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Chrome trace, complete ("X") events with ts and dur in microseconds.  The
+// fractional part keeps the ns resolution.
+//--------------------------------------------------------------------------------------
+bool ProfilerWriteChromeTrace(const char* path)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	s_Calibration.End();
+	double baseNs = (double)s_Calibration.StartNs;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	bool first = true;
+	for (ProfileThreadBuffer* p = s_pFirstBuffer; p; p = p->Next)
+	{
+		if (p->Name[0])
+		{
+			fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+				first ? "" : ",\n", p->ThreadId);
+			WriteJsonString(f, p->Name);
+			fprintf(f, "}}");
+			first = false;
+		}
+
+		uint32_t count = p->Count.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const ProfileEvent& e = p->Events[i];
+			double startUs = (s_Calibration.ToNs(e.Start) - baseNs) / 1000.0;
+			double durUs = (double)(e.End - e.Start) * s_Calibration.NsPerCycle / 1000.0;
+
+			fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+			WriteJsonString(f, e.Name);
+			fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", p->ThreadId, startUs, durUs);
+			first = false;
+		}
+	}
+	fprintf(f, "\n]}\n");
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Binary trace, see the top of the file for the layout.
+//--------------------------------------------------------------------------------------
+bool ProfilerWriteBinary(const char* path)
+{
+	std::vector<uint8_t> names;
+	std::vector<uint8_t> threads;
+	std::map<std::string, uint32_t> nameIndex;
+	uint32_t threadCount = 0;
+
+	std::lock_guard<std::mutex> lock(s_ListMutex);
+	s_Calibration.End();
+
+	for (ProfileThreadBuffer* p = s_pFirstBuffer; p; p = p->Next)
+	{
+		uint32_t count = p->Count.load(std::memory_order_acquire);
+
+		WriteBytes(threads, &p->ThreadId, sizeof(p->ThreadId));
+		WriteShortString(threads, p->Name);
+		WriteBytes(threads, &count, sizeof(count));
+
+		uint64_t previousStart = s_Calibration.StartCycles;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const ProfileEvent& e = p->Events[i];
+
+			std::map<std::string, uint32_t>::iterator it = nameIndex.find(e.Name);
+			if (it == nameIndex.end())
+			{
+				it = nameIndex.insert(std::make_pair(std::string(e.Name), (uint32_t)nameIndex.size())).first;
+				WriteShortString(names, e.Name);
+			}
+
+			int64_t delta = (int64_t)(e.Start - previousStart);
+			WriteVarint(threads, it->second);
+			WriteVarint(threads, e.Depth);
+			WriteVarint(threads, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+			WriteVarint(threads, e.End - e.Start);
+			previousStart = e.Start;
+		}
+		threadCount++;
+	}
+
+	std::vector<uint8_t> header;
+	uint32_t version = 1;
+	uint32_t nameCount = (uint32_t)nameIndex.size();
+	WriteBytes(header, "PRFB", 4);
+	WriteBytes(header, &version, sizeof(version));
+	WriteBytes(header, &s_Calibration.NsPerCycle, sizeof(double));
+	WriteBytes(header, &s_Calibration.StartCycles, sizeof(uint64_t));
+	WriteBytes(header, &nameCount, sizeof(nameCount));
+	WriteBytes(header, &threadCount, sizeof(threadCount));
+
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	fwrite(header.data(), 1, header.size(), f);
+	if (!names.empty())
+		fwrite(names.data(), 1, names.size(), f);
+	if (!threads.empty())
+		fwrite(threads.data(), 1, threads.size(), f);
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	return ok;
+}
+
+#endif
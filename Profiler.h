@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------------------
+// File: Profiler.h
+//
+// Scoped CPU profiling zones.
+//
+//	void Foo()
+//	{
+//		PROFILE_ZONE("Foo");
+//		...
+//	}
+//
+// Each thread writes completed zones into its own fixed-size buffer, so recording
+// takes no locks and does no allocation after the first zone on a thread.  Zones
+// are timestamped with the cycle counter (see Timing.h), and converted to ns when
+// written out, as Chrome trace JSON (load in chrome://tracing or Perfetto), or
+// the compact binary format described in Profiler.cpp.
+//
+// Enabled when PROFILE is defined, which is the Debug and Profile configurations.
+// Release builds compile every zone out completely.  PROFILER_ENABLED can be set
+// to 0 or 1 to override that.
+//
+// Zone names must be string literals, only the pointer is stored.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+#include "Timing.h"
+
+#ifndef PROFILER_ENABLED
+#if defined(PROFILE)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+
+#if PROFILER_ENABLED
+
+#include <atomic>
+
+//--------------------------------------------------------------------------------------
+// One completed zone.
+//--------------------------------------------------------------------------------------
+struct ProfileEvent
+{
+	const char* Name;
+	uint64_t Start;
+	uint64_t End;
+	uint32_t Depth;
+};
+
+//--------------------------------------------------------------------------------------
+// Per-thread event storage.  Only the owning thread writes, and it publishes with
+// a release store of Count, so the exporter can read up to Count at any time.
+// Buffers are linked into a global list when created, and never freed.
+//--------------------------------------------------------------------------------------
+struct ProfileThreadBuffer
+{
+	ProfileEvent* Events;
+	uint32_t Capacity;
+	std::atomic<uint32_t> Count;
+	std::atomic<uint64_t> Dropped;
+	uint32_t ThreadId;
+	char Name[32];
+	ProfileThreadBuffer* Next;
+};
+
+// Slow path, creates the buffer for this thread on first use.
+ProfileThreadBuffer* ProfilerCreateThreadBuffer();
+
+inline void ProfilerRecord(ProfileThreadBuffer* pBuffer, const char* name, uint64_t start, uint64_t end, uint32_t depth)
+{
+	uint32_t count = pBuffer->Count.load(std::memory_order_relaxed);
+	if (count >= pBuffer->Capacity)
+	{
+		pBuffer->Dropped.store(pBuffer->Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+
+	ProfileEvent& e = pBuffer->Events[count];
+	e.Name = name;
+	e.Start = start;
+	e.End = end;
+	e.Depth = depth;
+	pBuffer->Count.store(count + 1, std::memory_order_release);
+}
+
+#if defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+extern PROFILER_THREAD_LOCAL ProfileThreadBuffer* g_pProfileThreadBuffer;
+extern PROFILER_THREAD_LOCAL uint32_t g_ProfileDepth;
+
+
+//--------------------------------------------------------------------------------------
+// RAII zone, use through PROFILE_ZONE.
+//--------------------------------------------------------------------------------------
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+	{
+		m_Name = name;
+		m_Depth = g_ProfileDepth++;
+		m_Start = ReadCycleCounter();
+	}
+
+	~ProfileZone()
+	{
+		uint64_t end = ReadCycleCounter();
+		ProfileThreadBuffer* pBuffer = g_pProfileThreadBuffer;
+		if (!pBuffer)
+			pBuffer = ProfilerCreateThreadBuffer();
+		ProfilerRecord(pBuffer, m_Name, m_Start, end, m_Depth);
+		g_ProfileDepth--;
+	}
+
+private:
+	ProfileZone(const ProfileZone&);
+	ProfileZone& operator=(const ProfileZone&);
+
+	const char* m_Name;
+	uint64_t m_Start;
+	uint32_t m_Depth;
+};
+
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+// Call once at startup, before any zones, sizes every thread's buffer.
+void ProfilerInit(uint32_t eventsPerThread);
+
+// Label the calling thread in the trace.
+void ProfilerSetThreadName(const char* name);
+
+// Zones dropped because a thread's buffer was full.
+uint64_t ProfilerDroppedEvents();
+
+// Write everything recorded so far.  Safe to call while other threads are still
+// recording, those zones just may or may not make it in.
+bool ProfilerWriteChromeTrace(const char* path);
+bool ProfilerWriteBinary(const char* path);
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+
+inline void ProfilerInit(uint32_t) {}
+inline void ProfilerSetThreadName(const char*) {}
+inline uint64_t ProfilerDroppedEvents() { return 0; }
+inline bool ProfilerWriteChromeTrace(const char*) { return false; }
+inline bool ProfilerWriteBinary(const char*) { return false; }
+
+#endif
@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------
+// File: RenderBackend.cpp
+//
+// The headless backend.
+//--------------------------------------------------------------------------------------
+
+#include "RenderBackend.h"
+#include "AlignedAlloc.h"
+#include "MeshOptimize.h"
+#include "Timing.h"
+
+#include <string.h>
+
+
+NullRenderBackend::NullRenderBackend(size_t ringBytes)
+	: m_Ring(ringBytes)
+{
+	m_RingOffset = 0;
+	m_Eye = 0;
+	m_DrawnStart = UINT32_MAX;
+	m_DrawnBaseVertex = 0;
+	m_pIndirectInstances = nullptr;
+	m_IndirectVisible = 0;
+	m_EmulateIndirect = true;
+	ResetCounters();
+	SetIndices(nullptr, 0, 0);
+}
+
+NullRenderBackend::~NullRenderBackend()
+{
+	AlignedFree(m_pIndirectInstances);
+}
+
+size_t NullRenderBackend::MemoryBytes() const
+{
+	return m_Ring.size() + m_Instances.capacity() + m_IndirectObjects.capacity() * sizeof(IndirectObject) +
+		(m_IndirectTemplate.capacity() + m_IndirectArgs.capacity()) * sizeof(IndirectDrawArgs) +
+		m_IndirectObjects.size() * sizeof(SMMatrix);
+}
+
+void NullRenderBackend::ResetCounters()
+{
+	memset(&m_Counters, 0, sizeof(m_Counters));
+}
+
+void NullRenderBackend::SetIndices(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount)
+{
+	m_pIndices = pIndices;
+	m_IndexCount = indexCount;
+	m_VertexCount = vertexCount;
+	m_LastStart = 0;
+	m_LastCount = 0;
+	m_LastTransforms = 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Each draw starts with an empty cache, and instances don't share one, so an
+// instanced draw costs its instance count times one draw.  Eyes past the
+// second count as the right.
+//--------------------------------------------------------------------------------------
+void NullRenderBackend::CountVertexInvocations(uint32_t indexCount, uint32_t startIndex, uint64_t instanceCount)
+{
+	if (!m_pIndices || (size_t)startIndex + indexCount > m_IndexCount)
+		return;
+
+	if (startIndex != m_LastStart || indexCount != m_LastCount)
+	{
+		m_LastTransforms = AnalyzeVertexCache(m_pIndices + startIndex, indexCount, m_VertexCount).Transforms;
+		m_LastStart = startIndex;
+		m_LastCount = indexCount;
+	}
+
+	uint64_t invocations = m_LastTransforms * instanceCount;
+	m_Counters.VertexInvocations += invocations;
+	m_Counters.EyeVertexInvocations[(m_Eye > 0) ? 1 : 0] += invocations;
+}
+
+void NullRenderBackend::CountMeshChange(uint32_t startIndex, int32_t baseVertex)
+{
+	if (startIndex != m_DrawnStart || baseVertex != m_DrawnBaseVertex)
+		m_Counters.MeshChanges++;
+	m_DrawnStart = startIndex;
+	m_DrawnBaseVertex = baseVertex;
+}
+
+void NullRenderBackend::BeginEye(uint32_t eye)
+{
+	m_Eye = eye;
+	m_DrawnStart = UINT32_MAX;
+}
+
+void NullRenderBackend::SetShader(uint32_t)
+{
+	m_Counters.ShaderChanges++;
+}
+
+void NullRenderBackend::SetMaterial(uint32_t)
+{
+	m_Counters.MaterialChanges++;
+}
+
+void NullRenderBackend::UpdateConstants(const void* pData, size_t bytes)
+{
+	if (bytes > m_Ring.size())
+		bytes = m_Ring.size();
+	if (m_RingOffset + bytes > m_Ring.size())
+		m_RingOffset = 0;
+
+	memcpy(&m_Ring[m_RingOffset], pData, bytes);
+	m_RingOffset += bytes;
+
+	m_Counters.ConstantUpdates++;
+	m_Counters.ConstantBytes += bytes;
+}
+
+void NullRenderBackend::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	CountMeshChange(startIndex, baseVertex);
+	m_Counters.Draws++;
+	m_Counters.Indices += indexCount;
+	m_Counters.Instances++;
+	CountVertexInvocations(indexCount, startIndex, 1);
+}
+
+void NullRenderBackend::EndEye()
+{
+}
+
+//--------------------------------------------------------------------------------------
+// A dynamic buffer mapped with discard, so the copy is all there is to it.
+//--------------------------------------------------------------------------------------
+void NullRenderBackend::UpdateInstances(const void* pData, size_t bytes)
+{
+	if (bytes > m_Instances.size())
+		m_Instances.resize(bytes);
+	if (bytes)
+		memcpy(&m_Instances[0], pData, bytes);
+
+	m_Counters.InstanceUpdates++;
+	m_Counters.InstanceBytes += bytes;
+}
+
+void NullRenderBackend::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t)
+{
+	CountMeshChange(startIndex, baseVertex);
+	m_Counters.Draws++;
+	m_Counters.Indices += (uint64_t)indexCount * instanceCount;
+	m_Counters.Instances += instanceCount;
+	CountVertexInvocations(indexCount, startIndex, instanceCount);
+}
+
+bool NullRenderBackend::SetIndirectScene(const IndirectObject* pObjects, uint32_t objectCount,
+	const IndirectDrawArgs* pArgs, uint32_t drawCount)
+{
+	if (objectCount > m_IndirectObjects.size())
+	{
+		AlignedFree(m_pIndirectInstances);
+		m_pIndirectInstances = static_cast<SMMatrix*>(AlignedAlloc(objectCount * sizeof(SMMatrix), 16));
+	}
+	m_IndirectObjects.assign(pObjects, pObjects + objectCount);
+	m_IndirectTemplate.assign(pArgs, pArgs + drawCount);
+	m_IndirectArgs = m_IndirectTemplate;
+	m_IndirectVisible = 0;
+	return true;
+}
+
+//--------------------------------------------------------------------------------------
+// The reset is the small upload a device backend makes too, the pass itself
+// is timed apart.
+//--------------------------------------------------------------------------------------
+void NullRenderBackend::CullIndirect(const IndirectCullConstants& constants)
+{
+	m_IndirectArgs = m_IndirectTemplate;
+	m_Counters.ConstantUpdates++;
+	m_Counters.ConstantBytes += sizeof(constants) + m_IndirectArgs.size() * sizeof(IndirectDrawArgs);
+
+	m_IndirectVisible = 0;
+	if (!m_EmulateIndirect || m_IndirectArgs.empty())
+		return;
+
+	IndirectCullConstants clamped = constants;
+	if (clamped.ObjectCount > m_IndirectObjects.size())
+		clamped.ObjectCount = (uint32_t)m_IndirectObjects.size();
+	uint64_t start = GetTimeNs();
+	m_IndirectVisible = EmulateIndirectCull(clamped, m_IndirectObjects.empty() ? nullptr : &m_IndirectObjects[0],
+		&m_IndirectArgs[0], m_pIndirectInstances);
+	m_Counters.IndirectCullNs += GetTimeNs() - start;
+}
+
+void NullRenderBackend::DrawIndirect()
+{
+	m_Counters.IndirectCalls++;
+	for (size_t d = 0; d < m_IndirectArgs.size(); d++)
+	{
+		const IndirectDrawArgs& args = m_IndirectArgs[d];
+		DrawIndexedInstanced(args.IndexCountPerInstance, args.InstanceCount, args.StartIndexLocation,
+			args.BaseVertexLocation, args.StartInstanceLocation);
+	}
+}
@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// File: RenderBackend.h
+//
+// The few device calls the per-eye draw loop makes, behind an interface, so the
+// same submission code can run without a device.
+//
+// Shaders and materials are ids, set only when they change from the last
+// draw's, so the calls are the state changes.
+//
+// Instances are row-major world matrices, as XMMATRIX stores them, in one
+// buffer for the frame; DrawIndexedInstanced draws a range of it.
+//
+// NullRenderBackend does what a driver's CPU side has to do at minimum, copy
+// the constants somewhere, and counts everything, which is what the scene
+// benchmarks measure against.  Given the index buffer, it also counts vertex
+// shader invocations per eye through the same FIFO cache model as
+// AnalyzeVertexCache in MeshOptimize.h.
+//
+// Indirect draws are GPU driven, see IndirectDraw.h: the backend is handed the
+// objects once, culls them and fills the argument records itself each frame,
+// and draws them all per eye in one call.  NullRenderBackend runs the cull
+// pass with EmulateIndirectCull and counts the records' draws as the GPU would
+// execute them, with the time the pass took kept apart, since on a device it
+// isn't the CPU's.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "IndirectDraw.h"
+#include "StereoMath.h"
+
+
+class IRenderBackend
+{
+public:
+	virtual ~IRenderBackend() {}
+
+	virtual void BeginEye(uint32_t eye) = 0;
+	virtual void SetShader(uint32_t shader) = 0;
+	virtual void SetMaterial(uint32_t material) = 0;
+	virtual void UpdateConstants(const void* pData, size_t bytes) = 0;
+	virtual void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) = 0;
+	virtual void EndEye() = 0;
+
+	// Replaces the whole instance buffer, once per frame, before either eye.
+	virtual void UpdateInstances(const void* pData, size_t bytes) = 0;
+	virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount,
+		uint32_t startIndex, int32_t baseVertex, uint32_t startInstance) = 0;
+
+	// The objects and argument records from BuildIndirectScene, again whenever
+	// they change.  False if the backend can't draw indirect.
+	virtual bool SetIndirectScene(const IndirectObject* pObjects, uint32_t objectCount,
+		const IndirectDrawArgs* pArgs, uint32_t drawCount) = 0;
+
+	// Once per frame, before either eye, and DrawIndirect per eye after it.
+	virtual void CullIndirect(const IndirectCullConstants& constants) = 0;
+	virtual void DrawIndirect() = 0;
+};
+
+
+struct RenderBackendCounters
+{
+	uint64_t Draws;
+	uint64_t Indices;
+	uint64_t ShaderChanges;
+	uint64_t MaterialChanges;
+	uint64_t MeshChanges;				// Draws of a different range or base vertex than the last
+	uint64_t ConstantUpdates;
+	uint64_t ConstantBytes;
+	uint64_t Instances;			// Objects drawn, one per DrawIndexed
+	uint64_t InstanceUpdates;
+	uint64_t InstanceBytes;
+	uint64_t VertexInvocations;			// Only with SetIndices
+	uint64_t EyeVertexInvocations[2];
+	uint64_t IndirectCalls;				// Indirect draw calls, each drawing every record
+	uint64_t IndirectCullNs;			// EmulateIndirectCull, the GPU's work
+};
+
+
+class NullRenderBackend : public IRenderBackend
+{
+public:
+	// Constants land in a ring of this many bytes, like a driver's upload heap.
+	explicit NullRenderBackend(size_t ringBytes = 1 << 20);
+	~NullRenderBackend();
+
+	void BeginEye(uint32_t eye);
+	void SetShader(uint32_t shader);
+	void SetMaterial(uint32_t material);
+	void UpdateConstants(const void* pData, size_t bytes);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void EndEye();
+	void UpdateInstances(const void* pData, size_t bytes);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount,
+		uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	bool SetIndirectScene(const IndirectObject* pObjects, uint32_t objectCount,
+		const IndirectDrawArgs* pArgs, uint32_t drawCount);
+	void CullIndirect(const IndirectCullConstants& constants);
+	void DrawIndirect();
+
+	// On by default.  Off, CullIndirect only resets the records and they draw
+	// nothing, which leaves the CPU's part of an indirect frame to time.
+	void SetEmulateIndirect(bool emulate) { m_EmulateIndirect = emulate; }
+
+	// What the last CullIndirect wrote, for checking it.
+	const std::vector<IndirectDrawArgs>& IndirectArgs() const { return m_IndirectArgs; }
+	const SMMatrix* IndirectInstances() const { return m_pIndirectInstances; }
+	uint32_t IndirectVisible() const { return m_IndirectVisible; }
+
+	// The bound index buffer, which has to stay alive.  Null stops counting
+	// vertex shader invocations.
+	void SetIndices(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount);
+
+	const RenderBackendCounters& Counters() const { return m_Counters; }
+	void ResetCounters();
+	size_t MemoryBytes() const;
+
+private:
+	void CountVertexInvocations(uint32_t indexCount, uint32_t startIndex, uint64_t instanceCount);
+	void CountMeshChange(uint32_t startIndex, int32_t baseVertex);
+
+	NullRenderBackend(const NullRenderBackend&);
+	NullRenderBackend& operator=(const NullRenderBackend&);
+
+	std::vector<uint8_t> m_Ring;
+	std::vector<uint8_t> m_Instances;
+	size_t m_RingOffset;
+	uint32_t m_Eye;
+	RenderBackendCounters m_Counters;
+
+	const uint32_t* m_pIndices;
+	size_t m_IndexCount;
+	uint32_t m_VertexCount;
+	uint32_t m_LastStart;				// The last range simulated, which is usually the next
+	uint32_t m_LastCount;
+	uint64_t m_LastTransforms;
+
+	uint32_t m_DrawnStart;				// The last draw's, for MeshChanges
+	int32_t m_DrawnBaseVertex;
+
+	std::vector<IndirectObject> m_IndirectObjects;
+	std::vector<IndirectDrawArgs> m_IndirectTemplate;	// Instance counts 0
+	std::vector<IndirectDrawArgs> m_IndirectArgs;
+	SMMatrix* m_pIndirectInstances;
+	uint32_t m_IndirectVisible;
+	bool m_EmulateIndirect;
+};
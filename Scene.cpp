@@ -0,0 +1,164 @@
+//--------------------------------------------------------------------------------------
+// File: Scene.cpp
+//
+// Scene generators.
+//--------------------------------------------------------------------------------------
+
+#include "Scene.h"
+
+#include <math.h>
+
+
+const char* SceneLayoutName(SceneLayout layout)
+{
+	switch (layout)
+	{
+	case SCENE_GRID:	return "grid";
+	case SCENE_CLOUD:	return "cloud";
+	case SCENE_STACK:	return "stack";
+	default:			return "unknown";
+	}
+}
+
+SceneMesh CubeSceneMesh()
+{
+	SceneMesh mesh;
+	mesh.IndexCount = 36;
+	mesh.StartIndex = 0;
+	mesh.BaseVertex = 0;
+	mesh.VertexCount = 24;
+	mesh.Radius = 1.7320508f;
+	mesh.LodCount = 1;
+	mesh.LodError = 0.0f;
+	return mesh;
+}
+
+uint64_t Scene::TriangleCount() const
+{
+	uint64_t triangles = 0;
+	for (size_t i = 0; i < Objects.size(); i++)
+		triangles += Meshes[Objects[i].Mesh].IndexCount / 3;
+	return triangles;
+}
+
+size_t Scene::MemoryBytes() const
+{
+	return Meshes.capacity() * sizeof(SceneMesh) + Materials.capacity() * sizeof(SceneMaterial) + Objects.capacity() * sizeof(SceneObject) +
+		(Bounds.CenterX.capacity() + Bounds.CenterY.capacity() + Bounds.CenterZ.capacity() + Bounds.Radius.capacity()) * sizeof(float);
+}
+
+//--------------------------------------------------------------------------------------
+// The sphere is around the object's origin, so it holds whatever the rotation.
+//--------------------------------------------------------------------------------------
+void Scene::UpdateBounds()
+{
+	size_t count = Objects.size();
+	size_t padded = (count + 3) & ~(size_t)3;
+	Bounds.CenterX.assign(padded, 0.0f);
+	Bounds.CenterY.assign(padded, 0.0f);
+	Bounds.CenterZ.assign(padded, 0.0f);
+	Bounds.Radius.assign(padded, -1.0f);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const SceneObject& object = Objects[i];
+		Bounds.CenterX[i] = object.Position[0];
+		Bounds.CenterY[i] = object.Position[1];
+		Bounds.CenterZ[i] = object.Position[2];
+		Bounds.Radius[i] = Meshes[object.Mesh].Radius * object.Scale;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Small, fast, and the same everywhere, unlike rand().
+//--------------------------------------------------------------------------------------
+static float NextRandom(uint32_t* pState)
+{
+	uint32_t x = *pState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*pState = x;
+	return (float)(x >> 8) / 16777216.0f;
+}
+
+//--------------------------------------------------------------------------------------
+// Everything is centered on the point the sample's camera looks at, (0, 1, 0),
+// and spaced in units of the cube, which is 2 wide.
+//--------------------------------------------------------------------------------------
+void GenerateScene(SceneLayout layout, uint32_t count, uint32_t seed, Scene* pScene)
+{
+	pScene->Meshes.clear();
+	pScene->Meshes.push_back(CubeSceneMesh());
+	pScene->Materials.clear();
+	SceneMaterial material = { 0 };
+	pScene->Materials.push_back(material);
+	pScene->Objects.clear();
+	pScene->Objects.reserve(count);
+
+	uint32_t random = seed ? seed : 1;
+	uint32_t side = (uint32_t)ceil(pow((double)count, 1.0 / 3.0));
+	if (side == 0)
+		side = 1;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		SceneObject object;
+		object.Scale = 1.0f;
+		object.Phase = NextRandom(&random) * 6.2831853f;
+		object.Mesh = 0;
+		object.Material = 0;
+
+		switch (layout)
+		{
+		case SCENE_GRID:
+		{
+			float spacing = 3.0f;
+			float offset = 0.5f * spacing * (float)(side - 1);
+			object.Position[0] = (float)(i % side) * spacing - offset;
+			object.Position[1] = (float)((i / side) % side) * spacing - offset + 1.0f;
+			object.Position[2] = (float)(i / (side * side)) * spacing - offset;
+			break;
+		}
+
+		case SCENE_CLOUD:
+		{
+			// Same volume as the grid, rejection sampled in a sphere.
+			float radius = 1.5f * (float)side * 1.24f;
+			float x, y, z;
+			do
+			{
+				x = NextRandom(&random) * 2.0f - 1.0f;
+				y = NextRandom(&random) * 2.0f - 1.0f;
+				z = NextRandom(&random) * 2.0f - 1.0f;
+			} while (x * x + y * y + z * z > 1.0f);
+			object.Position[0] = x * radius;
+			object.Position[1] = y * radius + 1.0f;
+			object.Position[2] = z * radius;
+			object.Scale = 0.5f + NextRandom(&random);
+			break;
+		}
+
+		case SCENE_STACK:
+		default:
+		{
+			// Columns of 64 along z, a quarter cube apart, columns on a square grid.
+			const uint32_t depth = 64;
+			uint32_t column = i / depth;
+			uint32_t columns = (count + depth - 1) / depth;
+			uint32_t columnSide = (uint32_t)ceil(sqrt((double)columns));
+			float spacing = 2.5f;
+			float offset = 0.5f * spacing * (float)(columnSide - 1);
+			object.Position[0] = (float)(column % columnSide) * spacing - offset;
+			object.Position[1] = (float)(column / columnSide) * spacing - offset + 1.0f;
+			object.Position[2] = (float)(i % depth) * 0.25f;
+			break;
+		}
+		}
+
+		pScene->Objects.push_back(object);
+	}
+
+	pScene->UpdateBounds();
+}
@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------
+// File: Scene.h
+//
+// Procedural scenes of many copies of the cube, for finding out how the stereo
+// path scales past the one cube the sample draws.
+//
+// Grid is a regular 3D block, the best case for everything.  Cloud is random
+// positions in a sphere, nothing lines up.  Stack is columns of cubes a
+// fraction of a cube apart along the view direction, so nearly everything
+// overlaps, the worst case for overdraw and anything depth related.
+//
+// Generation is deterministic for a given seed, so the same scene comes out on
+// every machine and every commit.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+
+enum SceneLayout
+{
+	SCENE_GRID = 0,
+	SCENE_CLOUD,
+	SCENE_STACK,
+	SCENE_LAYOUT_COUNT
+};
+
+const char* SceneLayoutName(SceneLayout layout);
+
+
+// A range of the shared index buffer, what one DrawIndexed draws.  A mesh with
+// LODs is followed by its coarser ones, each a mesh of its own, so a LOD is
+// drawn the same way as any other mesh.
+struct SceneMesh
+{
+	uint32_t IndexCount;
+	uint32_t StartIndex;
+	int32_t BaseVertex;
+	uint32_t VertexCount;
+	float Radius;			// Bounding sphere about the mesh origin
+	uint32_t LodCount;		// This mesh and the coarser ones after it, 1 without LODs
+	float LodError;			// MeshLod::Error, 0 for the finest
+};
+
+// The 24 vertex, 36 index cube from InitDevice().
+SceneMesh CubeSceneMesh();
+
+
+// What a draw binds besides the mesh, ids for the backend's own tables.
+struct SceneMaterial
+{
+	uint32_t Shader;
+};
+
+
+struct SceneObject
+{
+	float Position[3];
+	float Scale;
+	float Phase;			// Added to the rotation angle, so the cubes don't all spin in step
+	uint32_t Mesh;
+	uint32_t Material;
+};
+
+
+// Bounding spheres of the objects, SoA and padded to a multiple of four for
+// StereoCull.  The padding has a negative radius, so it is never visible.
+struct SceneBounds
+{
+	std::vector<float> CenterX;
+	std::vector<float> CenterY;
+	std::vector<float> CenterZ;
+	std::vector<float> Radius;
+};
+
+
+struct Scene
+{
+	std::vector<SceneMesh> Meshes;
+	std::vector<SceneMaterial> Materials;
+	std::vector<SceneObject> Objects;
+	SceneBounds Bounds;
+
+	uint64_t TriangleCount() const;
+	size_t MemoryBytes() const;
+
+	// After objects move or change size.  GenerateScene does it.
+	void UpdateBounds();
+};
+
+// One mesh, the cube, and one material.
+void GenerateScene(SceneLayout layout, uint32_t count, uint32_t seed, Scene* pScene);
@@ -0,0 +1,384 @@
+//--------------------------------------------------------------------------------------
+// File: SceneRenderer.cpp
+//
+// Stereo submission of a Scene.
+//--------------------------------------------------------------------------------------
+
+#include "SceneRenderer.h"
+#include "AlignedAlloc.h"
+#include "StereoCull.h"
+#include "Timing.h"
+
+#include <math.h>
+#include <string.h>
+
+
+StereoView DefaultStereoView(float aspect)
+{
+	StereoView view;
+
+	// What InitDevice() builds with DirectXMath.
+	const float eye[3] = { 0.0f, 3.0f, -6.0f };
+	const float at[3] = { 0.0f, 1.0f, 0.0f };
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	view.View = StereoLookAtLH(eye, at, up);
+	view.Projection = StereoPerspectiveFovLH(0.785398163f, aspect, 0.01f, 100.0f);
+
+	// 6cm between the eyes, 15% separation, convergence 4, as RenderFrame() computes them.
+	view.Separation = 6.0f * 15.0f / 100.0f;
+	view.Convergence = view.Separation * 4.0f;
+	return view;
+}
+
+
+const char* SceneSubmitModeName(SceneSubmitMode mode)
+{
+	switch (mode)
+	{
+	case SCENE_SUBMIT_INSTANCED:	return "instanced";
+	case SCENE_SUBMIT_SORTED:		return "sorted";
+	case SCENE_SUBMIT_INDIRECT:		return "indirect";
+	default:						return "per-object";
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sets what differs from the last draw's, both UINT32_MAX at the start of an
+// eye.
+//--------------------------------------------------------------------------------------
+static void SetDrawState(uint32_t shader, uint32_t material, uint32_t* pShader, uint32_t* pMaterial,
+	IRenderBackend* pBackend)
+{
+	if (shader != *pShader)
+	{
+		pBackend->SetShader(shader);
+		*pShader = shader;
+	}
+	if (material != *pMaterial)
+	{
+		pBackend->SetMaterial(material);
+		*pMaterial = material;
+	}
+}
+
+
+SceneRenderer::SceneRenderer()
+{
+	m_Mode = SCENE_SUBMIT_PER_OBJECT;
+	m_pWorld = nullptr;
+	m_Capacity = 0;
+	m_pInstances = nullptr;
+	m_InstanceCapacity = 0;
+	m_pInstanceData = nullptr;
+	m_Culling = false;
+	m_pCullIndex = nullptr;
+	m_DrawCount = 0;
+	memset(&m_CullStats, 0, sizeof(m_CullStats));
+	m_LodEnabled = false;
+	m_pSortPool = nullptr;
+	m_pIndirectScene = nullptr;
+	m_pIndirectBackend = nullptr;
+	m_IndirectReady = false;
+}
+
+SceneRenderer::~SceneRenderer()
+{
+	AlignedFree(m_pWorld);
+	AlignedFree(m_pInstances);
+}
+
+size_t SceneRenderer::MemoryBytes() const
+{
+	return (m_Capacity + m_InstanceCapacity) * sizeof(SMMatrix) + m_Ranges.capacity() * sizeof(SceneInstanceRange) +
+		m_Visible.capacity() * sizeof(uint32_t) + m_DrawMeshes.capacity() * sizeof(uint32_t) + m_Lod.MemoryBytes() +
+		m_Queue.MemoryBytes() + m_IndirectObjects.capacity() * sizeof(IndirectObject) +
+		m_IndirectArgs.capacity() * sizeof(IndirectDrawArgs);
+}
+
+//--------------------------------------------------------------------------------------
+// One test for both eyes against their union frustum, so the visible list is
+// shared by both.
+//--------------------------------------------------------------------------------------
+void SceneRenderer::Cull(const Scene& scene, const StereoView& view)
+{
+	uint64_t start = GetTimeNs();
+
+	uint32_t count = (uint32_t)scene.Objects.size();
+	m_Visible.resize(scene.Bounds.Radius.size());
+
+	// Bounds out of date, so nothing can be culled.
+	if (scene.Bounds.Radius.size() < count)
+	{
+		m_Visible.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+			m_Visible[i] = i;
+		m_DrawCount = count;
+		m_CullStats.Total = count;
+		m_CullStats.Visible = count;
+		m_CullStats.CullNs = GetTimeNs() - start;
+		return;
+	}
+
+	StereoFrustum frustum;
+	BuildStereoUnionFrustum(view.View, view.Projection, view.Separation, view.Convergence, &frustum);
+	if (m_pCullIndex && m_pCullIndex->ObjectCount() == count && count > 0)
+		m_DrawCount = m_pCullIndex->QueryFrustum(frustum, &m_Visible[0]);
+	else
+		m_DrawCount = count ? StereoCullSpheresSIMD(frustum, &scene.Bounds.CenterX[0], &scene.Bounds.CenterY[0],
+			&scene.Bounds.CenterZ[0], &scene.Bounds.Radius[0], count, &m_Visible[0]) : 0;
+
+	m_CullStats.Total = count;
+	m_CullStats.Visible = m_DrawCount;
+	m_CullStats.CullNs = GetTimeNs() - start;
+}
+
+//--------------------------------------------------------------------------------------
+// Scale, spin about y like the sample's cube, then translate.  The product is
+// written out directly rather than multiplying three matrices.  Only for the
+// objects being drawn, in draw order, or sorted the queue's order.
+//--------------------------------------------------------------------------------------
+void SceneRenderer::BuildWorldMatrices(const Scene& scene, float time)
+{
+	size_t count = m_DrawCount;
+	if (count > m_Capacity)
+	{
+		AlignedFree(m_pWorld);
+		m_pWorld = static_cast<SMMatrix*>(AlignedAlloc(count * sizeof(SMMatrix), 16));
+		m_Capacity = count;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t draw = (m_Mode == SCENE_SUBMIT_SORTED) ? m_Queue.Value((uint32_t)i) : i;
+		const SceneObject& object = scene.Objects[DrawnObject(draw)];
+		float s = sinf(time + object.Phase) * object.Scale;
+		float c = cosf(time + object.Phase) * object.Scale;
+
+		SMMatrix& world = m_pWorld[i];
+		world.m[0][0] = c;    world.m[0][1] = 0.0f;         world.m[0][2] = -s;   world.m[0][3] = 0.0f;
+		world.m[1][0] = 0.0f; world.m[1][1] = object.Scale; world.m[1][2] = 0.0f; world.m[1][3] = 0.0f;
+		world.m[2][0] = s;    world.m[2][1] = 0.0f;         world.m[2][2] = c;    world.m[2][3] = 0.0f;
+		world.m[3][0] = object.Position[0];
+		world.m[3][1] = object.Position[1];
+		world.m[3][2] = object.Position[2];
+		world.m[3][3] = 1.0f;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Groups the world matrices by mesh, a counting sort, so each mesh is one range.
+// The usual scene is all one mesh, and then the world matrices are used as is.
+//--------------------------------------------------------------------------------------
+void SceneRenderer::BuildInstances(const Scene& scene)
+{
+	size_t count = m_DrawCount;
+	m_Ranges.clear();
+	if (scene.Meshes.size() == 1)
+	{
+		SceneInstanceRange range = { 0, 0, (uint32_t)count };
+		if (count)
+			m_Ranges.push_back(range);
+		m_pInstanceData = m_pWorld;
+		return;
+	}
+
+	if (count > m_InstanceCapacity)
+	{
+		AlignedFree(m_pInstances);
+		m_pInstances = static_cast<SMMatrix*>(AlignedAlloc(count * sizeof(SMMatrix), 16));
+		m_InstanceCapacity = count;
+	}
+
+	std::vector<uint32_t> next(scene.Meshes.size(), 0);
+	for (size_t i = 0; i < count; i++)
+		next[DrawnMesh(scene, i)]++;
+
+	uint32_t start = 0;
+	for (uint32_t mesh = 0; mesh < (uint32_t)next.size(); mesh++)
+	{
+		SceneInstanceRange range = { mesh, start, next[mesh] };
+		if (range.InstanceCount)
+			m_Ranges.push_back(range);
+		next[mesh] = start;
+		start += range.InstanceCount;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		m_pInstances[next[DrawnMesh(scene, i)]++] = m_pWorld[i];
+	m_pInstanceData = m_pInstances;
+}
+
+//--------------------------------------------------------------------------------------
+// Depth is along the view's z, of the object's origin.
+//--------------------------------------------------------------------------------------
+void SceneRenderer::BuildSortedDraws(const Scene& scene, const StereoView& view)
+{
+	const SMMatrix& v = view.View;
+	m_Queue.Clear();
+	m_Queue.Reserve(m_DrawCount);
+	for (uint32_t i = 0; i < m_DrawCount; i++)
+	{
+		const SceneObject& object = scene.Objects[DrawnObject(i)];
+		const float* p = object.Position;
+		float depth = p[0] * v.m[0][2] + p[1] * v.m[1][2] + p[2] * v.m[2][2] + v.m[3][2];
+		uint32_t shader = scene.Materials.empty() ? 0 : scene.Materials[object.Material].Shader;
+		m_Queue.Add(MakeDrawKey(shader, object.Material, DrawnMesh(scene, i), depth), i);
+	}
+	m_Queue.Sort(m_pSortPool);
+}
+
+//--------------------------------------------------------------------------------------
+// The CPU's part of an indirect frame: the frustum and the time for the cull
+// pass, and the objects when they're new to the backend.
+//--------------------------------------------------------------------------------------
+void SceneRenderer::PrepareIndirect(const Scene& scene, const StereoView& view, float time, IRenderBackend* pBackend)
+{
+	uint64_t start = GetTimeNs();
+	uint32_t count = (uint32_t)scene.Objects.size();
+	if (m_pIndirectScene != &scene || m_pIndirectBackend != pBackend || m_IndirectObjects.size() != count)
+	{
+		BuildIndirectScene(scene, &m_IndirectObjects, &m_IndirectArgs);
+		m_IndirectReady = count > 0 && pBackend->SetIndirectScene(&m_IndirectObjects[0], count,
+			&m_IndirectArgs[0], (uint32_t)m_IndirectArgs.size());
+		m_pIndirectScene = &scene;
+		m_pIndirectBackend = pBackend;
+	}
+
+	IndirectCullConstants constants;
+	memset(&constants, 0, sizeof(constants));
+	BuildStereoUnionFrustum(view.View, view.Projection, view.Separation, view.Convergence, &constants.Frustum);
+	constants.Time = time;
+	constants.ObjectCount = count;
+	if (m_IndirectReady)
+		pBackend->CullIndirect(constants);
+
+	m_DrawCount = 0;
+	m_CullStats.Total = count;
+	m_CullStats.Visible = count;
+	m_CullStats.CullNs = GetTimeNs() - start;
+}
+
+void SceneRenderer::PrepareFrame(const Scene& scene, const StereoView& view, float time, SceneSubmitMode mode,
+	IRenderBackend* pBackend)
+{
+	m_Mode = mode;
+	if (mode == SCENE_SUBMIT_INDIRECT)
+	{
+		PrepareIndirect(scene, view, time, pBackend);
+		return;
+	}
+
+	if (m_Culling)
+	{
+		Cull(scene, view);
+	}
+	else
+	{
+		m_DrawCount = (uint32_t)scene.Objects.size();
+		m_CullStats.Total = m_DrawCount;
+		m_CullStats.Visible = m_DrawCount;
+		m_CullStats.CullNs = 0;
+	}
+
+	// One pick per object for both eyes.
+	if (m_LodEnabled)
+	{
+		m_DrawMeshes.resize(m_DrawCount);
+		if (m_DrawCount)
+			m_Lod.Select(scene, view.View, view.Projection, m_Culling ? &m_Visible[0] : nullptr, m_DrawCount, &m_DrawMeshes[0]);
+	}
+
+	// Sorted first, so the world matrices come out in the order they're drawn.
+	if (mode == SCENE_SUBMIT_SORTED)
+		BuildSortedDraws(scene, view);
+
+	BuildWorldMatrices(scene, time);
+
+	if (mode == SCENE_SUBMIT_INSTANCED)
+	{
+		BuildInstances(scene);
+		pBackend->UpdateInstances(m_pInstanceData, m_DrawCount * sizeof(SMMatrix));
+	}
+}
+
+void SceneRenderer::DrawEye(const Scene& scene, const StereoView& view, uint32_t eye, IRenderBackend* pBackend)
+{
+	SMSharedCB cb;
+	cb.View = StereoMathSIMD::Transpose(view.View);
+
+	SMMatrix projection = view.Projection;
+	StereoProjectionEdit(&projection, eye ? 1.0f : -1.0f, view.Separation, view.Convergence);
+	cb.Projection = StereoMathSIMD::Transpose(projection);
+
+	// One call for every mesh's instances, as the cull pass left them.
+	if (m_Mode == SCENE_SUBMIT_INDIRECT)
+	{
+		cb.World = StereoMathScalar::Identity();
+		pBackend->UpdateConstants(&cb, sizeof(cb));
+		if (m_IndirectReady)
+			pBackend->DrawIndirect();
+		return;
+	}
+
+	if (m_Mode == SCENE_SUBMIT_INSTANCED)
+	{
+		// World comes from the instance, this one is unused.
+		cb.World = StereoMathScalar::Identity();
+		pBackend->UpdateConstants(&cb, sizeof(cb));
+		for (size_t r = 0; r < m_Ranges.size(); r++)
+		{
+			const SceneInstanceRange& range = m_Ranges[r];
+			const SceneMesh& mesh = scene.Meshes[range.Mesh];
+			pBackend->DrawIndexedInstanced(mesh.IndexCount, range.InstanceCount, mesh.StartIndex, mesh.BaseVertex, range.StartInstance);
+		}
+		return;
+	}
+
+	// A scene without materials sets no state.
+	bool state = !scene.Materials.empty();
+	uint32_t shader = UINT32_MAX;
+	uint32_t material = UINT32_MAX;
+
+	// Sorted replays the queue, where the keys have the state and the mesh.
+	if (m_Mode == SCENE_SUBMIT_SORTED)
+	{
+		for (uint32_t n = 0; n < m_DrawCount; n++)
+		{
+			uint64_t key = m_Queue.Key(n);
+			if (state)
+				SetDrawState(DrawKeyShader(key), DrawKeyMaterial(key), &shader, &material, pBackend);
+			const SceneMesh& mesh = scene.Meshes[DrawKeyMesh(key)];
+			cb.World = StereoMathSIMD::Transpose(m_pWorld[n]);
+			pBackend->UpdateConstants(&cb, sizeof(cb));
+			pBackend->DrawIndexed(mesh.IndexCount, mesh.StartIndex, mesh.BaseVertex);
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < m_DrawCount; i++)
+	{
+		if (state)
+		{
+			uint32_t objectMaterial = scene.Objects[DrawnObject(i)].Material;
+			SetDrawState(scene.Materials[objectMaterial].Shader, objectMaterial, &shader, &material, pBackend);
+		}
+		const SceneMesh& mesh = scene.Meshes[DrawnMesh(scene, i)];
+		cb.World = StereoMathSIMD::Transpose(m_pWorld[i]);
+		pBackend->UpdateConstants(&cb, sizeof(cb));
+		pBackend->DrawIndexed(mesh.IndexCount, mesh.StartIndex, mesh.BaseVertex);
+	}
+}
+
+void SceneRenderer::Submit(const Scene& scene, const StereoView& view, float time, IRenderBackend* pBackend,
+	SceneSubmitMode mode)
+{
+	PrepareFrame(scene, view, time, mode, pBackend);
+
+	for (uint32_t eye = 0; eye < 2; eye++)
+	{
+		pBackend->BeginEye(eye);
+		DrawEye(scene, view, eye, pBackend);
+		pBackend->EndEye();
+	}
+}
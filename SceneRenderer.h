@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------
+// File: SceneRenderer.h
+//
+// Draws a Scene in stereo the way Render() draws the cube.  World matrices are
+// built once per frame and shared by both eyes, the view and eye projections
+// once per eye.
+//
+// Per object is what Render() does: per eye, per object, update SharedCB and
+// DrawIndexed, so 2 * objects constant updates and draws a frame.  Instanced
+// uploads every world matrix once per frame into the instance buffer, and then
+// per eye updates SharedCB once and makes one DrawIndexedInstanced per mesh.
+// The instance matrices go up untransposed, VSInstanced in Tutorial07.fx
+// builds the matrix from its rows.  Instanced draws ignore materials, it is
+// for scenes of one.
+//
+// Per object sets the shader and material whenever an object's differ from
+// the one drawn before, so a scene of mixed materials in object order changes
+// state nearly every draw.  Sorted draws per object too, but in the order of
+// a DrawQueue sorted once per frame, see DrawQueue.h, which both eyes replay.
+//
+// With culling on, objects are first tested against the union of both eyes'
+// frusta, see StereoCull.h, and only the visible ones get world matrices and
+// draws.  Given a Bvh over the scene's bounds, the cull walks that instead of
+// testing every object.
+//
+// With LOD on, each drawn object's LOD is picked once in PrepareFrame, see
+// StereoLod.h, and both eyes draw it.
+//
+// Indirect hands the culling, the world matrices and the draw arguments to
+// the GPU, see IndirectDraw.h.  The objects go to the backend the first frame
+// and again when the scene or its object count changes, after that a frame
+// is one cull pass and one indirect call per eye whatever the object count.
+// The cull is always on and the CPU never learns what passed, so the cull
+// stats count every object visible, and LOD and materials are ignored.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <vector>
+
+#include "Bvh.h"
+#include "DrawQueue.h"
+#include "IndirectDraw.h"
+#include "RenderBackend.h"
+#include "Scene.h"
+#include "StereoLod.h"
+#include "StereoMath.h"
+
+
+struct StereoView
+{
+	SMMatrix View;
+	SMMatrix Projection;		// Mono, the per-eye edits are made while drawing
+	float Separation;
+	float Convergence;
+};
+
+// The camera InitDevice() sets up, with the driver's default stereo settings.
+StereoView DefaultStereoView(float aspect);
+
+
+enum SceneSubmitMode
+{
+	SCENE_SUBMIT_PER_OBJECT = 0,
+	SCENE_SUBMIT_INSTANCED,
+	SCENE_SUBMIT_SORTED,
+	SCENE_SUBMIT_INDIRECT
+};
+
+const char* SceneSubmitModeName(SceneSubmitMode mode);
+
+
+struct SceneCullStats
+{
+	uint32_t Total;
+	uint32_t Visible;
+	uint64_t CullNs;		// Frustum setup and the tests
+};
+
+
+// The instances of one mesh, a range of the instance buffer.
+struct SceneInstanceRange
+{
+	uint32_t Mesh;
+	uint32_t StartInstance;
+	uint32_t InstanceCount;
+};
+
+
+class SceneRenderer
+{
+public:
+	SceneRenderer();
+	~SceneRenderer();
+
+	// Off by default.
+	void SetCulling(bool culling) { m_Culling = culling; }
+	bool GetCulling() const { return m_Culling; }
+
+	// Built over scene.Bounds, and kept up to date by the caller.  Ignored if
+	// it covers a different number of objects than the scene has.
+	void SetCullIndex(const Bvh* pIndex) { m_pCullIndex = pIndex; }
+
+	// Off by default, when every object draws its own mesh.
+	void SetLod(bool lod) { m_LodEnabled = lod; }
+	bool GetLod() const { return m_LodEnabled; }
+	void SetLodConfig(const StereoLodConfig& config) { m_Lod.SetConfig(config); }
+
+	// Sorted sorts on these threads, null on the caller's.
+	void SetSortPool(WorkerPool* pPool) { m_pSortPool = pPool; }
+
+	// Once per frame before either eye.  Culls, and instanced uploads the
+	// instances here.
+	void PrepareFrame(const Scene& scene, const StereoView& view, float time, SceneSubmitMode mode,
+		IRenderBackend* pBackend);
+
+	// eye is 0 for left, 1 for right.  Leaves BeginEye and EndEye to the caller.
+	void DrawEye(const Scene& scene, const StereoView& view, uint32_t eye, IRenderBackend* pBackend);
+
+	// The whole frame, both eyes.
+	void Submit(const Scene& scene, const StereoView& view, float time, IRenderBackend* pBackend,
+		SceneSubmitMode mode = SCENE_SUBMIT_PER_OBJECT);
+
+	const std::vector<SceneInstanceRange>& InstanceRanges() const { return m_Ranges; }
+	const SceneCullStats& CullStats() const { return m_CullStats; }
+	const StereoLodStats& LodStats() const { return m_Lod.Stats(); }
+	const DrawQueue& SortedDraws() const { return m_Queue; }
+
+	size_t MemoryBytes() const;
+
+private:
+	SceneRenderer(const SceneRenderer&);
+	SceneRenderer& operator=(const SceneRenderer&);
+
+	void Cull(const Scene& scene, const StereoView& view);
+	void BuildWorldMatrices(const Scene& scene, float time);
+	void BuildInstances(const Scene& scene);
+	void BuildSortedDraws(const Scene& scene, const StereoView& view);
+	void PrepareIndirect(const Scene& scene, const StereoView& view, float time, IRenderBackend* pBackend);
+
+	// Object index of the i'th draw.
+	uint32_t DrawnObject(size_t i) const { return m_Culling ? m_Visible[i] : (uint32_t)i; }
+
+	// Scene mesh of the i'th draw, its LOD's with LOD on.
+	uint32_t DrawnMesh(const Scene& scene, size_t i) const
+	{
+		return m_LodEnabled ? m_DrawMeshes[i] : scene.Objects[DrawnObject(i)].Mesh;
+	}
+
+	SceneSubmitMode m_Mode;
+	bool m_Culling;
+	const Bvh* m_pCullIndex;
+	std::vector<uint32_t> m_Visible;
+	uint32_t m_DrawCount;
+	SceneCullStats m_CullStats;
+
+	bool m_LodEnabled;
+	StereoLodSelector m_Lod;
+	std::vector<uint32_t> m_DrawMeshes;		// In draw order, with LOD on
+
+	// Values are draw indices.  Shader, material and mesh ids have to fit
+	// their bits of the key.
+	DrawQueue m_Queue;
+	WorkerPool* m_pSortPool;
+
+	// World matrices in draw order, one per drawn object, sorted in the
+	// queue's order.
+	SMMatrix* m_pWorld;
+	size_t m_Capacity;
+
+	// Only used when the scene has more than one mesh, otherwise m_pWorld is already in order.
+	SMMatrix* m_pInstances;
+	size_t m_InstanceCapacity;
+	const SMMatrix* m_pInstanceData;
+	std::vector<SceneInstanceRange> m_Ranges;
+
+	// What the backend was last given for indirect, and for which scene.
+	std::vector<IndirectObject> m_IndirectObjects;
+	std::vector<IndirectDrawArgs> m_IndirectArgs;
+	const Scene* m_pIndirectScene;
+	IRenderBackend* m_pIndirectBackend;
+	bool m_IndirectReady;
+};
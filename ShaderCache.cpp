@@ -0,0 +1,299 @@
+//--------------------------------------------------------------------------------------
+// File: ShaderCache.cpp
+//
+// The shader archive: keys, lookup and writing.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include "Timing.h"
+
+
+static_assert(sizeof(ShaderCacheHeader) == 32, "ShaderCacheHeader is written to files as is");
+static_assert(sizeof(ShaderCacheEntry) == 104, "ShaderCacheEntry is written to files as is");
+
+uint64_t HashShaderBytes(const void* pData, size_t bytes, uint64_t seed)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(pData);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		hash ^= p[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+// Hash is of the key's bytes after it, which MakeShaderCacheKey zeroes first.
+static uint64_t HashKey(const ShaderCacheKey& key)
+{
+	return HashShaderBytes(&key.SourceHash, sizeof(key) - sizeof(key.Hash));
+}
+
+bool MakeShaderCacheKey(const void* pSource, size_t sourceBytes, const char* defines, uint32_t flags,
+	const char* entryPoint, const char* target, uint32_t compilerVersion, ShaderCacheKey* pKey)
+{
+	memset(pKey, 0, sizeof(*pKey));
+	if (strlen(entryPoint) >= sizeof(pKey->EntryPoint) || strlen(target) >= sizeof(pKey->Target))
+		return false;
+
+	pKey->SourceHash = HashShaderBytes(pSource, sourceBytes);
+	pKey->OptionsHash = HashShaderBytes(&flags, sizeof(flags), HashShaderBytes(defines, strlen(defines)));
+	pKey->CompilerVersion = compilerVersion;
+	strcpy(pKey->EntryPoint, entryPoint);
+	strcpy(pKey->Target, target);
+	pKey->Hash = HashKey(*pKey);
+	return true;
+}
+
+static bool SameKey(const ShaderCacheKey& a, const ShaderCacheKey& b)
+{
+	return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// The same shader from another source or compiler, which a new entry replaces.
+static bool SameSlot(const ShaderCacheKey& a, const ShaderCacheKey& b)
+{
+	return a.OptionsHash == b.OptionsHash && strcmp(a.EntryPoint, b.EntryPoint) == 0 && strcmp(a.Target, b.Target) == 0;
+}
+
+static uint64_t AlignUp(uint64_t offset)
+{
+	return (offset + kShaderCacheAlignment - 1) & ~(uint64_t)(kShaderCacheAlignment - 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ShaderCache
+//--------------------------------------------------------------------------------------
+ShaderCache::ShaderCache()
+{
+	m_pEntries = nullptr;
+	m_EntryCount = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool ShaderCache::Open(const char* path, std::string* pError)
+{
+	Close();
+	if (!m_File.Open(path))
+	{
+		if (pError)
+			*pError = "no archive";
+		return false;
+	}
+	if (!Parse(pError))
+	{
+		m_File.Close();
+		return false;
+	}
+	return true;
+}
+
+void ShaderCache::Close()
+{
+	m_File.Close();
+	m_pEntries = nullptr;
+	m_EntryCount = 0;
+	m_Added.clear();
+}
+
+static bool Fail(std::string* pError, const char* message)
+{
+	if (pError)
+		*pError = message;
+	return false;
+}
+
+// Whether [offset, offset + bytes) is inside the file, without overflowing.
+static bool InFile(uint64_t offset, uint64_t bytes, uint64_t fileBytes)
+{
+	return offset <= fileBytes && bytes <= fileBytes - offset;
+}
+
+bool ShaderCache::Parse(std::string* pError)
+{
+	if (m_File.Size() < sizeof(ShaderCacheHeader))
+		return Fail(pError, "too small for a shader archive");
+
+	const uint8_t* pBase = static_cast<const uint8_t*>(m_File.Data());
+	const ShaderCacheHeader* pHeader = reinterpret_cast<const ShaderCacheHeader*>(pBase);
+	if (pHeader->Magic != kShaderCacheMagic)
+		return Fail(pError, "not a shader archive");
+	if (pHeader->Version != kShaderCacheVersion)
+		return Fail(pError, "unsupported shader archive version");
+	if (pHeader->HeaderBytes < sizeof(ShaderCacheHeader) || pHeader->FileBytes > m_File.Size())
+		return Fail(pError, "truncated");
+
+	uint64_t fileBytes = pHeader->FileBytes;
+	if ((pHeader->EntryOffset & (sizeof(uint64_t) - 1)) != 0 ||
+		!InFile(pHeader->EntryOffset, (uint64_t)pHeader->EntryCount * sizeof(ShaderCacheEntry), fileBytes))
+		return Fail(pError, "table outside the file");
+
+	const ShaderCacheEntry* pEntries = reinterpret_cast<const ShaderCacheEntry*>(pBase + pHeader->EntryOffset);
+	for (uint32_t e = 0; e < pHeader->EntryCount; e++)
+	{
+		const ShaderCacheEntry& entry = pEntries[e];
+		if (entry.Key.Hash != HashKey(entry.Key) ||
+			entry.Key.EntryPoint[sizeof(entry.Key.EntryPoint) - 1] != 0 || entry.Key.Target[sizeof(entry.Key.Target) - 1] != 0)
+			return Fail(pError, "bad key");
+		if (e > 0 && entry.Key.Hash < pEntries[e - 1].Key.Hash)
+			return Fail(pError, "table out of order");
+		if ((entry.Offset & (kShaderCacheAlignment - 1)) != 0 || !InFile(entry.Offset, entry.Bytes, fileBytes))
+			return Fail(pError, "bytecode outside the file");
+	}
+
+	m_pEntries = pEntries;
+	m_EntryCount = pHeader->EntryCount;
+	return true;
+}
+
+const ShaderCacheEntry* ShaderCache::FindMapped(const ShaderCacheKey& key) const
+{
+	uint32_t first = 0;
+	uint32_t count = m_EntryCount;
+	while (count > 0)
+	{
+		uint32_t half = count / 2;
+		if (m_pEntries[first + half].Key.Hash < key.Hash)
+		{
+			first += half + 1;
+			count -= half + 1;
+		}
+		else
+			count = half;
+	}
+	for (uint32_t e = first; e < m_EntryCount && m_pEntries[e].Key.Hash == key.Hash; e++)
+		if (SameKey(m_pEntries[e].Key, key))
+			return &m_pEntries[e];
+	return nullptr;
+}
+
+const void* ShaderCache::Find(const ShaderCacheKey& key, size_t* pBytes)
+{
+	uint64_t startNs = GetTimeNs();
+	const void* pData = nullptr;
+	uint64_t compileNs = 0;
+
+	for (size_t a = 0; a < m_Added.size() && !pData; a++)
+	{
+		if (SameKey(m_Added[a].Key, key))
+		{
+			pData = &m_Added[a].Bytecode[0];
+			*pBytes = m_Added[a].Bytecode.size();
+			compileNs = m_Added[a].CompileNs;
+		}
+	}
+	if (!pData)
+	{
+		const ShaderCacheEntry* pEntry = FindMapped(key);
+		if (pEntry)
+		{
+			pData = static_cast<const uint8_t*>(m_File.Data()) + pEntry->Offset;
+			*pBytes = (size_t)pEntry->Bytes;
+			compileNs = pEntry->CompileNs;
+		}
+	}
+
+	if (pData)
+	{
+		m_Stats.Hits++;
+		m_Stats.HitCompileNs += compileNs;
+	}
+	else
+		m_Stats.Misses++;
+	m_Stats.FindNs += GetTimeNs() - startNs;
+	return pData;
+}
+
+void ShaderCache::Add(const ShaderCacheKey& key, const void* pData, size_t bytes, uint64_t compileNs)
+{
+	if (bytes == 0)
+		return;
+
+	size_t a = 0;
+	while (a < m_Added.size() && !SameSlot(m_Added[a].Key, key))
+		a++;
+	if (a == m_Added.size())
+		m_Added.push_back(Added());
+
+	const uint8_t* p = static_cast<const uint8_t*>(pData);
+	m_Added[a].Key = key;
+	m_Added[a].CompileNs = compileNs;
+	m_Added[a].Bytecode.assign(p, p + bytes);
+	m_Stats.Added++;
+}
+
+bool ShaderCache::Save(const char* path)
+{
+	// The archive's entries that nothing added replaces, then the added ones.
+	std::vector<ShaderCacheEntry> entries;
+	std::vector<const void*> data;
+	for (uint32_t e = 0; e < m_EntryCount; e++)
+	{
+		bool replaced = false;
+		for (size_t a = 0; a < m_Added.size() && !replaced; a++)
+			replaced = SameSlot(m_pEntries[e].Key, m_Added[a].Key);
+		if (replaced)
+			continue;
+		entries.push_back(m_pEntries[e]);
+		data.push_back(static_cast<const uint8_t*>(m_File.Data()) + m_pEntries[e].Offset);
+	}
+	for (size_t a = 0; a < m_Added.size(); a++)
+	{
+		ShaderCacheEntry entry;
+		entry.Key = m_Added[a].Key;
+		entry.Offset = 0;
+		entry.Bytes = m_Added[a].Bytecode.size();
+		entry.CompileNs = m_Added[a].CompileNs;
+		entries.push_back(entry);
+		data.push_back(&m_Added[a].Bytecode[0]);
+	}
+
+	std::vector<uint32_t> order(entries.size());
+	for (uint32_t e = 0; e < (uint32_t)order.size(); e++)
+		order[e] = e;
+	std::sort(order.begin(), order.end(),
+		[&](uint32_t a, uint32_t b) { return entries[a].Key.Hash < entries[b].Key.Hash; });
+
+	ShaderCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Magic = kShaderCacheMagic;
+	header.Version = kShaderCacheVersion;
+	header.HeaderBytes = sizeof(ShaderCacheHeader);
+	header.EntryCount = (uint32_t)entries.size();
+	header.EntryOffset = sizeof(ShaderCacheHeader);
+
+	std::vector<ShaderCacheEntry> table(entries.size());
+	uint64_t offset = AlignUp(header.EntryOffset + table.size() * sizeof(ShaderCacheEntry));
+	for (size_t e = 0; e < table.size(); e++)
+	{
+		table[e] = entries[order[e]];
+		table[e].Offset = offset;
+		offset = AlignUp(offset + table[e].Bytes);
+	}
+	header.FileBytes = offset;
+
+	std::vector<uint8_t> image((size_t)header.FileBytes, 0);
+	memcpy(&image[0], &header, sizeof(header));
+	if (!table.empty())
+		memcpy(&image[(size_t)header.EntryOffset], &table[0], table.size() * sizeof(ShaderCacheEntry));
+	for (size_t e = 0; e < table.size(); e++)
+		memcpy(&image[(size_t)table[e].Offset], data[order[e]], (size_t)table[e].Bytes);
+
+	// Windows won't replace a file that is still mapped.
+	Close();
+
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	bool written = (fwrite(&image[0], 1, image.size(), f) == image.size());
+	if (fclose(f) != 0 || !written)
+		return false;
+	return Open(path);
+}
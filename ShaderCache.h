@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------
+// File: ShaderCache.h
+//
+// Compiled shader bytecode kept between runs in one archive file, so a launch
+// whose shaders were compiled before maps them instead of compiling.
+//
+//     ShaderCacheHeader
+//     ShaderCacheEntry table		sorted by Key.Hash
+//     bytecode					each kShaderCacheAlignment aligned
+//
+// An entry is found by its ShaderCacheKey: hashes of the source text and of
+// the defines and compile flags, the entry point, the target profile and the
+// compiler's version, so editing the .fx, building with other flags or a new
+// d3dcompiler each miss instead of loading stale bytecode.  Key.Hash covers
+// all of those and orders the table for a binary search, and the fields are
+// still compared on a match.  Only the one source file is hashed, so a shader
+// with #includes would have to hash them into the defines.
+//
+// The archive is mapped and Find hands back a pointer into the mapping, so a
+// hit is a search of the table and the bytecode is read from the file cache by
+// CreateXShader.  The caller compiles misses and hands them to Add, and Save
+// writes the old entries and the new to a fresh file.  An entry replaces any
+// of the same entry point, target and defines left from an older source or
+// compiler, so the archive only holds what the current build can hit.
+//
+// Nothing here compiles, which keeps it free of d3dcompiler and lets the
+// Benchmarks check it.  Everything is little endian, Parse checks the header
+// and table against the file size, and any change to the layout bumps
+// kShaderCacheVersion.  One thread at a time.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+
+static const uint32_t kShaderCacheMagic = 0x43444853;		// "SHDC"
+static const uint32_t kShaderCacheVersion = 1;
+static const uint32_t kShaderCacheAlignment = 16;
+
+// FNV-1a, seed chains one call onto the last.
+static const uint64_t kShaderHashSeed = 0xCBF29CE484222325ull;
+uint64_t HashShaderBytes(const void* pData, size_t bytes, uint64_t seed = kShaderHashSeed);
+
+
+struct ShaderCacheKey
+{
+	uint64_t Hash;					// Of everything below
+	uint64_t SourceHash;
+	uint64_t OptionsHash;			// Defines and compile flags
+	uint32_t CompilerVersion;		// D3D_COMPILER_VERSION
+	uint32_t Pad;
+	char EntryPoint[32];			// NUL terminated
+	char Target[16];
+};
+
+struct ShaderCacheEntry
+{
+	ShaderCacheKey Key;
+	uint64_t Offset;
+	uint64_t Bytes;
+	uint64_t CompileNs;				// How long the miss took, for reports
+};
+
+struct ShaderCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderBytes;
+	uint32_t EntryCount;
+	uint64_t EntryOffset;			// Of the table
+	uint64_t FileBytes;
+};
+
+// defines is any text standing for the macros, "" for none.  False if the
+// entry point or target doesn't fit the key.
+bool MakeShaderCacheKey(const void* pSource, size_t sourceBytes, const char* defines, uint32_t flags,
+	const char* entryPoint, const char* target, uint32_t compilerVersion, ShaderCacheKey* pKey);
+
+
+struct ShaderCacheStats
+{
+	uint32_t Hits;
+	uint32_t Misses;
+	uint32_t Added;
+	uint64_t FindNs;				// Every Find, hits and misses
+	uint64_t HitCompileNs;			// What the hits took when they were compiled
+};
+
+
+class ShaderCache
+{
+public:
+	ShaderCache();
+
+	// Maps the archive.  False, with the cache empty, if there isn't one or it
+	// can't be used, which only means everything misses and Save makes a new one.
+	bool Open(const char* path, std::string* pError = nullptr);
+	void Close();
+
+	// The bytecode, valid until Save or Close, or null on a miss.
+	const void* Find(const ShaderCacheKey& key, size_t* pBytes);
+
+	void Add(const ShaderCacheKey& key, const void* pData, size_t bytes, uint64_t compileNs);
+
+	// Whether anything was added since Open.
+	bool Dirty() const { return !m_Added.empty(); }
+
+	// Writes every entry to path, and maps it in place of the old archive.
+	bool Save(const char* path);
+
+	uint32_t EntryCount() const { return m_EntryCount + (uint32_t)m_Added.size(); }
+	const ShaderCacheStats& Stats() const { return m_Stats; }
+
+private:
+	ShaderCache(const ShaderCache&);
+	ShaderCache& operator=(const ShaderCache&);
+
+	struct Added
+	{
+		ShaderCacheKey Key;
+		uint64_t CompileNs;
+		std::vector<uint8_t> Bytecode;
+	};
+
+	bool Parse(std::string* pError);
+	const ShaderCacheEntry* FindMapped(const ShaderCacheKey& key) const;
+
+	MappedFile m_File;
+	const ShaderCacheEntry* m_pEntries;
+	uint32_t m_EntryCount;
+	std::vector<Added> m_Added;
+	ShaderCacheStats m_Stats;
+};
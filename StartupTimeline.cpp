@@ -0,0 +1,257 @@
+//--------------------------------------------------------------------------------------
+// File: StartupTimeline.cpp
+//
+// Phase table, budget file, and the JSON report.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "StartupTimeline.h"
+#include "Timing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static const uint32_t kMaxPhases = 256;
+
+static StartupPhaseRecord s_Phases[kMaxPhases];
+static uint32_t s_Count = 0;
+static int s_Current = -1;			// Innermost open phase or step
+static uint64_t s_OriginNs = 0;
+static bool s_Started = false;
+static bool s_Finished = false;
+static uint32_t s_IgnoredDepth = 0;		// Pushes that didn't get an entry
+
+// Start CPU time of each entry, only needed while it is open.
+static uint64_t s_StartCpuNs[kMaxPhases];
+
+
+static void Close(int index)
+{
+	StartupPhaseRecord& phase = s_Phases[index];
+	phase.WallNs = GetTimeNs() - s_OriginNs - phase.StartNs;
+	phase.CpuNs = GetThreadCpuTimeNs() - s_StartCpuNs[index];
+	phase.Open = false;
+	s_Current = phase.Parent;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Begin and end of the whole timeline.
+//--------------------------------------------------------------------------------------
+void StartupTimelineBegin()
+{
+	s_Count = 0;
+	s_Current = -1;
+	s_OriginNs = GetTimeNs();
+	s_Started = true;
+	s_Finished = false;
+
+	StartupTimelinePush("Startup", false);
+}
+
+void StartupTimelineEnd()
+{
+	while (s_Current >= 0)
+		Close(s_Current);
+	s_Finished = true;
+}
+
+//--------------------------------------------------------------------------------------
+// Phases past the end of the table, or after StartupTimelineEnd, are ignored.
+// Pop has to match, so an ignored push leaves a marker on the stack.
+//--------------------------------------------------------------------------------------
+void StartupTimelinePush(const char* name, bool step)
+{
+	if (!s_Started || s_Finished || s_Count == kMaxPhases)
+	{
+		s_IgnoredDepth++;
+		return;
+	}
+
+	int index = (int)s_Count++;
+	StartupPhaseRecord& phase = s_Phases[index];
+	phase.Name = name;
+	phase.Parent = s_Current;
+	phase.Depth = (s_Current >= 0) ? s_Phases[s_Current].Depth + 1 : 0;
+	phase.Step = step;
+	phase.Open = true;
+	phase.StartNs = GetTimeNs() - s_OriginNs;
+	phase.WallNs = 0;
+	phase.CpuNs = 0;
+	s_StartCpuNs[index] = GetThreadCpuTimeNs();
+
+	s_Current = index;
+}
+
+void StartupTimelinePop()
+{
+	if (s_IgnoredDepth > 0)
+	{
+		s_IgnoredDepth--;
+		return;
+	}
+	if (s_Current < 0)
+		return;
+
+	// Steps end with the phase they were taken in.
+	while (s_Current >= 0 && s_Phases[s_Current].Step)
+		Close(s_Current);
+	if (s_Current >= 0)
+		Close(s_Current);
+}
+
+void StartupTimelineStep(const char* name)
+{
+	if (s_IgnoredDepth > 0 || !s_Started || s_Finished)
+		return;
+
+	if (s_Current >= 0 && s_Phases[s_Current].Step)
+		Close(s_Current);
+
+	// A step has no matching pop, so it can't go through the ignored path.
+	if (s_Count < kMaxPhases)
+		StartupTimelinePush(name, true);
+}
+
+int StartupTimelineAddSpan(const char* name, int parent, uint64_t startNs, uint64_t endNs, uint64_t cpuNs)
+{
+	if (!s_Started || s_Finished || s_Count == kMaxPhases || s_Count == 0 || parent >= (int)s_Count)
+		return -1;
+
+	if (parent < 0)
+		parent = 0;
+	int index = (int)s_Count++;
+	StartupPhaseRecord& phase = s_Phases[index];
+	phase.Name = name;
+	phase.Parent = parent;
+	phase.Depth = s_Phases[parent].Depth + 1;
+	phase.Step = false;
+	phase.Open = false;
+	phase.StartNs = (startNs > s_OriginNs) ? startNs - s_OriginNs : 0;
+	phase.WallNs = (endNs > startNs) ? endNs - startNs : 0;
+	phase.CpuNs = cpuNs;
+	return index;
+}
+
+
+uint32_t StartupTimelineCount()
+{
+	return s_Count;
+}
+
+const StartupPhaseRecord& StartupTimelineGet(uint32_t index)
+{
+	return s_Phases[index];
+}
+
+std::string StartupTimelinePath(uint32_t index)
+{
+	std::string path = s_Phases[index].Name;
+	for (int parent = s_Phases[index].Parent; parent >= 0; parent = s_Phases[parent].Parent)
+		path = std::string(s_Phases[parent].Name) + "/" + path;
+	return path;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Budget file, one "path wall_ms [cpu_ms]" per line, # for comments.
+//--------------------------------------------------------------------------------------
+bool StartupTimelineCheckBudget(const char* budgetPath, std::vector<StartupBudgetCheck>* pChecks)
+{
+	pChecks->clear();
+
+	FILE* f = fopen(budgetPath, "rb");
+	if (!f)
+		return false;
+
+	bool passed = true;
+	char line[512];
+	while (fgets(line, sizeof(line), f))
+	{
+		char* comment = strchr(line, '#');
+		if (comment)
+			*comment = '\0';
+
+		char path[256];
+		double wallMs = 0.0;
+		double cpuMs = -1.0;
+		int fields = sscanf(line, "%255s %lf %lf", path, &wallMs, &cpuMs);
+		if (fields < 2)
+			continue;
+
+		StartupBudgetCheck check;
+		check.Path = path;
+		check.BudgetWallMs = wallMs;
+		check.BudgetCpuMs = (fields == 3) ? cpuMs : -1.0;
+		check.WallMs = 0.0;
+		check.CpuMs = 0.0;
+		check.Ran = false;
+
+		for (uint32_t i = 0; i < s_Count; i++)
+		{
+			if (StartupTimelinePath(i) != check.Path)
+				continue;
+			check.WallMs += (double)s_Phases[i].WallNs / 1e6;
+			check.CpuMs += (double)s_Phases[i].CpuNs / 1e6;
+			check.Ran = true;
+		}
+
+		check.Passed = !check.Ran ||
+			(check.WallMs <= check.BudgetWallMs &&
+			 (check.BudgetCpuMs < 0.0 || check.CpuMs <= check.BudgetCpuMs));
+		if (!check.Passed)
+			passed = false;
+
+		pChecks->push_back(check);
+	}
+
+	fclose(f);
+	return passed;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Phases are in the order they started, with spans from other threads after
+// them, so the order and depth no longer make a tree on their own; each
+// carries its full path, which does.
+//--------------------------------------------------------------------------------------
+bool StartupTimelineWriteReport(const char* path, const std::vector<StartupBudgetCheck>* pChecks)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+
+	fprintf(f, "{\"phases\":[\n");
+	for (uint32_t i = 0; i < s_Count; i++)
+	{
+		const StartupPhaseRecord& phase = s_Phases[i];
+		fprintf(f, "%s{\"path\":\"%s\",\"name\":\"%s\",\"depth\":%u,\"step\":%s,\"start_ms\":%.3f,\"wall_ms\":%.3f,\"cpu_ms\":%.3f}",
+			(i > 0) ? ",\n" : "", StartupTimelinePath(i).c_str(), phase.Name, phase.Depth,
+			phase.Step ? "true" : "false", (double)phase.StartNs / 1e6,
+			(double)phase.WallNs / 1e6, (double)phase.CpuNs / 1e6);
+	}
+	fprintf(f, "\n]");
+
+	if (pChecks)
+	{
+		bool passed = true;
+		fprintf(f, ",\n\"budget\":[\n");
+		for (size_t i = 0; i < pChecks->size(); i++)
+		{
+			const StartupBudgetCheck& check = (*pChecks)[i];
+			passed = passed && check.Passed;
+			fprintf(f, "%s{\"path\":\"%s\",\"budget_wall_ms\":%.3f,\"wall_ms\":%.3f,",
+				(i > 0) ? ",\n" : "", check.Path.c_str(), check.BudgetWallMs, check.WallMs);
+			if (check.BudgetCpuMs >= 0.0)
+				fprintf(f, "\"budget_cpu_ms\":%.3f,", check.BudgetCpuMs);
+			fprintf(f, "\"cpu_ms\":%.3f,\"ran\":%s,\"passed\":%s}",
+				check.CpuMs, check.Ran ? "true" : "false", check.Passed ? "true" : "false");
+		}
+		fprintf(f, "\n],\n\"budget_passed\":%s", passed ? "true" : "false");
+	}
+
+	fprintf(f, "}\n");
+	fclose(f);
+	return true;
+}
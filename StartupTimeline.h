@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// File: StartupTimeline.h
+//
+// Wall and CPU time for each phase of startup, InitWindow through ActivateStereo.
+//
+// STARTUP_PHASE opens a scope, usually a whole function, and nests under whatever
+// phase is already open.  STARTUP_STEP splits straight-line code inside a phase
+// into sub-steps without adding braces, each step runs until the next one or the
+// end of the phase.  Comparing wall to CPU time shows where startup is waiting
+// on the driver, the disk, or the display rather than computing.
+//
+// Main thread only, and startup only, so there is no locking and a fixed table.
+// Work other threads did during startup is added afterwards from the main
+// thread as spans, with the times the other threads took.
+// GetThreadTimes only ticks every 15.6ms on most systems, so CPU times for short
+// steps on Windows are coarse.
+//
+// A budget file lists phase paths with a maximum wall time, and optionally CPU
+// time, in ms:
+//
+//     # path                           wall_ms   [cpu_ms]
+//     Startup                          3000
+//     Startup/InitDevice               1500
+//     Startup/InitDevice/CompileVS     400       300
+//
+// Paths are phase names joined with '/'.  If a path occurs more than once the
+// times are summed.  Budgeted paths that never ran are reported but don't fail.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+struct StartupPhaseRecord
+{
+	const char* Name;		// Must outlive the timeline, normally a literal
+	int Parent;				// Index of the enclosing phase, -1 at the top
+	uint32_t Depth;
+	bool Step;				// Opened by STARTUP_STEP rather than STARTUP_PHASE
+	bool Open;
+	uint64_t StartNs;		// Since StartupTimelineBegin
+	uint64_t WallNs;
+	uint64_t CpuNs;
+};
+
+struct StartupBudgetCheck
+{
+	std::string Path;
+	double BudgetWallMs;
+	double BudgetCpuMs;		// Negative when the file gives no CPU budget
+	double WallMs;
+	double CpuMs;
+	bool Ran;
+	bool Passed;
+};
+
+
+// Sets the origin, and opens the top level "Startup" phase.
+void StartupTimelineBegin();
+
+// Closes everything still open.  Later phases are ignored.
+void StartupTimelineEnd();
+
+void StartupTimelinePush(const char* name, bool step);
+void StartupTimelinePop();
+void StartupTimelineStep(const char* name);
+
+// A finished phase that ran on another thread, GetTimeNs at its start and end
+// and that thread's CPU time.  parent is an earlier span's index, or -1 for
+// directly under "Startup".  Returns its index, -1 if it was ignored, which
+// includes a parent that isn't in the table yet.
+int StartupTimelineAddSpan(const char* name, int parent, uint64_t startNs, uint64_t endNs, uint64_t cpuNs);
+
+uint32_t StartupTimelineCount();
+const StartupPhaseRecord& StartupTimelineGet(uint32_t index);
+std::string StartupTimelinePath(uint32_t index);
+
+// False if the file can't be read or any phase is over budget.
+bool StartupTimelineCheckBudget(const char* budgetPath, std::vector<StartupBudgetCheck>* pChecks);
+
+// JSON with every phase, plus the budget checks if given.
+bool StartupTimelineWriteReport(const char* path, const std::vector<StartupBudgetCheck>* pChecks);
+
+
+//--------------------------------------------------------------------------------------
+// RAII phase, use through STARTUP_PHASE.
+//--------------------------------------------------------------------------------------
+class StartupPhase
+{
+public:
+	explicit StartupPhase(const char* name) { StartupTimelinePush(name, false); }
+	~StartupPhase() { StartupTimelinePop(); }
+
+private:
+	StartupPhase(const StartupPhase&);
+	StartupPhase& operator=(const StartupPhase&);
+};
+
+#define STARTUP_CONCAT_INNER(a, b) a##b
+#define STARTUP_CONCAT(a, b) STARTUP_CONCAT_INNER(a, b)
+
+#define STARTUP_PHASE(name) StartupPhase STARTUP_CONCAT(startupPhase, __LINE__)(name)
+#define STARTUP_STEP(name) StartupTimelineStep(name)
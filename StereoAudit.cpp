@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------------------
+// File: StereoAudit.cpp
+//
+// Sampling, and the report.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "StereoAudit.h"
+#include "NvapiShim.h"
+#include "Timing.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+StereoAudit::StereoAudit()
+{
+	memset(m_Sites, 0, sizeof(m_Sites));
+	m_SiteCount = 0;
+	Configure(0.0, 1);
+}
+
+void StereoAudit::Configure(double sampleRate, uint32_t seed)
+{
+	m_SampleRate = (sampleRate > 1.0) ? 1.0 : sampleRate;
+	m_Random = 0x9E3779B97F4A7C15ull ^ seed;
+	m_Countdown = NextCountdown();
+}
+
+//--------------------------------------------------------------------------------------
+// The last slot collects every site past the limit, rather than losing them.
+//--------------------------------------------------------------------------------------
+uint32_t StereoAudit::RegisterSite(const char* name, const char* file, int line)
+{
+	if (m_SiteCount == kMaxSites - 1)
+	{
+		StereoAuditSite& overflow = m_Sites[kMaxSites - 1];
+		overflow.Name = "(other sites)";
+		overflow.File = "";
+		overflow.Line = 0;
+		return kMaxSites - 1;
+	}
+
+	StereoAuditSite& site = m_Sites[m_SiteCount];
+	site.Name = name;
+	site.File = file;
+	site.Line = line;
+	return m_SiteCount++;
+}
+
+//--------------------------------------------------------------------------------------
+// Draws until the next sample, geometric with mean 1/rate.  xorshift64* is
+// plenty random for this.
+//--------------------------------------------------------------------------------------
+uint64_t StereoAudit::NextCountdown()
+{
+	if (m_SampleRate <= 0.0)
+		return ~0ull;
+	if (m_SampleRate >= 1.0)
+		return 1;
+
+	m_Random ^= m_Random >> 12;
+	m_Random ^= m_Random << 25;
+	m_Random ^= m_Random >> 27;
+	uint64_t bits = (m_Random * 2685821657736338717ull) >> 11;
+	double u = ((double)bits + 1.0) / 9007199254740992.0;		// (0, 1]
+
+	double draws = ceil(log(u) / log(1.0 - m_SampleRate));
+	return (draws < 1.0) ? 1 : (uint64_t)draws;
+}
+
+void StereoAudit::Sample(StereoAuditSite& site, StereoHandle handle)
+{
+	uint64_t start = GetTimeNs();
+	NvU8 stereoized = 0;
+	NvAPI_Status status = NvAPI_Stereo_Debug_WasLastDrawStereoized(handle, &stereoized);
+	site.SampleNs += GetTimeNs() - start;
+
+	site.Sampled++;
+	if (status != NVAPI_OK)
+		site.Errors++;
+	else if (stereoized)
+		site.Stereo++;
+	else
+		site.Mono++;
+
+	m_Countdown = NextCountdown();
+}
+
+
+//--------------------------------------------------------------------------------------
+// The error is the 95% normal interval on the sampled mono fraction.  Estimated
+// mono draws scale that fraction up to all the site's draws.
+//--------------------------------------------------------------------------------------
+bool StereoAudit::WriteReport(const char* path) const
+{
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+
+	uint64_t totalDraws = 0;
+	uint64_t totalSampled = 0;
+	uint64_t totalSampleNs = 0;
+	for (uint32_t i = 0; i < kMaxSites; i++)
+	{
+		totalDraws += m_Sites[i].Draws;
+		totalSampled += m_Sites[i].Sampled;
+		totalSampleNs += m_Sites[i].SampleNs;
+	}
+
+	fprintf(f, "{\"sample_rate\":%g,\"draws\":%llu,\"sampled\":%llu,\"sample_ms\":%.3f,\"sites\":[\n",
+		m_SampleRate, (unsigned long long)totalDraws, (unsigned long long)totalSampled, (double)totalSampleNs / 1e6);
+
+	bool first = true;
+	for (uint32_t i = 0; i < kMaxSites; i++)
+	{
+		const StereoAuditSite& s = m_Sites[i];
+		if (!s.Name)
+			continue;
+
+		uint64_t answered = s.Stereo + s.Mono;
+		double monoFraction = answered ? (double)s.Mono / (double)answered : 0.0;
+		double error = answered ? 1.96 * sqrt(monoFraction * (1.0 - monoFraction) / (double)answered) : 0.0;
+
+		fprintf(f, "%s{\"name\":\"%s\",\"file\":\"", first ? "" : ",\n", s.Name);
+		for (const char* c = s.File; *c; c++)
+		{
+			if (*c == '\\')
+				fputc('\\', f);		// __FILE__ has backslashes on Windows
+			fputc(*c, f);
+		}
+		fprintf(f, "\",\"line\":%d,\"draws\":%llu,\"sampled\":%llu,\"stereo\":%llu,\"mono\":%llu,\"errors\":%llu,"
+			"\"mono_fraction\":%.4f,\"mono_fraction_error\":%.4f,\"estimated_mono_draws\":%.0f,\"mean_sample_ns\":%.0f}",
+			s.Line, (unsigned long long)s.Draws, (unsigned long long)s.Sampled, (unsigned long long)s.Stereo,
+			(unsigned long long)s.Mono, (unsigned long long)s.Errors, monoFraction, error,
+			monoFraction * (double)s.Draws, s.Sampled ? (double)s.SampleNs / (double)s.Sampled : 0.0);
+		first = false;
+	}
+
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------
+// File: StereoAudit.h
+//
+// Sampled check that draws really come out in stereo.
+//
+// A draw the driver falls back to mono still costs its full price but only
+// shows up in one eye, and nothing reports it.  NvAPI_Stereo_Debug_WasLastDrawStereoized
+// answers for the draw just made, but it is a driver call, far too slow to make
+// after every draw.  So the audit asks after a random fraction of draws, and
+// counts the answers per draw site.  With rate p each site's mono fraction is
+// estimated from roughly p * draws samples.
+//
+// The draws between samples are a geometric random count, not a fixed stride.
+// A stride would alias with the frame: every 2nd draw in a two-eye loop is
+// always the same eye.  Between samples AfterDraw is a decrement and a compare.
+//
+// Draw sites are registered once, through STEREO_AUDIT_DRAW, which keeps the
+// site index in a function static, or with RegisterSite by code that draws
+// for others, as D3D11RenderBackend does for the scene.  Render thread only.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+#include "NvapiStereo.h"
+
+
+struct StereoAuditSite
+{
+	const char* Name;
+	const char* File;
+	int Line;
+	uint64_t Draws;			// Every draw, sampled or not
+	uint64_t Sampled;
+	uint64_t Stereo;
+	uint64_t Mono;
+	uint64_t Errors;		// The query itself failed
+	uint64_t SampleNs;		// Time spent in the query
+};
+
+
+class StereoAudit
+{
+public:
+	static const uint32_t kMaxSites = 64;
+
+	StereoAudit();
+
+	// Fraction of draws to check, 0 turns it off.  Seed fixes the sample pattern.
+	void Configure(double sampleRate, uint32_t seed);
+	double SampleRate() const { return m_SampleRate; }
+
+	uint32_t RegisterSite(const char* name, const char* file, int line);
+
+	// Call right after the draw.
+	void AfterDraw(uint32_t site, StereoHandle handle)
+	{
+		StereoAuditSite& s = m_Sites[site];
+		s.Draws++;
+		if (--m_Countdown != 0)
+			return;
+		Sample(s, handle);
+	}
+
+	uint32_t SiteCount() const { return m_SiteCount; }
+	const StereoAuditSite& GetSite(uint32_t site) const { return m_Sites[site]; }
+
+	// Per site counts, mono fraction with its error, and query cost.
+	bool WriteReport(const char* path) const;
+
+private:
+	void Sample(StereoAuditSite& site, StereoHandle handle);
+	uint64_t NextCountdown();
+
+	double m_SampleRate;
+	uint64_t m_Countdown;
+	uint64_t m_Random;
+
+	StereoAuditSite m_Sites[kMaxSites];
+	uint32_t m_SiteCount;
+};
+
+
+#define STEREO_AUDIT_DRAW(audit, handle, name) \
+	do { \
+		static uint32_t s_AuditSite = (audit).RegisterSite(name, __FILE__, __LINE__); \
+		(audit).AfterDraw(s_AuditSite, handle); \
+	} while (0)
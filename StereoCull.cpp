@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------
+// File: StereoCull.cpp
+//
+// Union frustum construction and the sphere tests.
+//--------------------------------------------------------------------------------------
+
+#include "StereoCull.h"
+
+#include <math.h>
+
+
+//--------------------------------------------------------------------------------------
+// Planes of a row-vector projection, Gribb and Hartmann, in the projection's
+// own space.  D3D clip z runs 0 to w.
+//--------------------------------------------------------------------------------------
+static void ProjectionPlanes(const SMMatrix& p, float planes[CULL_PLANE_COUNT][4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		planes[CULL_LEFT][i] = p.m[i][3] + p.m[i][0];
+		planes[CULL_RIGHT][i] = p.m[i][3] - p.m[i][0];
+		planes[CULL_BOTTOM][i] = p.m[i][3] + p.m[i][1];
+		planes[CULL_TOP][i] = p.m[i][3] - p.m[i][1];
+		planes[CULL_NEAR][i] = p.m[i][2];
+		planes[CULL_FAR][i] = p.m[i][3] - p.m[i][2];
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// View space to world space, and normalized.  With row vectors a world point
+// is p * View, so the world plane is View times the view plane as a column.
+//--------------------------------------------------------------------------------------
+static void ToWorld(const SMMatrix& view, const float planes[CULL_PLANE_COUNT][4], StereoFrustum* pFrustum)
+{
+	for (int k = 0; k < CULL_PLANE_COUNT; k++)
+	{
+		float world[4];
+		for (int i = 0; i < 4; i++)
+			world[i] = view.m[i][0] * planes[k][0] + view.m[i][1] * planes[k][1] + view.m[i][2] * planes[k][2] + view.m[i][3] * planes[k][3];
+
+		float length = sqrtf(world[0] * world[0] + world[1] * world[1] + world[2] * world[2]);
+		float scale = (length > 0.0f) ? 1.0f / length : 0.0f;
+		for (int i = 0; i < 4; i++)
+			pFrustum->Planes[k][i] = world[i] * scale;
+	}
+}
+
+void BuildFrustum(const SMMatrix& view, const SMMatrix& projection, StereoFrustum* pFrustum)
+{
+	float planes[CULL_PLANE_COUNT][4];
+	ProjectionPlanes(projection, planes);
+	ToWorld(view, planes, pFrustum);
+}
+
+// Where a side plane, with no y term, crosses depth z.
+static float SideX(const float plane[4], float z)
+{
+	return -(plane[2] * z + plane[3]) / plane[0];
+}
+
+//--------------------------------------------------------------------------------------
+// In view space the side planes are lines in x-z.  The hull's left side goes
+// through the leftmost of the eyes' left edges at the near plane and at the far
+// plane, the right side likewise.
+//--------------------------------------------------------------------------------------
+void BuildStereoUnionFrustum(const SMMatrix& view, const SMMatrix& projection, float separation, float convergence,
+	StereoFrustum* pFrustum)
+{
+	float eyePlanes[2][CULL_PLANE_COUNT][4];
+	for (int eye = 0; eye < 2; eye++)
+	{
+		SMMatrix eyeProjection = projection;
+		StereoProjectionEdit(&eyeProjection, eye ? 1.0f : -1.0f, separation, convergence);
+		ProjectionPlanes(eyeProjection, eyePlanes[eye]);
+	}
+
+	// Shared by both eyes.
+	float planes[CULL_PLANE_COUNT][4];
+	for (int k = CULL_BOTTOM; k < CULL_PLANE_COUNT; k++)
+		for (int i = 0; i < 4; i++)
+			planes[k][i] = eyePlanes[0][k][i];
+
+	const float* nearPlane = planes[CULL_NEAR];
+	const float* farPlane = planes[CULL_FAR];
+	float nearZ = -nearPlane[3] / nearPlane[2];
+	float farZ = -farPlane[3] / farPlane[2];
+
+	float leftNear = fminf(SideX(eyePlanes[0][CULL_LEFT], nearZ), SideX(eyePlanes[1][CULL_LEFT], nearZ));
+	float leftFar = fminf(SideX(eyePlanes[0][CULL_LEFT], farZ), SideX(eyePlanes[1][CULL_LEFT], farZ));
+	float rightNear = fmaxf(SideX(eyePlanes[0][CULL_RIGHT], nearZ), SideX(eyePlanes[1][CULL_RIGHT], nearZ));
+	float rightFar = fmaxf(SideX(eyePlanes[0][CULL_RIGHT], farZ), SideX(eyePlanes[1][CULL_RIGHT], farZ));
+
+	// Normals are the edge direction turned a quarter, toward the inside.
+	float dz = farZ - nearZ;
+	float dx = leftFar - leftNear;
+	planes[CULL_LEFT][0] = dz;
+	planes[CULL_LEFT][1] = 0.0f;
+	planes[CULL_LEFT][2] = -dx;
+	planes[CULL_LEFT][3] = -(dz * leftNear - dx * nearZ);
+
+	dx = rightFar - rightNear;
+	planes[CULL_RIGHT][0] = -dz;
+	planes[CULL_RIGHT][1] = 0.0f;
+	planes[CULL_RIGHT][2] = dx;
+	planes[CULL_RIGHT][3] = -(-dz * rightNear + dx * nearZ);
+
+	ToWorld(view, planes, pFrustum);
+}
+
+
+uint32_t StereoCullSpheresScalar(const StereoFrustum& frustum, const float* pX, const float* pY, const float* pZ,
+	const float* pRadius, uint32_t count, uint32_t* pVisible)
+{
+	uint32_t visible = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (int k = 0; k < CULL_PLANE_COUNT && inside; k++)
+		{
+			const float* p = frustum.Planes[k];
+			inside = (p[0] * pX[i] + p[1] * pY[i] + p[2] * pZ[i] + p[3] >= -pRadius[i]);
+		}
+		if (inside)
+			pVisible[visible++] = i;
+	}
+	return visible;
+}
+
+#if STEREO_MATH_SSE
+//--------------------------------------------------------------------------------------
+// All six planes for every block, no early out, so there are no branches on
+// the data until the visible lanes are written out.
+//--------------------------------------------------------------------------------------
+uint32_t StereoCullSpheresSIMD(const StereoFrustum& frustum, const float* pX, const float* pY, const float* pZ,
+	const float* pRadius, uint32_t count, uint32_t* pVisible)
+{
+	__m128 planes[CULL_PLANE_COUNT][4];
+	for (int k = 0; k < CULL_PLANE_COUNT; k++)
+		for (int i = 0; i < 4; i++)
+			planes[k][i] = _mm_set1_ps(frustum.Planes[k][i]);
+
+	uint32_t visible = 0;
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(pX + i);
+		__m128 y = _mm_loadu_ps(pY + i);
+		__m128 z = _mm_loadu_ps(pZ + i);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(pRadius + i));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int k = 0; k < CULL_PLANE_COUNT; k++)
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[k][0], x), _mm_mul_ps(planes[k][1], y)),
+				_mm_add_ps(_mm_mul_ps(planes[k][2], z), planes[k][3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		if (count - i < 4)
+			mask &= (1 << (count - i)) - 1;
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			pVisible[visible] = i + lane;
+			visible += (mask >> lane) & 1;
+		}
+	}
+	return visible;
+}
+#else
+uint32_t StereoCullSpheresSIMD(const StereoFrustum& frustum, const float* pX, const float* pY, const float* pZ,
+	const float* pRadius, uint32_t count, uint32_t* pVisible)
+{
+	return StereoCullSpheresScalar(frustum, pX, pY, pZ, pRadius, count, pVisible);
+}
+#endif
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// File: StereoCull.h
+//
+// Frustum culling for both eyes at once.
+//
+// The two eye projections RenderFrame() builds differ only in _31 and _41, the
+// horizontal skew and offset, so both eyes share their top, bottom, near and
+// far planes, and every side plane contains the view's y axis.  The union of
+// the two frusta is then bounded by those four planes and, on each side, the
+// line through the outermost eye's edge at the near plane and the outermost
+// eye's edge at the far plane, which is its convex hull.  An object is tested
+// against that one six plane frustum, and the visible list is shared by both
+// eyes.
+//
+// Bounds are spheres in SoA arrays padded to a multiple of four, the padding
+// with a negative radius so it never passes.  The SIMD test does four spheres
+// against all six planes per step.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+#include "StereoMath.h"
+
+
+enum StereoCullPlane
+{
+	CULL_LEFT = 0,
+	CULL_RIGHT,
+	CULL_BOTTOM,
+	CULL_TOP,
+	CULL_NEAR,
+	CULL_FAR,
+	CULL_PLANE_COUNT
+};
+
+// World space planes, normalized, a point p is inside when dot(p, n) + d >= 0.
+struct StereoFrustum
+{
+	float Planes[CULL_PLANE_COUNT][4];
+};
+
+// projection is the mono one, the eye projections are made from it with
+// StereoProjectionEdit.
+void BuildStereoUnionFrustum(const SMMatrix& view, const SMMatrix& projection, float separation, float convergence,
+	StereoFrustum* pFrustum);
+
+// Mono frustum of one projection, for checking the union against each eye.
+void BuildFrustum(const SMMatrix& view, const SMMatrix& projection, StereoFrustum* pFrustum);
+
+
+//--------------------------------------------------------------------------------------
+// Writes the indices of the spheres at least partly inside to pVisible and
+// returns how many.  count need not be a multiple of four, but the arrays, and
+// pVisible, must be padded to one.
+//--------------------------------------------------------------------------------------
+uint32_t StereoCullSpheresScalar(const StereoFrustum& frustum, const float* pX, const float* pY, const float* pZ,
+	const float* pRadius, uint32_t count, uint32_t* pVisible);
+
+uint32_t StereoCullSpheresSIMD(const StereoFrustum& frustum, const float* pX, const float* pY, const float* pZ,
+	const float* pRadius, uint32_t count, uint32_t* pVisible);
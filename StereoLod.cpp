@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// File: StereoLod.cpp
+//
+// Stereo LOD selection with hysteresis.
+//--------------------------------------------------------------------------------------
+
+#include "StereoLod.h"
+#include "Timing.h"
+
+#include <string.h>
+
+
+StereoLodConfig DefaultStereoLodConfig()
+{
+	StereoLodConfig config;
+	config.ThresholdPixels = 1.0f;
+	config.Hysteresis = 0.25f;
+	config.ViewportHeight = 720.0f;
+	return config;
+}
+
+
+StereoLodSelector::StereoLodSelector()
+{
+	m_Config = DefaultStereoLodConfig();
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+//--------------------------------------------------------------------------------------
+// Error in pixels is error * pixelsPerUnit / depth, so rather than dividing
+// for every LOD, the LOD's error is compared against the threshold times
+// depth / pixelsPerUnit, the most error allowed at that depth.
+//--------------------------------------------------------------------------------------
+void StereoLodSelector::Select(const Scene& scene, const SMMatrix& view, const SMMatrix& projection,
+	const uint32_t* pObjects, uint32_t count, uint32_t* pMeshes)
+{
+	uint64_t start = GetTimeNs();
+
+	if (m_Lods.size() != scene.Objects.size())
+		m_Lods.assign(scene.Objects.size(), 0);
+
+	// _22 is the same in both eyes, half the viewport's height in pixels per
+	// unit of height at depth 1.
+	float pixelsPerUnit = 0.5f * m_Config.ViewportHeight * projection.m[1][1];
+	float nearZ = (projection.m[2][2] != 0.0f) ? -projection.m[3][2] / projection.m[2][2] : 0.0f;
+	float finerAt = m_Config.ThresholdPixels / pixelsPerUnit;
+	float coarserAt = finerAt * (1.0f - m_Config.Hysteresis);
+
+	uint32_t changes = 0;
+	uint64_t triangles = 0;
+	uint64_t fullTriangles = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t object = pObjects ? pObjects[i] : i;
+		const SceneObject& o = scene.Objects[object];
+		const SceneMesh* pLods = &scene.Meshes[o.Mesh];
+		uint32_t lodCount = (pLods->LodCount > 1) ? pLods->LodCount : 1;
+		if (lodCount > 256)
+			lodCount = 256;
+
+		uint32_t previous = m_Lods[object];
+		uint32_t lod = (previous < lodCount) ? previous : lodCount - 1;
+		if (lodCount > 1)
+		{
+			const float* p = o.Position;
+			float z = p[0] * view.m[0][2] + p[1] * view.m[1][2] + p[2] * view.m[2][2] + view.m[3][2];
+			float radius = pLods->Radius * o.Scale;
+
+			// Entirely behind the near plane, which only gets here without
+			// culling, is never seen.
+			if (z + radius <= nearZ)
+			{
+				lod = lodCount - 1;
+			}
+			else
+			{
+				float depth = (z - radius > nearZ) ? z - radius : nearZ;
+				float finer = finerAt * depth;
+				float coarser = coarserAt * depth;
+				while (lod > 0 && pLods[lod].LodError * o.Scale > finer)
+					lod--;
+				while (lod + 1 < lodCount && pLods[lod + 1].LodError * o.Scale <= coarser)
+					lod++;
+			}
+		}
+
+		if (lod != previous)
+			changes++;
+		m_Lods[object] = (uint8_t)lod;
+		pMeshes[i] = o.Mesh + lod;
+		triangles += pLods[lod].IndexCount / 3;
+		fullTriangles += pLods->IndexCount / 3;
+	}
+
+	m_Stats.Objects = count;
+	m_Stats.Changes = changes;
+	m_Stats.Triangles = triangles;
+	m_Stats.FullTriangles = fullTriangles;
+	m_Stats.SelectNs = GetTimeNs() - start;
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// File: StereoLod.h
+//
+// Level of detail picked once per object per frame, for both eyes.
+//
+// Picking per eye could give the eyes different meshes of the same object,
+// which shows as shimmer where the eyes disagree, and does the work twice.
+// The eye projections RenderFrame() builds differ only in _31 and _41, which
+// shift x by an amount that doesn't depend on the object's size, and share
+// the view, so something at a given view depth projects to the same size in
+// both eyes.  The one estimate made from the view and the shared projection
+// scale is then exact for either eye, and both draw its pick.
+//
+// A LOD's error, MeshLod::Error scaled by the object, is projected to pixels
+// at the depth of the nearest point of the object's bounding sphere.  The
+// coarsest LOD whose error is at most the threshold is wanted.  To stop an
+// object sitting on a boundary flipping every frame, it only goes coarser
+// once that LOD's error is below the threshold by the hysteresis fraction,
+// and goes finer as soon as the current one's error is over it.
+//
+// A scene mesh's LODs are that mesh and the ones after it, see SceneMesh.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Scene.h"
+#include "StereoMath.h"
+
+
+struct StereoLodConfig
+{
+	float ThresholdPixels;		// Largest error allowed on screen
+	float Hysteresis;			// Fraction of the threshold, 0 for none
+	float ViewportHeight;		// Pixels, per eye
+};
+
+// Threshold of one pixel, 25% hysteresis, a 720 pixel viewport.
+StereoLodConfig DefaultStereoLodConfig();
+
+
+struct StereoLodStats
+{
+	uint32_t Objects;			// Picked for this frame
+	uint32_t Changes;			// Of those, how many changed LOD since they were last picked
+	uint64_t Triangles;			// Per eye, of the picked LODs
+	uint64_t FullTriangles;		// Per eye, had every object drawn its finest LOD
+	uint64_t SelectNs;
+};
+
+
+class StereoLodSelector
+{
+public:
+	StereoLodSelector();
+
+	void SetConfig(const StereoLodConfig& config) { m_Config = config; }
+	const StereoLodConfig& GetConfig() const { return m_Config; }
+
+	// For each of the count objects in pObjects, writes the scene mesh to draw
+	// it with to pMeshes.  The LOD each object had is kept for the hysteresis,
+	// and forgotten when the scene's object count changes.
+	void Select(const Scene& scene, const SMMatrix& view, const SMMatrix& projection, const uint32_t* pObjects,
+		uint32_t count, uint32_t* pMeshes);
+
+	// Back to every object at its finest LOD.
+	void Reset() { m_Lods.clear(); }
+
+	const StereoLodStats& Stats() const { return m_Stats; }
+
+	size_t MemoryBytes() const { return m_Lods.capacity() * sizeof(uint8_t); }
+
+private:
+	StereoLodConfig m_Config;
+	std::vector<uint8_t> m_Lods;		// Per scene object, offset from its mesh
+	StereoLodStats m_Stats;
+};
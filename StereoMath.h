@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------
+// File: StereoMath.h
+//
+// The few matrix operations RenderFrame() does per eye, with the same layout
+// and results as DirectXMath (row-major, left-handed), but buildable anywhere.
+//
+// Two implementations with the same interface: StereoMathScalar, the plain C++
+// that DirectXMath compiles to with _XM_NO_INTRINSICS_, which is how this
+// project builds, and StereoMathSSE, the SSE2 version.  Both are always
+// compiled where SSE2 exists, so a benchmark can compare them in one binary.
+// StereoMathSIMD names the SSE version, or the scalar one on other CPUs.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define STEREO_MATH_SSE 1
+#include <emmintrin.h>
+#else
+#define STEREO_MATH_SSE 0
+#endif
+
+#if defined(_MSC_VER)
+#define STEREO_MATH_ALIGN16 __declspec(align(16))
+#else
+#define STEREO_MATH_ALIGN16 __attribute__((aligned(16)))
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Same memory layout as XMMATRIX and XMFLOAT4X4, m[row][column], so _31 is m[2][0].
+//--------------------------------------------------------------------------------------
+struct STEREO_MATH_ALIGN16 SMMatrix
+{
+	float m[4][4];
+};
+
+// What the shaders see in g_pSharedCB, like SharedCB in Tutorial07.cpp.
+struct STEREO_MATH_ALIGN16 SMSharedCB
+{
+	SMMatrix World;
+	SMMatrix View;
+	SMMatrix Projection;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Plain C++.
+//--------------------------------------------------------------------------------------
+struct StereoMathScalar
+{
+	static const char* Name() { return "scalar"; }
+
+	static SMMatrix Identity()
+	{
+		SMMatrix r;
+		memset(&r, 0, sizeof(r));
+		r.m[0][0] = r.m[1][1] = r.m[2][2] = r.m[3][3] = 1.0f;
+		return r;
+	}
+
+	static SMMatrix RotationY(float angle)
+	{
+		float s = sinf(angle);
+		float c = cosf(angle);
+		SMMatrix r = Identity();
+		r.m[0][0] = c;
+		r.m[0][2] = -s;
+		r.m[2][0] = s;
+		r.m[2][2] = c;
+		return r;
+	}
+
+	static SMMatrix Transpose(const SMMatrix& a)
+	{
+		SMMatrix r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.m[i][j] = a.m[j][i];
+		return r;
+	}
+
+	static SMMatrix Multiply(const SMMatrix& a, const SMMatrix& b)
+	{
+		SMMatrix r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+		return r;
+	}
+};
+
+
+#if STEREO_MATH_SSE
+//--------------------------------------------------------------------------------------
+// SSE2, one row per register.
+//--------------------------------------------------------------------------------------
+struct StereoMathSSE
+{
+	static const char* Name() { return "sse2"; }
+
+	static SMMatrix Identity()
+	{
+		return StereoMathScalar::Identity();
+	}
+
+	static SMMatrix RotationY(float angle)
+	{
+		// The sin and cos are scalar in DirectXMath's SSE path too.
+		float s = sinf(angle);
+		float c = cosf(angle);
+		SMMatrix r;
+		_mm_store_ps(r.m[0], _mm_setr_ps(c, 0.0f, -s, 0.0f));
+		_mm_store_ps(r.m[1], _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f));
+		_mm_store_ps(r.m[2], _mm_setr_ps(s, 0.0f, c, 0.0f));
+		_mm_store_ps(r.m[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+		return r;
+	}
+
+	static SMMatrix Transpose(const SMMatrix& a)
+	{
+		__m128 r0 = _mm_load_ps(a.m[0]);
+		__m128 r1 = _mm_load_ps(a.m[1]);
+		__m128 r2 = _mm_load_ps(a.m[2]);
+		__m128 r3 = _mm_load_ps(a.m[3]);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		SMMatrix r;
+		_mm_store_ps(r.m[0], r0);
+		_mm_store_ps(r.m[1], r1);
+		_mm_store_ps(r.m[2], r2);
+		_mm_store_ps(r.m[3], r3);
+		return r;
+	}
+
+	static SMMatrix Multiply(const SMMatrix& a, const SMMatrix& b)
+	{
+		__m128 b0 = _mm_load_ps(b.m[0]);
+		__m128 b1 = _mm_load_ps(b.m[1]);
+		__m128 b2 = _mm_load_ps(b.m[2]);
+		__m128 b3 = _mm_load_ps(b.m[3]);
+		SMMatrix r;
+		for (int i = 0; i < 4; i++)
+		{
+			__m128 row = _mm_mul_ps(_mm_set1_ps(a.m[i][0]), b0);
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][1]), b1));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][2]), b2));
+			row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[i][3]), b3));
+			_mm_store_ps(r.m[i], row);
+		}
+		return r;
+	}
+};
+
+typedef StereoMathSSE StereoMathSIMD;
+#else
+typedef StereoMathScalar StereoMathSIMD;
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Camera setup, scalar only since it runs once.  Same results as
+// XMMatrixLookAtLH and XMMatrixPerspectiveFovLH.
+//--------------------------------------------------------------------------------------
+inline SMMatrix StereoLookAtLH(const float eye[3], const float at[3], const float up[3])
+{
+	float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+	float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	z[0] /= length; z[1] /= length; z[2] /= length;
+
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	length = sqrtf(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	x[0] /= length; x[1] /= length; x[2] /= length;
+
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	SMMatrix r;
+	for (int i = 0; i < 3; i++)
+	{
+		r.m[i][0] = x[i];
+		r.m[i][1] = y[i];
+		r.m[i][2] = z[i];
+		r.m[i][3] = 0.0f;
+	}
+	r.m[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+	r.m[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+	r.m[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+	r.m[3][3] = 1.0f;
+	return r;
+}
+
+inline SMMatrix StereoPerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ)
+{
+	float yScale = 1.0f / tanf(0.5f * fovY);
+	float range = farZ / (farZ - nearZ);
+
+	SMMatrix r;
+	memset(&r, 0, sizeof(r));
+	r.m[0][0] = yScale / aspect;
+	r.m[1][1] = yScale;
+	r.m[2][2] = range;
+	r.m[2][3] = 1.0f;
+	r.m[3][2] = -range * nearZ;
+	return r;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The per-eye steps from RenderFrame(), for either implementation.
+//
+// eyeSign is -1 for the left eye and +1 for the right, which gives the
+// _31 -= separation, _41 = convergence edits of the left eye and the mirror
+// image for the right.
+//--------------------------------------------------------------------------------------
+inline void StereoProjectionEdit(SMMatrix* pProjection, float eyeSign, float separation, float convergence)
+{
+	pProjection->m[2][0] += eyeSign * separation;
+	pProjection->m[3][0] = -eyeSign * convergence;
+}
+
+template <typename Math>
+inline void StereoPackSharedCB(SMSharedCB* pCB, const SMMatrix& world, const SMMatrix& view, const SMMatrix& projection,
+	float eyeSign, float separation, float convergence)
+{
+	pCB->World = Math::Transpose(world);
+	pCB->View = Math::Transpose(view);
+
+	SMMatrix eyeProjection = projection;
+	StereoProjectionEdit(&eyeProjection, eyeSign, separation, convergence);
+	pCB->Projection = Math::Transpose(eyeProjection);
+}
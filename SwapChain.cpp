@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------
+// File: SwapChain.cpp
+//
+// Swap chain creation with flip model and frame latency control, plus the DXGI
+// presenter.
+//--------------------------------------------------------------------------------------
+
+#include "SwapChain.h"
+
+
+//--------------------------------------------------------------------------------------
+// Flip model swap chain, through IDXGIFactory2.  Fails if the OS is too old, or if
+// the config doesn't have enough buffers for flip model, in which case the caller
+// falls back to blt-model.
+//--------------------------------------------------------------------------------------
+static HRESULT CreateFlipSwapChain(IDXGIFactory1* pFactory, ID3D11Device* pDevice, HWND hWnd,
+	UINT width, UINT height, const SwapChainConfig& config, IDXGISwapChain** ppSwapChain, SwapChainInfo* pInfo)
+{
+	HRESULT hr;
+
+	if (config.BufferCount < 2)
+		return E_INVALIDARG;
+
+	IDXGIFactory2* pFactory2 = nullptr;
+	hr = pFactory->QueryInterface(__uuidof(IDXGIFactory2), reinterpret_cast<void**>(&pFactory2));
+	if (FAILED(hr))
+		return hr;
+
+	// The waitable object flag is only understood by DXGI 1.3.
+	BOOL waitable = FALSE;
+	if (config.WaitableObject)
+	{
+		IDXGIFactory3* pFactory3 = nullptr;
+		if (SUCCEEDED(pFactory->QueryInterface(__uuidof(IDXGIFactory3), reinterpret_cast<void**>(&pFactory3))))
+		{
+			waitable = TRUE;
+			pFactory3->Release();
+		}
+	}
+
+	DXGI_SWAP_CHAIN_DESC1 sd;
+	ZeroMemory(&sd, sizeof(sd));
+	sd.Width = width;
+	sd.Height = height;
+	sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	sd.SampleDesc.Count = 1;
+	sd.SampleDesc.Quality = 0;
+	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	sd.BufferCount = config.BufferCount;
+	sd.Scaling = DXGI_SCALING_STRETCH;
+	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+	sd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+	sd.Flags = waitable ? DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT : 0;
+
+	DXGI_SWAP_CHAIN_FULLSCREEN_DESC fsd;
+	ZeroMemory(&fsd, sizeof(fsd));
+	fsd.RefreshRate.Numerator = 120;	// Needs to be 120Hz for 3D Vision
+	fsd.RefreshRate.Denominator = 1;
+	fsd.Windowed = TRUE;
+
+	IDXGISwapChain1* pSwapChain1 = nullptr;
+	hr = pFactory2->CreateSwapChainForHwnd(pDevice, hWnd, &sd, &fsd, nullptr, &pSwapChain1);
+	pFactory2->Release();
+	if (FAILED(hr))
+		return hr;
+
+	pInfo->BufferCount = config.BufferCount;
+	pInfo->FlipModel = TRUE;
+	pInfo->FrameLatencyWaitable = nullptr;
+
+	if (waitable)
+	{
+		IDXGISwapChain2* pSwapChain2 = nullptr;
+		hr = pSwapChain1->QueryInterface(__uuidof(IDXGISwapChain2), reinterpret_cast<void**>(&pSwapChain2));
+		if (SUCCEEDED(hr))
+		{
+			pSwapChain2->SetMaximumFrameLatency(config.MaxFrameLatency);
+			pInfo->FrameLatencyWaitable = pSwapChain2->GetFrameLatencyWaitableObject();
+			pSwapChain2->Release();
+		}
+	}
+
+	*ppSwapChain = pSwapChain1;
+	return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The original swap chain from the sample, only the buffer count is configurable.
+//--------------------------------------------------------------------------------------
+static HRESULT CreateBltSwapChain(IDXGIFactory1* pFactory, ID3D11Device* pDevice, HWND hWnd,
+	UINT width, UINT height, const SwapChainConfig& config, IDXGISwapChain** ppSwapChain, SwapChainInfo* pInfo)
+{
+	DXGI_SWAP_CHAIN_DESC sd;
+	ZeroMemory(&sd, sizeof(sd));
+	sd.BufferCount = config.BufferCount ? config.BufferCount : 1;
+	sd.BufferDesc.Width = width;
+	sd.BufferDesc.Height = height;
+	sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	sd.BufferDesc.RefreshRate.Numerator = 120;	// Needs to be 120Hz for 3D Vision
+	sd.BufferDesc.RefreshRate.Denominator = 1;
+	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	sd.OutputWindow = hWnd;
+	sd.SampleDesc.Count = 1;
+	sd.SampleDesc.Quality = 0;
+	sd.Windowed = TRUE;
+	sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+
+	HRESULT hr = pFactory->CreateSwapChain(pDevice, &sd, ppSwapChain);
+	if (FAILED(hr))
+		return hr;
+
+	pInfo->BufferCount = sd.BufferCount;
+	pInfo->FlipModel = FALSE;
+	pInfo->FrameLatencyWaitable = nullptr;
+	return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Create the swap chain for an existing device, using the factory that made the
+// device.  Without the waitable object, the latency limit goes on the device instead.
+//--------------------------------------------------------------------------------------
+HRESULT CreateStereoSwapChain(ID3D11Device* pDevice, HWND hWnd, UINT width, UINT height,
+	const SwapChainConfig& config, IDXGISwapChain** ppSwapChain, SwapChainInfo* pInfo)
+{
+	HRESULT hr;
+
+	IDXGIDevice1* pDXGIDevice = nullptr;
+	hr = pDevice->QueryInterface(__uuidof(IDXGIDevice1), reinterpret_cast<void**>(&pDXGIDevice));
+	if (FAILED(hr))
+		return hr;
+
+	IDXGIAdapter* pAdapter = nullptr;
+	hr = pDXGIDevice->GetAdapter(&pAdapter);
+	if (FAILED(hr))
+	{
+		pDXGIDevice->Release();
+		return hr;
+	}
+
+	IDXGIFactory1* pFactory = nullptr;
+	hr = pAdapter->GetParent(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&pFactory));
+	pAdapter->Release();
+	if (FAILED(hr))
+	{
+		pDXGIDevice->Release();
+		return hr;
+	}
+
+	hr = E_FAIL;
+	if (config.FlipModel)
+		hr = CreateFlipSwapChain(pFactory, pDevice, hWnd, width, height, config, ppSwapChain, pInfo);
+	if (FAILED(hr))
+		hr = CreateBltSwapChain(pFactory, pDevice, hWnd, width, height, config, ppSwapChain, pInfo);
+	pFactory->Release();
+
+	if (SUCCEEDED(hr) && !pInfo->FrameLatencyWaitable)
+		pDXGIDevice->SetMaximumFrameLatency(config.MaxFrameLatency);
+	pDXGIDevice->Release();
+
+	return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// DXGIPresenter
+//
+// Does not hold a reference on the swap chain, the app owns that.  It does own
+// the waitable handle.
+//--------------------------------------------------------------------------------------
+DXGIPresenter::DXGIPresenter(IDXGISwapChain* pSwapChain, HANDLE frameLatencyWaitable)
+{
+	m_pSwapChain = pSwapChain;
+	m_FrameLatencyWaitable = frameLatencyWaitable;
+	QueryPerformanceFrequency(&m_QpcFrequency);
+}
+
+DXGIPresenter::~DXGIPresenter()
+{
+	if (m_FrameLatencyWaitable) CloseHandle(m_FrameLatencyWaitable);
+}
+
+bool DXGIPresenter::WaitForNextFrame(uint32_t timeoutMs)
+{
+	if (!m_FrameLatencyWaitable)
+		return true;
+	return WaitForSingleObjectEx(m_FrameLatencyWaitable, timeoutMs, TRUE) == WAIT_OBJECT_0;
+}
+
+bool DXGIPresenter::Present(uint32_t syncInterval)
+{
+	return SUCCEEDED(m_pSwapChain->Present(syncInterval, 0));
+}
+
+uint32_t DXGIPresenter::GetLastPresentCount()
+{
+	UINT count = 0;
+	m_pSwapChain->GetLastPresentCount(&count);
+	return count;
+}
+
+//--------------------------------------------------------------------------------------
+// Only works for full-screen or flip model.  Also fails with DISJOINT right after
+// a mode change, we just skip those frames.
+//--------------------------------------------------------------------------------------
+bool DXGIPresenter::GetFrameStatistics(PresentStatistics* pStats)
+{
+	DXGI_FRAME_STATISTICS fs;
+	if (FAILED(m_pSwapChain->GetFrameStatistics(&fs)))
+		return false;
+
+	pStats->PresentCount = fs.PresentCount;
+	pStats->PresentRefreshCount = fs.PresentRefreshCount;
+	pStats->SyncRefreshCount = fs.SyncRefreshCount;
+	pStats->SyncTimeNs = QpcToNs(fs.SyncQPCTime.QuadPart);
+	return true;
+}
+
+uint64_t DXGIPresenter::NowNs()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return QpcToNs(now.QuadPart);
+}
+
+uint64_t DXGIPresenter::QpcToNs(LONGLONG qpc) const
+{
+	// Split to avoid overflowing the multiply on long uptimes.
+	uint64_t freq = (uint64_t)m_QpcFrequency.QuadPart;
+	uint64_t ticks = (uint64_t)qpc;
+	return (ticks / freq) * 1000000000ull + ((ticks % freq) * 1000000000ull) / freq;
+}
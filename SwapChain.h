@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------
+// File: SwapChain.h
+//
+// Swap chain creation for the stereo device, and the DXGI implementation of
+// IPresenter.
+//
+// Flip model needs DXGI 1.2 (Win8) and the waitable object needs DXGI 1.3 (Win8.1).
+// The 3D Vision driver has historically only been happy with blt-model in Direct
+// Mode, so flip model is opt-in, and anything the system can't do falls back to
+// the original DISCARD swap chain instead of failing.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <windows.h>
+#include <d3d11.h>
+#include <dxgi1_3.h>
+
+#include "Presenter.h"
+
+
+//--------------------------------------------------------------------------------------
+// What we actually ended up with, after any fallbacks.
+//--------------------------------------------------------------------------------------
+struct SwapChainInfo
+{
+	UINT BufferCount;
+	BOOL FlipModel;
+	HANDLE FrameLatencyWaitable;	// nullptr unless the waitable object is in use
+};
+
+HRESULT CreateStereoSwapChain(ID3D11Device* pDevice, HWND hWnd, UINT width, UINT height,
+	const SwapChainConfig& config, IDXGISwapChain** ppSwapChain, SwapChainInfo* pInfo);
+
+
+//--------------------------------------------------------------------------------------
+// IPresenter on a real IDXGISwapChain.
+//--------------------------------------------------------------------------------------
+class DXGIPresenter : public IPresenter
+{
+public:
+	DXGIPresenter(IDXGISwapChain* pSwapChain, HANDLE frameLatencyWaitable);
+	~DXGIPresenter();
+
+	bool WaitForNextFrame(uint32_t timeoutMs);
+	bool Present(uint32_t syncInterval);
+	uint32_t GetLastPresentCount();
+	bool GetFrameStatistics(PresentStatistics* pStats);
+	uint64_t NowNs();
+
+private:
+	uint64_t QpcToNs(LONGLONG qpc) const;
+
+	IDXGISwapChain* m_pSwapChain;
+	HANDLE m_FrameLatencyWaitable;
+	LARGE_INTEGER m_QpcFrequency;
+};
@@ -0,0 +1,939 @@
+//--------------------------------------------------------------------------------------
+// File: TextureCodec.cpp
+//
+// Block decoders, scalar and SSE2, and the simple encoders.
+//--------------------------------------------------------------------------------------
+
+#include "TextureCodec.h"
+#include "StereoMath.h"
+
+#include <string.h>
+
+
+namespace
+{
+
+inline uint32_t Load16(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8); }
+inline uint32_t Load32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+inline uint64_t Load48(const uint8_t* p) { return (uint64_t)Load32(p) | ((uint64_t)Load16(p + 4) << 32); }
+
+// 5:6:5 to 8 bits a channel, the top bits repeated into the bottom.
+inline void Expand565(uint32_t c, uint8_t* pOut)
+{
+	uint32_t r = (c >> 11) & 31;
+	uint32_t g = (c >> 5) & 63;
+	uint32_t b = c & 31;
+	pOut[0] = (uint8_t)((r << 3) | (r >> 2));
+	pOut[1] = (uint8_t)((g << 2) | (g >> 4));
+	pOut[2] = (uint8_t)((b << 3) | (b >> 2));
+	pOut[3] = 255;
+}
+
+// Truncating, like the reference decoders.
+void BC1Palette(uint32_t c0, uint32_t c1, bool fourColors, uint8_t palette[4][4])
+{
+	Expand565(c0, palette[0]);
+	Expand565(c1, palette[1]);
+	if (fourColors)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+		palette[2][3] = 255;
+		palette[3][3] = 255;
+	}
+	else
+	{
+		for (int c = 0; c < 3; c++)
+			palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+		palette[2][3] = 255;
+		memset(palette[3], 0, 4);
+	}
+}
+
+void BC3AlphaPalette(uint32_t a0, uint32_t a1, uint8_t palette[8])
+{
+	palette[0] = (uint8_t)a0;
+	palette[1] = (uint8_t)a1;
+	if (a0 > a1)
+	{
+		for (uint32_t i = 1; i < 7; i++)
+			palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+	}
+	else
+	{
+		for (uint32_t i = 1; i < 5; i++)
+			palette[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+void DecodeBC1ColorScalar(const uint8_t* pBlock, bool alwaysFour, uint8_t* pOut, size_t pitch)
+{
+	uint32_t c0 = Load16(pBlock);
+	uint32_t c1 = Load16(pBlock + 2);
+	uint8_t palette[4][4];
+	BC1Palette(c0, c1, alwaysFour || c0 > c1, palette);
+
+	uint32_t indices = Load32(pBlock + 4);
+	for (uint32_t y = 0; y < 4; y++)
+		for (uint32_t x = 0; x < 4; x++)
+			memcpy(pOut + y * pitch + x * 4, palette[(indices >> (2 * (y * 4 + x))) & 3], 4);
+}
+
+void DecodeBC1Scalar(const uint8_t* pBlock, uint8_t* pOut, size_t pitch)
+{
+	DecodeBC1ColorScalar(pBlock, false, pOut, pitch);
+}
+
+void DecodeBC3Scalar(const uint8_t* pBlock, uint8_t* pOut, size_t pitch)
+{
+	DecodeBC1ColorScalar(pBlock + 8, true, pOut, pitch);
+
+	uint8_t palette[8];
+	BC3AlphaPalette(pBlock[0], pBlock[1], palette);
+	uint64_t indices = Load48(pBlock + 2);
+	for (uint32_t y = 0; y < 4; y++)
+		for (uint32_t x = 0; x < 4; x++)
+			pOut[y * pitch + x * 4 + 3] = palette[(indices >> (3 * (y * 4 + x))) & 7];
+}
+
+
+//--------------------------------------------------------------------------------------
+// BC7.  Eight modes, each a different split of the 128 bits between
+// partitions, endpoint precision and index precision.
+//--------------------------------------------------------------------------------------
+struct BC7Mode
+{
+	uint8_t Subsets;
+	uint8_t PartitionBits;
+	uint8_t RotationBits;
+	uint8_t IndexSelectionBits;
+	uint8_t ColorBits;
+	uint8_t AlphaBits;
+	uint8_t EndpointPBits;			// One per endpoint
+	uint8_t SharedPBits;			// One per subset
+	uint8_t IndexBits;
+	uint8_t IndexBits2;				// Separate alpha indices, modes 4 and 5
+};
+
+static const BC7Mode kBC7Modes[8] =
+{
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+};
+
+// Subset of each pixel, 2 bits a pixel, pixel 0 lowest.
+static const uint32_t kBC7Partitions2[64] =
+{
+	0x50505050, 0x40404040, 0x54545454, 0x54505040, 0x50404000, 0x55545450, 0x55545040, 0x54504000,
+	0x50400000, 0x55555450, 0x55544000, 0x54400000, 0x55555440, 0x55550000, 0x55555500, 0x55000000,
+	0x55150100, 0x00004054, 0x15010000, 0x00405054, 0x00004050, 0x15050100, 0x05010000, 0x40505054,
+	0x00404050, 0x05010100, 0x14141414, 0x05141450, 0x01155440, 0x00555500, 0x15014054, 0x05414150,
+	0x44444444, 0x55005500, 0x11441144, 0x05055050, 0x05500550, 0x11114444, 0x41144114, 0x44111144,
+	0x15055054, 0x01055040, 0x05041050, 0x05455150, 0x14414114, 0x50050550, 0x41411414, 0x00141400,
+	0x00041504, 0x00105410, 0x10541000, 0x04150400, 0x50410514, 0x41051450, 0x05415014, 0x14054150,
+	0x41050514, 0x41505014, 0x40011554, 0x54150140, 0x50505500, 0x00555050, 0x15151010, 0x54540404,
+};
+
+static const uint32_t kBC7Partitions3[64] =
+{
+	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+	0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+	0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+	0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+	0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+	0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+};
+
+// The pixel of each subset after the first whose index drops its top bit.
+static const uint8_t kBC7Anchors2[64] =
+{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+static const uint8_t kBC7Anchors3Second[64] =
+{
+	 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+	 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+	 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+	 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+};
+
+static const uint8_t kBC7Anchors3Third[64] =
+{
+	15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+	15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+	15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+	15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+};
+
+static const uint8_t kBC7Weights2[4] = { 0, 21, 43, 64 };
+static const uint8_t kBC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline const uint8_t* BC7Weights(uint32_t indexBits)
+{
+	return (indexBits == 2) ? kBC7Weights2 : (indexBits == 3) ? kBC7Weights3 : kBC7Weights4;
+}
+
+inline uint8_t BC7Interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+{
+	return (uint8_t)(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+// The block's 128 bits, read from the bottom up.
+struct BC7Bits
+{
+	uint64_t Lo;
+	uint64_t Hi;
+	uint32_t Position;
+
+	uint32_t Read(uint32_t count)
+	{
+		uint64_t bits;
+		if (Position >= 64)
+			bits = Hi >> (Position - 64);
+		else if (Position + count <= 64)
+			bits = Lo >> Position;
+		else
+			bits = (Lo >> Position) | (Hi << (64 - Position));
+		Position += count;
+		return (uint32_t)bits & ((1u << count) - 1);
+	}
+};
+
+// A block with its fields pulled out and the endpoints back to 8 bits.
+struct BC7Block
+{
+	uint32_t Subsets;
+	uint32_t Partition;				// 2 bits a pixel
+	uint32_t Rotation;
+	uint32_t ColorIndexBits;
+	uint32_t AlphaIndexBits;		// 0 when alpha uses the color indices
+	uint8_t Endpoints[3][2][4];
+	uint8_t ColorIndices[16];
+	uint8_t AlphaIndices[16];
+};
+
+// False for the reserved mode, which decodes to zero.
+bool UnpackBC7(const uint8_t* pBlock, BC7Block* b)
+{
+	uint32_t modeByte = pBlock[0];
+	if (modeByte == 0)
+		return false;
+	uint32_t mode = 0;
+	while (!(modeByte & (1u << mode)))
+		mode++;
+	const BC7Mode& m = kBC7Modes[mode];
+
+	BC7Bits bits;
+	memcpy(&bits.Lo, pBlock, 8);
+	memcpy(&bits.Hi, pBlock + 8, 8);
+	bits.Position = mode + 1;
+
+	uint32_t partition = bits.Read(m.PartitionBits);
+	b->Rotation = bits.Read(m.RotationBits);
+	uint32_t indexSelection = bits.Read(m.IndexSelectionBits);
+	b->Subsets = m.Subsets;
+	b->Partition = (m.Subsets == 2) ? kBC7Partitions2[partition] : (m.Subsets == 3) ? kBC7Partitions3[partition] : 0;
+
+	// All the endpoints' reds, then greens, blues and alphas.
+	uint32_t endpoints = m.Subsets * 2;
+	uint32_t raw[6][4];
+	for (uint32_t c = 0; c < 3; c++)
+		for (uint32_t e = 0; e < endpoints; e++)
+			raw[e][c] = bits.Read(m.ColorBits);
+	for (uint32_t e = 0; e < endpoints; e++)
+		raw[e][3] = bits.Read(m.AlphaBits);
+
+	uint32_t pBits[6] = { 0, 0, 0, 0, 0, 0 };
+	bool hasPBits = m.EndpointPBits || m.SharedPBits;
+	if (m.EndpointPBits)
+	{
+		for (uint32_t e = 0; e < endpoints; e++)
+			pBits[e] = bits.Read(1);
+	}
+	else if (m.SharedPBits)
+	{
+		for (uint32_t s = 0; s < m.Subsets; s++)
+			pBits[2 * s] = pBits[2 * s + 1] = bits.Read(1);
+	}
+
+	for (uint32_t e = 0; e < endpoints; e++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			uint32_t precision = (c < 3) ? m.ColorBits : m.AlphaBits;
+			if (precision == 0)
+			{
+				b->Endpoints[e / 2][e % 2][c] = 255;
+				continue;
+			}
+			uint32_t v = raw[e][c];
+			if (hasPBits)
+			{
+				v = (v << 1) | pBits[e];
+				precision++;
+			}
+			v <<= 8 - precision;
+			b->Endpoints[e / 2][e % 2][c] = (uint8_t)(v | (v >> precision));
+		}
+	}
+
+	uint32_t anchor2 = (m.Subsets == 2) ? kBC7Anchors2[partition] : (m.Subsets == 3) ? kBC7Anchors3Second[partition] : 0;
+	uint32_t anchor3 = (m.Subsets == 3) ? kBC7Anchors3Third[partition] : 0;
+	uint8_t primary[16];
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		bool anchor = (i == 0) || (m.Subsets > 1 && i == anchor2) || (m.Subsets > 2 && i == anchor3);
+		primary[i] = (uint8_t)bits.Read(m.IndexBits - (anchor ? 1 : 0));
+	}
+
+	if (m.IndexBits2 == 0)
+	{
+		memcpy(b->ColorIndices, primary, 16);
+		b->ColorIndexBits = m.IndexBits;
+		b->AlphaIndexBits = 0;
+		return true;
+	}
+
+	uint8_t secondary[16];
+	for (uint32_t i = 0; i < 16; i++)
+		secondary[i] = (uint8_t)bits.Read(m.IndexBits2 - (i == 0 ? 1 : 0));
+	if (indexSelection)
+	{
+		memcpy(b->ColorIndices, secondary, 16);
+		memcpy(b->AlphaIndices, primary, 16);
+		b->ColorIndexBits = m.IndexBits2;
+		b->AlphaIndexBits = m.IndexBits;
+	}
+	else
+	{
+		memcpy(b->ColorIndices, primary, 16);
+		memcpy(b->AlphaIndices, secondary, 16);
+		b->ColorIndexBits = m.IndexBits;
+		b->AlphaIndexBits = m.IndexBits2;
+	}
+	return true;
+}
+
+// Every palette entry gets all four channels from the color weights, and
+// separate alpha indices get their own palette, from the first subset.
+void BC7PalettesScalar(const BC7Block& b, uint8_t colors[3][16][4], uint8_t alphas[16])
+{
+	uint32_t entries = 1u << b.ColorIndexBits;
+	const uint8_t* pWeights = BC7Weights(b.ColorIndexBits);
+	for (uint32_t s = 0; s < b.Subsets; s++)
+		for (uint32_t i = 0; i < entries; i++)
+			for (uint32_t c = 0; c < 4; c++)
+				colors[s][i][c] = BC7Interpolate(b.Endpoints[s][0][c], b.Endpoints[s][1][c], pWeights[i]);
+
+	if (b.AlphaIndexBits)
+	{
+		pWeights = BC7Weights(b.AlphaIndexBits);
+		for (uint32_t i = 0; i < (1u << b.AlphaIndexBits); i++)
+			alphas[i] = BC7Interpolate(b.Endpoints[0][0][3], b.Endpoints[0][1][3], pWeights[i]);
+	}
+}
+
+void BC7WritePixels(const BC7Block& b, const uint8_t colors[3][16][4], const uint8_t alphas[16], uint8_t* pOut, size_t pitch)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		uint8_t* p = pOut + (i / 4) * pitch + (i % 4) * 4;
+		memcpy(p, colors[(b.Partition >> (2 * i)) & 3][b.ColorIndices[i]], 4);
+		if (b.AlphaIndexBits)
+			p[3] = alphas[b.AlphaIndices[i]];
+		if (b.Rotation)
+		{
+			uint8_t swap = p[3];
+			p[3] = p[b.Rotation - 1];
+			p[b.Rotation - 1] = swap;
+		}
+	}
+}
+
+void DecodeBC7Zero(uint8_t* pOut, size_t pitch)
+{
+	for (uint32_t y = 0; y < 4; y++)
+		memset(pOut + y * pitch, 0, 16);
+}
+
+void DecodeBC7Scalar(const uint8_t* pBlock, uint8_t* pOut, size_t pitch)
+{
+	BC7Block b;
+	if (!UnpackBC7(pBlock, &b))
+	{
+		DecodeBC7Zero(pOut, pitch);
+		return;
+	}
+	uint8_t colors[3][16][4];
+	uint8_t alphas[16];
+	BC7PalettesScalar(b, colors, alphas);
+	BC7WritePixels(b, colors, alphas, pOut, pitch);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Whole mips, the blocks on the right and bottom edges through a scratch
+// block when the mip isn't a multiple of four.
+//--------------------------------------------------------------------------------------
+typedef void (*BlockDecoder)(const uint8_t* pBlock, uint8_t* pOut, size_t pitch);
+
+template <BlockDecoder Decode>
+void DecodeBlocks(const uint8_t* pBlocks, uint32_t blockBytes, uint32_t width, uint32_t height, uint8_t* pRGBA, size_t pitch)
+{
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			const uint8_t* pBlock = pBlocks + ((size_t)by * blocksWide + bx) * blockBytes;
+			uint32_t x = bx * 4;
+			uint32_t y = by * 4;
+			uint8_t* pOut = pRGBA + y * pitch + x * 4;
+			if (x + 4 <= width && y + 4 <= height)
+			{
+				Decode(pBlock, pOut, pitch);
+				continue;
+			}
+
+			uint8_t scratch[64];
+			Decode(pBlock, scratch, 16);
+			uint32_t columns = (width - x < 4) ? width - x : 4;
+			uint32_t rows = (height - y < 4) ? height - y : 4;
+			for (uint32_t r = 0; r < rows; r++)
+				memcpy(pOut + r * pitch, scratch + r * 16, columns * 4);
+		}
+	}
+}
+
+}
+
+
+void DecodeTextureScalar(TextureFormat format, const void* pBlocks, uint32_t width, uint32_t height,
+	uint8_t* pRGBA, size_t pitch)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(pBlocks);
+	switch (format)
+	{
+	case TEXTURE_BC1:	DecodeBlocks<DecodeBC1Scalar>(p, 8, width, height, pRGBA, pitch); break;
+	case TEXTURE_BC3:	DecodeBlocks<DecodeBC3Scalar>(p, 16, width, height, pRGBA, pitch); break;
+	case TEXTURE_BC7:	DecodeBlocks<DecodeBC7Scalar>(p, 16, width, height, pRGBA, pitch); break;
+	default:			break;
+	}
+}
+
+
+#if STEREO_MATH_SSE
+namespace
+{
+
+//--------------------------------------------------------------------------------------
+// The palette is four 32 bit colors in one register.  Each row of four pixels
+// is one byte of indices, broadcast, each lane masked to its own two bits and
+// compared against each index in that lane's position, and the palette entry
+// broadcast to all lanes kept where it matched.
+//--------------------------------------------------------------------------------------
+inline __m128i BC1PaletteSSE(uint32_t c0, uint32_t c1, bool fourColors)
+{
+	uint8_t ends[2][4];
+	Expand565(c0, ends[0]);
+	Expand565(c1, ends[1]);
+	__m128i endBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ends));
+
+	// c0 and c1 as 16 bit lanes, and swapped, so one add makes both mixes.
+	__m128i e = _mm_unpacklo_epi8(endBytes, _mm_setzero_si128());
+	__m128i swapped = _mm_shuffle_epi32(e, _MM_SHUFFLE(1, 0, 3, 2));
+	__m128i mixes;
+	if (fourColors)
+	{
+		// x / 3 is (x * 0xAAAB) >> 17 for every x up to 3 * 255.
+		__m128i sum = _mm_add_epi16(_mm_add_epi16(e, e), swapped);
+		mixes = _mm_srli_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16((short)0xAAAB)), 1);
+	}
+	else
+	{
+		mixes = _mm_srli_epi16(_mm_add_epi16(e, swapped), 1);
+		mixes = _mm_and_si128(mixes, _mm_setr_epi32(-1, -1, 0, 0));
+	}
+	return _mm_unpacklo_epi64(endBytes, _mm_packus_epi16(mixes, mixes));
+}
+
+inline void BC1WriteRowsSSE(__m128i palette, uint32_t indices, __m128i alphaMask, const __m128i* pAlpha,
+	uint8_t* pOut, size_t pitch)
+{
+	const __m128i laneMask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+	const __m128i one = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+	const __m128i two = _mm_add_epi32(one, one);
+	const __m128i three = laneMask;
+	__m128i p0 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128i p1 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128i p2 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128i p3 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(3, 3, 3, 3));
+
+	for (uint32_t y = 0; y < 4; y++)
+	{
+		__m128i lanes = _mm_and_si128(_mm_set1_epi32((int)(indices >> (8 * y))), laneMask);
+		__m128i row = _mm_and_si128(_mm_cmpeq_epi32(lanes, _mm_setzero_si128()), p0);
+		row = _mm_or_si128(row, _mm_and_si128(_mm_cmpeq_epi32(lanes, one), p1));
+		row = _mm_or_si128(row, _mm_and_si128(_mm_cmpeq_epi32(lanes, two), p2));
+		row = _mm_or_si128(row, _mm_and_si128(_mm_cmpeq_epi32(lanes, three), p3));
+		if (pAlpha)
+			row = _mm_or_si128(_mm_andnot_si128(alphaMask, row), pAlpha[y]);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + y * pitch), row);
+	}
+}
+
+void DecodeBC1SSE(const uint8_t* pBlock, uint8_t* pOut, size_t pitch)
+{
+	uint32_t c0 = Load16(pBlock);
+	uint32_t c1 = Load16(pBlock + 2);
+	BC1WriteRowsSSE(BC1PaletteSSE(c0, c1, c0 > c1), Load32(pBlock + 4), _mm_setzero_si128(), nullptr, pOut, pitch);
+}
+
+// SSE2 has no byte shuffle, so the alpha indices are looked up one at a time
+// and the bytes widened into the top of each lane, then merged over the color.
+void DecodeBC3SSE(const uint8_t* pBlock, uint8_t* pOut, size_t pitch)
+{
+	uint8_t palette[8];
+	BC3AlphaPalette(pBlock[0], pBlock[1], palette);
+	uint64_t indices = Load48(pBlock + 2);
+	uint8_t alphas[16];
+	for (uint32_t i = 0; i < 16; i++)
+		alphas[i] = palette[(indices >> (3 * i)) & 7];
+
+	__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alphas));
+	__m128i words[2] = { _mm_unpacklo_epi8(_mm_setzero_si128(), bytes), _mm_unpackhi_epi8(_mm_setzero_si128(), bytes) };
+	__m128i rows[4];
+	for (int half = 0; half < 2; half++)
+	{
+		rows[half * 2] = _mm_unpacklo_epi16(_mm_setzero_si128(), words[half]);
+		rows[half * 2 + 1] = _mm_unpackhi_epi16(_mm_setzero_si128(), words[half]);
+	}
+
+	uint32_t c0 = Load16(pBlock + 8);
+	uint32_t c1 = Load16(pBlock + 10);
+	BC1WriteRowsSSE(BC1PaletteSSE(c0, c1, true), Load32(pBlock + 12), _mm_set1_epi32((int)0xFF000000), rows, pOut, pitch);
+}
+
+//--------------------------------------------------------------------------------------
+// Two palette entries a step: both endpoints' four channels in 16 bit lanes,
+// weighted, and packed back to bytes.
+//--------------------------------------------------------------------------------------
+void BC7PalettesSSE(const BC7Block& b, uint8_t colors[3][16][4], uint8_t alphas[16])
+{
+	const __m128i rounding = _mm_set1_epi16(32);
+	const __m128i sixtyFour = _mm_set1_epi16(64);
+	uint32_t entries = 1u << b.ColorIndexBits;
+	const uint8_t* pWeights = BC7Weights(b.ColorIndexBits);
+	for (uint32_t s = 0; s < b.Subsets; s++)
+	{
+		uint32_t e0;
+		uint32_t e1;
+		memcpy(&e0, b.Endpoints[s][0], 4);
+		memcpy(&e1, b.Endpoints[s][1], 4);
+		__m128i ends0 = _mm_unpacklo_epi8(_mm_set1_epi32((int)e0), _mm_setzero_si128());
+		__m128i ends1 = _mm_unpacklo_epi8(_mm_set1_epi32((int)e1), _mm_setzero_si128());
+		for (uint32_t i = 0; i < entries; i += 2)
+		{
+			__m128i w = _mm_setr_epi16(pWeights[i], pWeights[i], pWeights[i], pWeights[i],
+				pWeights[i + 1], pWeights[i + 1], pWeights[i + 1], pWeights[i + 1]);
+			__m128i mix = _mm_add_epi16(_mm_mullo_epi16(ends0, _mm_sub_epi16(sixtyFour, w)), _mm_mullo_epi16(ends1, w));
+			mix = _mm_srli_epi16(_mm_add_epi16(mix, rounding), 6);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(colors[s][i]), _mm_packus_epi16(mix, mix));
+		}
+	}
+
+	if (b.AlphaIndexBits)
+	{
+		pWeights = BC7Weights(b.AlphaIndexBits);
+		for (uint32_t i = 0; i < (1u << b.AlphaIndexBits); i++)
+			alphas[i] = BC7Interpolate(b.Endpoints[0][0][3], b.Endpoints[0][1][3], pWeights[i]);
+	}
+}
+
+void DecodeBC7SSE(const uint8_t* pBlock, uint8_t* pOut, size_t pitch)
+{
+	BC7Block b;
+	if (!UnpackBC7(pBlock, &b))
+	{
+		DecodeBC7Zero(pOut, pitch);
+		return;
+	}
+	uint8_t colors[3][16][4];
+	uint8_t alphas[16];
+	BC7PalettesSSE(b, colors, alphas);
+	BC7WritePixels(b, colors, alphas, pOut, pitch);
+}
+
+}
+
+void DecodeTextureSIMD(TextureFormat format, const void* pBlocks, uint32_t width, uint32_t height,
+	uint8_t* pRGBA, size_t pitch)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(pBlocks);
+	switch (format)
+	{
+	case TEXTURE_BC1:	DecodeBlocks<DecodeBC1SSE>(p, 8, width, height, pRGBA, pitch); break;
+	case TEXTURE_BC3:	DecodeBlocks<DecodeBC3SSE>(p, 16, width, height, pRGBA, pitch); break;
+	case TEXTURE_BC7:	DecodeBlocks<DecodeBC7SSE>(p, 16, width, height, pRGBA, pitch); break;
+	default:			break;
+	}
+}
+#else
+void DecodeTextureSIMD(TextureFormat format, const void* pBlocks, uint32_t width, uint32_t height,
+	uint8_t* pRGBA, size_t pitch)
+{
+	DecodeTextureScalar(format, pBlocks, width, height, pRGBA, pitch);
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Encoding
+//--------------------------------------------------------------------------------------
+namespace
+{
+
+inline uint32_t ColorDistance(const uint8_t* a, const uint8_t* b, uint32_t channels)
+{
+	uint32_t d = 0;
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		int delta = (int)a[c] - (int)b[c];
+		d += (uint32_t)(delta * delta);
+	}
+	return d;
+}
+
+// Index of the palette entry nearest each pixel.
+uint64_t NearestIndices(const uint8_t pixels[16][4], const uint8_t (*palette)[4], uint32_t entries, uint32_t channels,
+	uint32_t indexBits)
+{
+	uint64_t indices = 0;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		uint32_t best = 0;
+		uint32_t bestDistance = ColorDistance(pixels[i], palette[0], channels);
+		for (uint32_t k = 1; k < entries; k++)
+		{
+			uint32_t d = ColorDistance(pixels[i], palette[k], channels);
+			if (d < bestDistance)
+			{
+				best = k;
+				bestDistance = d;
+			}
+		}
+		indices |= (uint64_t)best << (indexBits * i);
+	}
+	return indices;
+}
+
+inline uint32_t Pack565(const uint8_t* c)
+{
+	return (((c[0] * 31u + 127) / 255) << 11) | (((c[1] * 63u + 127) / 255) << 5) | ((c[2] * 31u + 127) / 255);
+}
+
+// Four color mode always, c0 above c1, or both the same and every index 0.
+void EncodeBC1Color(const uint8_t pixels[16][4], uint8_t* pOut)
+{
+	uint8_t lo[3] = { 255, 255, 255 };
+	uint8_t hi[3] = { 0, 0, 0 };
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			lo[c] = (pixels[i][c] < lo[c]) ? pixels[i][c] : lo[c];
+			hi[c] = (pixels[i][c] > hi[c]) ? pixels[i][c] : hi[c];
+		}
+	}
+	// Inset a sixteenth, which the extremes lose less to than the rest gain.
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		uint8_t inset = (uint8_t)((hi[c] - lo[c]) / 16);
+		lo[c] = (uint8_t)(lo[c] + inset);
+		hi[c] = (uint8_t)(hi[c] - inset);
+	}
+
+	uint32_t c0 = Pack565(hi);
+	uint32_t c1 = Pack565(lo);
+	if (c0 < c1)
+	{
+		uint32_t swap = c0;
+		c0 = c1;
+		c1 = swap;
+	}
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		uint8_t palette[4][4];
+		BC1Palette(c0, c1, true, palette);
+		indices = (uint32_t)NearestIndices(pixels, palette, 4, 3, 2);
+	}
+	pOut[0] = (uint8_t)c0;
+	pOut[1] = (uint8_t)(c0 >> 8);
+	pOut[2] = (uint8_t)c1;
+	pOut[3] = (uint8_t)(c1 >> 8);
+	memcpy(pOut + 4, &indices, 4);
+}
+
+void EncodeBC3Alpha(const uint8_t pixels[16][4], uint8_t* pOut)
+{
+	uint32_t lo = 255;
+	uint32_t hi = 0;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		lo = (pixels[i][3] < lo) ? pixels[i][3] : lo;
+		hi = (pixels[i][3] > hi) ? pixels[i][3] : hi;
+	}
+	uint64_t indices = 0;
+	if (hi != lo)
+	{
+		uint8_t palette[8];
+		BC3AlphaPalette(hi, lo, palette);
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t best = 0;
+			uint32_t bestDistance = 256;
+			for (uint32_t k = 0; k < 8; k++)
+			{
+				uint32_t d = (pixels[i][3] > palette[k]) ? pixels[i][3] - palette[k] : palette[k] - pixels[i][3];
+				if (d < bestDistance)
+				{
+					best = k;
+					bestDistance = d;
+				}
+			}
+			indices |= (uint64_t)best << (3 * i);
+		}
+	}
+	pOut[0] = (uint8_t)hi;
+	pOut[1] = (uint8_t)lo;
+	for (uint32_t b = 0; b < 6; b++)
+		pOut[2 + b] = (uint8_t)(indices >> (8 * b));
+}
+
+// A 7 bit value and p bit nearest v, trying both p bits.
+void QuantizeMode6Endpoint(const uint8_t* v, uint32_t* pValues, uint32_t* pPBit)
+{
+	uint32_t bestError = ~0u;
+	for (uint32_t p = 0; p < 2; p++)
+	{
+		uint32_t error = 0;
+		uint32_t values[4];
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			int q = ((int)v[c] - (int)p + 1) / 2;
+			q = (q < 0) ? 0 : (q > 127) ? 127 : q;
+			values[c] = (uint32_t)q;
+			int delta = (int)(((uint32_t)q << 1) | p) - (int)v[c];
+			error += (uint32_t)(delta * delta);
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			memcpy(pValues, values, sizeof(values));
+			*pPBit = p;
+		}
+	}
+}
+
+struct BitWriter
+{
+	uint8_t* pOut;
+	uint32_t Position;
+
+	void Write(uint32_t value, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++, Position++)
+			if ((value >> i) & 1)
+				pOut[Position / 8] |= (uint8_t)(1u << (Position % 8));
+	}
+};
+
+// Mode 6, one subset, 7 bit RGBA endpoints with a p bit each and 4 bit
+// indices.  Pixel 0's index has no top bit, so the endpoints swap when it
+// would need one.
+void EncodeBC7Mode6(const uint8_t pixels[16][4], uint8_t* pOut)
+{
+	uint8_t ends[2][4] = { { 255, 255, 255, 255 }, { 0, 0, 0, 0 } };
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			ends[0][c] = (pixels[i][c] < ends[0][c]) ? pixels[i][c] : ends[0][c];
+			ends[1][c] = (pixels[i][c] > ends[1][c]) ? pixels[i][c] : ends[1][c];
+		}
+	}
+
+	uint32_t values[2][4];
+	uint32_t pBits[2];
+	uint8_t decoded[2][4];
+	for (uint32_t e = 0; e < 2; e++)
+	{
+		QuantizeMode6Endpoint(ends[e], values[e], &pBits[e]);
+		for (uint32_t c = 0; c < 4; c++)
+			decoded[e][c] = (uint8_t)((values[e][c] << 1) | pBits[e]);
+	}
+
+	uint8_t palette[16][4];
+	for (uint32_t k = 0; k < 16; k++)
+		for (uint32_t c = 0; c < 4; c++)
+			palette[k][c] = BC7Interpolate(decoded[0][c], decoded[1][c], kBC7Weights4[k]);
+	uint64_t indices = NearestIndices(pixels, palette, 16, 4, 4);
+
+	uint32_t first = 0;
+	if (indices & 8)
+	{
+		indices = ~indices;
+		first = 1;
+	}
+
+	memset(pOut, 0, 16);
+	BitWriter bits = { pOut, 0 };
+	bits.Write(1u << 6, 7);
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		bits.Write(values[first][c], 7);
+		bits.Write(values[first ^ 1][c], 7);
+	}
+	bits.Write(pBits[first], 1);
+	bits.Write(pBits[first ^ 1], 1);
+	bits.Write((uint32_t)indices & 7, 3);
+	for (uint32_t i = 1; i < 16; i++)
+		bits.Write((uint32_t)(indices >> (4 * i)) & 15, 4);
+}
+
+void Downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height, std::vector<uint8_t>* pOut)
+{
+	uint32_t outWidth = TextureMipSize(width, 1);
+	uint32_t outHeight = TextureMipSize(height, 1);
+	pOut->resize((size_t)outWidth * outHeight * 4);
+	for (uint32_t y = 0; y < outHeight; y++)
+	{
+		uint32_t y0 = (2 * y < height) ? 2 * y : height - 1;
+		uint32_t y1 = (2 * y + 1 < height) ? 2 * y + 1 : height - 1;
+		for (uint32_t x = 0; x < outWidth; x++)
+		{
+			uint32_t x0 = (2 * x < width) ? 2 * x : width - 1;
+			uint32_t x1 = (2 * x + 1 < width) ? 2 * x + 1 : width - 1;
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				uint32_t sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c] +
+					source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+				(*pOut)[((size_t)y * outWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+}
+
+
+void EncodeTexture(TextureFormat format, const uint8_t* pRGBA, uint32_t width, uint32_t height, size_t pitch,
+	std::vector<uint8_t>* pBlocks)
+{
+	uint32_t blockBytes = TextureBlockBytes(format);
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	pBlocks->assign((size_t)blocksWide * blocksHigh * blockBytes, 0);
+
+	for (uint32_t by = 0; by < blocksHigh; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksWide; bx++)
+		{
+			uint8_t pixels[16][4];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = bx * 4 + i % 4;
+				uint32_t y = by * 4 + i / 4;
+				x = (x < width) ? x : width - 1;
+				y = (y < height) ? y : height - 1;
+				memcpy(pixels[i], pRGBA + y * pitch + x * 4, 4);
+			}
+
+			uint8_t* pOut = &(*pBlocks)[((size_t)by * blocksWide + bx) * blockBytes];
+			switch (format)
+			{
+			case TEXTURE_BC1:
+				EncodeBC1Color(pixels, pOut);
+				break;
+			case TEXTURE_BC3:
+				EncodeBC3Alpha(pixels, pOut);
+				EncodeBC1Color(pixels, pOut + 8);
+				break;
+			case TEXTURE_BC7:
+				EncodeBC7Mode6(pixels, pOut);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void BuildTexture(TextureFormat format, const uint8_t* pRGBA, uint32_t width, uint32_t height, uint32_t mipCount,
+	TextureData* pTexture)
+{
+	uint32_t fullCount = 1;
+	while ((TextureMipSize(width, fullCount - 1) > 1 || TextureMipSize(height, fullCount - 1) > 1) && fullCount < kTextureMaxMips)
+		fullCount++;
+	if (mipCount == 0 || mipCount > fullCount)
+		mipCount = fullCount;
+
+	pTexture->Format = format;
+	pTexture->Width = width;
+	pTexture->Height = height;
+	pTexture->Mips.resize(mipCount);
+
+	std::vector<uint8_t> level(pRGBA, pRGBA + (size_t)width * height * 4);
+	std::vector<uint8_t> next;
+	for (uint32_t m = 0; m < mipCount; m++)
+	{
+		uint32_t w = TextureMipSize(width, m);
+		uint32_t h = TextureMipSize(height, m);
+		EncodeTexture(format, &level[0], w, h, (size_t)w * 4, &pTexture->Mips[m]);
+		if (m + 1 < mipCount)
+		{
+			Downsample(level, w, h, &next);
+			level.swap(next);
+		}
+	}
+}
+
+void BuildCheckerImage(uint32_t width, uint32_t height, uint32_t cells, std::vector<uint8_t>* pRGBA)
+{
+	pRGBA->resize((size_t)width * height * 4);
+	uint32_t cellWidth = (width / cells) ? width / cells : 1;
+	uint32_t cellHeight = (height / cells) ? height / cells : 1;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			bool light = (((x / cellWidth) + (y / cellHeight)) & 1) != 0;
+			uint32_t gray = light ? 160 : 96;
+			uint8_t* p = &(*pRGBA)[((size_t)y * width + x) * 4];
+			p[0] = (uint8_t)(gray + (32 * x) / width);
+			p[1] = (uint8_t)gray;
+			p[2] = (uint8_t)(gray + (32 * y) / height);
+			p[3] = (uint8_t)(255 - (128 * x) / width);
+		}
+	}
+}
@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------------------
+// File: TextureCodec.h
+//
+// BC1, BC3 and BC7 blocks to RGBA8 and back, for drawing block compressed
+// textures without a GPU and for making them.
+//
+// Decoding follows the D3D11 rules: a BC1 block whose first endpoint isn't
+// above its second has three colors and transparent black, BC3's color block
+// always has four, and a BC7 block with no mode bit set is transparent black.
+// DecodeTextureScalar is plain C++ and DecodeTextureSIMD the SSE2 version,
+// both compiled where SSE2 exists so a benchmark can compare them, and they
+// give the same bytes.  The SSE2 BC1 and BC3 decoders build the palette in one
+// register and pick each row of four pixels out of it with compares.  BC7's
+// bits are unpacked the same way in both, one field at a time, and the SSE2
+// version builds its palettes two entries a step in 16 bit lanes.
+//
+// The encoders are simple and quick: bounding box endpoints and the nearest
+// palette entry for each pixel, and BC7 in mode 6 only.  They are for test
+// textures and the converter, not for shipping assets, which want a real
+// compressor.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "TextureFile.h"
+
+
+// pBlocks is a mip's rows of blocks, pRGBA gets width x height pixels, 4 bytes
+// each, R first, pitch bytes between rows.
+void DecodeTextureScalar(TextureFormat format, const void* pBlocks, uint32_t width, uint32_t height,
+	uint8_t* pRGBA, size_t pitch);
+
+void DecodeTextureSIMD(TextureFormat format, const void* pBlocks, uint32_t width, uint32_t height,
+	uint8_t* pRGBA, size_t pitch);
+
+// The other way, edge blocks padded by repeating the last row and column.
+void EncodeTexture(TextureFormat format, const uint8_t* pRGBA, uint32_t width, uint32_t height, size_t pitch,
+	std::vector<uint8_t>* pBlocks);
+
+// Box filtered down to mipCount mips, 0 for all of them, and each encoded.
+void BuildTexture(TextureFormat format, const uint8_t* pRGBA, uint32_t width, uint32_t height, uint32_t mipCount,
+	TextureData* pTexture);
+
+// Gray checks, cells on a side, tinted across the image so that no two blocks
+// are alike and the mips differ, and alpha falling off to the right.
+void BuildCheckerImage(uint32_t width, uint32_t height, uint32_t cells, std::vector<uint8_t>* pRGBA);
@@ -0,0 +1,225 @@
+//--------------------------------------------------------------------------------------
+// File: TextureFile.cpp
+//
+// Writing and checking texture files.
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "TextureFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static_assert(sizeof(TextureFileHeader) == 64, "TextureFileHeader is written to files as is");
+static_assert(sizeof(TextureMip) == 24, "TextureMip is written to files as is");
+
+uint32_t TextureBlockBytes(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1:	return 8;
+	case TEXTURE_BC3:	return 16;
+	case TEXTURE_BC7:	return 16;
+	default:			return 0;
+	}
+}
+
+const char* TextureFormatName(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1:	return "bc1";
+	case TEXTURE_BC3:	return "bc3";
+	case TEXTURE_BC7:	return "bc7";
+	default:			return "unknown";
+	}
+}
+
+uint32_t TextureTailMip(uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+		if (TextureMipSize(width, mip) <= kTextureTailSize && TextureMipSize(height, mip) <= kTextureTailSize)
+			return mip;
+	return mipCount - 1;
+}
+
+static uint64_t AlignUp(uint64_t offset)
+{
+	return (offset + kTextureFileAlignment - 1) & ~(uint64_t)(kTextureFileAlignment - 1);
+}
+
+// Mips down to 1x1, at most kTextureMaxMips.
+static uint32_t FullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while ((width > 1 || height > 1) && count < kTextureMaxMips)
+	{
+		width = TextureMipSize(width, 1);
+		height = TextureMipSize(height, 1);
+		count++;
+	}
+	return count;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Writing
+//--------------------------------------------------------------------------------------
+bool SerializeTexture(const TextureData& texture, std::vector<uint8_t>* pImage)
+{
+	uint32_t mipCount = (uint32_t)texture.Mips.size();
+	if (texture.Format >= TEXTURE_FORMAT_COUNT || texture.Width == 0 || texture.Height == 0 ||
+		mipCount == 0 || mipCount > FullMipCount(texture.Width, texture.Height))
+		return false;
+
+	TextureFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Magic = kTextureFileMagic;
+	header.Version = kTextureFileVersion;
+	header.HeaderBytes = sizeof(TextureFileHeader);
+	header.Format = texture.Format;
+	header.Width = texture.Width;
+	header.Height = texture.Height;
+	header.MipCount = mipCount;
+	header.TailMip = TextureTailMip(texture.Width, texture.Height, mipCount);
+	header.MipOffset = sizeof(TextureFileHeader);
+
+	std::vector<TextureMip> mips(mipCount);
+	uint64_t offset = AlignUp(header.MipOffset + mipCount * sizeof(TextureMip));
+	for (uint32_t m = mipCount; m-- > 0; )
+	{
+		TextureMip& mip = mips[m];
+		mip.Width = TextureMipSize(texture.Width, m);
+		mip.Height = TextureMipSize(texture.Height, m);
+		mip.RowBytes = TextureRowBytes(texture.Format, mip.Width);
+		mip.Bytes = (uint32_t)TextureMipBytes(texture.Format, mip.Width, mip.Height);
+		if (texture.Mips[m].size() != mip.Bytes)
+			return false;
+		mip.Offset = offset;
+		offset = AlignUp(offset + mip.Bytes);
+	}
+	header.TailOffset = mips[mipCount - 1].Offset;
+	header.TailBytes = mips[header.TailMip].Offset + mips[header.TailMip].Bytes - header.TailOffset;
+	header.FileBytes = mips[0].Offset + mips[0].Bytes;
+
+	pImage->assign((size_t)header.FileBytes, 0);
+	uint8_t* pBase = &(*pImage)[0];
+	memcpy(pBase, &header, sizeof(header));
+	memcpy(pBase + header.MipOffset, &mips[0], mipCount * sizeof(TextureMip));
+	for (uint32_t m = 0; m < mipCount; m++)
+		memcpy(pBase + mips[m].Offset, &texture.Mips[m][0], mips[m].Bytes);
+	return true;
+}
+
+bool WriteTextureFile(const char* path, const TextureData& texture)
+{
+	std::vector<uint8_t> image;
+	if (!SerializeTexture(texture, &image))
+		return false;
+
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	bool written = (fwrite(&image[0], 1, image.size(), f) == image.size());
+	return (fclose(f) == 0) && written;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reading
+//--------------------------------------------------------------------------------------
+TextureFileView::TextureFileView()
+{
+	m_pBase = nullptr;
+	m_pHeader = nullptr;
+	m_pMips = nullptr;
+}
+
+static bool Fail(std::string* pError, const char* message)
+{
+	if (pError)
+		*pError = message;
+	return false;
+}
+
+// Whether [offset, offset + bytes) is inside the file, without overflowing.
+static bool InFile(uint64_t offset, uint64_t bytes, uint64_t fileBytes)
+{
+	return offset <= fileBytes && bytes <= fileBytes - offset;
+}
+
+bool TextureFileView::Parse(const void* pData, size_t bytes, std::string* pError)
+{
+	m_pBase = nullptr;
+	m_pHeader = nullptr;
+	m_pMips = nullptr;
+
+	if (!pData || bytes < sizeof(TextureFileHeader))
+		return Fail(pError, "too small for a texture file");
+	if (((uintptr_t)pData & (sizeof(uint64_t) - 1)) != 0)
+		return Fail(pError, "image is not aligned");
+
+	const TextureFileHeader* pHeader = static_cast<const TextureFileHeader*>(pData);
+	if (pHeader->Magic != kTextureFileMagic)
+		return Fail(pError, "not a texture file");
+	if (pHeader->Version != kTextureFileVersion)
+		return Fail(pError, "unsupported texture file version");
+	if (pHeader->HeaderBytes < sizeof(TextureFileHeader) || pHeader->FileBytes > bytes)
+		return Fail(pError, "truncated");
+	if (pHeader->Format >= TEXTURE_FORMAT_COUNT)
+		return Fail(pError, "unknown texture format");
+	if (pHeader->Width == 0 || pHeader->Height == 0 || pHeader->MipCount == 0 ||
+		pHeader->MipCount > FullMipCount(pHeader->Width, pHeader->Height) ||
+		pHeader->TailMip != TextureTailMip(pHeader->Width, pHeader->Height, pHeader->MipCount))
+		return Fail(pError, "bad size or mip count");
+
+	uint64_t fileBytes = pHeader->FileBytes;
+	if ((pHeader->MipOffset & (sizeof(uint64_t) - 1)) != 0 ||
+		!InFile(pHeader->MipOffset, (uint64_t)pHeader->MipCount * sizeof(TextureMip), fileBytes) ||
+		!InFile(pHeader->TailOffset, pHeader->TailBytes, fileBytes))
+		return Fail(pError, "offsets outside the file");
+
+	const uint8_t* pBase = static_cast<const uint8_t*>(pData);
+	const TextureMip* pMips = reinterpret_cast<const TextureMip*>(pBase + pHeader->MipOffset);
+	TextureFormat format = (TextureFormat)pHeader->Format;
+	for (uint32_t m = 0; m < pHeader->MipCount; m++)
+	{
+		const TextureMip& mip = pMips[m];
+		if (mip.Width != TextureMipSize(pHeader->Width, m) || mip.Height != TextureMipSize(pHeader->Height, m) ||
+			mip.RowBytes != TextureRowBytes(format, mip.Width) || mip.Bytes != TextureMipBytes(format, mip.Width, mip.Height))
+			return Fail(pError, "mip is the wrong size");
+		if ((mip.Offset & (kTextureFileAlignment - 1)) != 0 || !InFile(mip.Offset, mip.Bytes, fileBytes))
+			return Fail(pError, "mip outside the file");
+		if (m >= pHeader->TailMip && (mip.Offset < pHeader->TailOffset ||
+			mip.Offset + mip.Bytes > pHeader->TailOffset + pHeader->TailBytes))
+			return Fail(pError, "mip outside the tail");
+	}
+
+	m_pBase = pBase;
+	m_pHeader = pHeader;
+	m_pMips = pMips;
+	return true;
+}
+
+uint64_t TextureFileView::BytesFrom(uint32_t mip) const
+{
+	uint64_t bytes = 0;
+	for (uint32_t m = mip; m < m_pHeader->MipCount; m++)
+		bytes += m_pMips[m].Bytes;
+	return bytes;
+}
+
+bool TextureFileView::ToTextureData(TextureData* pTexture) const
+{
+	pTexture->Format = Format();
+	pTexture->Width = Width();
+	pTexture->Height = Height();
+	pTexture->Mips.resize(MipCount());
+	for (uint32_t m = 0; m < MipCount(); m++)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(MipData(m));
+		pTexture->Mips[m].assign(p, p + m_pMips[m].Bytes);
+	}
+	return true;
+}
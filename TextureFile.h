@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------------------
+// File: TextureFile.h
+//
+// Binary texture container for block compressed textures, laid out like the
+// mesh file so a mip can go from the mapped file to the GPU with no parsing
+// and no copy in between.
+//
+//     TextureFileHeader
+//     TextureMip table		finest first
+//     mips					coarsest first, each kTextureFileAlignment aligned
+//
+// The mips are stored coarsest first so the mip tail, every mip no larger
+// than kTextureTailSize on either side, is one range at the start of the data.
+// A streamer reads that range when the texture is opened, which gives it
+// something to draw at once, and the finer mips each from their own offset as
+// they are wanted.
+//
+// Mips are BC1, BC3 or BC7 blocks in rows, the same as D3D11 wants them, with
+// mips smaller than a block still taking one.  Everything is little endian,
+// offsets are from the start of the file, and Parse only checks the header and
+// table against the file size.  Any change to the layout bumps
+// kTextureFileVersion, and Parse refuses other versions.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+static const uint32_t kTextureFileMagic = 0x58455453;		// "STEX"
+static const uint32_t kTextureFileVersion = 1;
+static const uint32_t kTextureFileAlignment = 64;
+static const uint32_t kTextureMaxMips = 16;					// 32768 on a side
+static const uint32_t kTextureTailSize = 64;
+
+enum TextureFormat
+{
+	TEXTURE_BC1 = 0,			// RGB and 1 bit alpha, 8 bytes a block
+	TEXTURE_BC3,				// RGBA, 16 bytes a block
+	TEXTURE_BC7,				// RGBA, 16 bytes a block
+	TEXTURE_FORMAT_COUNT
+};
+
+uint32_t TextureBlockBytes(TextureFormat format);
+const char* TextureFormatName(TextureFormat format);		// "bc1", "bc3", "bc7"
+
+inline uint32_t TextureMipSize(uint32_t size, uint32_t mip)
+{
+	return (size >> mip) ? (size >> mip) : 1;
+}
+
+// Bytes of one row of blocks, and of the whole mip.
+inline uint32_t TextureRowBytes(TextureFormat format, uint32_t width)
+{
+	return ((width + 3) / 4) * TextureBlockBytes(format);
+}
+
+inline uint64_t TextureMipBytes(TextureFormat format, uint32_t width, uint32_t height)
+{
+	return (uint64_t)TextureRowBytes(format, width) * ((height + 3) / 4);
+}
+
+
+struct TextureMip
+{
+	uint64_t Offset;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t RowBytes;
+	uint32_t Bytes;
+};
+
+struct TextureFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderBytes;
+	uint32_t Format;				// TextureFormat
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t MipCount;
+	uint32_t TailMip;				// The finest mip of the tail
+	uint64_t MipOffset;				// Of the table
+	uint64_t TailOffset;			// The tail is TailBytes from here, all the mips from TailMip on
+	uint64_t TailBytes;
+	uint64_t FileBytes;
+};
+
+
+//--------------------------------------------------------------------------------------
+// A texture in memory, every mip's blocks, finest first.
+//--------------------------------------------------------------------------------------
+struct TextureData
+{
+	TextureFormat Format;
+	uint32_t Width;
+	uint32_t Height;
+	std::vector<std::vector<uint8_t> > Mips;
+};
+
+// The whole file image, and the file.  False if a mip is missing, the wrong
+// size, or the chain doesn't halve down from Width and Height.
+bool SerializeTexture(const TextureData& texture, std::vector<uint8_t>* pImage);
+bool WriteTextureFile(const char* path, const TextureData& texture);
+
+// The first mip of the tail for a texture of this size.
+uint32_t TextureTailMip(uint32_t width, uint32_t height, uint32_t mipCount);
+
+
+//--------------------------------------------------------------------------------------
+// A file image in memory, mapped or otherwise.  Points into the image, which
+// must outlive it.
+//--------------------------------------------------------------------------------------
+class TextureFileView
+{
+public:
+	TextureFileView();
+
+	bool Parse(const void* pData, size_t bytes, std::string* pError = nullptr);
+
+	const TextureFileHeader& Header() const { return *m_pHeader; }
+	TextureFormat Format() const { return (TextureFormat)m_pHeader->Format; }
+	uint32_t Width() const { return m_pHeader->Width; }
+	uint32_t Height() const { return m_pHeader->Height; }
+	uint32_t MipCount() const { return m_pHeader->MipCount; }
+	uint32_t TailMip() const { return m_pHeader->TailMip; }
+
+	const TextureMip& Mip(uint32_t mip) const { return m_pMips[mip]; }
+	const void* MipData(uint32_t mip) const { return m_pBase + m_pMips[mip].Offset; }
+	const void* Tail() const { return m_pBase + m_pHeader->TailOffset; }
+
+	// Of the mips from mip on, which is what holding them takes.
+	uint64_t BytesFrom(uint32_t mip) const;
+
+	// A copy back into memory, for the tools.
+	bool ToTextureData(TextureData* pTexture) const;
+
+private:
+	const uint8_t* m_pBase;
+	const TextureFileHeader* m_pHeader;
+	const TextureMip* m_pMips;
+};
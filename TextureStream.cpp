@@ -0,0 +1,301 @@
+//--------------------------------------------------------------------------------------
+// File: TextureStream.cpp
+//
+// Mip residency and the CPU backend's decoding sink.
+//--------------------------------------------------------------------------------------
+
+#include "TextureStream.h"
+
+#include <string.h>
+
+#include "TextureCodec.h"
+#include "Timing.h"
+
+
+//--------------------------------------------------------------------------------------
+// NullTextureStreamSink
+//--------------------------------------------------------------------------------------
+NullTextureStreamSink::NullTextureStreamSink()
+{
+	m_DecodeNs = 0;
+	m_BlockBytes = 0;
+	m_PixelBytes = 0;
+}
+
+bool NullTextureStreamSink::SetResidentMips(uint32_t texture, const TextureFileHeader& header, uint32_t finestMip)
+{
+	if (m_Textures.size() <= texture)
+		m_Textures.resize(texture + 1);
+
+	Texture& t = m_Textures[texture];
+	if (t.Mips.size() != header.MipCount)
+	{
+		t.Format = (TextureFormat)header.Format;
+		t.Mips.assign(header.MipCount, std::vector<uint8_t>());
+	}
+	for (uint32_t m = 0; m < finestMip; m++)
+		std::vector<uint8_t>().swap(t.Mips[m]);
+	t.FinestMip = finestMip;
+	return true;
+}
+
+void NullTextureStreamSink::UploadMip(uint32_t texture, uint32_t mip, const TextureMip& layout, const void* pData)
+{
+	Texture& t = m_Textures[texture];
+	if (mip < t.FinestMip || mip >= t.Mips.size())
+		return;
+
+	uint64_t start = GetTimeNs();
+	std::vector<uint8_t>& pixels = t.Mips[mip];
+	pixels.resize((size_t)layout.Width * layout.Height * 4);
+	DecodeTextureSIMD(t.Format, pData, layout.Width, layout.Height, &pixels[0], (size_t)layout.Width * 4);
+	m_DecodeNs += GetTimeNs() - start;
+	m_BlockBytes += layout.Bytes;
+	m_PixelBytes += pixels.size();
+}
+
+const uint8_t* NullTextureStreamSink::Pixels(uint32_t texture, uint32_t mip) const
+{
+	if (texture >= m_Textures.size() || mip >= m_Textures[texture].Mips.size() || m_Textures[texture].Mips[mip].empty())
+		return nullptr;
+	return &m_Textures[texture].Mips[mip][0];
+}
+
+size_t NullTextureStreamSink::MemoryBytes() const
+{
+	size_t bytes = 0;
+	for (size_t t = 0; t < m_Textures.size(); t++)
+		for (size_t m = 0; m < m_Textures[t].Mips.size(); m++)
+			bytes += m_Textures[t].Mips[m].capacity();
+	return bytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// 2MB a frame is 120MB/s at 60Hz, and 64MB holds a few dozen 1024x1024
+// textures at full detail.  2ms is an eighth of a 60Hz frame, and at the
+// CPU backend's BC7 decode, around 80MB/s, about 160KB of it.
+//--------------------------------------------------------------------------------------
+TextureStreamConfig DefaultTextureStreamConfig()
+{
+	TextureStreamConfig config;
+	config.UploadBudgetBytes = 2 << 20;
+	config.UploadBudgetNs = 2000000;
+	config.ResidentCapBytes = 64ull << 20;
+	return config;
+}
+
+uint32_t TextureMipForScreenSize(const TextureFileHeader& header, float pixels)
+{
+	uint32_t size = (header.Width > header.Height) ? header.Width : header.Height;
+	uint32_t mip = 0;
+	while (mip + 1 < header.MipCount && (float)(size >> (mip + 1)) >= pixels)
+		mip++;
+	return mip;
+}
+
+
+TextureStreamer::TextureStreamer(const TextureStreamConfig& config, TextureStreamSink* pSink)
+	: m_Config(config), m_pSink(pSink)
+{
+	m_Frame = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	memset(m_UploadNs, 0, sizeof(m_UploadNs));
+	memset(m_UploadBytes, 0, sizeof(m_UploadBytes));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	for (size_t t = 0; t < m_Textures.size(); t++)
+		delete m_Textures[t];
+}
+
+uint32_t TextureStreamer::Open(const char* path, std::string* pError)
+{
+	Texture* t = new Texture;
+	if (!t->File.Open(path))
+	{
+		if (pError)
+			*pError = "can't open the file";
+		delete t;
+		m_Stats.Failed++;
+		return UINT32_MAX;
+	}
+	uint32_t texture = (uint32_t)m_Textures.size();
+	if (!t->View.Parse(t->File.Data(), t->File.Size(), pError) ||
+		!m_pSink->SetResidentMips(texture, t->View.Header(), t->View.TailMip()))
+	{
+		delete t;
+		m_Stats.Failed++;
+		return UINT32_MAX;
+	}
+
+	// The tail is one range of the file, read here in one go.
+	uint32_t tail = t->View.TailMip();
+	t->ResidentMip = tail;
+	t->PlannedMip = tail;
+	t->RequestedMip = tail;
+	t->LastRequested = m_Frame;
+	m_Textures.push_back(t);
+	for (uint32_t m = t->View.MipCount(); m-- > tail; )
+		UploadMip(texture, m);
+
+	uint64_t tailBytes = t->View.BytesFrom(tail);
+	m_Stats.Textures++;
+	m_Stats.BytesUploaded += tailBytes;
+	m_Stats.ResidentBytes += tailBytes;
+	m_Stats.FullBytes += t->View.BytesFrom(0);
+	if (m_Stats.ResidentBytes > m_Stats.PeakResidentBytes)
+		m_Stats.PeakResidentBytes = m_Stats.ResidentBytes;
+	return texture;
+}
+
+void TextureStreamer::Request(uint32_t texture, uint32_t mip)
+{
+	Texture* t = m_Textures[texture];
+	uint32_t tail = t->View.TailMip();
+	t->RequestedMip = (mip < tail) ? mip : tail;
+	t->LastRequested = m_Frame;
+}
+
+void TextureStreamer::UploadMip(uint32_t texture, uint32_t mip)
+{
+	const Texture* t = m_Textures[texture];
+	uint64_t startNs = GetTimeNs();
+	m_pSink->UploadMip(texture, mip, t->View.Mip(mip), t->View.MipData(mip));
+	uint64_t uploadNs = GetTimeNs() - startNs;
+
+	TextureFormat format = t->View.Format();
+	m_UploadNs[format] += uploadNs;
+	m_UploadBytes[format] += t->View.Mip(mip).Bytes;
+	if (uploadNs > m_Stats.MaxUploadMipNs)
+		m_Stats.MaxUploadMipNs = uploadNs;
+}
+
+// At the format's cost per byte so far.  Open uploads every tail, so each
+// format has one before an Update plans a load of it.
+uint64_t TextureStreamer::ExpectedUploadNs(const Texture* t, uint32_t mip) const
+{
+	TextureFormat format = t->View.Format();
+	if (m_UploadBytes[format] == 0)
+		return 0;
+	return (uint64_t)((double)t->View.Mip(mip).Bytes * (double)m_UploadNs[format] / (double)m_UploadBytes[format]);
+}
+
+// Plans drops until bytes more fit, finest mip first from the least recently
+// requested texture holding more than its request.  False if it can't.
+bool TextureStreamer::DropFor(uint64_t bytes, uint64_t* pResidentBytes)
+{
+	while (*pResidentBytes + bytes > m_Config.ResidentCapBytes)
+	{
+		Texture* pVictim = nullptr;
+		for (size_t i = 0; i < m_Textures.size(); i++)
+		{
+			Texture* t = m_Textures[i];
+			if (t->PlannedMip < t->RequestedMip && (!pVictim || t->LastRequested < pVictim->LastRequested))
+				pVictim = t;
+		}
+		if (!pVictim)
+			return false;
+
+		*pResidentBytes -= pVictim->View.Mip(pVictim->PlannedMip).Bytes;
+		pVictim->PlannedMip++;
+		m_Stats.MipsDropped++;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Plans the frame's mips first and then tells the sink, so a texture whose
+// mips change gets one SetResidentMips however many mips it gains or loses.
+//--------------------------------------------------------------------------------------
+void TextureStreamer::Update()
+{
+	uint64_t startNs = GetTimeNs();
+
+	uint64_t requestedBytes = 0;
+	for (size_t i = 0; i < m_Textures.size(); i++)
+	{
+		Texture* t = m_Textures[i];
+		if (t->LastRequested != m_Frame)
+			t->RequestedMip = t->View.TailMip();
+		t->PlannedMip = t->ResidentMip;
+		requestedBytes += t->View.BytesFrom(t->RequestedMip);
+	}
+
+	// Always the texture furthest from its request.
+	uint64_t residentBytes = m_Stats.ResidentBytes;
+	uint64_t uploaded = 0;
+	uint64_t expectedNs = 0;
+	for (;;)
+	{
+		Texture* pNext = nullptr;
+		for (size_t i = 0; i < m_Textures.size(); i++)
+		{
+			Texture* t = m_Textures[i];
+			if (t->PlannedMip > t->RequestedMip &&
+				(!pNext || t->PlannedMip - t->RequestedMip > pNext->PlannedMip - pNext->RequestedMip))
+				pNext = t;
+		}
+		if (!pNext)
+			break;
+
+		uint64_t bytes = pNext->View.Mip(pNext->PlannedMip - 1).Bytes;
+		uint64_t ns = ExpectedUploadNs(pNext, pNext->PlannedMip - 1);
+		if (uploaded > 0 && uploaded + bytes > m_Config.UploadBudgetBytes)
+			break;
+		if (uploaded > 0 && expectedNs + ns > m_Config.UploadBudgetNs)
+		{
+			m_Stats.TimeLimited++;
+			break;
+		}
+		if (!DropFor(bytes, &residentBytes))
+		{
+			m_Stats.CapLimited++;
+			break;
+		}
+		pNext->PlannedMip--;
+		residentBytes += bytes;
+		uploaded += bytes;
+		expectedNs += ns;
+	}
+
+	for (size_t i = 0; i < m_Textures.size(); i++)
+	{
+		Texture* t = m_Textures[i];
+		if (t->PlannedMip == t->ResidentMip)
+			continue;
+
+		// The sink keeps what it had when it can't make the change.
+		if (!m_pSink->SetResidentMips((uint32_t)i, t->View.Header(), t->PlannedMip))
+		{
+			for (uint32_t m = t->PlannedMip; m < t->ResidentMip; m++)
+			{
+				residentBytes -= t->View.Mip(m).Bytes;
+				uploaded -= t->View.Mip(m).Bytes;
+			}
+			for (uint32_t m = t->ResidentMip; m < t->PlannedMip; m++)
+				residentBytes += t->View.Mip(m).Bytes;
+			t->PlannedMip = t->ResidentMip;
+			m_Stats.Failed++;
+			continue;
+		}
+		for (uint32_t m = t->ResidentMip; m-- > t->PlannedMip; )
+		{
+			UploadMip((uint32_t)i, m);
+			m_Stats.MipsLoaded++;
+		}
+		t->ResidentMip = t->PlannedMip;
+	}
+
+	m_Stats.ResidentBytes = residentBytes;
+	if (residentBytes > m_Stats.PeakResidentBytes)
+		m_Stats.PeakResidentBytes = residentBytes;
+	m_Stats.RequestedBytes = requestedBytes;
+	m_Stats.BytesUploaded += uploaded;
+	m_Frame++;
+
+	uint64_t updateNs = GetTimeNs() - startNs;
+	if (updateNs > m_Stats.MaxUpdateNs)
+		m_Stats.MaxUpdateNs = updateNs;
+}
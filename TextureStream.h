@@ -0,0 +1,184 @@
+//--------------------------------------------------------------------------------------
+// File: TextureStream.h
+//
+// Texture files held from their mip tail up, with the finer mips read from
+// the mapped file as the textures are drawn larger.
+//
+// Open maps a texture file and hands its tail to the sink at once, so every
+// texture has something to sample from the first frame, at kTextureTailSize
+// or smaller.  Each frame the renderer calls Request with the finest mip a
+// texture needs at its size on screen, see TextureMipForScreenSize, and Update
+// loads the missing mips, coarsest first since each is the next step sharper,
+// and the texture furthest from its request first, up to an upload budget a
+// frame.  A mip is handed to the sink straight out of the mapping, so that is
+// where the file is read, and the budget in bytes bounds how long a frame can
+// wait on the disk.  Bytes don't bound the frame time, though: the CPU
+// backend's sink decodes BC7 several times slower than BC1, and a GPU upload
+// is faster than either.  So the streamer also times every UploadMip, keeps
+// what a byte of each format has cost the sink so far, and stops planning
+// loads once their expected time passes the budget in nanoseconds.  A mip is
+// the smallest load, so a frame still takes as long as one mip when that alone
+// is over the budget.
+//
+// A texture's resident mips are always its tail and the mips just above it,
+// so the sink only needs to know the finest.  Residency is capped in bytes of
+// the compressed mips.  Mips finer than a texture's request stay until the
+// memory is wanted, so a texture going back and forth across a mip boundary
+// isn't read each time.  Before a load would go over the cap, the finest mip
+// of a texture holding more than its request is dropped, least recently
+// requested first, and if nothing can be dropped the load waits a frame,
+// which is counted.  Tails are never dropped.
+//
+// Everything here is for the render thread.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "TextureFile.h"
+
+
+//--------------------------------------------------------------------------------------
+// Where the mips go, called from Open and Update.
+//--------------------------------------------------------------------------------------
+class TextureStreamSink
+{
+public:
+	virtual ~TextureStreamSink() {}
+
+	// Hold the mips from finestMip on.  Those already held are kept and the
+	// ones new to it follow in UploadMip, coarsest first.  The first call for
+	// a texture is for its tail.  False fails the change, and the sink keeps
+	// the mips it had.
+	virtual bool SetResidentMips(uint32_t texture, const TextureFileHeader& header, uint32_t finestMip) = 0;
+
+	// pData is the mip's blocks, only valid during the call.
+	virtual void UploadMip(uint32_t texture, uint32_t mip, const TextureMip& layout, const void* pData) = 0;
+};
+
+
+// The CPU backend's textures: each resident mip decoded to RGBA8 with
+// DecodeTextureSIMD as it comes in, ready for sampling.
+class NullTextureStreamSink : public TextureStreamSink
+{
+public:
+	NullTextureStreamSink();
+	virtual ~NullTextureStreamSink() {}
+
+	virtual bool SetResidentMips(uint32_t texture, const TextureFileHeader& header, uint32_t finestMip);
+	virtual void UploadMip(uint32_t texture, uint32_t mip, const TextureMip& layout, const void* pData);
+
+	// Null when the mip isn't resident.  Rows are the mip's width apart.
+	const uint8_t* Pixels(uint32_t texture, uint32_t mip) const;
+
+	// Of every UploadMip so far, blocks in and pixels out.
+	uint64_t DecodeNs() const { return m_DecodeNs; }
+	uint64_t DecodedBlockBytes() const { return m_BlockBytes; }
+	uint64_t DecodedPixelBytes() const { return m_PixelBytes; }
+
+	size_t MemoryBytes() const;
+
+private:
+	NullTextureStreamSink(const NullTextureStreamSink&);
+	NullTextureStreamSink& operator=(const NullTextureStreamSink&);
+
+	struct Texture
+	{
+		TextureFormat Format;
+		uint32_t FinestMip;
+		std::vector<std::vector<uint8_t> > Mips;
+	};
+	std::vector<Texture> m_Textures;
+	uint64_t m_DecodeNs;
+	uint64_t m_BlockBytes;
+	uint64_t m_PixelBytes;
+};
+
+
+struct TextureStreamConfig
+{
+	size_t UploadBudgetBytes;		// Per Update, at least one mip goes through
+	uint64_t UploadBudgetNs;		// The same, in the sink's expected time for the mips
+	uint64_t ResidentCapBytes;		// Compressed bytes of the resident mips, tails included
+};
+
+TextureStreamConfig DefaultTextureStreamConfig();
+
+
+struct TextureStreamStats
+{
+	uint32_t Textures;
+	uint32_t Failed;
+	uint32_t MipsLoaded;
+	uint32_t MipsDropped;
+	uint32_t CapLimited;			// Updates where the cap held a load back
+	uint64_t BytesUploaded;
+	uint64_t ResidentBytes;
+	uint64_t PeakResidentBytes;
+	uint64_t RequestedBytes;		// What the last frame's requests would hold
+	uint64_t FullBytes;				// Every mip of every texture
+	uint64_t MaxUpdateNs;			// Longest Update, the worst hitch streaming added
+	uint64_t MaxUploadMipNs;		// Longest UploadMip, the least MaxUpdateNs can be
+	uint32_t TimeLimited;			// Updates the budget in nanoseconds ended
+};
+
+
+// The coarsest mip with at least pixels texels across the longer side.
+uint32_t TextureMipForScreenSize(const TextureFileHeader& header, float pixels);
+
+
+class TextureStreamer
+{
+public:
+	TextureStreamer(const TextureStreamConfig& config, TextureStreamSink* pSink);
+	~TextureStreamer();
+
+	// Maps the file and loads its tail.  Returns the texture's id, the one the
+	// sink sees, or UINT32_MAX if the file can't be used.
+	uint32_t Open(const char* path, std::string* pError = nullptr);
+
+	// The finest mip the texture is drawn with this frame.  Textures not
+	// requested in a frame only need their tail.
+	void Request(uint32_t texture, uint32_t mip);
+
+	// Loads and drops mips, and starts a new frame for Request.
+	void Update();
+
+	const TextureFileHeader& Header(uint32_t texture) const { return m_Textures[texture]->View.Header(); }
+	uint32_t ResidentMip(uint32_t texture) const { return m_Textures[texture]->ResidentMip; }
+	uint32_t RequestedMip(uint32_t texture) const { return m_Textures[texture]->RequestedMip; }
+
+	const TextureStreamStats& Stats() const { return m_Stats; }
+
+private:
+	TextureStreamer(const TextureStreamer&);
+	TextureStreamer& operator=(const TextureStreamer&);
+
+	struct Texture
+	{
+		MappedFile File;
+		TextureFileView View;
+		uint32_t ResidentMip;		// In the sink
+		uint32_t PlannedMip;		// During Update
+		uint32_t RequestedMip;
+		uint64_t LastRequested;		// Frame
+	};
+
+	bool DropFor(uint64_t bytes, uint64_t* pResidentBytes);
+	void UploadMip(uint32_t texture, uint32_t mip);
+	uint64_t ExpectedUploadNs(const Texture* t, uint32_t mip) const;
+
+	TextureStreamConfig m_Config;
+	TextureStreamSink* m_pSink;
+	std::vector<Texture*> m_Textures;
+	uint64_t m_Frame;
+	TextureStreamStats m_Stats;
+
+	// What UploadMip has taken so far, by format.
+	uint64_t m_UploadNs[TEXTURE_FORMAT_COUNT];
+	uint64_t m_UploadBytes[TEXTURE_FORMAT_COUNT];
+};
@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// File: Timing.h
+//
+// Clocks shared by the instrumentation.
+//
+// GetTimeNs is a monotonic wall clock in ns, QueryPerformanceCounter on Windows
+// and CLOCK_MONOTONIC elsewhere.  ReadCycleCounter is the raw TSC where there is one,
+// which is a lot cheaper to read, and gets converted to ns later with a
+// CycleCalibration taken against GetTimeNs.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Monotonic time in ns.
+//--------------------------------------------------------------------------------------
+inline uint64_t GetTimeNs()
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	uint64_t freq = (uint64_t)frequency.QuadPart;
+	uint64_t ticks = (uint64_t)now.QuadPart;
+	return (ticks / freq) * 1000000000ull + ((ticks % freq) * 1000000000ull) / freq;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Process CPU time (user + kernel) for the calling thread in ns.
+//--------------------------------------------------------------------------------------
+inline uint64_t GetThreadCpuTimeNs()
+{
+#if defined(_WIN32)
+	FILETIME creation, exitTime, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exitTime, &kernel, &user))
+		return 0;
+	uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (k + u) * 100;	// FILETIME is in 100ns units
+#else
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cheapest monotonic counter available.  Units are whatever the hardware uses,
+// ns on platforms without a TSC.  Assumes an invariant TSC, which every CPU that
+// can drive 3D Vision has.
+//--------------------------------------------------------------------------------------
+inline uint64_t ReadCycleCounter()
+{
+#if defined(_WIN32) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return GetTimeNs();
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Maps cycle counter values to GetTimeNs.  Take one with Begin early on, and
+// finish it with End right before converting, the longer in between the better.
+//--------------------------------------------------------------------------------------
+struct CycleCalibration
+{
+	uint64_t StartCycles;
+	uint64_t StartNs;
+	double NsPerCycle;
+
+	void Begin()
+	{
+		StartCycles = ReadCycleCounter();
+		StartNs = GetTimeNs();
+		NsPerCycle = 1.0;
+	}
+
+	void End()
+	{
+		uint64_t cycles = ReadCycleCounter() - StartCycles;
+		uint64_t ns = GetTimeNs() - StartNs;
+		NsPerCycle = (cycles > 0 && ns > 0) ? (double)ns / (double)cycles : 1.0;
+	}
+
+	double ToNs(uint64_t cycles) const
+	{
+		return (double)StartNs + ((double)cycles - (double)StartCycles) * NsPerCycle;
+	}
+};
@@ -0,0 +1,293 @@
+//--------------------------------------------------------------------------------------
+// File: TransformStore.cpp
+//
+// SoA storage and the world matrix kernels.
+//--------------------------------------------------------------------------------------
+
+#include "TransformStore.h"
+#include "AlignedAlloc.h"
+#include "WorkerPool.h"
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+
+
+const char* TransformKernelName(TransformKernel kernel)
+{
+	if (kernel == TRANSFORM_KERNEL_SCALAR)
+		return "scalar";
+	return STEREO_MATH_SSE ? "sse2" : "scalar";
+}
+
+
+TransformStore::TransformStore()
+{
+	m_Count = 0;
+	m_Capacity = 0;
+	m_pPositionX = m_pPositionY = m_pPositionZ = nullptr;
+	m_pRotationX = m_pRotationY = m_pRotationZ = m_pRotationW = nullptr;
+	m_pScale = nullptr;
+	m_pDirty = nullptr;
+	m_pWorld = nullptr;
+}
+
+TransformStore::~TransformStore()
+{
+	float* arrays[] = { m_pPositionX, m_pPositionY, m_pPositionZ, m_pRotationX, m_pRotationY, m_pRotationZ, m_pRotationW, m_pScale };
+	for (size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); a++)
+		AlignedFree(arrays[a]);
+	AlignedFree(m_pDirty);
+	AlignedFree(m_pWorld);
+}
+
+static void Grow(float** ppArray, uint32_t count, uint32_t capacity, float fill)
+{
+	float* pArray = static_cast<float*>(AlignedAlloc(capacity * sizeof(float), 16));
+	if (*ppArray)
+		memcpy(pArray, *ppArray, count * sizeof(float));
+	for (uint32_t i = count; i < capacity; i++)
+		pArray[i] = fill;
+	AlignedFree(*ppArray);
+	*ppArray = pArray;
+}
+
+//--------------------------------------------------------------------------------------
+// The lanes past Count() in the last block hold identity transforms that are
+// never dirty, so the kernels never need a partial block.
+//--------------------------------------------------------------------------------------
+void TransformStore::Resize(uint32_t count)
+{
+	if (count > m_Capacity)
+	{
+		uint32_t capacity = (count + 3) & ~3u;
+		Grow(&m_pPositionX, m_Count, capacity, 0.0f);
+		Grow(&m_pPositionY, m_Count, capacity, 0.0f);
+		Grow(&m_pPositionZ, m_Count, capacity, 0.0f);
+		Grow(&m_pRotationX, m_Count, capacity, 0.0f);
+		Grow(&m_pRotationY, m_Count, capacity, 0.0f);
+		Grow(&m_pRotationZ, m_Count, capacity, 0.0f);
+		Grow(&m_pRotationW, m_Count, capacity, 1.0f);
+		Grow(&m_pScale, m_Count, capacity, 1.0f);
+
+		uint8_t* pDirty = static_cast<uint8_t*>(AlignedAlloc(capacity, 16));
+		memset(pDirty, 0, capacity);
+		if (m_pDirty)
+			memcpy(pDirty, m_pDirty, m_Count);
+		AlignedFree(m_pDirty);
+		m_pDirty = pDirty;
+
+		SMMatrix* pWorld = static_cast<SMMatrix*>(AlignedAlloc(capacity * sizeof(SMMatrix), 16));
+		if (m_pWorld)
+			memcpy(pWorld, m_pWorld, m_Count * sizeof(SMMatrix));
+		AlignedFree(m_pWorld);
+		m_pWorld = pWorld;
+
+		m_Capacity = capacity;
+	}
+
+	for (uint32_t i = m_Count; i < count; i++)
+	{
+		m_pPositionX[i] = m_pPositionY[i] = m_pPositionZ[i] = 0.0f;
+		m_pRotationX[i] = m_pRotationY[i] = m_pRotationZ[i] = 0.0f;
+		m_pRotationW[i] = 1.0f;
+		m_pScale[i] = 1.0f;
+		m_pDirty[i] = 1;
+	}
+	for (uint32_t i = count; i < m_Capacity; i++)
+		m_pDirty[i] = 0;
+	m_Count = count;
+}
+
+void TransformStore::SetPosition(uint32_t i, float x, float y, float z)
+{
+	m_pPositionX[i] = x;
+	m_pPositionY[i] = y;
+	m_pPositionZ[i] = z;
+	m_pDirty[i] = 1;
+}
+
+void TransformStore::SetRotation(uint32_t i, float x, float y, float z, float w)
+{
+	m_pRotationX[i] = x;
+	m_pRotationY[i] = y;
+	m_pRotationZ[i] = z;
+	m_pRotationW[i] = w;
+	m_pDirty[i] = 1;
+}
+
+void TransformStore::SetRotationY(uint32_t i, float angle)
+{
+	SetRotation(i, 0.0f, sinf(0.5f * angle), 0.0f, cosf(0.5f * angle));
+}
+
+void TransformStore::SetScale(uint32_t i, float scale)
+{
+	m_pScale[i] = scale;
+	m_pDirty[i] = 1;
+}
+
+void TransformStore::MarkAllDirty()
+{
+	memset(m_pDirty, 1, m_Count);
+}
+
+size_t TransformStore::MemoryBytes() const
+{
+	return (size_t)m_Capacity * (8 * sizeof(float) + 1 + sizeof(SMMatrix));
+}
+
+
+//--------------------------------------------------------------------------------------
+// The rotation part of XMMatrixRotationQuaternion, each row scaled.
+//--------------------------------------------------------------------------------------
+static void ComposeScalar(SMMatrix* pWorld, float qx, float qy, float qz, float qw, float s, float px, float py, float pz)
+{
+	float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+	pWorld->m[0][0] = s * (1.0f - 2.0f * (yy + zz));
+	pWorld->m[0][1] = s * 2.0f * (xy + wz);
+	pWorld->m[0][2] = s * 2.0f * (xz - wy);
+	pWorld->m[0][3] = 0.0f;
+	pWorld->m[1][0] = s * 2.0f * (xy - wz);
+	pWorld->m[1][1] = s * (1.0f - 2.0f * (xx + zz));
+	pWorld->m[1][2] = s * 2.0f * (yz + wx);
+	pWorld->m[1][3] = 0.0f;
+	pWorld->m[2][0] = s * 2.0f * (xz + wy);
+	pWorld->m[2][1] = s * 2.0f * (yz - wx);
+	pWorld->m[2][2] = s * (1.0f - 2.0f * (xx + yy));
+	pWorld->m[2][3] = 0.0f;
+	pWorld->m[3][0] = px;
+	pWorld->m[3][1] = py;
+	pWorld->m[3][2] = pz;
+	pWorld->m[3][3] = 1.0f;
+}
+
+#if STEREO_MATH_SSE
+//--------------------------------------------------------------------------------------
+// Four transforms at once.  Each matrix element is computed for all four lanes,
+// then each row is transposed out of the lanes into the four matrices.
+//--------------------------------------------------------------------------------------
+static void ComposeSSE(SMMatrix* pWorld, const float* qx, const float* qy, const float* qz, const float* qw,
+	const float* s, const float* px, const float* py, const float* pz)
+{
+	__m128 x = _mm_load_ps(qx);
+	__m128 y = _mm_load_ps(qy);
+	__m128 z = _mm_load_ps(qz);
+	__m128 w = _mm_load_ps(qw);
+	__m128 scale = _mm_load_ps(s);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	__m128 x2 = _mm_mul_ps(x, two);
+	__m128 y2 = _mm_mul_ps(y, two);
+	__m128 z2 = _mm_mul_ps(z, two);
+	__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+	__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+	__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+	__m128 r0 = _mm_mul_ps(scale, _mm_sub_ps(one, _mm_add_ps(yy, zz)));
+	__m128 r1 = _mm_mul_ps(scale, _mm_add_ps(xy, wz));
+	__m128 r2 = _mm_mul_ps(scale, _mm_sub_ps(xz, wy));
+	__m128 r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_store_ps(pWorld[0].m[0], r0);
+	_mm_store_ps(pWorld[1].m[0], r1);
+	_mm_store_ps(pWorld[2].m[0], r2);
+	_mm_store_ps(pWorld[3].m[0], r3);
+
+	r0 = _mm_mul_ps(scale, _mm_sub_ps(xy, wz));
+	r1 = _mm_mul_ps(scale, _mm_sub_ps(one, _mm_add_ps(xx, zz)));
+	r2 = _mm_mul_ps(scale, _mm_add_ps(yz, wx));
+	r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_store_ps(pWorld[0].m[1], r0);
+	_mm_store_ps(pWorld[1].m[1], r1);
+	_mm_store_ps(pWorld[2].m[1], r2);
+	_mm_store_ps(pWorld[3].m[1], r3);
+
+	r0 = _mm_mul_ps(scale, _mm_add_ps(xz, wy));
+	r1 = _mm_mul_ps(scale, _mm_sub_ps(yz, wx));
+	r2 = _mm_mul_ps(scale, _mm_sub_ps(one, _mm_add_ps(xx, yy)));
+	r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_store_ps(pWorld[0].m[2], r0);
+	_mm_store_ps(pWorld[1].m[2], r1);
+	_mm_store_ps(pWorld[2].m[2], r2);
+	_mm_store_ps(pWorld[3].m[2], r3);
+
+	r0 = _mm_load_ps(px);
+	r1 = _mm_load_ps(py);
+	r2 = _mm_load_ps(pz);
+	r3 = one;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_store_ps(pWorld[0].m[3], r0);
+	_mm_store_ps(pWorld[1].m[3], r1);
+	_mm_store_ps(pWorld[2].m[3], r2);
+	_mm_store_ps(pWorld[3].m[3], r3);
+}
+#endif
+
+uint32_t TransformStore::UpdateBlocks(uint32_t beginBlock, uint32_t endBlock, TransformKernel kernel)
+{
+	uint32_t updated = 0;
+	for (uint32_t block = beginBlock; block < endBlock; block++)
+	{
+		uint32_t i = block * 4;
+		uint32_t dirty;
+		memcpy(&dirty, &m_pDirty[i], sizeof(dirty));
+		if (dirty == 0)
+			continue;
+		memset(&m_pDirty[i], 0, sizeof(dirty));
+		updated += 4;
+
+#if STEREO_MATH_SSE
+		if (kernel == TRANSFORM_KERNEL_SIMD)
+		{
+			ComposeSSE(&m_pWorld[i], &m_pRotationX[i], &m_pRotationY[i], &m_pRotationZ[i], &m_pRotationW[i],
+				&m_pScale[i], &m_pPositionX[i], &m_pPositionY[i], &m_pPositionZ[i]);
+			continue;
+		}
+#endif
+		for (uint32_t j = i; j < i + 4; j++)
+		{
+			ComposeScalar(&m_pWorld[j], m_pRotationX[j], m_pRotationY[j], m_pRotationZ[j], m_pRotationW[j],
+				m_pScale[j], m_pPositionX[j], m_pPositionY[j], m_pPositionZ[j]);
+		}
+	}
+	return updated;
+}
+
+namespace
+{
+
+struct UpdateContext
+{
+	TransformStore* pStore;
+	TransformKernel Kernel;
+	std::atomic<uint32_t> Updated;
+};
+
+}
+
+void TransformStore::UpdateChunk(void* pContext, uint32_t beginBlock, uint32_t endBlock)
+{
+	UpdateContext* c = static_cast<UpdateContext*>(pContext);
+	c->Updated += c->pStore->UpdateBlocks(beginBlock, endBlock, c->Kernel);
+}
+
+uint32_t TransformStore::UpdateWorld(TransformKernel kernel, WorkerPool* pPool)
+{
+	uint32_t blocks = m_Capacity / 4;
+	if (!pPool)
+		return UpdateBlocks(0, blocks, kernel);
+
+	UpdateContext c;
+	c.pStore = this;
+	c.Kernel = kernel;
+	c.Updated = 0;
+	pPool->ParallelFor(blocks, kBlocksPerChunk, UpdateChunk, &c);
+	return c.Updated;
+}
@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// File: TransformStore.h
+//
+// Transforms for many animated objects, kept as structure of arrays: position
+// x, y and z, rotation quaternion x, y, z and w, and uniform scale, each in its
+// own 16 byte aligned array.  World matrices are computed four at a time with
+// SSE2, one transform per lane, which that layout makes straight loads.
+//
+// Setting any part of a transform marks it dirty, and UpdateWorld only redoes
+// blocks of four with something dirty in them.  With a WorkerPool the blocks
+// are split across its threads.
+//
+// World matrices come out row-major like XMMATRIX, scale then rotate then
+// translate, the same as XMMatrixAffineTransformation with no rotation origin.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+
+#include "StereoMath.h"
+
+class WorkerPool;
+
+
+enum TransformKernel
+{
+	TRANSFORM_KERNEL_SCALAR = 0,
+	TRANSFORM_KERNEL_SIMD			// SSE2 where there is one, else the scalar code
+};
+
+const char* TransformKernelName(TransformKernel kernel);
+
+
+class TransformStore
+{
+public:
+	TransformStore();
+	~TransformStore();
+
+	// New transforms are identity, and dirty.
+	void Resize(uint32_t count);
+	uint32_t Count() const { return m_Count; }
+
+	void SetPosition(uint32_t i, float x, float y, float z);
+	void SetRotation(uint32_t i, float x, float y, float z, float w);
+	void SetRotationY(uint32_t i, float angle);
+	void SetScale(uint32_t i, float scale);
+	void MarkAllDirty();
+
+	// Returns how many transforms were recomputed, whole blocks of four.
+	uint32_t UpdateWorld(TransformKernel kernel, WorkerPool* pPool = nullptr);
+
+	// Count() matrices, valid after UpdateWorld.
+	const SMMatrix* World() const { return m_pWorld; }
+
+	size_t MemoryBytes() const;
+
+	// Blocks of four per ParallelFor chunk.
+	static const uint32_t kBlocksPerChunk = 256;
+
+private:
+	TransformStore(const TransformStore&);
+	TransformStore& operator=(const TransformStore&);
+
+	static void UpdateChunk(void* pContext, uint32_t beginBlock, uint32_t endBlock);
+	uint32_t UpdateBlocks(uint32_t beginBlock, uint32_t endBlock, TransformKernel kernel);
+
+	uint32_t m_Count;
+	uint32_t m_Capacity;			// Multiple of four
+
+	float* m_pPositionX;
+	float* m_pPositionY;
+	float* m_pPositionZ;
+	float* m_pRotationX;
+	float* m_pRotationY;
+	float* m_pRotationZ;
+	float* m_pRotationW;
+	float* m_pScale;
+	uint8_t* m_pDirty;
+	SMMatrix* m_pWorld;
+};
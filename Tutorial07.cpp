@@ -41,14 +41,39 @@
 //--------------------------------------------------------------------------------------
 
 #include <windows.h>
+#include <shellapi.h>
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <directxmath.h>
 #include <directxcolors.h>
+#include <stdio.h>
 #include "resource.h"
+#include "SwapChain.h"
+#include "Profiler.h"
+#include "D3D11GpuTimer.h"
+#include "FrameStats.h"
+#include "StartupTimeline.h"
+#include "LiveMetrics.h"
+#include "StereoAudit.h"
+#include "Timing.h"
+#include "D3D11RenderBackend.h"
+#include "SceneRenderer.h"
+#include "ShaderCache.h"
+#include "WorkerPool.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshOptimize.h"
+#include "Meshlet.h"
+#include "MeshStream.h"
+#include "D3D11MeshStream.h"
+#include "TextureCodec.h"
+#include "TextureStream.h"
+#include "D3D11TextureStream.h"
 
 #include "nvapi.h"
 #include "nvapi_lite_stereo.h"
+#include "NvapiShim.h"
 
 
 using namespace DirectX;
@@ -62,6 +87,8 @@ struct SimpleVertex
 	XMFLOAT2 Tex;
 };
 
+static_assert(sizeof(SimpleVertex) == sizeof(MeshVertex), "float mesh files hold SimpleVertex");
+
 struct SharedCB
 {
 	XMMATRIX mWorld;
@@ -69,6 +96,14 @@ struct SharedCB
 	XMMATRIX mProjection;
 };
 
+// cbMeshDecode, MeshVertexDecode padded to float4s.
+struct MeshDecodeCB
+{
+	XMFLOAT4 PositionScale;
+	XMFLOAT4 PositionOffset;
+	XMFLOAT4 TexcoordScaleOffset;
+};
+
 
 //--------------------------------------------------------------------------------------
 // Global Variables
@@ -91,6 +126,7 @@ ID3D11Buffer*                       g_pVertexBuffer = nullptr;
 ID3D11Buffer*                       g_pIndexBuffer = nullptr;
 
 ID3D11Buffer*                       g_pSharedCB = nullptr;
+ID3D11Buffer*                       g_pMeshDecodeCB = nullptr;
 
 XMMATRIX                            g_World;
 XMMATRIX                            g_View;
@@ -100,16 +136,110 @@ StereoHandle						g_StereoHandle;
 UINT								g_ScreenWidth = 1280;
 UINT								g_ScreenHeight = 720;
 
+SwapChainConfig						g_SwapChainConfig = DefaultSwapChainConfig();
+IPresenter*							g_pPresenter = nullptr;
+PresentTracker						g_PresentTracker(1000000000ull / 120);
+GpuTimer*							g_pGpuTimer = nullptr;
+FrameStats							g_FrameStats;
+std::string							g_StartupBudgetPath;
+bool								g_StartupOnly = false;
+LiveMetricsWriter					g_LiveMetrics;
+uint64_t							g_UploadBytesTotal = 0;
+StereoAudit							g_StereoAudit;
+
+// Shaders compiled by earlier runs, see ShaderCache.h.  -noshadercache
+// compiles every launch, for comparing.
+std::string							g_ShaderCachePath = "Tutorial07_shaders.bin";
+bool								g_ShaderCacheEnabled = true;
+bool								g_BuildShaderCache = false;
+ShaderCache							g_ShaderCache;
+uint32_t							g_ShadersCompiled = 0;
+uint64_t							g_ShaderCompileNs = 0;		// Summed over the compiles
+uint32_t							g_ShadersLoaded = 0;
+uint64_t							g_ShaderLoadNs = 0;
+
+// The shaders' misses compile on this pool from process start, see StartShaders.
+MappedFile							g_ShaderSource;
+DWORD								g_ShaderFlags = 0;
+WorkerPool*							g_pShaderPool = nullptr;
+std::vector<uint32_t>				g_ShaderCompileList;
+uint64_t							g_ShaderPoolWallNs = 0;		// First compile's start to last one's end
+uint64_t							g_ShaderOverlapNs = 0;		// Of that, before InitDevice waited
+uint64_t							g_ShaderWaitNs = 0;
+
+// The cube, or the -mesh file.
+std::string							g_MeshPath;
+bool								g_MeshOptimize = false;
+MeshVertexFormat					g_MeshVertexFormat = MESH_VERTEX_FORMAT_COUNT;		// Count keeps the file's
+SceneMesh							g_Mesh = CubeSceneMesh();
+
+// -meshlets, the one mesh drawn as the meshlets that survive a cull each frame.
+bool								g_MeshMeshlets = false;
+MeshletMesh							g_Meshlets;
+std::vector<uint32_t>				g_MeshletVisible;
+std::vector<MeshletDraw>			g_MeshletDraws;
+uint64_t							g_MeshletFrames = 0;
+uint64_t							g_MeshletTrianglesCulled = 0;
+
+// -stream, the -mesh file's blobs loaded in the background after startup.
+// Nothing is drawn until they are all uploaded.
+bool								g_MeshStream = false;
+MeshStreamer*						g_pMeshStreamer = nullptr;
+D3D11MeshStreamSink*				g_pMeshStreamSink = nullptr;
+uint32_t							g_StreamedMesh = 0;
+uint64_t							g_StreamStartNs = 0;
+bool								g_MeshReady = true;
+MeshStreamStats						g_MeshStreamStats = {};
+
+// The mesh's texture: a -texture file streamed from its mip tail up as the
+// mesh's size on screen wants, or without one a checker built at startup.
+std::string							g_TexturePath;
+TextureStreamer*					g_pTextureStreamer = nullptr;
+D3D11TextureStreamSink*				g_pTextureStreamSink = nullptr;
+uint32_t							g_StreamedTexture = 0;
+TextureStreamStats					g_TextureStreamStats = {};
+ID3D11ShaderResourceView*			g_pTextureSRV = nullptr;
+ID3D11SamplerState*					g_pSamplerLinear = nullptr;
+
+// Only with -objects, otherwise the one cube as before.
+uint32_t							g_SceneObjects = 0;
+SceneLayout							g_SceneLayout = SCENE_GRID;
+SceneSubmitMode						g_SceneMode = SCENE_SUBMIT_PER_OBJECT;
+Scene								g_Scene;
+Bvh									g_SceneBvh;
+bool								g_SceneUseBvh = false;
+SceneRenderer						g_SceneRenderer;
+bool								g_SceneLod = false;
+uint64_t							g_LodFrames = 0;
+uint64_t							g_LodTriangles = 0;
+uint64_t							g_LodFullTriangles = 0;
+uint64_t							g_LodChanges = 0;
+WorkerPool*							g_pSortPool = nullptr;		// -sorted
+D3D11RenderBackend*					g_pSceneBackend = nullptr;
+StereoView							g_SceneView;
+ID3D11VertexShader*					g_pInstancedVertexShader = nullptr;
+ID3D11InputLayout*					g_pInstancedLayout = nullptr;
+ID3D11ComputeShader*				g_pCullIndirectShader = nullptr;		// -indirect
+bool								g_SceneMultiDraw = false;
+
 
 //--------------------------------------------------------------------------------------
 // Forward declarations
 //--------------------------------------------------------------------------------------
+void ParseCommandLine();
+bool FinishStartupTimeline();
+void StartShaders();
+HRESULT WaitForShaders();
+void ReleaseShaders();
+HRESULT BuildShaderCache();
+void SaveShaderCache();
 HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow);
 HRESULT InitStereo();
 HRESULT InitDevice();
 HRESULT ActivateStereo();
 void CleanupDevice();
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
+void Render(UINT eye);
 void RenderFrame();
 
 
@@ -122,11 +252,33 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 	UNREFERENCED_PARAMETER(hPrevInstance);
 	UNREFERENCED_PARAMETER(lpCmdLine);
 
+	StartupTimelineBegin();
+	ParseCommandLine();
+
+	// Roughly a minute of frames at a few thousand fps before zones get dropped.
+	ProfilerInit(1 << 20);
+	ProfilerSetThreadName("Main");
+
+	// Shaders compile from here on while the window, stereo and device are
+	// set up, and InitDevice waits for them.  -buildshadercache needs no
+	// window or device, only the compiler.
+	StartShaders();
+	if (g_BuildShaderCache)
+		return SUCCEEDED(BuildShaderCache()) ? 0 : 1;
+
+	// Until InitDevice, whose cleanup does it, a failure has to join the
+	// shader pool itself.
 	if (FAILED(InitWindow(hInstance, nCmdShow)))
+	{
+		ReleaseShaders();
 		return 0;
+	}
 
 	if (FAILED(InitStereo()))
+	{
+		ReleaseShaders();
 		return 0;
+	}
 
 	if (FAILED(InitDevice()))
 	{
@@ -140,6 +292,25 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 		return 0;
 	}
 
+	// A benchmark run with -startuponly stops here, and fails if over budget.
+	bool startupPassed = FinishStartupTimeline();
+
+	// After the timeline, so writing the archive isn't counted as startup.
+	SaveShaderCache();
+	if (g_StartupOnly)
+	{
+		CleanupDevice();
+		return startupPassed ? 0 : 1;
+	}
+
+	g_FrameStats.Start(DefaultFrameStatsConfig());
+
+	// For external monitors, see LiveMetricsMonitor.  Running without it is fine.
+	const char* nvapiNames[NVSHIM_COUNT];
+	for (uint32_t f = 0; f < NVSHIM_COUNT; f++)
+		nvapiNames[f] = NvapiShimFunctionName((NvapiShimFunction)f);
+	g_LiveMetrics.Open(LIVE_METRICS_DEFAULT_NAME, nvapiNames, NVSHIM_COUNT);
+
 	// Main message loop
 	MSG msg = { 0 };
 	while (WM_QUIT != msg.message)
@@ -155,17 +326,242 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 		}
 	}
 
+	g_FrameStats.Stop();
+	g_LiveMetrics.Close();
 	CleanupDevice();
 
+	if (g_MeshletFrames > 0)
+	{
+		char message[128];
+		sprintf_s(message, "-meshlets: %.1f%% of %llu triangles culled a frame on average\n",
+			100.0 * (double)g_MeshletTrianglesCulled / ((double)g_MeshletFrames * (double)g_Meshlets.TriangleCount),
+			(unsigned long long)g_Meshlets.TriangleCount);
+		OutputDebugStringA(message);
+	}
+
+	if (g_LodFrames > 0 && g_LodFullTriangles > 0)
+	{
+		char message[128];
+		sprintf_s(message, "-lod: %.1f%% of the finest LODs' triangles drawn, %.2f objects changed LOD a frame\n",
+			100.0 * (double)g_LodTriangles / (double)g_LodFullTriangles, (double)g_LodChanges / (double)g_LodFrames);
+		OutputDebugStringA(message);
+	}
+
+	if (g_MeshStreamStats.Requests > 0)
+	{
+		char message[160];
+		sprintf_s(message, "-stream: %.1f MB read, %.1f MB uploaded, longest update %.2f ms\n",
+			(double)g_MeshStreamStats.BytesRead / (1024.0 * 1024.0),
+			(double)g_MeshStreamStats.BytesUploaded / (1024.0 * 1024.0),
+			(double)g_MeshStreamStats.MaxUpdateNs / 1e6);
+		OutputDebugStringA(message);
+	}
+
+	if (g_SceneObjects > 0 && g_SceneMode == SCENE_SUBMIT_INDIRECT)
+	{
+		OutputDebugStringA(g_SceneMultiDraw ? "-indirect: one NvAPI_D3D11_MultiDrawIndexedInstancedIndirect per eye\n" :
+			"-indirect: no NVAPI multi-draw, one DrawIndexedInstancedIndirect per mesh per eye\n");
+	}
+
+	if (g_TextureStreamStats.Textures > 0)
+	{
+		char message[192];
+		sprintf_s(message, "-texture: %.2f MB resident of %.2f MB requested (%.2f MB all mips), %u mips loaded, longest update %.2f ms\n",
+			(double)g_TextureStreamStats.ResidentBytes / (1024.0 * 1024.0),
+			(double)g_TextureStreamStats.RequestedBytes / (1024.0 * 1024.0),
+			(double)g_TextureStreamStats.FullBytes / (1024.0 * 1024.0),
+			g_TextureStreamStats.MipsLoaded, (double)g_TextureStreamStats.MaxUpdateNs / 1e6);
+		OutputDebugStringA(message);
+	}
+
+	// Only written in Debug and Profile builds.
+	ProfilerWriteChromeTrace("Tutorial07_trace.json");
+	ProfilerWriteBinary("Tutorial07_trace.prfb");
+
+	// Latency of every NVAPI call made through the shim.
+	NvapiShimWriteReport("Tutorial07_nvapi.json");
+
+	// Which draws fell back to mono, only with -audit.
+	if (g_StereoAudit.SampleRate() > 0.0)
+		g_StereoAudit.WriteReport("Tutorial07_stereo_audit.json");
+
 	return (int)msg.wParam;
 }
 
 
+//--------------------------------------------------------------------------------------
+// Optional settings, all default to the original sample behavior.
+//
+//	-buffers N		swap chain buffer count
+//	-flip			flip model presentation, if the system and stereo driver allow it
+//	-latency N		maximum frames queued ahead of the display
+//	-waitable		wait on the frame latency waitable object at the start of each frame
+//	-vsync N		Present sync interval
+//	-mesh path		draw a mesh file from MeshConvert instead of the cube
+//	-optimize		reorder the mesh for the vertex cache and overdraw at load
+//	-vertexformat F	float, half or unorm, the mesh's vertex format
+//	-meshlets		cull the mesh in meshlets against both eyes, without -objects
+//	-stream			load the -mesh file in the background while frames are drawn
+//	-texture path	texture the mesh with a MeshConvert texture file, mips streamed in as needed
+//	-objects N		draw a scene of N cubes instead of the one
+//	-layout L		grid, cloud or stack, for -objects
+//	-instanced		draw the -objects scene with one instanced draw per eye
+//	-sorted			draw the -objects scene per object, sorted by state once a frame
+//	-indirect		cull the -objects scene on the GPU and draw it with one multi-draw per eye
+//	-cull			cull the -objects scene against both eyes' frusta
+//	-bvh			the same, through a BVH over the scene
+//	-lod			draw each -objects object at the LOD of the mesh its size on screen needs
+//	-shadercache path	the compiled shader archive, Tutorial07_shaders.bin by default
+//	-noshadercache	compile every shader at startup, without the archive
+//	-buildshadercache	compile every shader Tutorial07 can use into the archive and exit
+//--------------------------------------------------------------------------------------
+void ParseCommandLine()
+{
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (!argv)
+		return;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc);
+
+		if (wcscmp(argv[i], L"-buffers") == 0 && hasValue)
+			g_SwapChainConfig.BufferCount = _wtoi(argv[++i]);
+		else if (wcscmp(argv[i], L"-flip") == 0)
+			g_SwapChainConfig.FlipModel = true;
+		else if (wcscmp(argv[i], L"-latency") == 0 && hasValue)
+			g_SwapChainConfig.MaxFrameLatency = _wtoi(argv[++i]);
+		else if (wcscmp(argv[i], L"-waitable") == 0)
+			g_SwapChainConfig.WaitableObject = true;
+		else if (wcscmp(argv[i], L"-vsync") == 0 && hasValue)
+			g_SwapChainConfig.SyncInterval = _wtoi(argv[++i]);
+		else if (wcscmp(argv[i], L"-startupbudget") == 0 && hasValue)
+		{
+			char path[MAX_PATH];
+			if (WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, path, MAX_PATH, nullptr, nullptr) > 0)
+				g_StartupBudgetPath = path;
+		}
+		else if (wcscmp(argv[i], L"-startuponly") == 0)
+			g_StartupOnly = true;
+		else if (wcscmp(argv[i], L"-audit") == 0 && hasValue)
+			g_StereoAudit.Configure(_wtof(argv[++i]), GetTickCount());
+		else if (wcscmp(argv[i], L"-mesh") == 0 && hasValue)
+		{
+			char path[MAX_PATH];
+			if (WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, path, MAX_PATH, nullptr, nullptr) > 0)
+				g_MeshPath = path;
+		}
+		else if (wcscmp(argv[i], L"-optimize") == 0)
+			g_MeshOptimize = true;
+		else if (wcscmp(argv[i], L"-meshlets") == 0)
+			g_MeshMeshlets = true;
+		else if (wcscmp(argv[i], L"-stream") == 0)
+			g_MeshStream = true;
+		else if (wcscmp(argv[i], L"-texture") == 0 && hasValue)
+		{
+			char path[MAX_PATH];
+			if (WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, path, MAX_PATH, nullptr, nullptr) > 0)
+				g_TexturePath = path;
+		}
+		else if (wcscmp(argv[i], L"-vertexformat") == 0 && hasValue)
+		{
+			char name[16];
+			if (WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, name, sizeof(name), nullptr, nullptr) > 0)
+			{
+				for (int format = 0; format < MESH_VERTEX_FORMAT_COUNT; format++)
+					if (strcmp(name, MeshVertexFormatName((MeshVertexFormat)format)) == 0)
+						g_MeshVertexFormat = (MeshVertexFormat)format;
+			}
+		}
+		else if (wcscmp(argv[i], L"-objects") == 0 && hasValue)
+			g_SceneObjects = _wtoi(argv[++i]);
+		else if (wcscmp(argv[i], L"-layout") == 0 && hasValue)
+		{
+			char name[16];
+			if (WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, name, sizeof(name), nullptr, nullptr) > 0)
+			{
+				for (int layout = 0; layout < SCENE_LAYOUT_COUNT; layout++)
+					if (strcmp(name, SceneLayoutName((SceneLayout)layout)) == 0)
+						g_SceneLayout = (SceneLayout)layout;
+			}
+		}
+		else if (wcscmp(argv[i], L"-instanced") == 0)
+			g_SceneMode = SCENE_SUBMIT_INSTANCED;
+		else if (wcscmp(argv[i], L"-sorted") == 0)
+			g_SceneMode = SCENE_SUBMIT_SORTED;
+		else if (wcscmp(argv[i], L"-indirect") == 0)
+			g_SceneMode = SCENE_SUBMIT_INDIRECT;
+		else if (wcscmp(argv[i], L"-cull") == 0)
+			g_SceneRenderer.SetCulling(true);
+		else if (wcscmp(argv[i], L"-bvh") == 0)
+		{
+			g_SceneRenderer.SetCulling(true);
+			g_SceneUseBvh = true;
+		}
+		else if (wcscmp(argv[i], L"-lod") == 0)
+			g_SceneLod = true;
+		else if (wcscmp(argv[i], L"-shadercache") == 0 && hasValue)
+		{
+			char path[MAX_PATH];
+			if (WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, path, MAX_PATH, nullptr, nullptr) > 0)
+				g_ShaderCachePath = path;
+		}
+		else if (wcscmp(argv[i], L"-noshadercache") == 0)
+			g_ShaderCacheEnabled = false;
+		else if (wcscmp(argv[i], L"-buildshadercache") == 0)
+			g_BuildShaderCache = true;
+	}
+
+	// Flip model can't work with a single buffer.
+	if (g_SwapChainConfig.FlipModel && g_SwapChainConfig.BufferCount < 2)
+		g_SwapChainConfig.BufferCount = 2;
+	if (g_SwapChainConfig.MaxFrameLatency < 1)
+		g_SwapChainConfig.MaxFrameLatency = 1;
+
+	LocalFree(argv);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Close the startup timeline, check it against the budget file if one was given,
+// and write Tutorial07_startup.json.  Returns false if a phase was over budget.
+//--------------------------------------------------------------------------------------
+bool FinishStartupTimeline()
+{
+	StartupTimelineEnd();
+
+	if (g_StartupBudgetPath.empty())
+	{
+		StartupTimelineWriteReport("Tutorial07_startup.json", nullptr);
+		return true;
+	}
+
+	std::vector<StartupBudgetCheck> checks;
+	bool passed = StartupTimelineCheckBudget(g_StartupBudgetPath.c_str(), &checks);
+	StartupTimelineWriteReport("Tutorial07_startup.json", &checks);
+
+	for (size_t i = 0; i < checks.size(); i++)
+	{
+		if (checks[i].Passed)
+			continue;
+		char message[512];
+		sprintf_s(message, "Startup over budget: %s took %.1fms wall, %.1fms CPU, budget %.1fms\n",
+			checks[i].Path.c_str(), checks[i].WallMs, checks[i].CpuMs, checks[i].BudgetWallMs);
+		OutputDebugStringA(message);
+	}
+
+	return passed;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Register class and create window
 //--------------------------------------------------------------------------------------
 HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow)
 {
+	STARTUP_PHASE("InitWindow");
+
 	// Register class
 	WNDCLASSEX wcex;
 	wcex.cbSize = sizeof(WNDCLASSEX);
@@ -206,14 +602,19 @@ HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow)
 //--------------------------------------------------------------------------------------
 HRESULT InitStereo()
 {
+	PROFILE_ZONE("InitStereo");
+	STARTUP_PHASE("InitStereo");
+
 	NvAPI_Status status;
 
+	STARTUP_STEP("NvAPI_Initialize");
 	status = NvAPI_Initialize();
 	if (FAILED(status))
 		return status;
 
 	// The entire point is to show stereo.  
 	// If it's not enabled in the control panel, let the user know.
+	STARTUP_STEP("NvAPI_Stereo_IsEnabled");
 	NvU8 stereoEnabled;
 	status = NvAPI_Stereo_IsEnabled(&stereoEnabled);
 	if (FAILED(status) || !stereoEnabled)
@@ -222,6 +623,7 @@ HRESULT InitStereo()
 		return status;
 	}
 
+	STARTUP_STEP("NvAPI_Stereo_SetDriverMode");
 	status = NvAPI_Stereo_SetDriverMode(NVAPI_STEREO_DRIVER_MODE_DIRECT);
 	if (FAILED(status))
 		return status;
@@ -236,25 +638,92 @@ HRESULT InitStereo()
 //--------------------------------------------------------------------------------------
 HRESULT ActivateStereo()
 {
+	PROFILE_ZONE("ActivateStereo");
+	STARTUP_PHASE("ActivateStereo");
+
 	NvAPI_Status status;
 
 	status = NvAPI_Stereo_CreateHandleFromIUnknown(g_pd3dDevice, &g_StereoHandle);
 	if (FAILED(status))
 		return status;
 
+	if (g_pSceneBackend && g_StereoAudit.SampleRate() > 0.0)
+		g_pSceneBackend->SetStereoAudit(&g_StereoAudit, g_StereoHandle);
+
 	return status;
 }
 
 
 //--------------------------------------------------------------------------------------
-// Helper for compiling shaders with D3DCompile
-//
-// With VS 11, we could load up prebuilt .cso files instead...
+// The slot 0 input elements for a mesh vertex format.  Quantized positions
+// are four UNORM16s with w at 1, so the shader sees the same float4 either way.
 //--------------------------------------------------------------------------------------
-HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut)
+UINT MeshInputElements(MeshVertexFormat format, D3D11_INPUT_ELEMENT_DESC elements[2])
 {
-	HRESULT hr = S_OK;
+	DXGI_FORMAT position = DXGI_FORMAT_R32G32B32_FLOAT;
+	DXGI_FORMAT texcoord = DXGI_FORMAT_R32G32_FLOAT;
+	UINT texcoordOffset = 12;
+	if (format == MESH_VERTEX_UNORM16_HALF || format == MESH_VERTEX_UNORM16_UNORM16)
+	{
+		position = DXGI_FORMAT_R16G16B16A16_UNORM;
+		texcoord = (format == MESH_VERTEX_UNORM16_HALF) ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R16G16_UNORM;
+		texcoordOffset = 8;
+	}
+
+	D3D11_INPUT_ELEMENT_DESC positionElement = { "POSITION", 0, position, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+	D3D11_INPUT_ELEMENT_DESC texcoordElement = { "TEXCOORD", 0, texcoord, 0, texcoordOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+	elements[0] = positionElement;
+	elements[1] = texcoordElement;
+	return 2;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Every shader InitDevice can use.  StartShaders loads the ones this run wants
+// from the shader cache, or starts compiling them on a pool, at process start,
+// so the compiles run while the window, stereo and device are set up.
+// WaitForShaders joins them right before InitDevice creates the shaders.
+//--------------------------------------------------------------------------------------
+enum ShaderId
+{
+	SHADER_VS = 0,
+	SHADER_PS,
+	SHADER_VS_INSTANCED,
+	SHADER_CULL_INDIRECT,
+	SHADER_COUNT
+};
+
+struct ShaderJob
+{
+	LPCSTR EntryPoint;
+	LPCSTR Target;
+	const char* SpanName;		// On the startup timeline
+	bool Wanted;
+	bool Cached;				// Has a key, so the compile goes into the cache
+	ShaderCacheKey Key;
+	ID3DBlob* pBlob;
+	HRESULT Result;
+	uint64_t StartNs;			// The compile, on whichever thread ran it
+	uint64_t EndNs;
+	uint64_t CpuNs;
+};
 
+static const char* kShaderSourcePath = "Tutorial07.fx";
+
+ShaderJob g_ShaderJobs[SHADER_COUNT] =
+{
+	{ "VS", "vs_4_0", "CompileVS" },
+	{ "PS", "ps_4_0", "CompilePS" },
+	{ "VSInstanced", "vs_4_0", "CompileVSInstanced" },
+	{ "CullIndirect", "cs_5_0", "CompileCullIndirect" },
+};
+
+
+//--------------------------------------------------------------------------------------
+// Flags for D3DCompile, part of each shader's cache key.
+//--------------------------------------------------------------------------------------
+DWORD ShaderCompileFlags()
+{
 	DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
 #ifdef _DEBUG
 	// Set the D3DCOMPILE_DEBUG flag to embed debug information in the shaders.
@@ -266,22 +735,244 @@ HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szS
 	// Disable optimizations to further improve shader debugging
 	dwShaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+	return dwShaderFlags;
+}
 
-	ID3DBlob* pErrorBlob = nullptr;
-	hr = D3DCompileFromFile(szFileName, nullptr, nullptr, szEntryPoint, szShaderModel,
-		dwShaderFlags, 0, ppBlobOut, &pErrorBlob);
-	if (FAILED(hr))
+
+//--------------------------------------------------------------------------------------
+// Compiles g_ShaderCompileList[begin, end) from the mapped source, on a pool
+// thread or in WaitForShaders.  D3DCompile can run on several threads at once.
+//--------------------------------------------------------------------------------------
+void CompileShaderTask(void* pContext, uint32_t begin, uint32_t end)
+{
+	const uint32_t* pList = static_cast<const uint32_t*>(pContext);
+	for (uint32_t i = begin; i < end; i++)
 	{
+		PROFILE_ZONE("CompileShader");
+		ShaderJob& job = g_ShaderJobs[pList[i]];
+		job.StartNs = GetTimeNs();
+		uint64_t startCpuNs = GetThreadCpuTimeNs();
+
+		ID3DBlob* pErrorBlob = nullptr;
+		job.Result = D3DCompile(g_ShaderSource.Data(), g_ShaderSource.Size(), kShaderSourcePath, nullptr, nullptr,
+			job.EntryPoint, job.Target, g_ShaderFlags, 0, &job.pBlob, &pErrorBlob);
 		if (pErrorBlob)
 		{
-			OutputDebugStringA(reinterpret_cast<const char*>(pErrorBlob->GetBufferPointer()));
+			if (FAILED(job.Result))
+				OutputDebugStringA(reinterpret_cast<const char*>(pErrorBlob->GetBufferPointer()));
 			pErrorBlob->Release();
 		}
-		return hr;
+
+		job.CpuNs = GetThreadCpuTimeNs() - startCpuNs;
+		job.EndNs = GetTimeNs();
 	}
-	if (pErrorBlob) pErrorBlob->Release();
+}
 
-	return S_OK;
+
+//--------------------------------------------------------------------------------------
+// Which shaders are wanted follows from the options.  -indirect's are compiled
+// even though a device below 11_0 draws instanced instead, since the device
+// doesn't exist yet.  Cache hits are loaded here, they take microseconds, and
+// the misses go to the pool.
+//--------------------------------------------------------------------------------------
+void StartShaders()
+{
+	PROFILE_ZONE("StartShaders");
+	STARTUP_PHASE("StartShaders");
+
+	bool indirect = (g_SceneObjects > 0 && g_SceneMode == SCENE_SUBMIT_INDIRECT);
+	g_ShaderJobs[SHADER_VS].Wanted = true;
+	g_ShaderJobs[SHADER_PS].Wanted = true;
+	g_ShaderJobs[SHADER_VS_INSTANCED].Wanted = g_BuildShaderCache || indirect ||
+		(g_SceneObjects > 0 && g_SceneMode == SCENE_SUBMIT_INSTANCED);
+	g_ShaderJobs[SHADER_CULL_INDIRECT].Wanted = g_BuildShaderCache || indirect;
+	g_ShaderFlags = ShaderCompileFlags();
+
+	// The source is read once, hashed for the keys and compiled from on a miss.
+	if (!g_ShaderSource.Open(kShaderSourcePath))
+	{
+		for (UINT s = 0; s < SHADER_COUNT; s++)
+			g_ShaderJobs[s].Result = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+		return;
+	}
+
+	// Not having a cache is fine, every shader misses and SaveShaderCache
+	// writes it.
+	std::string error;
+	if (g_ShaderCacheEnabled && !g_ShaderCache.Open(g_ShaderCachePath.c_str(), &error))
+	{
+		char message[MAX_PATH + 128];
+		sprintf_s(message, "%s: %s, compiling the shaders\n", g_ShaderCachePath.c_str(), error.c_str());
+		OutputDebugStringA(message);
+	}
+
+	for (UINT s = 0; s < SHADER_COUNT; s++)
+	{
+		ShaderJob& job = g_ShaderJobs[s];
+		if (!job.Wanted)
+			continue;
+
+		uint64_t startNs = GetTimeNs();
+		job.Cached = g_ShaderCacheEnabled && MakeShaderCacheKey(g_ShaderSource.Data(), g_ShaderSource.Size(), "",
+			g_ShaderFlags, job.EntryPoint, job.Target, D3D_COMPILER_VERSION, &job.Key);
+		size_t bytes = 0;
+		const void* pBytecode = job.Cached ? g_ShaderCache.Find(job.Key, &bytes) : nullptr;
+		if (pBytecode)
+		{
+			job.Result = D3DCreateBlob(bytes, &job.pBlob);
+			if (SUCCEEDED(job.Result))
+				memcpy(job.pBlob->GetBufferPointer(), pBytecode, bytes);
+			g_ShadersLoaded++;
+			g_ShaderLoadNs += GetTimeNs() - startNs;
+		}
+		else
+			g_ShaderCompileList.push_back(s);
+	}
+
+	// Workers beyond one a compile would only sit there.  With a single core
+	// there are none and everything compiles in WaitForShaders.
+	if (!g_ShaderCompileList.empty())
+	{
+		uint32_t workers = WorkerPool::DefaultWorkers();
+		if (workers > (uint32_t)g_ShaderCompileList.size())
+			workers = (uint32_t)g_ShaderCompileList.size();
+		g_pShaderPool = new WorkerPool(workers);
+		g_pShaderPool->Begin((uint32_t)g_ShaderCompileList.size(), 1, CompileShaderTask, &g_ShaderCompileList[0]);
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Joins the compiles, helping with any not yet started, puts them in the
+// shader cache, and adds them to the startup timeline as a "ShaderPool" span
+// with one span per shader under it.  Returns the first wanted shader's
+// failure.
+//--------------------------------------------------------------------------------------
+HRESULT WaitForShaders()
+{
+	PROFILE_ZONE("WaitForShaders");
+
+	uint64_t waitStartNs = GetTimeNs();
+	if (g_pShaderPool)
+	{
+		g_pShaderPool->Wait();
+		delete g_pShaderPool;
+		g_pShaderPool = nullptr;
+	}
+	g_ShaderWaitNs = GetTimeNs() - waitStartNs;
+
+	HRESULT hr = S_OK;
+	uint64_t firstStartNs = UINT64_MAX;
+	uint64_t lastEndNs = 0;
+	uint64_t cpuNs = 0;
+	for (size_t i = 0; i < g_ShaderCompileList.size(); i++)
+	{
+		ShaderJob& job = g_ShaderJobs[g_ShaderCompileList[i]];
+		if (job.StartNs < firstStartNs)
+			firstStartNs = job.StartNs;
+		if (job.EndNs > lastEndNs)
+			lastEndNs = job.EndNs;
+		cpuNs += job.CpuNs;
+		g_ShadersCompiled++;
+		g_ShaderCompileNs += job.EndNs - job.StartNs;
+		if (SUCCEEDED(job.Result) && job.Cached)
+			g_ShaderCache.Add(job.Key, job.pBlob->GetBufferPointer(), job.pBlob->GetBufferSize(), job.EndNs - job.StartNs);
+	}
+	for (UINT s = 0; s < SHADER_COUNT && SUCCEEDED(hr); s++)
+		if (g_ShaderJobs[s].Wanted && FAILED(g_ShaderJobs[s].Result))
+			hr = g_ShaderJobs[s].Result;
+
+	if (!g_ShaderCompileList.empty())
+	{
+		g_ShaderPoolWallNs = lastEndNs - firstStartNs;
+		g_ShaderOverlapNs = (waitStartNs > firstStartNs) ? ((lastEndNs < waitStartNs) ? lastEndNs : waitStartNs) - firstStartNs : 0;
+
+		int pool = StartupTimelineAddSpan("ShaderPool", -1, firstStartNs, lastEndNs, cpuNs);
+		for (size_t i = 0; i < g_ShaderCompileList.size() && pool >= 0; i++)
+		{
+			const ShaderJob& job = g_ShaderJobs[g_ShaderCompileList[i]];
+			StartupTimelineAddSpan(job.SpanName, pool, job.StartNs, job.EndNs, job.CpuNs);
+		}
+		g_ShaderCompileList.clear();
+	}
+
+	g_ShaderSource.Close();
+	return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// A wanted shader's bytecode, which the caller releases, after WaitForShaders.
+//--------------------------------------------------------------------------------------
+ID3DBlob* TakeShader(ShaderId id)
+{
+	ID3DBlob* pBlob = g_ShaderJobs[id].pBlob;
+	g_ShaderJobs[id].pBlob = nullptr;
+	return pBlob;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Joins the pool if InitDevice never got to WaitForShaders, and releases the
+// bytecode nothing took, -indirect's cull shader on a 10_x device say.
+//--------------------------------------------------------------------------------------
+void ReleaseShaders()
+{
+	if (g_pShaderPool)
+	{
+		g_pShaderPool->Wait();
+		delete g_pShaderPool;
+		g_pShaderPool = nullptr;
+	}
+	for (UINT s = 0; s < SHADER_COUNT; s++)
+	{
+		ID3DBlob* pBlob = TakeShader((ShaderId)s);
+		if (pBlob) pBlob->Release();
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Write what this run compiled to the shader cache, and report the time the
+// shaders took either way, and how much of the compiling startup didn't wait
+// for.
+//--------------------------------------------------------------------------------------
+void SaveShaderCache()
+{
+	if (g_ShaderCache.Dirty() && !g_ShaderCache.Save(g_ShaderCachePath.c_str()))
+	{
+		char message[MAX_PATH + 64];
+		sprintf_s(message, "%s: can't be written\n", g_ShaderCachePath.c_str());
+		OutputDebugStringA(message);
+	}
+
+	char message[256];
+	sprintf_s(message, "Shaders: %u loaded from the cache in %.2f ms (%.1f ms when compiled), %u compiled in %.1f ms\n",
+		g_ShadersLoaded, (double)g_ShaderLoadNs / 1e6, (double)g_ShaderCache.Stats().HitCompileNs / 1e6,
+		g_ShadersCompiled, (double)g_ShaderCompileNs / 1e6);
+	OutputDebugStringA(message);
+
+	if (g_ShadersCompiled > 0)
+	{
+		sprintf_s(message, "Shaders: compiling took %.1f ms of wall time, %.1f ms of it overlapped with startup, and InitDevice waited %.1f ms\n",
+			(double)g_ShaderPoolWallNs / 1e6, (double)g_ShaderOverlapNs / 1e6, (double)g_ShaderWaitNs / 1e6);
+		OutputDebugStringA(message);
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// -buildshadercache, every shader InitDevice can use, so an install or a build
+// can fill the cache before the first launch.
+//--------------------------------------------------------------------------------------
+HRESULT BuildShaderCache()
+{
+	HRESULT hr = WaitForShaders();
+	SaveShaderCache();
+	ReleaseShaders();
+	if (FAILED(hr))
+		return hr;
+	return g_ShaderCacheEnabled ? S_OK : E_FAIL;
 }
 
 
@@ -290,6 +981,9 @@ HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szS
 //--------------------------------------------------------------------------------------
 HRESULT InitDevice()
 {
+	PROFILE_ZONE("InitDevice");
+	STARTUP_PHASE("InitDevice");
+
 	HRESULT hr = S_OK;
 
 	UINT createDeviceFlags = 0;
@@ -297,28 +991,27 @@ HRESULT InitDevice()
 	createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
-	DXGI_SWAP_CHAIN_DESC sd;
-	ZeroMemory(&sd, sizeof(sd));
-	sd.BufferCount = 1;
-	sd.BufferDesc.Width = g_ScreenWidth;// *2;	// Swapchain needs to be 2x sized for direct stereo.
-	sd.BufferDesc.Height = g_ScreenHeight;
-	sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	sd.BufferDesc.RefreshRate.Numerator = 120;	// Needs to be 120Hz for 3D Vision 
-	sd.BufferDesc.RefreshRate.Denominator = 1;
-	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	sd.OutputWindow = g_hWnd;
-	sd.SampleDesc.Count = 1;
-	sd.SampleDesc.Quality = 0;
-	sd.Windowed = TRUE;
-
-	// Create the simple DX11, Device, SwapChain, and Context.
-	hr = D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, createDeviceFlags, nullptr, 0,
-		D3D11_SDK_VERSION, &sd, &g_pSwapChain, &g_pd3dDevice, nullptr, &g_pImmediateContext);
+	// Create the simple DX11 Device and Context.
+	STARTUP_STEP("CreateDevice");
+	hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, createDeviceFlags, nullptr, 0,
+		D3D11_SDK_VERSION, &g_pd3dDevice, nullptr, &g_pImmediateContext);
 	if (FAILED(hr))
 		return hr;
 
+	// Then the SwapChain, flip model if asked for and possible, otherwise the
+	// original blt-model.
+	STARTUP_STEP("CreateSwapChain");
+	SwapChainInfo swapInfo;
+	hr = CreateStereoSwapChain(g_pd3dDevice, g_hWnd, g_ScreenWidth,// *2,	// Swapchain needs to be 2x sized for direct stereo.
+		g_ScreenHeight, g_SwapChainConfig, &g_pSwapChain, &swapInfo);
+	if (FAILED(hr))
+		return hr;
+
+	g_pPresenter = new DXGIPresenter(g_pSwapChain, swapInfo.FrameLatencyWaitable);
+
 	// For DX11 3D, it's required that we run in exclusive full-screen mode, otherwise 3D
 	// Vision will not activate.
+	STARTUP_STEP("SetFullscreenState");
 	hr = g_pSwapChain->SetFullscreenState(TRUE, nullptr);
 	if (FAILED(hr))
 		return hr;
@@ -326,6 +1019,7 @@ HRESULT InitDevice()
 	// Create a render target view from the backbuffer
 	//
 	// Since this is derived from the backbuffer, it will also be 2x in width.
+	STARTUP_STEP("CreateRenderTargets");
 	ID3D11Texture2D* pBackBuffer = nullptr;
 	hr = g_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&pBackBuffer));
 	if (FAILED(hr))
@@ -378,9 +1072,119 @@ HRESULT InitDevice()
 	vp.TopLeftY = 0;
 	g_pImmediateContext->RSSetViewports(1, &vp);
 
-	// Compile the vertex shader
-	ID3DBlob* pVSBlob = nullptr;
-	hr = CompileShaderFromFile(L"Tutorial07.fx", "VS", "vs_4_0", &pVSBlob);
+	// Load the mesh first, since its vertex format picks the input layouts.  A
+	// -mesh file is mapped and its blobs go to CreateBuffer as they are, so the
+	// only copy is the driver's.  Without -mesh the cube is built in memory in
+	// the same format.
+	STARTUP_STEP("LoadMesh");
+	MappedFile meshFile;
+	std::vector<uint8_t> cubeImage;
+	MeshFileView mesh;
+	std::string meshError;
+	if (!g_MeshPath.empty())
+	{
+		if (!meshFile.Open(g_MeshPath.c_str()))
+			meshError = "can't open the file";
+		else
+			mesh.Parse(meshFile.Data(), meshFile.Size(), &meshError);
+	}
+	else
+	{
+		MeshData cube;
+		BuildCubeMesh(&cube);
+		SerializeMesh(cube, &cubeImage, (g_MeshVertexFormat < MESH_VERTEX_FORMAT_COUNT) ? g_MeshVertexFormat : MESH_VERTEX_POSITION_TEXCOORD);
+		mesh.Parse(&cubeImage[0], cubeImage.size(), &meshError);
+	}
+	if (!meshError.empty() && g_MeshPath.empty())
+	{
+		// Only a bug gets here, the cube is built and serialized just above.
+		char message[256];
+		sprintf_s(message, "Built-in cube: %s\n", meshError.c_str());
+		OutputDebugStringA(message);
+		MessageBox(nullptr, L"The built-in cube mesh cannot be created.", L"Error", MB_OK);
+		return E_FAIL;
+	}
+	if (!meshError.empty())
+	{
+		char message[MAX_PATH + 128];
+		sprintf_s(message, "%s: %s\n", g_MeshPath.c_str(), meshError.c_str());
+		OutputDebugStringA(message);
+		MessageBox(nullptr, L"The -mesh file cannot be loaded.", L"Error", MB_OK);
+		return E_FAIL;
+	}
+
+	// -stream only needs the header now, which Parse has checked, and the
+	// options below that rewrite the mesh in memory don't apply to it.
+	bool streaming = g_MeshStream && !g_MeshPath.empty();
+	if (streaming && (g_MeshOptimize || g_MeshVertexFormat < MESH_VERTEX_FORMAT_COUNT || g_MeshMeshlets))
+		OutputDebugStringA("-stream: -optimize, -vertexformat and -meshlets are ignored, convert the file with MeshConvert instead\n");
+
+	// -optimize, and a -vertexformat other than the file's, rewrite a copy,
+	// which gives up the mapped load, so files should be converted by
+	// MeshConvert and these kept for comparing.
+	bool reformat = (g_MeshVertexFormat < MESH_VERTEX_FORMAT_COUNT && g_MeshVertexFormat != mesh.VertexFormat());
+	std::vector<uint8_t> rewrittenImage;
+	if ((g_MeshOptimize || reformat) && !streaming)
+	{
+		MeshData data;
+		MeshOptimizeReport report;
+		if (mesh.CheckIndices() && mesh.ToMeshData(&data))
+		{
+			MeshVertexFormat format = reformat ? g_MeshVertexFormat : mesh.VertexFormat();
+			if (g_MeshOptimize)
+				OptimizeMesh(&data, &report);
+			MeshQuantizeError error = MeasureQuantizeError(data, format);
+			if (SerializeMesh(data, &rewrittenImage, format))
+				mesh.Parse(&rewrittenImage[0], rewrittenImage.size());
+
+			char message[256];
+			if (g_MeshOptimize)
+			{
+				sprintf_s(message, "-optimize: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.3f -> %.3f\n",
+					report.CacheBefore.Acmr, report.CacheAfter.Acmr, report.CacheBefore.Atvr, report.CacheAfter.Atvr,
+					report.FetchBefore.Overfetch, report.FetchAfter.Overfetch);
+				OutputDebugStringA(message);
+			}
+			if (format != MESH_VERTEX_POSITION_TEXCOORD)
+			{
+				sprintf_s(message, "-vertexformat %s: %u bytes a vertex, position error %g max %g rms, texcoord error %g max %g rms\n",
+					MeshVertexFormatName(format), MeshVertexStride(format), error.PositionMax, error.PositionRms,
+					error.TexcoordMax, error.TexcoordRms);
+				OutputDebugStringA(message);
+			}
+		}
+	}
+
+	// -meshlets splits LOD 0, in the order the file or -optimize left it, and
+	// past 65536 vertices gives each group of meshlets its own vertex range, so
+	// the vertex buffer is then gathered through the remap.
+	std::vector<uint8_t> meshletVertices;
+	if (g_MeshMeshlets && g_SceneObjects == 0 && !streaming)
+	{
+		STARTUP_STEP("BuildMeshlets");
+		MeshData data;
+		if (mesh.CheckIndices() && mesh.ToMeshData(&data) &&
+			BuildMeshlets(data, mesh.Lod(0).StartIndex, mesh.Lod(0).IndexCount, mesh.VertexStride(), &g_Meshlets))
+		{
+			const std::vector<uint32_t>& remap = g_Meshlets.VertexRemap;
+			const uint8_t* pSource = static_cast<const uint8_t*>(mesh.Vertices());
+			meshletVertices.resize(remap.size() * mesh.VertexStride());
+			for (size_t v = 0; v < remap.size(); v++)
+				memcpy(&meshletVertices[v * mesh.VertexStride()], pSource + (size_t)remap[v] * mesh.VertexStride(), mesh.VertexStride());
+			g_MeshletVisible.resize(g_Meshlets.Meshlets.size());
+
+			char message[256];
+			sprintf_s(message, "-meshlets: %u meshlets in %u groups, %u bit indices, %u duplicated vertices, %lld bytes saved against 32 bit indices\n",
+				(UINT)g_Meshlets.Meshlets.size(), (UINT)g_Meshlets.Groups.size(), g_Meshlets.IndexBytes * 8,
+				remap.empty() ? 0 : (UINT)(remap.size() - g_Meshlets.UsedVertexCount), (long long)g_Meshlets.BytesSaved());
+			OutputDebugStringA(message);
+		}
+	}
+
+	// The shaders have been compiling since process start, this is where
+	// they're needed.
+	STARTUP_STEP("WaitForShaders");
+	hr = WaitForShaders();
 	if (FAILED(hr))
 	{
 		MessageBox(nullptr,
@@ -389,6 +1193,8 @@ HRESULT InitDevice()
 	}
 
 	// Create the vertex shader
+	STARTUP_STEP("CreateVS");
+	ID3DBlob* pVSBlob = TakeShader(SHADER_VS);
 	hr = g_pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &g_pVertexShader);
 	if (FAILED(hr))
 	{
@@ -396,13 +1202,9 @@ HRESULT InitDevice()
 		return hr;
 	}
 
-	// Define the input layout
-	D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	UINT numElements = ARRAYSIZE(layout);
+	// Define the input layout, for the mesh's vertex format
+	D3D11_INPUT_ELEMENT_DESC layout[2];
+	UINT numElements = MeshInputElements(mesh.VertexFormat(), layout);
 
 	// Create the input layout
 	hr = g_pd3dDevice->CreateInputLayout(layout, numElements, pVSBlob->GetBufferPointer(),
@@ -414,109 +1216,206 @@ HRESULT InitDevice()
 	// Set the input layout
 	g_pImmediateContext->IASetInputLayout(g_pVertexLayout);
 
-	// Compile the pixel shader
-	ID3DBlob* pPSBlob = nullptr;
-	hr = CompileShaderFromFile(L"Tutorial07.fx", "PS", "ps_4_0", &pPSBlob);
-	if (FAILED(hr))
-	{
-		MessageBox(nullptr,
-			L"The FX file cannot be compiled.  Please run this executable from the directory that contains the FX file.", L"Error", MB_OK);
-		return hr;
-	}
-
 	// Create the pixel shader
+	STARTUP_STEP("CreatePS");
+	ID3DBlob* pPSBlob = TakeShader(SHADER_PS);
 	hr = g_pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &g_pPixelShader);
 	pPSBlob->Release();
 	if (FAILED(hr))
 		return hr;
 
-	// Create vertex buffer for the cube
-	SimpleVertex vertices[] =
+	// -indirect's cull pass is a cs_5_0 shader writing two UAVs, and draw
+	// indirect is an 11_0 feature too.
+	if (g_SceneMode == SCENE_SUBMIT_INDIRECT && g_pd3dDevice->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0)
 	{
-		{ XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT2(1.0f, 0.0f) },
-		{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT2(0.0f, 0.0f) },
-		{ XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT2(0.0f, 1.0f) },
-		{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT2(1.0f, 1.0f) },
-
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT2(0.0f, 0.0f) },
-		{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT2(1.0f, 0.0f) },
-		{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT2(1.0f, 1.0f) },
-		{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT2(0.0f, 1.0f) },
-
-		{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT2(0.0f, 1.0f) },
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT2(1.0f, 1.0f) },
-		{ XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT2(1.0f, 0.0f) },
-		{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT2(0.0f, 0.0f) },
+		OutputDebugStringA("-indirect: needs feature level 11_0, drawing instanced instead\n");
+		g_SceneMode = SCENE_SUBMIT_INSTANCED;
+	}
 
-		{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT2(1.0f, 1.0f) },
-		{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT2(0.0f, 1.0f) },
-		{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT2(0.0f, 0.0f) },
-		{ XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT2(1.0f, 0.0f) },
+	// The instanced vertex shader, and its layout with the world matrix rows
+	// from the instance buffer in slot 1, which -indirect draws with too.
+	if (g_SceneObjects > 0 && (g_SceneMode == SCENE_SUBMIT_INSTANCED || g_SceneMode == SCENE_SUBMIT_INDIRECT))
+	{
+		STARTUP_STEP("CreateVSInstanced");
+		ID3DBlob* pVSInstancedBlob = TakeShader(SHADER_VS_INSTANCED);
+		hr = g_pd3dDevice->CreateVertexShader(pVSInstancedBlob->GetBufferPointer(), pVSInstancedBlob->GetBufferSize(), nullptr, &g_pInstancedVertexShader);
+		if (FAILED(hr))
+		{
+			pVSInstancedBlob->Release();
+			return hr;
+		}
 
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT2(0.0f, 1.0f) },
-		{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT2(1.0f, 1.0f) },
-		{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT2(1.0f, 0.0f) },
-		{ XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT2(0.0f, 0.0f) },
+		D3D11_INPUT_ELEMENT_DESC instancedLayout[] =
+		{
+			layout[0],
+			layout[1],
+			{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		};
+
+		hr = g_pd3dDevice->CreateInputLayout(instancedLayout, ARRAYSIZE(instancedLayout), pVSInstancedBlob->GetBufferPointer(),
+			pVSInstancedBlob->GetBufferSize(), &g_pInstancedLayout);
+		pVSInstancedBlob->Release();
+		if (FAILED(hr))
+			return hr;
+
+		g_pImmediateContext->IASetInputLayout(g_pInstancedLayout);
+	}
 
-		{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT2(1.0f, 1.0f) },
-		{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT2(0.0f, 1.0f) },
-		{ XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT2(0.0f, 0.0f) },
-		{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT2(1.0f, 0.0f) },
-	};
+	if (g_SceneObjects > 0 && g_SceneMode == SCENE_SUBMIT_INDIRECT)
+	{
+		STARTUP_STEP("CreateCullIndirect");
+		ID3DBlob* pCSBlob = TakeShader(SHADER_CULL_INDIRECT);
+		hr = g_pd3dDevice->CreateComputeShader(pCSBlob->GetBufferPointer(), pCSBlob->GetBufferSize(), nullptr, &g_pCullIndirectShader);
+		pCSBlob->Release();
+		if (FAILED(hr))
+			return hr;
+	}
 
+	// Create the vertex and index buffers from the mesh loaded above, or with
+	// -stream start loading them, and RenderFrame binds them once they're in.
+	STARTUP_STEP("CreateBuffers");
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(SimpleVertex) * 24;
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.CPUAccessFlags = 0;
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = vertices;
-	hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, &g_pVertexBuffer);
-	if (FAILED(hr))
-		return hr;
-
-	// Set vertex buffer
-	UINT stride = sizeof(SimpleVertex);
-	UINT offset = 0;
-	g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer, &stride, &offset);
-
-	// Create index buffer
-	// Create vertex buffer
-	WORD indices[] =
+	if (streaming)
 	{
-		3, 1, 0,
-		2, 1, 3,
-
-		6, 4, 5,
-		7, 4, 6,
-
-		11, 9, 8,
-		10, 9, 11,
+		g_pMeshStreamSink = new D3D11MeshStreamSink(g_pd3dDevice, g_pImmediateContext);
+		g_pMeshStreamer = new MeshStreamer(DefaultMeshStreamConfig(), g_pMeshStreamSink);
+		g_StreamedMesh = g_pMeshStreamer->Register(g_MeshPath.c_str());
+		g_pMeshStreamer->Request(g_StreamedMesh, 1.0f);
+		g_StreamStartNs = GetTimeNs();
+		g_MeshReady = false;
+	}
+	else
+	{
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.ByteWidth = (UINT)(meshletVertices.empty() ? mesh.VertexDataBytes() : meshletVertices.size());
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = 0;
+		InitData.pSysMem = meshletVertices.empty() ? mesh.Vertices() : &meshletVertices[0];
+		hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, &g_pVertexBuffer);
+		if (FAILED(hr))
+			return hr;
+
+		// Set vertex buffer
+		UINT stride = mesh.VertexStride();
+		UINT offset = 0;
+		g_pImmediateContext->IASetVertexBuffers(0, 1, &g_pVertexBuffer, &stride, &offset);
+
+		// Create index buffer, the meshlets' own with -meshlets
+		bool meshlets = !g_Meshlets.Meshlets.empty();
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.ByteWidth = (UINT)(meshlets ? g_Meshlets.IndexData.size() : mesh.IndexDataBytes());
+		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		bd.CPUAccessFlags = 0;
+		InitData.pSysMem = meshlets ? &g_Meshlets.IndexData[0] : mesh.Indices();
+		hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, &g_pIndexBuffer);
+		if (FAILED(hr))
+			return hr;
+
+		// Set index buffer
+		UINT indexBytes = meshlets ? g_Meshlets.IndexBytes : mesh.IndexBytes();
+		g_pImmediateContext->IASetIndexBuffer(g_pIndexBuffer, (indexBytes == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+	}
 
-		14, 12, 13,
-		15, 12, 14,
+	// What the scene draws of it.  The sphere is about the mesh origin, where
+	// the objects are placed.
+	const MeshBounds& meshBounds = mesh.Bounds();
+	g_Mesh.IndexCount = mesh.Lod(0).IndexCount;
+	g_Mesh.StartIndex = mesh.Lod(0).StartIndex;
+	g_Mesh.BaseVertex = 0;
+	g_Mesh.VertexCount = mesh.VertexCount();
+	g_Mesh.Radius = sqrtf(meshBounds.Center[0] * meshBounds.Center[0] + meshBounds.Center[1] * meshBounds.Center[1] +
+		meshBounds.Center[2] * meshBounds.Center[2]) + meshBounds.Radius;
+
+	// With -lod the scene has the coarser LODs too, each after the one before.
+	std::vector<SceneMesh> sceneMeshes(1, g_Mesh);
+	if (g_SceneLod && g_SceneObjects > 0)
+	{
+		sceneMeshes[0].LodCount = mesh.LodCount();
+		for (uint32_t lod = 1; lod < mesh.LodCount(); lod++)
+		{
+			SceneMesh level = g_Mesh;
+			level.IndexCount = mesh.Lod(lod).IndexCount;
+			level.StartIndex = mesh.Lod(lod).StartIndex;
+			level.LodCount = mesh.LodCount() - lod;
+			level.LodError = mesh.Lod(lod).Error;
+			sceneMeshes.push_back(level);
+		}
+		if (mesh.LodCount() == 1)
+			OutputDebugStringA("-lod: the mesh has only the one LOD\n");
+	}
+	meshFile.Close();
 
-		19, 17, 16,
-		18, 17, 19,
+	// A -texture file starts with its tail and RenderFrame asks for finer mips
+	// as they're wanted.  The checker is small, so it has every mip at once.
+	STARTUP_STEP("CreateTexture");
+	if (!g_TexturePath.empty())
+	{
+		std::string textureError;
+		g_pTextureStreamSink = new D3D11TextureStreamSink(g_pd3dDevice, g_pImmediateContext);
+		g_pTextureStreamer = new TextureStreamer(DefaultTextureStreamConfig(), g_pTextureStreamSink);
+		g_StreamedTexture = g_pTextureStreamer->Open(g_TexturePath.c_str(), &textureError);
+		if (g_StreamedTexture == UINT32_MAX)
+		{
+			char message[MAX_PATH + 128];
+			sprintf_s(message, "%s: %s\n", g_TexturePath.c_str(), textureError.empty() ? "can't create the texture" : textureError.c_str());
+			OutputDebugStringA(message);
+			MessageBox(nullptr, L"The -texture file cannot be loaded.", L"Error", MB_OK);
+			return E_FAIL;
+		}
+	}
+	else
+	{
+		std::vector<uint8_t> checker;
+		TextureData texture;
+		BuildCheckerImage(256, 256, 8, &checker);
+		BuildTexture(TEXTURE_BC1, &checker[0], 256, 256, 0, &texture);
 
-		22, 20, 21,
-		23, 20, 22
-	};
+		D3D11_SUBRESOURCE_DATA mipData[kTextureMaxMips];
+		for (size_t m = 0; m < texture.Mips.size(); m++)
+		{
+			mipData[m].pSysMem = &texture.Mips[m][0];
+			mipData[m].SysMemPitch = TextureRowBytes(texture.Format, TextureMipSize(texture.Width, (uint32_t)m));
+			mipData[m].SysMemSlicePitch = 0;
+		}
+		D3D11_TEXTURE2D_DESC td;
+		ZeroMemory(&td, sizeof(td));
+		td.Width = texture.Width;
+		td.Height = texture.Height;
+		td.MipLevels = (UINT)texture.Mips.size();
+		td.ArraySize = 1;
+		td.Format = DXGI_FORMAT_BC1_UNORM;
+		td.SampleDesc.Count = 1;
+		td.Usage = D3D11_USAGE_IMMUTABLE;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		ID3D11Texture2D* pTexture = nullptr;
+		hr = g_pd3dDevice->CreateTexture2D(&td, mipData, &pTexture);
+		if (FAILED(hr))
+			return hr;
+		hr = g_pd3dDevice->CreateShaderResourceView(pTexture, nullptr, &g_pTextureSRV);
+		pTexture->Release();
+		if (FAILED(hr))
+			return hr;
+	}
 
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(WORD) * 36;
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.CPUAccessFlags = 0;
-	InitData.pSysMem = indices;
-	hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, &g_pIndexBuffer);
+	D3D11_SAMPLER_DESC sd;
+	ZeroMemory(&sd, sizeof(sd));
+	sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sd.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	sd.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	sd.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sd.MinLOD = 0;
+	sd.MaxLOD = D3D11_FLOAT32_MAX;
+	hr = g_pd3dDevice->CreateSamplerState(&sd, &g_pSamplerLinear);
 	if (FAILED(hr))
 		return hr;
 
-	// Set index buffer
-	g_pImmediateContext->IASetIndexBuffer(g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-
 	// Set primitive topology
 	g_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
@@ -529,6 +1428,74 @@ HRESULT InitDevice()
 	if (FAILED(hr))
 		return hr;
 
+	// The mesh's vertex decode, which never changes.
+	const MeshVertexDecode& decode = mesh.Decode();
+	MeshDecodeCB decodeCB;
+	decodeCB.PositionScale = XMFLOAT4(decode.PositionScale[0], decode.PositionScale[1], decode.PositionScale[2], 0.0f);
+	decodeCB.PositionOffset = XMFLOAT4(decode.PositionOffset[0], decode.PositionOffset[1], decode.PositionOffset[2], 0.0f);
+	decodeCB.TexcoordScaleOffset = XMFLOAT4(decode.TexcoordScale[0], decode.TexcoordScale[1], decode.TexcoordOffset[0], decode.TexcoordOffset[1]);
+	bd.Usage = D3D11_USAGE_IMMUTABLE;
+	bd.ByteWidth = sizeof(MeshDecodeCB);
+	InitData.pSysMem = &decodeCB;
+	hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, &g_pMeshDecodeCB);
+	if (FAILED(hr))
+		return hr;
+
+	// The -objects scene, drawn through the same SharedCB, and with -instanced
+	// an instance buffer big enough for all of it.
+	if (g_SceneObjects > 0)
+	{
+		STARTUP_STEP("CreateScene");
+		GenerateScene(g_SceneLayout, g_SceneObjects, 1, &g_Scene);
+		g_Scene.Meshes = sceneMeshes;
+		g_Scene.UpdateBounds();
+
+		if (g_SceneLod)
+		{
+			StereoLodConfig lodConfig = DefaultStereoLodConfig();
+			lodConfig.ViewportHeight = (float)g_ScreenHeight;
+			g_SceneRenderer.SetLodConfig(lodConfig);
+			g_SceneRenderer.SetLod(true);
+		}
+
+		// The cubes only spin in place, so their bounds never change and the
+		// tree never needs a refit.
+		if (g_SceneUseBvh)
+		{
+			const SceneBounds& bounds = g_Scene.Bounds;
+			g_SceneBvh.Build(&bounds.CenterX[0], &bounds.CenterY[0], &bounds.CenterZ[0], &bounds.Radius[0],
+				(uint32_t)g_Scene.Objects.size());
+			g_SceneRenderer.SetCullIndex(&g_SceneBvh);
+		}
+
+		// The sort only takes the pool's threads for a frame's worth of draws.
+		if (g_SceneMode == SCENE_SUBMIT_SORTED)
+		{
+			g_pSortPool = new WorkerPool(WorkerPool::DefaultWorkers());
+			g_SceneRenderer.SetSortPool(g_pSortPool);
+		}
+
+		UINT maxInstances = (g_SceneMode == SCENE_SUBMIT_INSTANCED) ? g_SceneObjects : 0;
+		g_pSceneBackend = new D3D11RenderBackend();
+		hr = g_pSceneBackend->Init(g_pd3dDevice, g_pImmediateContext, g_pSharedCB, maxInstances);
+		if (FAILED(hr))
+			return hr;
+		if (g_pCullIndirectShader)
+		{
+			hr = g_pSceneBackend->InitIndirect(g_pCullIndirectShader);
+			if (FAILED(hr))
+				return hr;
+		}
+
+		if (maxInstances > 0)
+		{
+			ID3D11Buffer* pInstanceBuffer = g_pSceneBackend->GetInstanceBuffer();
+			UINT instanceStride = g_pSceneBackend->GetInstanceStride();
+			UINT instanceOffset = 0;
+			g_pImmediateContext->IASetVertexBuffers(1, 1, &pInstanceBuffer, &instanceStride, &instanceOffset);
+		}
+	}
+
 	// Initialize the world matrix
 	g_World = XMMatrixIdentity();
 
@@ -544,6 +1511,10 @@ HRESULT InitDevice()
 	// so this needs to be only ScreenWidth, one per eye.
 	g_Projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)g_ScreenWidth / (float)g_ScreenHeight, 0.01f, 100.0f);
 
+	// Per-eye GPU timing, falls back to CPU timing if the device has no timestamp queries.
+	STARTUP_STEP("CreateGpuTimer");
+	g_pGpuTimer = CreateGpuTimer(g_pd3dDevice, g_pImmediateContext);
+
 	return S_OK;
 }
 
@@ -555,14 +1526,52 @@ void CleanupDevice()
 {
 	if (g_pSwapChain) g_pSwapChain->SetFullscreenState(FALSE, nullptr);
 
+	delete g_pPresenter;
+	g_pPresenter = nullptr;
+
+	delete g_pGpuTimer;
+	g_pGpuTimer = nullptr;
+
+	if (g_pSceneBackend)
+		g_SceneMultiDraw = g_pSceneBackend->GetMultiDraw();
+	delete g_pSceneBackend;
+	g_pSceneBackend = nullptr;
+
+	g_SceneRenderer.SetSortPool(nullptr);
+	delete g_pSortPool;
+	g_pSortPool = nullptr;
+
+	ReleaseShaders();
+
+	// The streamer first, its loader thread may still be filling the ring.
+	if (g_pMeshStreamer)
+		g_MeshStreamStats = g_pMeshStreamer->Stats();
+	delete g_pMeshStreamer;
+	g_pMeshStreamer = nullptr;
+	delete g_pMeshStreamSink;
+	g_pMeshStreamSink = nullptr;
+
+	if (g_pTextureStreamer)
+		g_TextureStreamStats = g_pTextureStreamer->Stats();
+	delete g_pTextureStreamer;
+	g_pTextureStreamer = nullptr;
+	delete g_pTextureStreamSink;
+	g_pTextureStreamSink = nullptr;
+
 	if (g_pImmediateContext) g_pImmediateContext->ClearState();
 
 	if (g_pSharedCB) g_pSharedCB->Release();
+	if (g_pMeshDecodeCB) g_pMeshDecodeCB->Release();
 	if (g_pVertexBuffer) g_pVertexBuffer->Release();
 	if (g_pIndexBuffer) g_pIndexBuffer->Release();
 	if (g_pVertexLayout) g_pVertexLayout->Release();
+	if (g_pInstancedLayout) g_pInstancedLayout->Release();
+	if (g_pTextureSRV) g_pTextureSRV->Release();
+	if (g_pSamplerLinear) g_pSamplerLinear->Release();
 
 	if (g_pVertexShader) g_pVertexShader->Release();
+	if (g_pInstancedVertexShader) g_pInstancedVertexShader->Release();
+	if (g_pCullIndirectShader) g_pCullIndirectShader->Release();
 	if (g_pPixelShader) g_pPixelShader->Release();
 	if (g_pDepthStencil) g_pDepthStencil->Release();
 	if (g_pDepthStencilView) g_pDepthStencilView->Release();
@@ -608,9 +1617,13 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 //--------------------------------------------------------------------------------------
 // Render current image, eye independent.  
+//
+// The eye is only used to label the GPU timings.
 //--------------------------------------------------------------------------------------
-void Render()
+void Render(UINT eye)
 {
+	g_pGpuTimer->Begin(eye, GPU_STAGE_CLEAR);
+
 	//
 	// Clear the back buffer
 	//
@@ -626,15 +1639,50 @@ void Render()
 	//
 	g_pImmediateContext->ClearDepthStencilView(g_pDepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
 
+	g_pGpuTimer->End(eye, GPU_STAGE_CLEAR);
+	g_pGpuTimer->Begin(eye, GPU_STAGE_DRAW);
+
 	//
 	// Render the cube
 	//
 	// Projection matrix in g_pSharedCB determines eye view.
 	//
 	g_pImmediateContext->VSSetShader(g_pVertexShader, nullptr, 0);
-	g_pImmediateContext->VSSetConstantBuffers(0, 1, &g_pSharedCB);
+	ID3D11Buffer* vsConstants[] = { g_pSharedCB, g_pMeshDecodeCB };
+	g_pImmediateContext->VSSetConstantBuffers(0, ARRAYSIZE(vsConstants), vsConstants);
 	g_pImmediateContext->PSSetShader(g_pPixelShader, nullptr, 0);
-	g_pImmediateContext->DrawIndexed(36, 0, 0);
+	ID3D11ShaderResourceView* pTextureSRV = g_pTextureStreamSink ? g_pTextureStreamSink->GetShaderResourceView(g_StreamedTexture) : g_pTextureSRV;
+	g_pImmediateContext->PSSetShaderResources(0, 1, &pTextureSRV);
+	g_pImmediateContext->PSSetSamplers(0, 1, &g_pSamplerLinear);
+	if (!g_MeshReady)
+	{
+		// -stream, nothing to draw until the mesh is resident.
+	}
+	else if (!g_Meshlets.Meshlets.empty())
+	{
+		// The draws RenderFrame culled down to, one per run of visible meshlets.
+		for (size_t d = 0; d < g_MeshletDraws.size(); d++)
+		{
+			const MeshletDraw& draw = g_MeshletDraws[d];
+			g_pImmediateContext->DrawIndexed(draw.IndexCount, draw.StartIndex, g_Meshlets.Groups[draw.Group].BaseVertex);
+			STEREO_AUDIT_DRAW(g_StereoAudit, g_StereoHandle, "Meshlets");
+		}
+	}
+	else if (g_Scene.Objects.empty())
+	{
+		g_pImmediateContext->DrawIndexed(g_Mesh.IndexCount, g_Mesh.StartIndex, g_Mesh.BaseVertex);
+		STEREO_AUDIT_DRAW(g_StereoAudit, g_StereoHandle, "Cube");
+	}
+	else
+	{
+		// The scene sets SharedCB itself, per object or once for the instances.
+		if (g_SceneMode == SCENE_SUBMIT_INSTANCED || g_SceneMode == SCENE_SUBMIT_INDIRECT)
+			g_pImmediateContext->VSSetShader(g_pInstancedVertexShader, nullptr, 0);
+		// The backend audits each of the scene's draws.
+		g_SceneRenderer.DrawEye(g_Scene, g_SceneView, eye, g_pSceneBackend);
+	}
+
+	g_pGpuTimer->End(eye, GPU_STAGE_DRAW);
 }
 
 
@@ -643,6 +1691,86 @@ void Render()
 //--------------------------------------------------------------------------------------
 void RenderFrame()
 {
+	PROFILE_ZONE("RenderFrame");
+
+	//
+	// Frame time is start to start, so the previous frame's sample is only
+	// complete now.
+	//
+	static FrameSample s_Sample;
+	static uint64_t s_FrameStartNs = 0;
+
+	uint64_t frameStartNs = GetTimeNs();
+	if (s_FrameStartNs != 0)
+	{
+		s_Sample.FrameNs = frameStartNs - s_FrameStartNs;
+		g_FrameStats.Record(s_Sample);
+	}
+	s_FrameStartNs = frameStartNs;
+	s_Sample.EyeNs[0] = 0;
+	s_Sample.EyeNs[1] = 0;
+
+	//
+	// Wait until the display can take another frame, so the frame starts with
+	// the freshest input and the queue stays at the configured latency.
+	// Does nothing without the waitable object.
+	//
+	{
+		PROFILE_ZONE("WaitForNextFrame");
+		g_pPresenter->WaitForNextFrame(1000);
+	}
+
+	//
+	// Flip model unbinds the back buffer at Present, so it is bound every frame.
+	//
+	g_pImmediateContext->OMSetRenderTargets(1, &g_pRenderTargetView, g_pDepthStencilView);
+
+	//
+	// -stream uploads what the loader has read so far, within its budget, and
+	// binds the buffers once the whole mesh is in.
+	//
+	uint64_t uploadBytes = 0;
+	if (g_pMeshStreamer)
+	{
+		PROFILE_ZONE("MeshStream");
+		g_pMeshStreamer->Update();
+		if (!g_MeshReady && g_pMeshStreamer->IsResident(g_StreamedMesh))
+		{
+			const MeshFileHeader& header = g_pMeshStreamSink->Header(g_StreamedMesh);
+			ID3D11Buffer* pVertexBuffer = g_pMeshStreamSink->GetVertexBuffer(g_StreamedMesh);
+			UINT stride = header.VertexStride;
+			UINT offset = 0;
+			g_pImmediateContext->IASetVertexBuffers(0, 1, &pVertexBuffer, &stride, &offset);
+			g_pImmediateContext->IASetIndexBuffer(g_pMeshStreamSink->GetIndexBuffer(g_StreamedMesh),
+				(header.IndexBytes == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+			g_MeshReady = true;
+
+			char message[128];
+			sprintf_s(message, "-stream: mesh resident after %.1f ms\n", (double)(GetTimeNs() - g_StreamStartNs) / 1e6);
+			OutputDebugStringA(message);
+		}
+		if (g_MeshReady)
+			g_pMeshStreamer->Touch(g_StreamedMesh);
+		uploadBytes += g_pMeshStreamSink->TakeUploadBytes();
+	}
+
+	//
+	// -texture asks for the mip the mesh needs at its size on screen, the
+	// mesh's diameter over its distance from the camera in pixels, which both
+	// eyes share.  Update loads toward it within the upload budget.
+	//
+	if (g_pTextureStreamer)
+	{
+		PROFILE_ZONE("TextureStream");
+		float distance = XMVectorGetZ(g_View.r[3]);
+		float pixels = 2.0f * g_Mesh.Radius * 0.5f * (float)g_ScreenHeight * XMVectorGetY(g_Projection.r[1]) /
+			((distance > 0.01f) ? distance : 0.01f);
+		const TextureFileHeader& header = g_pTextureStreamer->Header(g_StreamedTexture);
+		g_pTextureStreamer->Request(g_StreamedTexture, TextureMipForScreenSize(header, pixels));
+		g_pTextureStreamer->Update();
+		uploadBytes += g_pTextureStreamSink->TakeUploadBytes();
+	}
+
 	//
 	// Rotate cube around the origin
 	//
@@ -654,6 +1782,8 @@ void RenderFrame()
 	// the 3D settings.
 	// The variable names are a bit misleading at present.
 	//
+	g_pGpuTimer->BeginFrame();
+
 	NvAPI_Status status;
 	SharedCB cb;
 	float pConvergence;
@@ -667,6 +1797,47 @@ void RenderFrame()
 	float separation = pEyeSeparation * pSeparationPercentage / 100;
 	float convergence = pEyeSeparation * pSeparationPercentage / 100 * pConvergence;
 
+	//
+	// A -objects scene builds its world matrices, and with -lod picks its LODs,
+	// once for both eyes, and the instanced one uploads them here too.
+	//
+	if (!g_Scene.Objects.empty())
+	{
+		static_assert(sizeof(XMMATRIX) == sizeof(SMMatrix), "Same layout, copied as is");
+		memcpy(&g_SceneView.View, &g_View, sizeof(SMMatrix));
+		memcpy(&g_SceneView.Projection, &g_Projection, sizeof(SMMatrix));
+		g_SceneView.Separation = separation;
+		g_SceneView.Convergence = convergence;
+		g_SceneRenderer.PrepareFrame(g_Scene, g_SceneView, GetTickCount64() / 1000.0f, g_SceneMode, g_pSceneBackend);
+		if (g_SceneRenderer.GetLod())
+		{
+			const StereoLodStats& lod = g_SceneRenderer.LodStats();
+			g_LodFrames++;
+			g_LodTriangles += lod.Triangles;
+			g_LodFullTriangles += lod.FullTriangles;
+			g_LodChanges += lod.Changes;
+		}
+	}
+
+	//
+	// -meshlets culls once for both eyes too, in mesh space.
+	//
+	if (!g_Meshlets.Meshlets.empty())
+	{
+		PROFILE_ZONE("CullMeshlets");
+		SMMatrix world, view, projection;
+		memcpy(&world, &g_World, sizeof(SMMatrix));
+		memcpy(&view, &g_View, sizeof(SMMatrix));
+		memcpy(&projection, &g_Projection, sizeof(SMMatrix));
+		MeshletCullSpace space;
+		BuildMeshletCullSpace(world, view, projection, separation, convergence, &space);
+
+		MeshletCullStats stats;
+		uint32_t visible = CullMeshlets(g_Meshlets, space, &g_MeshletVisible[0], &stats);
+		BuildMeshletDraws(g_Meshlets, &g_MeshletVisible[0], visible, &g_MeshletDraws);
+		g_MeshletFrames++;
+		g_MeshletTrianglesCulled += stats.TrianglesCulled;
+	}
 
 	//
 	// Drawing same object twice, once for each eye.
@@ -678,6 +1849,9 @@ void RenderFrame()
 	status = NvAPI_Stereo_SetActiveEye(g_StereoHandle, NVAPI_STEREO_EYE_LEFT);
 	if (SUCCEEDED(status))
 	{
+		PROFILE_ZONE("LeftEye");
+		uint64_t eyeStartNs = GetTimeNs();
+
 		cb.mWorld = XMMatrixTranspose(g_World);
 		cb.mView = XMMatrixTranspose(g_View);
 
@@ -686,13 +1860,18 @@ void RenderFrame()
 		cb.mProjection._41 = convergence;
 		cb.mProjection = XMMatrixTranspose(cb.mProjection);
 		g_pImmediateContext->UpdateSubresource(g_pSharedCB, 0, nullptr, &cb, 0, 0);
+		uploadBytes += sizeof(SharedCB);
 
-		Render();
+		Render(0);
+		s_Sample.EyeNs[0] = GetTimeNs() - eyeStartNs;
 	}
 
 	status = NvAPI_Stereo_SetActiveEye(g_StereoHandle, NVAPI_STEREO_EYE_RIGHT);
 	if (SUCCEEDED(status))
 	{
+		PROFILE_ZONE("RightEye");
+		uint64_t eyeStartNs = GetTimeNs();
+
 		cb.mWorld = XMMatrixTranspose(g_World);
 		cb.mView = XMMatrixTranspose(g_View);
 
@@ -701,15 +1880,62 @@ void RenderFrame()
 		cb.mProjection._41 = -convergence;
 		cb.mProjection = XMMatrixTranspose(cb.mProjection);
 		g_pImmediateContext->UpdateSubresource(g_pSharedCB, 0, nullptr, &cb, 0, 0);
+		uploadBytes += sizeof(SharedCB);
 
-		Render();
+		Render(1);
+		s_Sample.EyeNs[1] = GetTimeNs() - eyeStartNs;
 	}
 
+	g_pGpuTimer->EndFrame();
+	if (!g_Scene.Objects.empty())
+		uploadBytes += g_pSceneBackend->TakeUploadBytes();
+
 	//
 	// Present our back buffer to our front buffer
 	//
 	// In stereo mode, the driver knows to use the 2x width buffer, and
 	// present each eye in order.
 	//
-	g_pSwapChain->Present(0, 0);
+	{
+		PROFILE_ZONE("Present");
+		g_pPresenter->Present(g_SwapChainConfig.SyncInterval);
+	}
+	g_PresentTracker.OnPresent(g_pPresenter->GetLastPresentCount(), g_pPresenter->NowNs());
+
+	PresentStatistics presentStats;
+	if (g_pPresenter->GetFrameStatistics(&presentStats))
+		g_PresentTracker.OnStatistics(presentStats);
+
+	//
+	// Publish for external monitors.  Frame time is the previous frame's, the
+	// same one just handed to g_FrameStats, eye times are this frame's.
+	//
+	static uint64_t s_FrameIndex = 0;
+	g_UploadBytesTotal += uploadBytes;
+	if (g_LiveMetrics.IsOpen())
+	{
+		LiveMetricsSnapshot metrics;
+		metrics.FrameIndex = s_FrameIndex;
+		metrics.TimestampNs = GetTimeNs();
+		metrics.FrameNs = s_Sample.FrameNs;
+		metrics.Convergence = pConvergence;
+		metrics.Separation = pSeparationPercentage;
+		metrics.EyeSeparation = pEyeSeparation;
+		metrics.UploadBytesFrame = uploadBytes;
+		metrics.UploadBytesTotal = g_UploadBytesTotal;
+		for (UINT eye = 0; eye < 2; eye++)
+		{
+			metrics.EyeCpuNs[eye] = s_Sample.EyeNs[eye];
+			metrics.EyeGpuNs[eye] = g_pGpuTimer->GetEyeWindow(eye).Last();
+		}
+
+		static_assert(NVSHIM_COUNT <= kLiveMetricsNvapiSlots, "Bump kLiveMetricsNvapiSlots and the version");
+		uint64_t calls[NVSHIM_COUNT];
+		NvapiShimGetThreadCalls(calls);
+		memset(metrics.NvapiCalls, 0, sizeof(metrics.NvapiCalls));
+		memcpy(metrics.NvapiCalls, calls, sizeof(calls));
+
+		g_LiveMetrics.Publish(metrics);
+	}
+	s_FrameIndex++;
 }
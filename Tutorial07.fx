@@ -15,6 +15,28 @@ cbuffer cbShared : register( b0 )
 	matrix Projection;
 };
 
+// Undoes the mesh file's vertex quantization, see MeshVertexDecode in
+// MeshFile.h.  Scale 1 and offset 0 for float vertices.
+cbuffer cbMeshDecode : register( b1 )
+{
+	float4 PositionScale;
+	float4 PositionOffset;
+	float4 TexcoordScaleOffset;
+};
+
+// -indirect's cull pass, see IndirectDraw.h.  The union of both eyes' frusta,
+// planes as ( normal, d ), and the time the objects spin by.
+cbuffer cbIndirectCull : register( b2 )
+{
+	float4 CullPlanes[6];
+	float CullTime;
+	uint CullObjectCount;
+};
+
+// The mesh's texture, a streamed file or the built in checker.
+Texture2D txDiffuse : register( t0 );
+SamplerState samLinear : register( s0 );
+
 
 //--------------------------------------------------------------------------------------
 struct VS_INPUT
@@ -23,12 +45,62 @@ struct VS_INPUT
     float2 Tex : TEXCOORD0;
 };
 
+// VSInstanced, the world matrix rows come from the instance buffer.
+struct VS_INSTANCED_INPUT
+{
+    float4 Pos : POSITION;
+    float2 Tex : TEXCOORD0;
+    float4 World0 : WORLD0;
+    float4 World1 : WORLD1;
+    float4 World2 : WORLD2;
+    float4 World3 : WORLD3;
+};
+
 struct PS_INPUT
 {
     float4 Pos : SV_POSITION;
     float2 Tex : TEXCOORD0;
 };
 
+// IndirectObject in IndirectDraw.h.
+struct IndirectObject
+{
+    float3 Position;
+    float Radius;
+    float Scale;
+    float Phase;
+    uint Draw;
+    uint Pad;
+};
+
+StructuredBuffer<IndirectObject> IndirectObjects : register( t1 );
+RWByteAddressBuffer IndirectArgs : register( u0 );		// D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, 20 bytes each
+RWByteAddressBuffer IndirectInstances : register( u1 );	// World matrix rows, as VSInstanced reads them
+
+
+//--------------------------------------------------------------------------------------
+// Vertex decode
+//--------------------------------------------------------------------------------------
+float4 DecodePosition( float4 pos )
+{
+    return float4( pos.xyz * PositionScale.xyz + PositionOffset.xyz, 1 );
+}
+
+float2 DecodeTexcoord( float2 tex )
+{
+    return tex * TexcoordScaleOffset.xy + TexcoordScaleOffset.zw;
+}
+
+// Two SNORM16 values back to a unit vector, for octahedral normals.  The same
+// as OctahedralDecode in VertexQuantize.h.
+float3 DecodeOctahedral( float2 e )
+{
+    float3 n = float3( e.xy, 1 - abs( e.x ) - abs( e.y ) );
+    if ( n.z < 0 )
+        n.xy = ( 1 - abs( n.yx ) ) * ( n.xy >= 0 ? 1 : -1 );
+    return normalize( n );
+}
+
 
 //--------------------------------------------------------------------------------------
 // Vertex Shader
@@ -36,19 +108,73 @@ struct PS_INPUT
 PS_INPUT VS( VS_INPUT input )
 {
     PS_INPUT output = (PS_INPUT)0;
-    output.Pos = mul( input.Pos, World );
+    output.Pos = mul( DecodePosition( input.Pos ), World );
     output.Pos = mul( output.Pos, View );
     output.Pos = mul( output.Pos, Projection );
-    output.Tex = input.Tex;
+    output.Tex = DecodeTexcoord( input.Tex );
     
     return output;
 }
 
 
+//--------------------------------------------------------------------------------------
+// Vertex Shader, instanced
+//
+// The instance rows are uploaded untransposed, so unlike World in the constant
+// buffer they build the matrix as is.
+//--------------------------------------------------------------------------------------
+PS_INPUT VSInstanced( VS_INSTANCED_INPUT input )
+{
+    float4x4 world = float4x4( input.World0, input.World1, input.World2, input.World3 );
+
+    PS_INPUT output = (PS_INPUT)0;
+    output.Pos = mul( DecodePosition( input.Pos ), world );
+    output.Pos = mul( output.Pos, View );
+    output.Pos = mul( output.Pos, Projection );
+    output.Tex = DecodeTexcoord( input.Tex );
+
+    return output;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Pixel Shader
 //--------------------------------------------------------------------------------------
 float4 PS( PS_INPUT input) : SV_Target
 {
-    return float4(0.5, 0.5, 0.5, 1);
+    return txDiffuse.Sample( samLinear, input.Tex );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Indirect cull, one thread per object
+//
+// A visible object takes the next instance of its mesh's argument record and
+// writes its world matrix there, built as SceneRenderer builds it.
+// EmulateIndirectCull in IndirectDraw.cpp is the same on the CPU.
+//--------------------------------------------------------------------------------------
+[numthreads( 64, 1, 1 )]
+void CullIndirect( uint3 id : SV_DispatchThreadID )
+{
+    if ( id.x >= CullObjectCount )
+        return;
+
+    IndirectObject o = IndirectObjects[id.x];
+    for ( int p = 0; p < 6; p++ )
+    {
+        if ( dot( o.Position, CullPlanes[p].xyz ) + CullPlanes[p].w < -o.Radius )
+            return;
+    }
+
+    uint record = o.Draw * 20;
+    uint slot;
+    IndirectArgs.InterlockedAdd( record + 4, 1, slot );
+    uint address = ( IndirectArgs.Load( record + 16 ) + slot ) * 64;
+
+    float s = sin( CullTime + o.Phase ) * o.Scale;
+    float c = cos( CullTime + o.Phase ) * o.Scale;
+    IndirectInstances.Store4( address, asuint( float4( c, 0, -s, 0 ) ) );
+    IndirectInstances.Store4( address + 16, asuint( float4( 0, o.Scale, 0, 0 ) ) );
+    IndirectInstances.Store4( address + 32, asuint( float4( s, 0, c, 0 ) ) );
+    IndirectInstances.Store4( address + 48, asuint( float4( o.Position, 1 ) ) );
 }
@@ -0,0 +1 @@
+#include "Tutorial07.fx"
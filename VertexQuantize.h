@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// File: VertexQuantize.h
+//
+// The scalar encodings behind the quantized mesh vertex formats, each the
+// exact inverse of what the input assembler does when it reads the format,
+// so the CPU side can measure the error the GPU will see.
+//
+// UNORM16 is q / 65535.  Half is IEEE binary16, rounded to nearest even.
+// Octahedral normals fold the unit sphere onto the [-1, 1] square, two SNORM16
+// values, which the input assembler reads as q / 32767 clamped to -1; the
+// shader unfolds them with OctahedralDecode in Tutorial07.fx.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+
+inline uint16_t QuantizeUnorm16(float value)
+{
+	if (!(value > 0.0f))
+		return 0;
+	if (value >= 1.0f)
+		return 0xFFFF;
+	return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+inline float DequantizeUnorm16(uint16_t q)
+{
+	return (float)q / 65535.0f;
+}
+
+inline int16_t QuantizeSnorm16(float value)
+{
+	if (value >= 1.0f)
+		return 32767;
+	if (!(value > -1.0f))
+		return -32767;
+	return (int16_t)floorf(value * 32767.0f + 0.5f);
+}
+
+inline float DequantizeSnorm16(int16_t q)
+{
+	float value = (float)q / 32767.0f;
+	return (value < -1.0f) ? -1.0f : value;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Half floats.  Overflow goes to infinity, and values below the smallest normal
+// to denormals, as DXGI_FORMAT_R16_FLOAT holds them.
+//--------------------------------------------------------------------------------------
+inline uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	if (magnitude >= 0x7F800000)						// Infinity and NaN
+		return (uint16_t)(sign | 0x7C00 | ((magnitude > 0x7F800000) ? 0x200 : 0));
+	if (magnitude >= 0x477FF000)						// Rounds past 65504
+		return (uint16_t)(sign | 0x7C00);
+	if (magnitude < 0x38800000)							// Below 2^-14
+	{
+		float a;
+		memcpy(&a, &magnitude, sizeof(a));
+		float scaled = a * 16777216.0f;					// Exact, in units of 2^-24
+		uint32_t denormal = (uint32_t)scaled;
+		float rest = scaled - (float)denormal;
+		if (rest > 0.5f || (rest == 0.5f && (denormal & 1)))
+			denormal++;
+		return (uint16_t)(sign | denormal);
+	}
+
+	uint32_t half = (magnitude - 0x38000000) >> 13;
+	uint32_t rest = magnitude & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+	return (uint16_t)(sign | half);
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		float value = (float)mantissa / 16777216.0f;
+		return sign ? -value : value;
+	}
+	if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Octahedral unit vectors.  n need not be normalized; the decode is.
+//--------------------------------------------------------------------------------------
+inline void OctahedralEncode(const float n[3], int16_t encoded[2])
+{
+	float length = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	if (length <= 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float u = n[0] / length;
+	float v = n[1] / length;
+	if (n[2] < 0.0f)
+	{
+		float foldedU = (1.0f - fabsf(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+		float foldedV = (1.0f - fabsf(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+	encoded[0] = QuantizeSnorm16(u);
+	encoded[1] = QuantizeSnorm16(v);
+}
+
+inline void OctahedralDecode(const int16_t encoded[2], float n[3])
+{
+	float u = DequantizeSnorm16(encoded[0]);
+	float v = DequantizeSnorm16(encoded[1]);
+	float z = 1.0f - fabsf(u) - fabsf(v);
+	if (z < 0.0f)
+	{
+		float unfoldedU = (1.0f - fabsf(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+		float unfoldedV = (1.0f - fabsf(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
+		u = unfoldedU;
+		v = unfoldedV;
+	}
+
+	float length = sqrtf(u * u + v * v + z * z);
+	n[0] = u / length;
+	n[1] = v / length;
+	n[2] = z / length;
+}
@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------
+// File: WorkerPool.cpp
+//
+// Chunked parallel loops.
+//--------------------------------------------------------------------------------------
+
+#include "WorkerPool.h"
+
+
+WorkerPool::WorkerPool(uint32_t workers)
+	: m_Next(0)
+{
+	m_Generation = 0;
+	m_Busy = 0;
+	m_Quit = false;
+	m_Task = nullptr;
+	m_pContext = nullptr;
+	m_Count = 0;
+	m_Grain = 1;
+
+	for (uint32_t i = 0; i < workers; i++)
+		m_Threads.push_back(std::thread(&WorkerPool::ThreadMain, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_Wake.notify_all();
+	for (size_t i = 0; i < m_Threads.size(); i++)
+		m_Threads[i].join();
+}
+
+uint32_t WorkerPool::DefaultWorkers()
+{
+	uint32_t cores = std::thread::hardware_concurrency();
+	return (cores > 1) ? cores - 1 : 0;
+}
+
+void WorkerPool::RunChunks()
+{
+	for (;;)
+	{
+		uint32_t begin = m_Next.fetch_add(m_Grain);
+		if (begin >= m_Count)
+			return;
+		uint32_t end = (m_Count - begin > m_Grain) ? begin + m_Grain : m_Count;
+		m_Task(m_pContext, begin, end);
+	}
+}
+
+void WorkerPool::ThreadMain()
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			while (!m_Quit && m_Generation == seen)
+				m_Wake.wait(lock);
+			if (m_Quit)
+				return;
+			seen = m_Generation;
+		}
+
+		RunChunks();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (--m_Busy == 0)
+			m_Done.notify_one();
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Small ranges aren't worth waking anyone for.
+//--------------------------------------------------------------------------------------
+void WorkerPool::ParallelFor(uint32_t count, uint32_t grain, WorkerTask task, void* pContext)
+{
+	if (grain == 0)
+		grain = 1;
+	if (m_Threads.empty() || count <= grain)
+	{
+		if (count > 0)
+			task(pContext, 0, count);
+		return;
+	}
+
+	Begin(count, grain, task, pContext);
+	Wait();
+}
+
+void WorkerPool::Begin(uint32_t count, uint32_t grain, WorkerTask task, void* pContext)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Task = task;
+		m_pContext = pContext;
+		m_Count = count;
+		m_Grain = (grain > 0) ? grain : 1;
+		m_Next.store(0);
+		if (m_Threads.empty())
+			return;
+		m_Busy = (uint32_t)m_Threads.size();
+		m_Generation++;
+	}
+	m_Wake.notify_all();
+}
+
+void WorkerPool::Wait()
+{
+	if (m_Task)
+		RunChunks();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (m_Busy != 0)
+		m_Done.wait(lock);
+	m_Task = nullptr;
+}
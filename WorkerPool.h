@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// File: WorkerPool.h
+//
+// A few persistent threads for splitting a loop across cores.
+//
+// ParallelFor hands out chunks of the range from an atomic counter, so a
+// thread that finishes early just takes the next chunk.  The calling thread
+// works too, and the call returns when every chunk is done.  Begin and Wait
+// are the same split in two, for a caller with something else to do while
+// the workers start.  One loop at a time, from one thread.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Runs items [begin, end).
+typedef void (*WorkerTask)(void* pContext, uint32_t begin, uint32_t end);
+
+
+class WorkerPool
+{
+public:
+	// Threads besides the caller's, 0 runs everything on the caller.
+	explicit WorkerPool(uint32_t workers);
+	~WorkerPool();
+
+	// Including the caller.
+	uint32_t ThreadCount() const { return (uint32_t)m_Threads.size() + 1; }
+
+	void ParallelFor(uint32_t count, uint32_t grain, WorkerTask task, void* pContext);
+
+	// Hands the range to the workers and returns at once.  Wait runs whatever
+	// they haven't taken on the caller, and returns when every chunk is done,
+	// so with no workers it all runs in Wait.  Every Begin needs its Wait.
+	void Begin(uint32_t count, uint32_t grain, WorkerTask task, void* pContext);
+	void Wait();
+
+	// One worker per core besides the caller's.
+	static uint32_t DefaultWorkers();
+
+private:
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+
+	void ThreadMain();
+	void RunChunks();
+
+	std::vector<std::thread> m_Threads;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::condition_variable m_Done;
+	uint64_t m_Generation;			// Bumped for each ParallelFor
+	uint32_t m_Busy;				// Workers still in the current one
+	bool m_Quit;
+
+	WorkerTask m_Task;
+	void* m_pContext;
+	uint32_t m_Count;
+	uint32_t m_Grain;
+	std::atomic<uint32_t> m_Next;
+};